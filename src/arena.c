@@ -0,0 +1,106 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static char* block_data(ArenaBlock* block) {
+    return (char*)block + ARENA_HEADER_SIZE;
+}
+
+void arena_init(Arena* arena) {
+    arena->head = NULL;
+    arena->next_block_size = ARENA_MIN_BLOCK_SIZE;
+}
+
+void arena_free(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+}
+
+void arena_reset(Arena* arena) {
+    if (arena->head == NULL) {
+        return;
+    }
+    ArenaBlock* keep = arena->head;
+    ArenaBlock* block = keep->next;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    keep->next = NULL;
+    keep->used = 0;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = align_up(size > 0 ? size : 1);
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->size - block->used < size) {
+        size_t block_size = arena->next_block_size;
+        if (block_size < size) {
+            block_size = size;
+        }
+        if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE) {
+            arena->next_block_size *= 2;
+        }
+        block = (ArenaBlock*)malloc(ARENA_HEADER_SIZE + block_size);
+        if (block == NULL) {
+            // callers build syntax trees, operators and results from arena
+            // memory without checking each allocation
+            fprintf(stderr, "error: out of memory allocating %zu bytes.\n", ARENA_HEADER_SIZE + block_size);
+            abort();
+        }
+        block->size = block_size;
+        block->used = 0;
+        block->next = arena->head;
+        arena->head = block;
+    }
+
+    void* memory = block_data(block) + block->used;
+    block->used += size;
+    return memory;
+}
+
+void* arena_calloc(Arena* arena, size_t size) {
+    void* memory = arena_alloc(arena, size);
+    memset(memory, 0, size);
+    return memory;
+}
+
+char* arena_strndup(Arena* arena, const char* text, size_t length) {
+    char* copy = (char*)arena_alloc(arena, length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void* arena_grow(Arena* arena, void* old, size_t old_size, size_t new_size) {
+    ArenaBlock* block = arena->head;
+    if (old != NULL && block != NULL && (char*)old >= block_data(block) && (char*)old < block_data(block) + block->used) {
+        // the last allocation of the current block can simply be extended
+        size_t offset = (size_t)((char*)old - block_data(block));
+        size_t end = align_up(offset + new_size);
+        if (offset + align_up(old_size > 0 ? old_size : 1) == block->used && end <= block->size) {
+            block->used = end;
+            return old;
+        }
+    }
+
+    void* memory = arena_alloc(arena, new_size);
+    if (old != NULL) {
+        memcpy(memory, old, old_size < new_size ? old_size : new_size);
+    }
+    return memory;
+}
@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_MIN_BLOCK_SIZE 4096
+#define ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+
+
+// bump allocator for memory that lives exactly as long as one statement,
+// cursor or result. allocations are never freed one by one; arena_free
+// releases everything at once. blocks double in size up to the maximum,
+// larger requests get a block of their own.
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;        // block allocations come from, older blocks follow
+    size_t next_block_size;
+} Arena;
+
+void arena_init(Arena* arena);
+void arena_free(Arena* arena);
+// drop every allocation but keep the newest block for reuse
+void arena_reset(Arena* arena);
+
+// memory is aligned for any type; arena_calloc zeroes it. these never return
+// NULL: the process aborts if a block cannot be allocated
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_calloc(Arena* arena, size_t size);
+char* arena_strndup(Arena* arena, const char* text, size_t length);
+// grow an array, in place when it is the block's last allocation
+void* arena_grow(Arena* arena, void* old, size_t old_size, size_t new_size);
+
+#endif // ARENA_H
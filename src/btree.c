@@ -1,99 +1,582 @@
 #include "btree.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
-static BTreeLeafNode* find_leaf(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key) {
-    Page* page = buffer_pool_get_page(pool, pager, root_page_id);
+#define BTREE_MAX_MODIFIED_PAGES (3 * (BTREE_MAX_DEPTH + 1))
+
+// pages touched by one structural change. they stay pinned until the change is
+// complete and are then logged together as a single page image record.
+typedef struct {
+    uint32_t page_ids[BTREE_MAX_MODIFIED_PAGES];
+    Page* pages[BTREE_MAX_MODIFIED_PAGES];
+    int count;
+} PageSet;
+
+static Page* page_set_get(PageSet* set, BufferPool* pool, Pager* pager, uint32_t page_id) {
+    for (int i = 0; i < set->count; i++) {
+        if (set->page_ids[i] == page_id) {
+            return set->pages[i];
+        }
+    }
+    if (set->count == BTREE_MAX_MODIFIED_PAGES) {
+        return NULL;
+    }
+    Page* page = buffer_pool_get_page(pool, pager, page_id);
     if (page == NULL) {
         return NULL;
     }
+    set->page_ids[set->count] = page_id;
+    set->pages[set->count] = page;
+    set->count++;
+    return page;
+}
+
+static Page* page_set_new(PageSet* set, BufferPool* pool, Pager* pager, PageType page_type, uint32_t* page_id) {
+    *page_id = pager_allocate_page(pager);
+    Page* page = page_set_get(set, pool, pager, *page_id);
+    if (page != NULL) {
+        page_init(page, page_type);
+    }
+    return page;
+}
 
-    BTreeNodeHeader* header = (BTreeNodeHeader*)page;
-    if (header->is_leaf) {
-        return (BTreeLeafNode*)page;
+static void page_set_release(PageSet* set, BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id) {
+    if (wal != NULL && set->count > 0) {
+        uint64_t lsn = wal_log_page_images(wal, tx_id, set->page_ids, set->pages, set->count);
+        for (int i = 0; i < set->count; i++) {
+            set->pages[i]->header.page_lsn = lsn;
+        }
+    }
+    for (int i = 0; i < set->count; i++) {
+        buffer_pool_unpin_page(pool, pager, set->page_ids[i], 1);
     }
+    set->count = 0;
+}
 
-    BTreeInternalNode* node = (BTreeInternalNode*)page;
+static int child_index(const BTreeInternalNode* node, int key) {
     int i = 0;
-    while (i < node->header.num_keys && key >= node->keys[i]) {
+    while (i < node->header.num_cells && key >= node->keys[i]) {
         i++;
     }
+    return i;
+}
+
+// descend to the leaf that holds key, recording the internal pages on the way.
+// the returned leaf is pinned, the internal pages are not. if upper is not
+// NULL it is set to the lowest separator above the leaf, which every key the
+// leaf may hold is below (INT64_MAX for the last leaf).
+static Page* find_leaf_bounded(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, uint32_t* path, int* depth,
+                               uint32_t* leaf_page_id, int64_t* upper) {
+    uint32_t page_id = root_page_id;
+    *depth = 0;
+    if (upper != NULL) {
+        *upper = INT64_MAX;
+    }
+
+    while (1) {
+        Page* page = buffer_pool_get_page(pool, pager, page_id);
+        if (page == NULL) {
+            return NULL;
+        }
+        if (page->header.page_type != PAGE_TYPE_INTERNAL) {
+            *leaf_page_id = page_id;
+            return page;
+        }
+        if (*depth == BTREE_MAX_DEPTH) {
+            buffer_pool_unpin_page(pool, pager, page_id, 0);
+            fprintf(stderr, "error: b-tree rooted at page %u is too deep.\n", root_page_id);
+            return NULL;
+        }
+
+        BTreeInternalNode* node = (BTreeInternalNode*)page;
+        int index = child_index(node, key);
+        uint32_t child = node->children[index];
+        if (upper != NULL && index < node->header.num_cells && node->keys[index] < *upper) {
+            *upper = node->keys[index];
+        }
+        path[(*depth)++] = page_id;
+        buffer_pool_unpin_page(pool, pager, page_id, 0);
+        page_id = child;
+    }
+}
+
+static Page* find_leaf(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, uint32_t* path, int* depth, uint32_t* leaf_page_id) {
+    return find_leaf_bounded(pool, pager, root_page_id, key, path, depth, leaf_page_id, NULL);
+}
+
+static void leaf_append(Page* page, int key, const char* value, uint16_t length) {
+    page_insert_cell(page, page->header.num_cells, key, value, length);
+}
+
+// add a separator and its right child to the internal node at path[level],
+// splitting upwards as needed. the root keeps its page id on a split.
+static void internal_insert(PageSet* set, BufferPool* pool, Pager* pager, const uint32_t* path, int level, int key, uint32_t right_child) {
+    BTreeInternalNode* node = (BTreeInternalNode*)page_set_get(set, pool, pager, path[level]);
+    if (node == NULL) {
+        return;
+    }
+
+    int num_keys = node->header.num_cells;
+    int pos = child_index(node, key);
+
+    if (num_keys < BTREE_ORDER - 1) {
+        memmove(&node->keys[pos + 1], &node->keys[pos], (num_keys - pos) * sizeof(int));
+        memmove(&node->children[pos + 2], &node->children[pos + 1], (num_keys - pos) * sizeof(uint32_t));
+        node->keys[pos] = key;
+        node->children[pos + 1] = right_child;
+        node->header.num_cells++;
+        return;
+    }
+
+    // node is full, lay out all keys and children before redistributing them
+    int keys[BTREE_ORDER];
+    uint32_t children[BTREE_ORDER + 1];
+    memcpy(keys, node->keys, pos * sizeof(int));
+    keys[pos] = key;
+    memcpy(&keys[pos + 1], &node->keys[pos], (num_keys - pos) * sizeof(int));
+    memcpy(children, node->children, (pos + 1) * sizeof(uint32_t));
+    children[pos + 1] = right_child;
+    memcpy(&children[pos + 2], &node->children[pos + 1], (num_keys - pos) * sizeof(uint32_t));
+
+    int mid = BTREE_ORDER / 2;
+    int separator = keys[mid];
+    uint32_t right_id;
+    BTreeInternalNode* right = (BTreeInternalNode*)page_set_new(set, pool, pager, PAGE_TYPE_INTERNAL, &right_id);
+    if (right == NULL) {
+        return;
+    }
+    right->header.num_cells = BTREE_ORDER - mid - 1;
+    memcpy(right->keys, &keys[mid + 1], right->header.num_cells * sizeof(int));
+    memcpy(right->children, &children[mid + 1], (right->header.num_cells + 1) * sizeof(uint32_t));
+
+    if (level == 0) {
+        // root split: move the left half out as well and leave a single separator behind
+        uint32_t left_id;
+        BTreeInternalNode* left = (BTreeInternalNode*)page_set_new(set, pool, pager, PAGE_TYPE_INTERNAL, &left_id);
+        if (left == NULL) {
+            return;
+        }
+        left->header.num_cells = mid;
+        memcpy(left->keys, keys, mid * sizeof(int));
+        memcpy(left->children, children, (mid + 1) * sizeof(uint32_t));
+
+        node->header.num_cells = 1;
+        node->keys[0] = separator;
+        node->children[0] = left_id;
+        node->children[1] = right_id;
+        return;
+    }
+
+    node->header.num_cells = mid;
+    memcpy(node->keys, keys, mid * sizeof(int));
+    memcpy(node->children, children, (mid + 1) * sizeof(uint32_t));
+    internal_insert(set, pool, pager, path, level - 1, separator, right_id);
+}
+
+// split a full leaf in two by bytes so both halves have room to grow. only
+// moves existing cells; the caller retries its change afterwards.
+static void split_leaf(PageSet* set, BufferPool* pool, Pager* pager, const uint32_t* path, int depth, Page* leaf) {
+    Page original;
+    memcpy(&original, leaf, PAGE_SIZE);
+
+    int total = original.header.num_cells;
+    uint32_t total_bytes = 0;
+    for (int i = 0; i < total; i++) {
+        uint16_t length;
+        page_cell_value(&original, i, &length);
+        total_bytes += length + sizeof(CellPointer);
+    }
+
+    int split = 0;
+    uint32_t left_bytes = 0;
+    while (split < total - 1) {
+        uint16_t length;
+        page_cell_value(&original, split, &length);
+        if (left_bytes + length + sizeof(CellPointer) > total_bytes / 2) {
+            break;
+        }
+        left_bytes += length + sizeof(CellPointer);
+        split++;
+    }
+    if (split == 0) {
+        split = 1;
+    }
+
+    uint32_t right_id;
+    Page* right = page_set_new(set, pool, pager, PAGE_TYPE_LEAF, &right_id);
+    if (right == NULL) {
+        return;
+    }
+    for (int i = split; i < total; i++) {
+        uint16_t length;
+        const char* value = page_cell_value(&original, i, &length);
+        leaf_append(right, page_cell_key(&original, i), value, length);
+    }
+    right->header.next_page_id = original.header.next_page_id;
+
+    Page* left = leaf;
+    uint32_t left_id = 0;
+    if (depth == 0) {
+        // the leaf is the root: its page id is referenced by the catalog, so it
+        // becomes an internal node over two fresh leaves
+        left = page_set_new(set, pool, pager, PAGE_TYPE_LEAF, &left_id);
+        if (left == NULL) {
+            return;
+        }
+    } else {
+        page_init(left, PAGE_TYPE_LEAF);
+        left->header.page_lsn = original.header.page_lsn;
+    }
+    for (int i = 0; i < split; i++) {
+        uint16_t length;
+        const char* value = page_cell_value(&original, i, &length);
+        leaf_append(left, page_cell_key(&original, i), value, length);
+    }
+    left->header.next_page_id = right_id;
 
-    buffer_pool_unpin_page(pool, pager, root_page_id, 0);
-    return find_leaf(pool, pager, node->children[i], key);
+    int separator = page_cell_key(&original, split);
+    if (depth == 0) {
+        BTreeInternalNode* root = (BTreeInternalNode*)leaf;
+        uint64_t page_lsn = original.header.page_lsn;
+        page_init(leaf, PAGE_TYPE_INTERNAL);
+        root->header.page_lsn = page_lsn;
+        root->header.num_cells = 1;
+        root->keys[0] = separator;
+        root->children[0] = left_id;
+        root->children[1] = right_id;
+        return;
+    }
+
+    internal_insert(set, pool, pager, path, depth - 1, separator, right_id);
+}
+
+uint32_t btree_create(BufferPool* pool, Pager* pager, Wal* wal) {
+    PageSet set;
+    set.count = 0;
+
+    uint32_t root_page_id;
+    if (page_set_new(&set, pool, pager, PAGE_TYPE_LEAF, &root_page_id) == NULL) {
+        return 0;
+    }
+    page_set_release(&set, pool, pager, wal, 0);
+    return root_page_id;
+}
+
+int btree_create_at(BufferPool* pool, Pager* pager, Wal* wal, uint32_t page_id) {
+    PageSet set;
+    set.count = 0;
+
+    Page* root = page_set_get(&set, pool, pager, page_id);
+    if (root == NULL) {
+        return -1;
+    }
+    page_init(root, PAGE_TYPE_LEAF);
+    page_set_release(&set, pool, pager, wal, 0);
+    return 0;
 }
 
-char* btree_search(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key) {
-    BTreeLeafNode* leaf = find_leaf(pool, pager, root_page_id, key);
+// returns a malloc'd copy of the value stored under key, or NULL
+char* btree_search(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, uint16_t* length) {
+    uint32_t path[BTREE_MAX_DEPTH];
+    int depth;
+    uint32_t leaf_page_id;
+    Page* leaf = find_leaf(pool, pager, root_page_id, key, path, &depth, &leaf_page_id);
     if (leaf == NULL) {
         return NULL;
     }
 
-    for (int i = 0; i < leaf->header.num_keys; i++) {
-        if (leaf->keys[i] != -1 && leaf->keys[i] == key) {
-            char* value = (char*)malloc(strlen(leaf->values[i]) + 1);
-            strcpy(value, leaf->values[i]);
-            buffer_pool_unpin_page(pool, pager, root_page_id, 0);
-            return value;
+    int found;
+    int slot = page_find_cell(leaf, key, &found);
+    char* value = NULL;
+    if (found) {
+        uint16_t cell_length;
+        const char* cell = page_cell_value(leaf, slot, &cell_length);
+        value = (char*)malloc(cell_length);
+        memcpy(value, cell, cell_length);
+        if (length != NULL) {
+            *length = cell_length;
         }
     }
 
-    buffer_pool_unpin_page(pool, pager, root_page_id, 0);
-    return NULL;
+    buffer_pool_unpin_page(pool, pager, leaf_page_id, 0);
+    return value;
 }
 
-void btree_insert(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, const char* value, int is_transaction_active) {
-    // simplified - no node splits
-    BTreeLeafNode* leaf = find_leaf(pool, pager, root_page_id, key);
-    if (leaf == NULL) {
+// insert or replace the value stored under key
+void btree_insert(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, int key, const char* value, uint16_t length) {
+    if (length > BTREE_MAX_VALUE_SIZE) {
+        fprintf(stderr, "error: value for key %d exceeds %d bytes.\n", key, BTREE_MAX_VALUE_SIZE);
         return;
     }
 
-    // check if key exists for update
-    for (int i = 0; i < leaf->header.num_keys; i++) {
-        if (leaf->keys[i] == key) {
+    // every row change is a single logged record so it can be undone on its
+    // own; when the leaf has no room it is split first and the change retried
+    for (int attempt = 0; attempt < BTREE_MAX_DEPTH; attempt++) {
+        uint32_t path[BTREE_MAX_DEPTH];
+        int depth;
+        uint32_t leaf_page_id;
+        Page* leaf = find_leaf(pool, pager, root_page_id, key, path, &depth, &leaf_page_id);
+        if (leaf == NULL) {
+            return;
+        }
 
-            strcpy(leaf->values[i], value);
-            buffer_pool_unpin_page(pool, pager, root_page_id, 1); 
+        int found;
+        int slot = page_find_cell(leaf, key, &found);
+        if (found) {
+            uint16_t old_length;
+            const char* old_value = page_cell_value(leaf, slot, &old_length);
+            if (page_free_space(leaf) + old_length >= length) {
+                if (wal != NULL) {
+                    leaf->header.page_lsn = wal_log_update(wal, tx_id, root_page_id, leaf_page_id, key, value, length,
+                                                           old_value, old_length);
+                }
+                page_update_cell(leaf, slot, value, length);
+                buffer_pool_unpin_page(pool, pager, leaf_page_id, 1);
+                return;
+            }
+        } else if (page_free_space(leaf) >= length + sizeof(CellPointer)) {
+            if (wal != NULL) {
+                leaf->header.page_lsn = wal_log_insert(wal, tx_id, root_page_id, leaf_page_id, key, value, length);
+            }
+            page_insert_cell(leaf, slot, key, value, length);
+            buffer_pool_unpin_page(pool, pager, leaf_page_id, 1);
             return;
         }
+
+        PageSet set;
+        set.count = 1;
+        set.page_ids[0] = leaf_page_id;
+        set.pages[0] = leaf;
+        split_leaf(&set, pool, pager, path, depth, leaf);
+        page_set_release(&set, pool, pager, wal, tx_id);
     }
+    fprintf(stderr, "error: unable to make room for key %d.\n", key);
+}
 
-    if (leaf->header.num_keys < BTREE_ORDER - 1) {
-        int i = 0;
-        while (i < leaf->header.num_keys && key > leaf->keys[i]) {
+int btree_insert_batch(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, const int* keys,
+                       const char* const* values, const uint16_t* lengths, int count) {
+    int num_writes = 0;
+    int i = 0;
+    while (i < count) {
+        uint32_t path[BTREE_MAX_DEPTH];
+        int depth;
+        uint32_t leaf_page_id;
+        int64_t upper;
+        Page* leaf = find_leaf_bounded(pool, pager, root_page_id, keys[i], path, &depth, &leaf_page_id, &upper);
+        if (leaf == NULL) {
+            return num_writes;
+        }
+
+        // the run of new keys that belong in this leaf and fit in it
+        int end = i;
+        uint32_t free_space = page_free_space(leaf);
+        while (end < count && keys[end] < upper && (end == i || keys[end] > keys[end - 1]) &&
+               lengths[end] <= BTREE_MAX_VALUE_SIZE && free_space >= lengths[end] + sizeof(CellPointer)) {
+            int found;
+            page_find_cell(leaf, keys[end], &found);
+            if (found) {
+                break;
+            }
+            free_space -= lengths[end] + sizeof(CellPointer);
+            end++;
+        }
+        if (end == i) {
+            // an existing key, a full leaf or an oversized value takes the single row path
+            buffer_pool_unpin_page(pool, pager, leaf_page_id, 0);
+            btree_insert(pool, pager, wal, tx_id, root_page_id, keys[i], values[i], lengths[i]);
+            num_writes++;
             i++;
+            continue;
         }
 
-        for (int j = leaf->header.num_keys; j > i; j--) {
-            leaf->keys[j] = leaf->keys[j - 1];
-            strcpy(leaf->values[j], leaf->values[j - 1]);
+        if (wal != NULL) {
+            leaf->header.page_lsn = wal_log_insert_batch(wal, tx_id, root_page_id, leaf_page_id, &keys[i], &values[i],
+                                                         &lengths[i], end - i);
         }
+        for (int j = i; j < end; j++) {
+            int found;
+            int slot = page_find_cell(leaf, keys[j], &found);
+            page_insert_cell(leaf, slot, keys[j], values[j], lengths[j]);
+        }
+        buffer_pool_unpin_page(pool, pager, leaf_page_id, 1);
+        num_writes++;
+        i = end;
+    }
+    return num_writes;
+}
 
-        leaf->keys[i] = key;
-        strcpy(leaf->values[i], value);
-        leaf->header.num_keys++;
-        buffer_pool_unpin_page(pool, pager, root_page_id, 1); 
+int btree_update_batch(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, const int* keys,
+                       const char* const* values, const uint16_t* lengths, int count) {
+    const char** old_values = (const char**)malloc(sizeof(char*) * count);
+    uint16_t* old_lengths = (uint16_t*)malloc(sizeof(uint16_t) * count);
+    if (count > 0 && (old_values == NULL || old_lengths == NULL)) {
+        free(old_values);
+        free(old_lengths);
+        fprintf(stderr, "error: unable to allocate b-tree update batch.\n");
+        return 0;
     }
+
+    int num_writes = 0;
+    int i = 0;
+    while (i < count) {
+        uint32_t path[BTREE_MAX_DEPTH];
+        int depth;
+        uint32_t leaf_page_id;
+        int64_t upper;
+        Page* leaf = find_leaf_bounded(pool, pager, root_page_id, keys[i], path, &depth, &leaf_page_id, &upper);
+        if (leaf == NULL) {
+            break;
+        }
+
+        // the run of present keys that belong in this leaf and whose new
+        // values still fit in it, their old values read before any changes
+        int end = i;
+        int32_t free_space = page_free_space(leaf);
+        while (end < count && keys[end] < upper && (end == i || keys[end] > keys[end - 1]) &&
+               lengths[end] <= BTREE_MAX_VALUE_SIZE) {
+            int found;
+            int slot = page_find_cell(leaf, keys[end], &found);
+            if (!found) {
+                break;
+            }
+            old_values[end] = page_cell_value(leaf, slot, &old_lengths[end]);
+            if (free_space + old_lengths[end] < lengths[end]) {
+                break;
+            }
+            free_space += old_lengths[end] - lengths[end];
+            end++;
+        }
+        if (end == i) {
+            // a missing key, a full leaf or an oversized value takes the single row path
+            buffer_pool_unpin_page(pool, pager, leaf_page_id, 0);
+            btree_insert(pool, pager, wal, tx_id, root_page_id, keys[i], values[i], lengths[i]);
+            num_writes++;
+            i++;
+            continue;
+        }
+
+        if (wal != NULL) {
+            leaf->header.page_lsn = wal_log_update_batch(wal, tx_id, root_page_id, leaf_page_id, &keys[i], &values[i],
+                                                         &lengths[i], &old_values[i], &old_lengths[i], end - i);
+        }
+        for (int j = i; j < end; j++) {
+            int found;
+            int slot = page_find_cell(leaf, keys[j], &found);
+            page_update_cell(leaf, slot, values[j], lengths[j]);
+        }
+        buffer_pool_unpin_page(pool, pager, leaf_page_id, 1);
+        num_writes++;
+        i = end;
+    }
+    free(old_values);
+    free(old_lengths);
+    return num_writes;
 }
 
-void btree_delete(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, int is_transaction_active) {
-    // simplified - no node merges
-    BTreeLeafNode* leaf = find_leaf(pool, pager, root_page_id, key);
+void btree_delete(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, int key) {
+    // simplified - no node merges, empty leaves stay linked in the leaf chain
+    uint32_t path[BTREE_MAX_DEPTH];
+    int depth;
+    uint32_t leaf_page_id;
+    Page* leaf = find_leaf(pool, pager, root_page_id, key, path, &depth, &leaf_page_id);
     if (leaf == NULL) {
         return;
     }
 
-    int i = 0;
-    while (i < leaf->header.num_keys && key != leaf->keys[i]) {
-        i++;
+    int found;
+    int slot = page_find_cell(leaf, key, &found);
+    if (!found) {
+        buffer_pool_unpin_page(pool, pager, leaf_page_id, 0);
+        return;
+    }
+
+    if (wal != NULL) {
+        uint16_t old_length;
+        const char* old_value = page_cell_value(leaf, slot, &old_length);
+        leaf->header.page_lsn = wal_log_delete(wal, tx_id, root_page_id, leaf_page_id, key, old_value, old_length);
+    }
+    page_delete_cell(leaf, slot);
+    buffer_pool_unpin_page(pool, pager, leaf_page_id, 1);
+}
+
+// move past exhausted leaves until the cursor rests on a cell or runs off the end
+static void cursor_settle(BTreeCursor* cursor) {
+    while (cursor->page != NULL && cursor->slot >= cursor->page->header.num_cells) {
+        uint32_t next_page_id = cursor->page->header.next_page_id;
+        buffer_pool_unpin_page(cursor->pool, cursor->pager, cursor->page_id, 0);
+        cursor->page = NULL;
+        if (next_page_id == 0) {
+            break;
+        }
+        cursor->page_id = next_page_id;
+        cursor->page = buffer_pool_get_page(cursor->pool, cursor->pager, next_page_id);
+        cursor->slot = 0;
+    }
+}
+
+void btree_cursor_first(BTreeCursor* cursor, BufferPool* pool, Pager* pager, uint32_t root_page_id) {
+    cursor->pool = pool;
+    cursor->pager = pager;
+    cursor->page_id = root_page_id;
+    cursor->slot = 0;
+    cursor->page = buffer_pool_get_page(pool, pager, root_page_id);
+
+    while (cursor->page != NULL && cursor->page->header.page_type == PAGE_TYPE_INTERNAL) {
+        uint32_t child = ((BTreeInternalNode*)cursor->page)->children[0];
+        buffer_pool_unpin_page(pool, pager, cursor->page_id, 0);
+        cursor->page_id = child;
+        cursor->page = buffer_pool_get_page(pool, pager, child);
     }
+    cursor_settle(cursor);
+}
+
+void btree_cursor_seek(BTreeCursor* cursor, BufferPool* pool, Pager* pager, uint32_t root_page_id, int key) {
+    uint32_t path[BTREE_MAX_DEPTH];
+    int depth;
+    cursor->pool = pool;
+    cursor->pager = pager;
+    cursor->page = find_leaf(pool, pager, root_page_id, key, path, &depth, &cursor->page_id);
+    cursor->slot = cursor->page != NULL ? page_find_cell(cursor->page, key, NULL) : 0;
+    cursor_settle(cursor);
+}
+
+int btree_cursor_valid(const BTreeCursor* cursor) {
+    return cursor->page != NULL;
+}
+
+int btree_cursor_key(const BTreeCursor* cursor) {
+    return page_cell_key(cursor->page, cursor->slot);
+}
+
+const char* btree_cursor_value(const BTreeCursor* cursor, uint16_t* length) {
+    return page_cell_value(cursor->page, cursor->slot, length);
+}
+
+void btree_cursor_next(BTreeCursor* cursor) {
+    if (cursor->page == NULL) {
+        return;
+    }
+    cursor->slot++;
+    cursor_settle(cursor);
+}
+
+int64_t btree_cursor_skip(BTreeCursor* cursor, int64_t count) {
+    int64_t skipped = 0;
+    while (cursor->page != NULL && skipped < count) {
+        int64_t in_leaf = cursor->page->header.num_cells - cursor->slot;
+        int64_t step = count - skipped < in_leaf ? count - skipped : in_leaf;
+        cursor->slot += (int)step;
+        skipped += step;
+        cursor_settle(cursor);
+    }
+    return skipped;
+}
 
-    if (i < leaf->header.num_keys) {
-        leaf->keys[i] = -1; // mark as deleted
-        memset(leaf->values[i], 0, sizeof(leaf->values[i]));
-        leaf->header.num_keys--;
-        buffer_pool_unpin_page(pool, pager, root_page_id, 1); 
+void btree_cursor_close(BTreeCursor* cursor) {
+    if (cursor->page != NULL) {
+        buffer_pool_unpin_page(cursor->pool, cursor->pager, cursor->page_id, 0);
+        cursor->page = NULL;
     }
 }
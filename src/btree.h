@@ -2,32 +2,61 @@
 #define BTREE_H
 
 #include "buffer.h"
+#include "wal.h"
 
 #define BTREE_ORDER 32
+#define BTREE_MAX_DEPTH 16
+#define BTREE_MAX_VALUE_SIZE 1000
 
 
+// leaf pages are slotted pages (see page.h) holding variable length values;
+// internal pages store fixed arrays of separator keys and child page ids
 typedef struct {
-    int is_leaf;
-    int num_keys;
-} BTreeNodeHeader;
-
-
-typedef struct {
-    BTreeNodeHeader header;
+    PageHeader header; // header.num_cells is the number of keys
     int keys[BTREE_ORDER - 1];
     uint32_t children[BTREE_ORDER];
 } BTreeInternalNode;
 
 
+// position within the leaf level, keeps the current leaf pinned
 typedef struct {
-    BTreeNodeHeader header;
-    int keys[BTREE_ORDER - 1];
-    char values[BTREE_ORDER - 1][256]; // fixed size values
-    uint32_t next_leaf;
-} BTreeLeafNode;
-
-void btree_insert(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, const char* value, int is_transaction_active);
-void btree_delete(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, int is_transaction_active);
-char* btree_search(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key);
+    BufferPool* pool;
+    Pager* pager;
+    uint32_t page_id;
+    Page* page;
+    int slot;
+} BTreeCursor;
+
+uint32_t btree_create(BufferPool* pool, Pager* pager, Wal* wal);
+// make the existing page page_id the empty root of a new tree, whatever it
+// held, logged like btree_create. 0 on success, -1 on failure.
+int btree_create_at(BufferPool* pool, Pager* pager, Wal* wal, uint32_t page_id);
+void btree_insert(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, int key, const char* value, uint16_t length);
+// insert count keys in ascending order with their values. the new keys that
+// fall in the same leaf are added together and logged as one record; keys
+// already present and leaves that need splitting go through btree_insert.
+// returns the number of row changes made (and logged): one per run of keys
+// added together, one per key that went through btree_insert.
+int btree_insert_batch(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, const int* keys,
+                       const char* const* values, const uint16_t* lengths, int count);
+// replace the values of count keys in ascending order. the keys the same leaf
+// holds are replaced together and logged as one record, with their old values
+// for undo; missing keys and values that no longer fit go through btree_insert.
+// returns the number of row changes made, counted like btree_insert_batch.
+int btree_update_batch(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, const int* keys,
+                       const char* const* values, const uint16_t* lengths, int count);
+void btree_delete(BufferPool* pool, Pager* pager, Wal* wal, uint32_t tx_id, uint32_t root_page_id, int key);
+char* btree_search(BufferPool* pool, Pager* pager, uint32_t root_page_id, int key, uint16_t* length);
+
+void btree_cursor_first(BTreeCursor* cursor, BufferPool* pool, Pager* pager, uint32_t root_page_id);
+void btree_cursor_seek(BTreeCursor* cursor, BufferPool* pool, Pager* pager, uint32_t root_page_id, int key);
+int btree_cursor_valid(const BTreeCursor* cursor);
+int btree_cursor_key(const BTreeCursor* cursor);
+const char* btree_cursor_value(const BTreeCursor* cursor, uint16_t* length);
+void btree_cursor_next(BTreeCursor* cursor);
+// move past up to count entries without reading them, a whole leaf at a time
+// where possible. returns how many were passed, fewer at the end of the tree.
+int64_t btree_cursor_skip(BTreeCursor* cursor, int64_t count);
+void btree_cursor_close(BTreeCursor* cursor);
 
 #endif // BTREE_H
@@ -1,5 +1,7 @@
 #include "buffer.h"
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,15 +17,28 @@ BufferPool* buffer_pool_init() {
         pool->frames[i].is_dirty = 0;
         pool->frames[i].pin_count = 0;
         pool->frames[i].lru_counter = 0;
+        pool->frames[i].io_pending = 0;
+        pool->frames[i].writing_page_id = -1;
     }
     pool->next_victim = 0;
+    pool->clock = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->io_done, NULL);
     return pool;
 }
 
-// find victim frame using lru
+void buffer_pool_free(BufferPool* pool) {
+    if (pool != NULL) {
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->io_done);
+        free(pool);
+    }
+}
+
+// find victim frame using lru: the unpinned frame accessed longest ago
 static int find_victim_frame(BufferPool* pool) {
     int victim = -1;
-    int min_lru_counter = -1;
+    uint64_t min_lru_counter = 0;
 
     for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
         if (pool->frames[i].pin_count == 0) {
@@ -37,63 +52,91 @@ static int find_victim_frame(BufferPool* pool) {
     return victim;
 }
 
+// frame metadata is guarded by pool->lock. page contents are not: a pinned
+// page is never evicted, and callers that share a pool across threads must
+// not modify the same page concurrently (parallel redo partitions by page).
+// a miss claims its victim frame under the lock and then writes the victim
+// back and reads the page without it, so threads missing on different pages
+// do their i/o at the same time; one wanting either page meanwhile waits.
 Page* buffer_pool_get_page(BufferPool* pool, Pager* pager, uint32_t page_id) {
-    
-    // check if page already in buffer
+    pthread_mutex_lock(&pool->lock);
+
+    // check if page already in buffer, or on its way in or out
     for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-        if (pool->frames[i].page_id == page_id) {
-            pool->frames[i].pin_count++;
-            pool->frames[i].lru_counter = 0;
-            
-            return &pool->frames[i].page;
+        Frame* frame = &pool->frames[i];
+        if (frame->io_pending && (frame->page_id == page_id || frame->writing_page_id == page_id)) {
+            pthread_cond_wait(&pool->io_done, &pool->lock);
+            i = -1;  // frames may have changed while waiting
+            continue;
+        }
+        if (frame->page_id == page_id) {
+            frame->pin_count++;
+            frame->lru_counter = ++pool->clock;
+
+            pthread_mutex_unlock(&pool->lock);
+            return &frame->page;
         }
     }
 
     // page not in buffer, find victim
     int frame_idx = find_victim_frame(pool);
     if (frame_idx == -1) {
-        
+        pthread_mutex_unlock(&pool->lock);
         return NULL;
     }
 
+    // claim the frame, pinned so nobody else evicts it
+    Frame* frame = &pool->frames[frame_idx];
+    int write_back = frame->is_dirty;
+    frame->writing_page_id = write_back ? frame->page_id : (uint32_t)-1;
+    frame->io_pending = 1;
+    frame->page_id = page_id;
+    frame->is_dirty = 0;
+    frame->pin_count = 1;
+    frame->lru_counter = ++pool->clock;
+    pthread_mutex_unlock(&pool->lock);
+
     // flush dirty victim
-    if (pool->frames[frame_idx].is_dirty) {
-        
-        buffer_pool_flush(pool, pager, pool->frames[frame_idx].page_id);
+    if (write_back) {
+        pwrite(pager->fd, &frame->page, PAGE_SIZE, (off_t)frame->writing_page_id * PAGE_SIZE);
     }
 
+    // pages past the end of the file have never been written, so they start zeroed
+    ssize_t bytes_read = pread(pager->fd, &frame->page, PAGE_SIZE, (off_t)page_id * PAGE_SIZE);
+    if (bytes_read < PAGE_SIZE) {
+        memset((char*)&frame->page + (bytes_read > 0 ? bytes_read : 0), 0, PAGE_SIZE - (bytes_read > 0 ? bytes_read : 0));
+    }
 
-    
-    lseek(pager->fd, page_id * PAGE_SIZE, SEEK_SET);
-    read(pager->fd, &pool->frames[frame_idx].page, PAGE_SIZE);
-
-    pool->frames[frame_idx].page_id = page_id;
-    pool->frames[frame_idx].is_dirty = 0;
-    pool->frames[frame_idx].pin_count = 1;
-    pool->frames[frame_idx].lru_counter = 0;
-
-    return &pool->frames[frame_idx].page;
+    pthread_mutex_lock(&pool->lock);
+    frame->io_pending = 0;
+    frame->writing_page_id = -1;
+    pthread_cond_broadcast(&pool->io_done);
+    pthread_mutex_unlock(&pool->lock);
+    return &frame->page;
 }
 
 void buffer_pool_unpin_page(BufferPool* pool, Pager* pager, uint32_t page_id, int is_dirty) {
+    (void)pager;
+    pthread_mutex_lock(&pool->lock);
     for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
         if (pool->frames[i].page_id == page_id) {
             pool->frames[i].pin_count--;
+            // dirty pages are written back on eviction or at close, which
+            // checkpoints the log; the wal covers anything lost before then
             if (is_dirty) {
                 pool->frames[i].is_dirty = 1;
-                buffer_pool_flush(pool, pager, page_id);
             }
             break;
         }
     }
+    pthread_mutex_unlock(&pool->lock);
 }
 
-void buffer_pool_flush(BufferPool* pool, Pager* pager, uint32_t page_id) {
+static void flush_frame(BufferPool* pool, Pager* pager, uint32_t page_id) {
     for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
         if (pool->frames[i].page_id == page_id) {
             if (pool->frames[i].is_dirty) {
-                lseek(pager->fd, page_id * PAGE_SIZE, SEEK_SET);
-                write(pager->fd, &pool->frames[i].page, PAGE_SIZE);
+                pwrite(pager->fd, &pool->frames[i].page, PAGE_SIZE, (off_t)page_id * PAGE_SIZE);
                 pool->frames[i].is_dirty = 0;
             }
             break;
@@ -101,10 +144,18 @@ void buffer_pool_flush(BufferPool* pool, Pager* pager, uint32_t page_id) {
     }
 }
 
+void buffer_pool_flush(BufferPool* pool, Pager* pager, uint32_t page_id) {
+    pthread_mutex_lock(&pool->lock);
+    flush_frame(pool, pager, page_id);
+    pthread_mutex_unlock(&pool->lock);
+}
+
 void buffer_pool_flush_all(BufferPool* pool, Pager* pager) {
+    pthread_mutex_lock(&pool->lock);
     for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-        buffer_pool_flush(pool, pager, pool->frames[i].page_id);
+        flush_frame(pool, pager, pool->frames[i].page_id);
     }
+    pthread_mutex_unlock(&pool->lock);
 }
 
 Pager* pager_open(const char* filename) {
@@ -127,6 +178,18 @@ Pager* pager_open(const char* filename) {
     return pager;
 }
 
+uint32_t pager_allocate_page(Pager* pager) {
+    return pager->next_page_id++;
+}
+
+int pager_sync(Pager* pager) {
+    if (fsync(pager->fd) != 0) {
+        fprintf(stderr, "error: unable to sync %s.\n", pager->filename);
+        return -1;
+    }
+    return 0;
+}
+
 void pager_close(Pager* pager) {
     if (pager != NULL) {
         close(pager->fd);
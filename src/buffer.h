@@ -2,6 +2,7 @@
 #define BUFFER_H
 
 #include "page.h"
+#include <pthread.h>
 #include <stdint.h>
 
 #define BUFFER_POOL_SIZE 100
@@ -12,13 +13,18 @@ typedef struct {
     uint32_t page_id;
     int is_dirty;
     int pin_count;
-    int lru_counter;
+    uint64_t lru_counter; // pool clock at the last access, 0 for an empty frame
+    int io_pending;       // the page is being read in, after the victim's is written back
+    uint32_t writing_page_id; // that victim while it is written back, -1 otherwise
 } Frame;
 
 
 typedef struct {
     Frame frames[BUFFER_POOL_SIZE];
     int next_victim;
+    uint64_t clock;       // advanced on every page access
+    pthread_mutex_t lock;
+    pthread_cond_t io_done; // signalled when a frame's io_pending clears
 } BufferPool;
 
 
@@ -29,12 +35,16 @@ typedef struct {
 } Pager;
 
 BufferPool* buffer_pool_init();
+void buffer_pool_free(BufferPool* pool);
 void buffer_pool_flush(BufferPool* pool, Pager* pager, uint32_t page_id);
 void buffer_pool_flush_all(BufferPool* pool, Pager* pager);
 Page* buffer_pool_get_page(BufferPool* pool, Pager* pager, uint32_t page_id);
 void buffer_pool_unpin_page(BufferPool* pool, Pager* pager, uint32_t page_id, int is_dirty);
 
 Pager* pager_open(const char* filename);
+uint32_t pager_allocate_page(Pager* pager);
+// force the pages written so far to disk, -1 if they may not all be there
+int pager_sync(Pager* pager);
 void pager_close(Pager* pager);
 
 #endif // BUFFER_H
@@ -0,0 +1,473 @@
+#include "catalog.h"
+#include "btree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CATALOG_HEADER_KEY 0
+#define CATALOG_INITIAL_SLOTS 16
+
+// key 0 of the tables tree
+typedef struct {
+    int32_t num_tables;
+    int32_t next_table_id;
+} CatalogHeader;
+
+// a table's entry in the tables tree; its columns and indexes have their own
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    int32_t id;
+    uint32_t root_page_id;
+    uint16_t num_columns;
+    uint16_t num_indexes;
+    int32_t analyzed;
+    int64_t num_rows;
+    uint32_t num_pages;
+} TableEntry;
+
+// a column's entry in the columns tree
+typedef struct {
+    ColumnSchema schema;
+    ColumnStats stats;
+} ColumnEntry;
+
+// fnv-1a
+static uint32_t name_hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// tables are stored under the hash of their name, taken positive and past
+// the header, and probe the following keys when it is in use
+static int32_t table_key(const char* table_name) {
+    int32_t key = (int32_t)(name_hash(table_name) & 0x7FFFFFFFu);
+    return key == CATALOG_HEADER_KEY ? 1 : key;
+}
+
+static int32_t next_table_key(int32_t key) {
+    return key == INT32_MAX ? 1 : key + 1;
+}
+
+static int32_t column_key(const TableSchema* table, int position) {
+    return table->id * MAX_COLUMNS_PER_TABLE + position;
+}
+
+static int32_t index_key(const TableSchema* table, int position) {
+    return table->id * MAX_INDEXES_PER_TABLE + position;
+}
+
+// catalog entries are written outside any transaction: they are logged and
+// redone after a crash, never undone
+static void write_entry(Catalog* catalog, uint32_t root_page_id, int32_t key, const void* value, uint16_t length) {
+    btree_insert(catalog->pool, catalog->pager, catalog->wal, 0, root_page_id, key, (const char*)value, length);
+}
+
+static void save_header(Catalog* catalog) {
+    CatalogHeader header;
+    memset(&header, 0, sizeof(CatalogHeader));
+    header.num_tables = catalog->num_tables;
+    header.next_table_id = catalog->next_table_id;
+    write_entry(catalog, CATALOG_TABLES_ROOT, CATALOG_HEADER_KEY, &header, sizeof(CatalogHeader));
+}
+
+static void save_table(Catalog* catalog, const TableSchema* table) {
+    TableEntry entry;
+    memset(&entry, 0, sizeof(TableEntry));
+    strcpy(entry.table_name, table->table_name);
+    entry.id = table->id;
+    entry.root_page_id = table->root_page_id;
+    entry.num_columns = table->num_columns;
+    entry.num_indexes = table->num_indexes;
+    entry.analyzed = table->stats.analyzed;
+    entry.num_rows = table->stats.num_rows;
+    entry.num_pages = table->stats.num_pages;
+    write_entry(catalog, CATALOG_TABLES_ROOT, table->key, &entry, sizeof(TableEntry));
+}
+
+static void save_column(Catalog* catalog, const TableSchema* table, int position) {
+    ColumnEntry entry;
+    memset(&entry, 0, sizeof(ColumnEntry));
+    entry.schema = table->columns[position];
+    entry.stats = table->stats.columns[position];
+    write_entry(catalog, CATALOG_COLUMNS_ROOT, column_key(table, position), &entry, sizeof(ColumnEntry));
+}
+
+// the entry stored under key in the tables tree. 0 if there is none
+static int read_table_entry(Catalog* catalog, int32_t key, TableEntry* entry) {
+    uint16_t length;
+    char* value = btree_search(catalog->pool, catalog->pager, CATALOG_TABLES_ROOT, key, &length);
+    if (value == NULL) {
+        return 0;
+    }
+    memset(entry, 0, sizeof(TableEntry));
+    memcpy(entry, value, length < sizeof(TableEntry) ? length : sizeof(TableEntry));
+    free(value);
+    return 1;
+}
+
+// a repeated name keeps the slot of its first position, as a linear search would
+static uint32_t column_slot(const TableSchema* table, const char* column_name) {
+    uint32_t slot = name_hash(column_name) & (COLUMN_HASH_SLOTS - 1);
+    while (table->column_slots[slot] != 0 &&
+           strcmp(table->columns[table->column_slots[slot] - 1].name, column_name) != 0) {
+        slot = (slot + 1) & (COLUMN_HASH_SLOTS - 1);
+    }
+    return slot;
+}
+
+static void index_columns(TableSchema* table) {
+    memset(table->column_slots, 0, sizeof(table->column_slots));
+    for (int i = 0; i < table->num_columns; i++) {
+        uint32_t slot = column_slot(table, table->columns[i].name);
+        if (table->column_slots[slot] == 0) {
+            table->column_slots[slot] = (uint8_t)(i + 1);
+        }
+    }
+}
+
+// the slot of the loaded table named table_name, or the empty one it would go in
+static uint32_t cache_slot(const Catalog* catalog, const char* table_name) {
+    uint32_t mask = catalog->num_slots - 1;
+    uint32_t slot = name_hash(table_name) & mask;
+    while (catalog->slots[slot] != NULL && strcmp(catalog->slots[slot]->table_name, table_name) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// keep a loaded table, doubling the slots when they are half full
+static int cache_add(Catalog* catalog, TableSchema* table) {
+    if ((catalog->num_loaded + 1) * 2 > catalog->num_slots) {
+        TableSchema** old_slots = catalog->slots;
+        uint32_t old_num_slots = catalog->num_slots;
+        TableSchema** slots = (TableSchema**)calloc(old_num_slots * 2, sizeof(TableSchema*));
+        if (slots == NULL) {
+            fprintf(stderr, "error: unable to grow the table cache.\n");
+            return -1;
+        }
+        catalog->slots = slots;
+        catalog->num_slots = old_num_slots * 2;
+        for (uint32_t i = 0; i < old_num_slots; i++) {
+            if (old_slots[i] != NULL) {
+                catalog->slots[cache_slot(catalog, old_slots[i]->table_name)] = old_slots[i];
+            }
+        }
+        free(old_slots);
+    }
+    catalog->slots[cache_slot(catalog, table->table_name)] = table;
+    catalog->num_loaded++;
+    return 0;
+}
+
+// read count consecutive entries of a system tree starting at key first
+static void read_entries(Catalog* catalog, uint32_t root_page_id, int32_t first, int count, void* entries, size_t size) {
+    BTreeCursor cursor;
+    btree_cursor_seek(&cursor, catalog->pool, catalog->pager, root_page_id, first);
+    for (int i = 0; i < count && btree_cursor_valid(&cursor) && btree_cursor_key(&cursor) == first + i; i++) {
+        uint16_t length;
+        const char* value = btree_cursor_value(&cursor, &length);
+        memcpy((char*)entries + i * size, value, length < size ? length : size);
+        btree_cursor_next(&cursor);
+    }
+    btree_cursor_close(&cursor);
+}
+
+// build a table from its entries and cache it
+static TableSchema* load_table(Catalog* catalog, int32_t key, const TableEntry* entry) {
+    TableSchema* table = (TableSchema*)calloc(1, sizeof(TableSchema));
+    if (table == NULL) {
+        fprintf(stderr, "error: unable to allocate table %s.\n", entry->table_name);
+        return NULL;
+    }
+    strcpy(table->table_name, entry->table_name);
+    table->id = entry->id;
+    table->key = key;
+    table->root_page_id = entry->root_page_id;
+    table->num_columns = entry->num_columns;
+    table->num_indexes = entry->num_indexes;
+    table->stats.analyzed = entry->analyzed;
+    table->stats.num_rows = entry->num_rows;
+    table->stats.num_pages = entry->num_pages;
+
+    ColumnEntry columns[MAX_COLUMNS_PER_TABLE];
+    memset(columns, 0, sizeof(columns));
+    read_entries(catalog, CATALOG_COLUMNS_ROOT, column_key(table, 0), table->num_columns, columns, sizeof(ColumnEntry));
+    for (int i = 0; i < table->num_columns; i++) {
+        table->columns[i] = columns[i].schema;
+        table->stats.columns[i] = columns[i].stats;
+    }
+    read_entries(catalog, CATALOG_INDEXES_ROOT, index_key(table, 0), table->num_indexes, table->indexes, sizeof(IndexSchema));
+    index_columns(table);
+
+    if (cache_add(catalog, table) != 0) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+// rewrite a catalog kept in metadata pages into the system trees. its first
+// pages become the tree roots and the others are left unused; the tables keep
+// their trees and get ids in their old order.
+static int migrate_legacy_catalog(Catalog* catalog) {
+    LegacyCatalog* legacy = (LegacyCatalog*)malloc(sizeof(LegacyCatalog));
+    if (legacy == NULL) {
+        fprintf(stderr, "error: unable to allocate the legacy catalog.\n");
+        return -1;
+    }
+    char* dest = (char*)legacy;
+    size_t remaining = sizeof(LegacyCatalog);
+    for (uint32_t i = 0; i < LEGACY_CATALOG_NUM_PAGES; i++) {
+        size_t chunk = remaining < LEGACY_CATALOG_PAGE_CAPACITY ? remaining : LEGACY_CATALOG_PAGE_CAPACITY;
+        Page* page = buffer_pool_get_page(catalog->pool, catalog->pager, CATALOG_TABLES_ROOT + i);
+        int is_metadata = page != NULL && page->header.page_type == PAGE_TYPE_METADATA;
+        if (is_metadata) {
+            memcpy(dest, page->data, chunk);
+        }
+        if (page != NULL) {
+            buffer_pool_unpin_page(catalog->pool, catalog->pager, CATALOG_TABLES_ROOT + i, 0);
+        }
+        if (!is_metadata) {
+            fprintf(stderr, "error: the legacy catalog of the database is incomplete.\n");
+            free(legacy);
+            return -1;
+        }
+        dest += chunk;
+        remaining -= chunk;
+    }
+    if (legacy->num_tables > LEGACY_CATALOG_TABLES) {
+        fprintf(stderr, "error: the legacy catalog of the database is corrupt.\n");
+        free(legacy);
+        return -1;
+    }
+
+    if (btree_create_at(catalog->pool, catalog->pager, catalog->wal, CATALOG_TABLES_ROOT) != 0 ||
+        btree_create_at(catalog->pool, catalog->pager, catalog->wal, CATALOG_COLUMNS_ROOT) != 0 ||
+        btree_create_at(catalog->pool, catalog->pager, catalog->wal, CATALOG_INDEXES_ROOT) != 0) {
+        fprintf(stderr, "error: unable to create the catalog.\n");
+        free(legacy);
+        return -1;
+    }
+    catalog->num_tables = 0;
+    catalog->next_table_id = 1;
+    for (int t = 0; t < legacy->num_tables; t++) {
+        const LegacyTableSchema* old = &legacy->tables[t];
+        TableSchema table;
+        memset(&table, 0, sizeof(TableSchema));
+        strcpy(table.table_name, old->table_name);
+        table.id = catalog->next_table_id++;
+        table.root_page_id = old->root_page_id;
+        table.num_columns = old->num_columns;
+        memcpy(table.columns, old->columns, sizeof(table.columns));
+        table.num_indexes = old->num_indexes;
+        memcpy(table.indexes, old->indexes, sizeof(table.indexes));
+        table.stats = old->stats;
+
+        TableEntry entry;
+        table.key = table_key(table.table_name);
+        while (read_table_entry(catalog, table.key, &entry)) {
+            table.key = next_table_key(table.key);
+        }
+        for (int i = 0; i < table.num_columns; i++) {
+            save_column(catalog, &table, i);
+        }
+        catalog_save_indexes(catalog, &table, 0, 0);
+        catalog->num_tables++;
+    }
+    free(legacy);
+
+    // the header last: a file cut short before it has no catalog, like a new
+    // database cut short while it is created
+    save_header(catalog);
+    return wal_sync(catalog->wal);
+}
+
+int catalog_open(Catalog* catalog, BufferPool* pool, Pager* pager, Wal* wal, int create) {
+    memset(catalog, 0, sizeof(Catalog));
+    catalog->pool = pool;
+    catalog->pager = pager;
+    catalog->wal = wal;
+
+    if (create) {
+        if (btree_create(pool, pager, wal) != CATALOG_TABLES_ROOT || btree_create(pool, pager, wal) != CATALOG_COLUMNS_ROOT ||
+            btree_create(pool, pager, wal) != CATALOG_INDEXES_ROOT) {
+            fprintf(stderr, "error: unable to create the catalog.\n");
+            return -1;
+        }
+        catalog->num_tables = 0;
+        catalog->next_table_id = 1;
+        save_header(catalog);
+    } else {
+        // files from before the system trees kept the catalog in metadata pages
+        Page* root = buffer_pool_get_page(pool, pager, CATALOG_TABLES_ROOT);
+        if (root == NULL) {
+            fprintf(stderr, "error: the database has no catalog.\n");
+            return -1;
+        }
+        int is_legacy = root->header.page_type == PAGE_TYPE_METADATA;
+        buffer_pool_unpin_page(pool, pager, CATALOG_TABLES_ROOT, 0);
+        if (is_legacy && migrate_legacy_catalog(catalog) != 0) {
+            return -1;
+        }
+        uint16_t length;
+        char* value = btree_search(pool, pager, CATALOG_TABLES_ROOT, CATALOG_HEADER_KEY, &length);
+        if (value == NULL || length != sizeof(CatalogHeader)) {
+            fprintf(stderr, "error: the database has no catalog.\n");
+            free(value);
+            return -1;
+        }
+        CatalogHeader header;
+        memcpy(&header, value, sizeof(CatalogHeader));
+        free(value);
+        catalog->num_tables = header.num_tables;
+        catalog->next_table_id = header.next_table_id;
+    }
+
+    catalog->slots = (TableSchema**)calloc(CATALOG_INITIAL_SLOTS, sizeof(TableSchema*));
+    if (catalog->slots == NULL) {
+        fprintf(stderr, "error: unable to allocate the table cache.\n");
+        return -1;
+    }
+    catalog->num_slots = CATALOG_INITIAL_SLOTS;
+    return 0;
+}
+
+void catalog_close(Catalog* catalog) {
+    for (uint32_t i = 0; i < catalog->num_slots; i++) {
+        free(catalog->slots[i]);
+    }
+    free(catalog->slots);
+    catalog->slots = NULL;
+    catalog->num_slots = 0;
+    catalog->num_loaded = 0;
+}
+
+TableSchema* catalog_find_table(Catalog* catalog, const char* table_name) {
+    TableSchema* table = catalog->slots[cache_slot(catalog, table_name)];
+    if (table != NULL) {
+        return table;
+    }
+    // not loaded yet: probe from the name's key until an empty one
+    TableEntry entry;
+    for (int32_t key = table_key(table_name); read_table_entry(catalog, key, &entry); key = next_table_key(key)) {
+        if (strcmp(entry.table_name, table_name) == 0) {
+            return load_table(catalog, key, &entry);
+        }
+    }
+    return NULL;
+}
+
+TableSchema* catalog_create_table(Catalog* catalog, const char* table_name, const ColumnSchema* columns, int num_columns) {
+    if (catalog->next_table_id > INT32_MAX / MAX_COLUMNS_PER_TABLE - 1) {
+        fprintf(stderr, "error: maximum number of tables reached.\n");
+        return NULL;
+    }
+    TableSchema* table = (TableSchema*)calloc(1, sizeof(TableSchema));
+    if (table == NULL) {
+        fprintf(stderr, "error: unable to allocate table %s.\n", table_name);
+        return NULL;
+    }
+    strcpy(table->table_name, table_name);
+    table->num_columns = (uint16_t)num_columns;
+    memcpy(table->columns, columns, sizeof(ColumnSchema) * num_columns);
+    table->root_page_id = btree_create(catalog->pool, catalog->pager, catalog->wal);
+
+    // the header first, so an id is never handed out twice even if this is
+    // cut short; the table's own entry last, as nothing finds it before that
+    table->id = catalog->next_table_id++;
+    catalog->num_tables++;
+    save_header(catalog);
+    for (int i = 0; i < num_columns; i++) {
+        save_column(catalog, table, i);
+    }
+    TableEntry entry;
+    table->key = table_key(table_name);
+    while (read_table_entry(catalog, table->key, &entry)) {
+        table->key = next_table_key(table->key);
+    }
+    save_table(catalog, table);
+
+    index_columns(table);
+    if (cache_add(catalog, table) != 0) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void catalog_save_indexes(Catalog* catalog, const TableSchema* table, int first, int num_removed) {
+    for (int i = first; i < table->num_indexes; i++) {
+        write_entry(catalog, CATALOG_INDEXES_ROOT, index_key(table, i), &table->indexes[i], sizeof(IndexSchema));
+    }
+    for (int i = 0; i < num_removed; i++) {
+        btree_delete(catalog->pool, catalog->pager, catalog->wal, 0, CATALOG_INDEXES_ROOT, index_key(table, table->num_indexes + i));
+    }
+    save_table(catalog, table);
+}
+
+void catalog_save_stats(Catalog* catalog, const TableSchema* table) {
+    for (int i = 0; i < table->num_columns; i++) {
+        save_column(catalog, table, i);
+    }
+    save_table(catalog, table);
+}
+
+static int compare_table_ids(const void* a, const void* b) {
+    const TableSchema* x = *(TableSchema* const*)a;
+    const TableSchema* y = *(TableSchema* const*)b;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+TableSchema** catalog_list_tables(Catalog* catalog, int* count) {
+    *count = 0;
+    if (catalog->num_tables == 0) {
+        return NULL;
+    }
+    // read the entries first, loading a table reads other trees
+    int capacity = catalog->num_tables;
+    int32_t* keys = (int32_t*)malloc(sizeof(int32_t) * capacity);
+    TableEntry* entries = (TableEntry*)malloc(sizeof(TableEntry) * capacity);
+    TableSchema** tables = (TableSchema**)malloc(sizeof(TableSchema*) * capacity);
+    if (keys == NULL || entries == NULL || tables == NULL) {
+        fprintf(stderr, "error: unable to allocate the table list.\n");
+        free(keys);
+        free(entries);
+        free(tables);
+        return NULL;
+    }
+    int num_entries = 0;
+    BTreeCursor cursor;
+    btree_cursor_seek(&cursor, catalog->pool, catalog->pager, CATALOG_TABLES_ROOT, CATALOG_HEADER_KEY + 1);
+    for (; btree_cursor_valid(&cursor) && num_entries < capacity; btree_cursor_next(&cursor)) {
+        uint16_t length;
+        const char* value = btree_cursor_value(&cursor, &length);
+        keys[num_entries] = btree_cursor_key(&cursor);
+        memset(&entries[num_entries], 0, sizeof(TableEntry));
+        memcpy(&entries[num_entries], value, length < sizeof(TableEntry) ? length : sizeof(TableEntry));
+        num_entries++;
+    }
+    btree_cursor_close(&cursor);
+
+    for (int i = 0; i < num_entries; i++) {
+        TableSchema* table = catalog->slots[cache_slot(catalog, entries[i].table_name)];
+        if (table == NULL) {
+            table = load_table(catalog, keys[i], &entries[i]);
+        }
+        if (table != NULL) {
+            tables[(*count)++] = table;
+        }
+    }
+    free(keys);
+    free(entries);
+    qsort(tables, *count, sizeof(TableSchema*), compare_table_ids);
+    return tables;
+}
+
+int catalog_find_column(const TableSchema* table, const char* column_name) {
+    uint32_t slot = column_slot(table, column_name);
+    return table->column_slots[slot] != 0 ? table->column_slots[slot] - 1 : -1;
+}
@@ -2,11 +2,19 @@
 #define CATALOG_H
 
 #include <stdint.h>
+#include "wal.h"
 
-#define MAX_TABLES 16
 #define MAX_COLUMNS_PER_TABLE 16
 #define MAX_INDEXES_PER_TABLE 8
 #define MAX_NAME_LEN 64
+#define HISTOGRAM_BUCKETS 16
+#define COLUMN_HASH_SLOTS 32  // open addressing slots for the column names of a table, a power of two
+
+// the system trees holding the catalog, created right after page 0 with a
+// new database. their roots never move.
+#define CATALOG_TABLES_ROOT 1   // a table under the hash of its name, the catalog header under key 0
+#define CATALOG_COLUMNS_ROOT 2  // a column and its statistics under table id * MAX_COLUMNS_PER_TABLE + position
+#define CATALOG_INDEXES_ROOT 3  // an index under table id * MAX_INDEXES_PER_TABLE + position
 
 typedef enum {
     COLUMN_TYPE_INT,
@@ -39,20 +47,99 @@ typedef struct {
     uint32_t root_page_id;
     int is_unique;
     int is_primary;
+    uint16_t num_include_columns;
+    uint16_t include_columns[MAX_COLUMNS_PER_TABLE]; // positions of the INCLUDE columns stored in each entry
 } IndexSchema;
 
+// column statistics, estimated by ANALYZE from a sample of the rows
+typedef struct {
+    int64_t num_distinct;     // distinct non-null values
+    int64_t num_nulls;
+    uint16_t num_bounds;      // histogram bounds, 0 for text columns and empty tables
+    double bounds[HISTOGRAM_BUCKETS + 1]; // equi-depth: about as many values fall in each bucket
+} ColumnStats;
+
+typedef struct {
+    int analyzed;             // 0 until the first ANALYZE, the planner then uses heuristics
+    int64_t num_rows;
+    uint32_t num_pages;       // leaf pages of the table's tree
+    ColumnStats columns[MAX_COLUMNS_PER_TABLE];
+} TableStats;
+
 typedef struct {
     char table_name[MAX_NAME_LEN];
+    int32_t id;               // numbers the table's column and index entries, from 1 in creation order
+    int32_t key;              // of its entry in the tables tree
     uint32_t root_page_id;
     uint16_t num_columns;
     ColumnSchema columns[MAX_COLUMNS_PER_TABLE];
     uint16_t num_indexes;
     IndexSchema indexes[MAX_INDEXES_PER_TABLE];
+    TableStats stats;
+    uint8_t column_slots[COLUMN_HASH_SLOTS]; // column position + 1 by name hash, 0 if empty
 } TableSchema;
 
+// files from before the system trees kept the whole catalog as one struct in
+// the metadata pages following page 0. catalog_open moves it into the trees
+// the first time such a file is opened.
+#define LEGACY_CATALOG_TABLES 16
+
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    uint32_t root_page_id;
+    uint16_t num_columns;
+    ColumnSchema columns[MAX_COLUMNS_PER_TABLE];
+    uint16_t num_indexes;
+    IndexSchema indexes[MAX_INDEXES_PER_TABLE];
+    TableStats stats;
+    uint8_t column_slots[COLUMN_HASH_SLOTS];
+} LegacyTableSchema;
+
 typedef struct {
     uint16_t num_tables;
-    TableSchema tables[MAX_TABLES];
+    LegacyTableSchema tables[LEGACY_CATALOG_TABLES];
+    uint8_t table_slots[32];
+} LegacyCatalog;
+
+#define LEGACY_CATALOG_PAGE_CAPACITY (PAGE_SIZE - sizeof(PageHeader))
+#define LEGACY_CATALOG_NUM_PAGES ((sizeof(LegacyCatalog) + LEGACY_CATALOG_PAGE_CAPACITY - 1) / LEGACY_CATALOG_PAGE_CAPACITY)
+
+// the schema lives in the system trees and tables are read from them the
+// first time a statement names them, so opening a database reads only the
+// header. loaded tables stay cached, and their addresses stay valid, until
+// the catalog is closed. ddl rewrites only the entries it changes, logged
+// like any other tree change.
+typedef struct {
+    BufferPool* pool;
+    Pager* pager;
+    Wal* wal;
+    int32_t num_tables;       // in the database, loaded or not
+    int32_t next_table_id;
+    TableSchema** slots;      // loaded tables by name hash, open addressing, NULL if empty
+    uint32_t num_slots;       // a power of two, at least twice num_loaded
+    uint32_t num_loaded;
 } Catalog;
 
+// create the system trees of a new database, or read the header of an
+// existing one, migrating a legacy catalog first. 0 on success, -1 on failure.
+int catalog_open(Catalog* catalog, BufferPool* pool, Pager* pager, Wal* wal, int create);
+void catalog_close(Catalog* catalog);
+
+// NULL if there is no such table
+TableSchema* catalog_find_table(Catalog* catalog, const char* table_name);
+// add a table with an empty tree of its own. NULL on failure; the name must
+// not be taken.
+TableSchema* catalog_create_table(Catalog* catalog, const char* table_name, const ColumnSchema* columns, int num_columns);
+// write the table's indexes from position first on, after CREATE INDEX or
+// DROP INDEX. num_removed entries past the last index are deleted.
+void catalog_save_indexes(Catalog* catalog, const TableSchema* table, int first, int num_removed);
+// write the table's statistics, after ANALYZE
+void catalog_save_stats(Catalog* catalog, const TableSchema* table);
+// every table in creation order, loading those not loaded yet. the array is
+// malloc'd and the caller frees it; NULL with *count 0 if there are none.
+TableSchema** catalog_list_tables(Catalog* catalog, int* count);
+
+// -1 if the table has no such column
+int catalog_find_column(const TableSchema* table, const char* column_name);
+
 #endif // CATALOG_H
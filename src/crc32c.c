@@ -0,0 +1,98 @@
+#include "crc32c.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32C_HAVE_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78u
+
+static uint32_t crc32c_table[8][256];
+
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = crc32c_table[t - 1][i];
+            crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+        }
+    }
+}
+
+// slicing-by-8: eight table lookups per 8 bytes of input
+static uint32_t crc32c_software(uint32_t crc, const unsigned char* data, size_t length) {
+    while (length >= 8) {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = crc32c_table[7][low & 0xff] ^ crc32c_table[6][(low >> 8) & 0xff] ^
+              crc32c_table[5][(low >> 16) & 0xff] ^ crc32c_table[4][low >> 24] ^
+              crc32c_table[3][high & 0xff] ^ crc32c_table[2][(high >> 8) & 0xff] ^
+              crc32c_table[1][(high >> 16) & 0xff] ^ crc32c_table[0][high >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *data++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hardware(uint32_t crc, const unsigned char* data, size_t length) {
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (length >= 4) {
+        uint32_t word;
+        memcpy(&word, data, 4);
+        crc = _mm_crc32_u32(crc, word);
+        data += 4;
+        length -= 4;
+    }
+    while (length-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+typedef uint32_t (*Crc32cFunction)(uint32_t crc, const unsigned char* data, size_t length);
+
+static Crc32cFunction crc32c_implementation = crc32c_software;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_select(void) {
+#ifdef CRC32C_HAVE_SSE42
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_implementation = crc32c_hardware;
+        return;
+    }
+#endif
+    crc32c_init_table();
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t length) {
+    pthread_once(&crc32c_once, crc32c_select);
+    return ~crc32c_implementation(~crc, (const unsigned char*)data, length);
+}
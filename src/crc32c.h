@@ -0,0 +1,12 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// crc32c (castagnoli). uses the sse4.2 crc32 instruction when the cpu has it
+// and a table driven implementation otherwise. pass the previous result as crc
+// to continue a checksum over several buffers, 0 to start a new one.
+uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+#endif // CRC32C_H
@@ -0,0 +1,155 @@
+#include "csv.h"
+#include <stdlib.h>
+#include <string.h>
+
+int csv_open(CsvReader* reader, const char* filename) {
+    memset(reader, 0, sizeof(CsvReader));
+    reader->file = fopen(filename, "rb");
+    if (reader->file == NULL) {
+        fprintf(stderr, "error: unable to open %s.\n", filename);
+        return -1;
+    }
+    reader->buffer = (char*)malloc(CSV_BUFFER_SIZE);
+    if (reader->buffer == NULL) {
+        fprintf(stderr, "error: unable to allocate csv read buffer.\n");
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+    reader->next_line = 1;
+    return 0;
+}
+
+void csv_close(CsvReader* reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+    }
+    free(reader->buffer);
+    memset(reader, 0, sizeof(CsvReader));
+}
+
+// move the unread bytes to the front and read more after them. 0 if nothing
+// more was read.
+static int csv_fill(CsvReader* reader) {
+    if (reader->eof) {
+        return 0;
+    }
+    size_t unread = reader->end - reader->start;
+    memmove(reader->buffer, reader->buffer + reader->start, unread);
+    reader->start = 0;
+    reader->end = unread;
+    size_t read = fread(reader->buffer + unread, 1, CSV_BUFFER_SIZE - unread, reader->file);
+    reader->end += read;
+    if (read == 0) {
+        reader->eof = 1;
+    }
+    return read > 0;
+}
+
+// the end of the row at start: the first newline outside quotes, or the end of
+// the file. newlines counts those inside quotes. 0 if more must be read first.
+static int find_row_end(const CsvReader* reader, size_t* row_end, int* newlines) {
+    const char* p = reader->buffer + reader->start;
+    const char* end = reader->buffer + reader->end;
+    int quoted = 0;
+    int lines = 0;
+    while (p < end) {
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        const char* stop = newline != NULL ? newline : end;
+        for (const char* quote = (const char*)memchr(p, '"', stop - p); quote != NULL;
+             quote = (const char*)memchr(quote + 1, '"', stop - quote - 1)) {
+            quoted = !quoted;
+        }
+        if (newline == NULL) {
+            break;
+        }
+        if (!quoted) {
+            *row_end = (size_t)(newline - reader->buffer);
+            *newlines = lines;
+            return 1;
+        }
+        lines++;
+        p = newline + 1;
+    }
+    if (reader->eof && reader->end > reader->start) {
+        *row_end = reader->end;
+        *newlines = lines;
+        return 1;
+    }
+    return 0;
+}
+
+// split a row into fields in place
+static int split_fields(const CsvReader* reader, char* row, size_t length, CsvField* fields, int max_fields) {
+    char* p = row;
+    char* end = row + length;
+    int count = 0;
+    while (1) {
+        if (count == max_fields) {
+            fprintf(stderr, "error: line %lld has more than %d fields.\n", (long long)reader->line, max_fields);
+            return -1;
+        }
+        CsvField* field = &fields[count++];
+        field->quoted = p < end && *p == '"';
+        if (field->quoted) {
+            // undo the "" escapes, the text moves over the opening quote
+            char* out = p;
+            char* in = p + 1;
+            while (in < end && !(*in == '"' && (in + 1 == end || in[1] != '"'))) {
+                if (*in == '"') {
+                    in++;
+                }
+                *out++ = *in++;
+            }
+            if (in == end) {
+                fprintf(stderr, "error: line %lld has an unterminated quoted field.\n", (long long)reader->line);
+                return -1;
+            }
+            field->text = p;
+            field->length = (uint32_t)(out - p);
+            p = in + 1;
+            if (p < end && *p != ',') {
+                fprintf(stderr, "error: line %lld has text after a quoted field.\n", (long long)reader->line);
+                return -1;
+            }
+        } else {
+            char* comma = (char*)memchr(p, ',', end - p);
+            char* stop = comma != NULL ? comma : end;
+            field->text = p;
+            field->length = (uint32_t)(stop - p);
+            p = stop;
+        }
+        if (p == end) {
+            return count;
+        }
+        p++; // the comma
+    }
+}
+
+int csv_next_row(CsvReader* reader, CsvField* fields, int max_fields) {
+    while (1) {
+        size_t row_end;
+        int newlines;
+        while (!find_row_end(reader, &row_end, &newlines)) {
+            if (reader->end - reader->start == CSV_BUFFER_SIZE) {
+                fprintf(stderr, "error: line %lld is longer than %d bytes.\n", (long long)reader->next_line, CSV_BUFFER_SIZE);
+                return -1;
+            }
+            if (!csv_fill(reader) && reader->start == reader->end) {
+                return 0;
+            }
+        }
+
+        char* row = reader->buffer + reader->start;
+        size_t length = row_end - reader->start;
+        reader->start = row_end < reader->end ? row_end + 1 : row_end;
+        reader->line = reader->next_line;
+        reader->next_line += newlines + 1;
+        if (length > 0 && row[length - 1] == '\r') {
+            length--;
+        }
+        if (length > 0) {
+            return split_fields(reader, row, length, fields, max_fields);
+        }
+    }
+}
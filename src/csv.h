@@ -0,0 +1,40 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define CSV_BUFFER_SIZE (1024 * 1024) // bytes read at once, and the longest row
+
+
+// one field of a row. text points into the reader's buffer and stays valid
+// until the next row is read; quoted fields have their "" escapes undone.
+typedef struct {
+    const char* text;
+    uint32_t length;
+    int quoted;
+} CsvField;
+
+// rows of comma separated fields read from a file in large blocks. fields may
+// be double quoted, and quoted fields may hold commas, newlines and quotes
+// written as "". lines end in \n or \r\n, blank lines are skipped.
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t start;      // unread bytes are buffer[start, end)
+    size_t end;
+    int eof;
+    int64_t line;      // line the last row read starts on, from 1
+    int64_t next_line;
+} CsvReader;
+
+// 0 on success, -1 if the file cannot be opened
+int csv_open(CsvReader* reader, const char* filename);
+void csv_close(CsvReader* reader);
+
+// the fields of the next row, up to max_fields. returns how many, 0 at the end
+// of the file and -1 for a malformed row, one longer than CSV_BUFFER_SIZE or
+// one with more than max_fields fields.
+int csv_next_row(CsvReader* reader, CsvField* fields, int max_fields);
+
+#endif // CSV_H
@@ -1,9 +1,15 @@
 #include "database.h"
 #include "btree.h"
 #include "wal.h"
+#include "row.h"
+#include "parser.h"
+#include "executor.h"
+#include "stats.h"
+#include "csv.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 Database* db_open(const char* filename) {
     Database* db = (Database*)malloc(sizeof(Database));
@@ -24,1018 +30,2203 @@ Database* db_open(const char* filename) {
         return NULL;
     }
 
-    db->wal = wal_init("wal.log");
+    // each database file has its own log, page ids are only meaningful per file
+    char wal_filename[512];
+    snprintf(wal_filename, sizeof(wal_filename), "%s.wal", filename);
+    db->wal = wal_init(wal_filename);
     if (db->wal == NULL) {
         pager_close(db->pager);
-        free(db->pool);
+        buffer_pool_free(db->pool);
         free(db);
         return NULL;
     }
 
-    db->root_page_id = 0;
-
-    if (db->pager->next_page_id == 0) {
-        // new database, create root page
-        Page* root_page = buffer_pool_get_page(db->pool, db->pager, 0);
-        BTreeLeafNode* root_node = (BTreeLeafNode*)root_page;
-        root_node->header.is_leaf = 1;
-        root_node->header.num_keys = 0;
-        root_node->next_leaf = 0;
-        db->pager->next_page_id++;
-        buffer_pool_unpin_page(db->pool, db->pager, 0, 1);
-
-        // initialize catalog on page 1
-        Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-        db->catalog = (Catalog*)malloc(sizeof(Catalog));
-        memcpy(db->catalog, catalog_page->data, sizeof(Catalog));
-        db->catalog->num_tables = 0;
-        db->pager->next_page_id++;
-        buffer_pool_unpin_page(db->pool, db->pager, 1, 1);
+    int created = db->pager->next_page_id == 0;
+    if (created) {
+        // new database: a leftover log belongs to a previous file of the same name
+        wal_truncate(db->wal);
+        db->root_page_id = btree_create(db->pool, db->pager, db->wal);
     } else {
-        // load catalog from page 1
-        Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-        db->catalog = (Catalog*)malloc(sizeof(Catalog));
-        memcpy(db->catalog, catalog_page->data, sizeof(Catalog));
-        buffer_pool_unpin_page(db->pool, db->pager, 1, 0);
+        db->root_page_id = 0;
     }
 
-    // recover all tables, not just the root page
-    for (int i = 0; i < db->catalog->num_tables; i++) {
-        wal_recover(db->pool, db->pager, db->wal, db->catalog->tables[i].root_page_id);
+    // replay page changes the data file is missing, one redo worker per core.
+    // the catalog trees are logged like any other, so they are read after
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (wal_recover_parallel(db->pool, db->pager, db->wal, num_cpus > 0 ? (int)num_cpus : 1) != 0) {
+        wal_close(db->wal);
+        pager_close(db->pager);
+        buffer_pool_free(db->pool);
+        free(db);
+        return NULL;
+    }
+
+    db->catalog = (Catalog*)malloc(sizeof(Catalog));
+    if (db->catalog == NULL || catalog_open(db->catalog, db->pool, db->pager, db->wal, created) != 0) {
+        if (db->catalog != NULL) {
+            catalog_close(db->catalog);
+        }
+        free(db->catalog);
+        wal_close(db->wal);
+        pager_close(db->pager);
+        buffer_pool_free(db->pool);
+        free(db);
+        return NULL;
+    }
+    if (created) {
+        buffer_pool_flush_all(db->pool, db->pager);
     }
 
-    db->current_tx_id = 0;
+    db->current_tx_id = db->wal->last_tx_id;
     db->locked = 0;
+    db->schema_version = 0;
+    db->num_open_cursors = 0;
+    db->sort_memory = SORT_MEMORY_BUDGET;
 
     return db;
 }
 
 void db_close(Database* db) {
     if (db != NULL) {
-        // flush catalog to disk
-        Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-        memcpy(catalog_page->data, db->catalog, sizeof(Catalog));
-        buffer_pool_unpin_page(db->pool, db->pager, 1, 1);
-
+        // a checkpoint: once the data file holds every change the log before
+        // here needs no redo. an open transaction is left for recovery to undo.
         buffer_pool_flush_all(db->pool, db->pager);
+        if (!db->locked && pager_sync(db->pager) == 0) {
+            wal_log_checkpoint(db->wal);
+        }
         wal_close(db->wal);
         pager_close(db->pager);
-        free(db->pool);
+        buffer_pool_free(db->pool);
+        catalog_close(db->catalog);
         free(db->catalog);
         free(db);
     }
 }
 
-// Helper function to extract column value from serialized data
-static char* extract_column_value(const char* serialized_data, int column_index) {
-    if (serialized_data == NULL) {
-        return NULL;
+static TableSchema* find_table(Database* db, const char* table_name) {
+    return catalog_find_table(db->catalog, table_name);
+}
+
+static int get_column_index(const TableSchema* table, const char* column_name) {
+    return catalog_find_column(table, column_name);
+}
+
+// indexes map an INT column value to the primary key, stored as an int32
+static int index_key_for_row(const RowLayout* layout, const char* row, int column_index, int* index_key) {
+    if (column_index < 0 || layout->types[column_index] != COLUMN_TYPE_INT || row_is_null(layout, row, column_index)) {
+        return 0;
     }
-    
-    char* data_copy = strdup(serialized_data);
-    char* token = strtok(data_copy, "|");
-    int current_index = 0;
-    
-    while (token != NULL && current_index <= column_index) {
-        if (current_index == column_index) {
-            char* result = strdup(token);
-            free(data_copy);
-            return result;
-        }
-        token = strtok(NULL, "|");
-        current_index++;
+    *index_key = row_get_int(layout, row, column_index);
+    return 1;
+}
+
+// bit i is set for each column i an index entry holds: the key, the primary
+// key and the INCLUDE columns
+static uint32_t index_columns(const TableSchema* table, const IndexSchema* index) {
+    uint32_t columns = 1u << 0;
+    int column_index = get_column_index(table, index->column_name);
+    if (column_index >= 0) {
+        columns |= 1u << column_index;
     }
-    
-    free(data_copy);
-    return NULL;
+    for (int i = 0; i < index->num_include_columns; i++) {
+        columns |= 1u << index->include_columns[i];
+    }
+    return columns;
 }
 
-// Helper function to get column index by name
-static int get_column_index(TableSchema* table, const char* column_name) {
-    for (int i = 0; i < table->num_columns; i++) {
-        if (strcmp(table->columns[i].name, column_name) == 0) {
-            return i;
+// an index entry is the row's primary key, or for an index with INCLUDE
+// columns the row itself with every column the index does not hold set to
+// null, so index-only scans decode it like a table row. never longer than
+// the row. columns is the index's index_columns, worked out once per index.
+static void index_entry(const RowLayout* layout, const IndexSchema* index, uint32_t columns, int32_t primary_key,
+                        const char* row, char* entry, uint16_t* length) {
+    if (index->num_include_columns == 0) {
+        memcpy(entry, &primary_key, sizeof(int32_t));
+        *length = sizeof(int32_t);
+        return;
+    }
+    Value values[MAX_COLUMNS_PER_TABLE];
+    for (int i = 0; i < layout->num_columns; i++) {
+        if (columns & (1u << i)) {
+            row_get_value(layout, row, i, &values[i]);
+        } else {
+            value_set_null(&values[i], layout->types[i]);
         }
     }
-    return -1;
+    row_encode(layout, values, entry, length);
+}
+
+typedef struct {
+    int32_t key;
+    int position;
+} KeyedRow;
+
+static int compare_keyed_rows(const void* a, const void* b) {
+    const KeyedRow* x = (const KeyedRow*)a;
+    const KeyedRow* y = (const KeyedRow*)b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (x->position > y->position) - (x->position < y->position);
+}
+
+// insert values into one tree in key order, so the keys that land in the same
+// leaf are added and logged together. values with the same key keep their
+// order and the last one wins, as when inserted one at a time.
+static void insert_sorted(Database* db, uint32_t root_page_id, KeyedRow* order, const char* const* values,
+                          const uint16_t* lengths, int count, Arena* arena) {
+    qsort(order, count, sizeof(KeyedRow), compare_keyed_rows);
+    int* keys = (int*)arena_alloc(arena, sizeof(int) * count);
+    const char** sorted = (const char**)arena_alloc(arena, sizeof(char*) * count);
+    uint16_t* sorted_lengths = (uint16_t*)arena_alloc(arena, sizeof(uint16_t) * count);
+    for (int i = 0; i < count; i++) {
+        keys[i] = order[i].key;
+        sorted[i] = values[order[i].position];
+        sorted_lengths[i] = lengths[order[i].position];
+    }
+    btree_insert_batch(db->pool, db->pager, db->wal, db->current_tx_id, root_page_id, keys, sorted, sorted_lengths, count);
+}
+
+// the primary key of the row an index entry belongs to
+static int32_t index_entry_row(const RowLayout* layout, const IndexSchema* index, const char* entry) {
+    if (index->num_include_columns == 0) {
+        int32_t primary_key;
+        memcpy(&primary_key, entry, sizeof(int32_t));
+        return primary_key;
+    }
+    return row_get_int(layout, entry, 0);
 }
 
-// Helper function to insert into all indexes for a table
-static void maintain_indexes_insert(Database* db, TableSchema* table, int primary_key, const char* serialized_data) {
+// an index holds one entry per value, so only a UNIQUE one, whose values are
+// never shared, has an entry for every row; the planner reads through no other
+static int index_holds_every_row(const IndexSchema* index) {
+    return index->is_unique;
+}
+
+// how many of the new rows, from the first, can be added without a value
+// repeating in a UNIQUE index: one another row already holds, or one of the
+// rows before it in the batch. the first row past that is reported.
+static int unique_prefix(Database* db, TableSchema* table, const RowLayout* layout, const int32_t* keys, const char* const* rows,
+                         int count, Arena* arena) {
+    int prefix = count;
+    KeyedRow* order = (KeyedRow*)arena_alloc(arena, sizeof(KeyedRow) * count);
+    const IndexSchema* violated = NULL;
+    int violating_key = 0;
     for (int i = 0; i < table->num_indexes; i++) {
         IndexSchema* index = &table->indexes[i];
+        if (!index->is_unique) {
+            continue;
+        }
         int column_index = get_column_index(table, index->column_name);
-        
-        if (column_index >= 0) {
-            char* column_value = extract_column_value(serialized_data, column_index);
-            if (column_value != NULL) {
-                int index_key;
-                
-                // for now, only support integer columns for indexing
-                if (table->columns[column_index].type == COLUMN_TYPE_INT) {
-                    index_key = atoi(column_value);
-                    
-                    // create index value: primary_key (to point back to main table)
-                    char index_value[32];
-                    snprintf(index_value, sizeof(index_value), "%d", primary_key);
-                    
-                    btree_insert(db->pool, db->pager, index->root_page_id, index_key, index_value, db->locked);
-                }
-                free(column_value);
+        int n = 0;
+        for (int j = 0; j < prefix; j++) {
+            int index_key;
+            if (!index_key_for_row(layout, rows[j], column_index, &index_key)) {
+                continue;
+            }
+            order[n].key = index_key;
+            order[n].position = j;
+            n++;
+        }
+        qsort(order, n, sizeof(KeyedRow), compare_keyed_rows);
+        for (int j = 0; j < n; j++) {
+            int position = order[j].position;
+            int repeated = j > 0 && order[j - 1].key == order[j].key && keys[order[j - 1].position] != keys[position];
+            if (!repeated) {
+                uint16_t length;
+                char* entry = btree_search(db->pool, db->pager, index->root_page_id, order[j].key, &length);
+                repeated = entry != NULL && index_entry_row(layout, index, entry) != keys[position];
+                free(entry);
+            }
+            if (repeated && position < prefix) {
+                prefix = position;
+                violated = index;
+                violating_key = order[j].key;
             }
         }
     }
+    if (violated != NULL) {
+        fprintf(stderr, "error: duplicate value %d in unique index %s.\n", violating_key, violated->name);
+    }
+    return prefix;
 }
 
-// Helper function to delete from all indexes for a table
-static void maintain_indexes_delete(Database* db, TableSchema* table, int primary_key, const char* serialized_data) {
+// add encoded rows to the table and their entries to each of its indexes, a
+// tree at a time
+static void insert_rows(Database* db, TableSchema* table, const RowLayout* layout, const int32_t* keys, const char* const* rows,
+                        const uint16_t* lengths, int count, Arena* arena) {
+    KeyedRow* order = (KeyedRow*)arena_alloc(arena, sizeof(KeyedRow) * count);
+    for (int i = 0; i < count; i++) {
+        order[i].key = keys[i];
+        order[i].position = i;
+    }
+    insert_sorted(db, table->root_page_id, order, rows, lengths, count, arena);
+
+    const char** entries = (const char**)arena_alloc(arena, sizeof(char*) * count);
+    uint16_t* entry_lengths = (uint16_t*)arena_alloc(arena, sizeof(uint16_t) * count);
     for (int i = 0; i < table->num_indexes; i++) {
         IndexSchema* index = &table->indexes[i];
         int column_index = get_column_index(table, index->column_name);
-        
-        if (column_index >= 0) {
-            char* column_value = extract_column_value(serialized_data, column_index);
-            if (column_value != NULL) {
-                int index_key;
-                
-                // for now, only support integer columns for indexing
-                if (table->columns[column_index].type == COLUMN_TYPE_INT) {
-                    index_key = atoi(column_value);
-                    btree_delete(db->pool, db->pager, index->root_page_id, index_key, db->locked);
-                }
-                free(column_value);
+        uint32_t columns = index_columns(table, index);
+        int n = 0;
+        for (int j = 0; j < count; j++) {
+            int index_key;
+            if (!index_key_for_row(layout, rows[j], column_index, &index_key)) {
+                continue;
             }
+            char* entry = (char*)arena_alloc(arena, lengths[j] > sizeof(int32_t) ? lengths[j] : sizeof(int32_t));
+            index_entry(layout, index, columns, keys[j], rows[j], entry, &entry_lengths[n]);
+            entries[n] = entry;
+            order[n].key = index_key;
+            order[n].position = n;
+            n++;
+        }
+        insert_sorted(db, index->root_page_id, order, entries, entry_lengths, n, arena);
+    }
+}
+
+// type a literal: as the column it is compared with, else from its spelling
+static int literal_value(Value* value, const Expr* literal, int has_type, ColumnType type) {
+    if (!has_type) {
+        switch (literal->literal_kind) {
+            case LITERAL_INTEGER: type = COLUMN_TYPE_INT; break;
+            case LITERAL_FLOAT: type = COLUMN_TYPE_DOUBLE; break;
+            case LITERAL_BOOLEAN: type = COLUMN_TYPE_BOOLEAN; break;
+            default: type = COLUMN_TYPE_TEXT; break;
         }
     }
+    if (literal->literal_kind == LITERAL_NULL) {
+        value_set_null(value, type);
+        return 0;
+    }
+    return value_parse(value, type, literal->text, literal->text_length);
 }
 
-// Helper function to find a usable index for a WHERE condition
-static IndexSchema* find_usable_index(TableSchema* table, const char* column_name, const char* operator) {
-    // for now, only optimize equality conditions
-    if (strcmp(operator, "=") != 0) {
-        return NULL;
+// give a literal or placeholder the type of the column it is used with
+static int type_operand(Expr* expr, ColumnType type) {
+    if (expr->type == EXPR_LITERAL) {
+        return literal_value(&expr->value, expr, 1, type);
     }
-    
-    for (int i = 0; i < table->num_indexes; i++) {
-        if (strcmp(table->indexes[i].column_name, column_name) == 0) {
-            return &table->indexes[i];
+    if (expr->type == EXPR_PARAMETER) {
+        expr->has_type = 1;
+        expr->value.type = type;
+    }
+    return 0;
+}
+
+// number a column reference across the table and the joined one, if any,
+// whose columns follow the table's. -1 if no table or more than one has it.
+static int resolve_column(TableSchema* table, TableSchema* joined, const Expr* column) {
+    TableSchema* tables[2] = {table, joined};
+    int column_index = -1;
+    int offset = 0;
+    int table_found = 0;
+    for (int i = 0; i < 2 && tables[i] != NULL; i++) {
+        if (column->table_name[0] == '\0' || strcmp(column->table_name, tables[i]->table_name) == 0) {
+            table_found = 1;
+            int found = get_column_index(tables[i], column->name);
+            if (found != -1 && column_index != -1) {
+                fprintf(stderr, "error: column %s is ambiguous.\n", column->name);
+                return -1;
+            }
+            if (found != -1) {
+                column_index = offset + found;
+            }
         }
+        offset += tables[i]->num_columns;
     }
-    return NULL;
+    if (!table_found) {
+        fprintf(stderr, "error: table %s not found.\n", column->table_name);
+    } else if (column_index == -1) {
+        fprintf(stderr, "error: column %s not found.\n", column->name);
+    }
+    return column_index;
 }
 
-// Helper function to execute index-based lookup
-static Result* execute_index_lookup(Database* db, TableSchema* table, IndexSchema* index, const char* search_value) {
-    int search_key = atoi(search_value);
-    
-    // search the index B-tree for the key
-    char* primary_key_str = btree_search(db->pool, db->pager, index->root_page_id, search_key);
-    if (primary_key_str == NULL) {
-        return NULL; // no matching index entry
+// the schema of a column numbered by resolve_column
+static ColumnSchema* resolved_column(TableSchema* table, TableSchema* joined, int column_index) {
+    if (column_index < table->num_columns) {
+        return &table->columns[column_index];
     }
-    
-    int primary_key = atoi(primary_key_str);
-    free(primary_key_str);
-    
-    // fetch the full record from the main table using the primary key
-    char* record_data = btree_search(db->pool, db->pager, table->root_page_id, primary_key);
-    if (record_data == NULL) {
-        return NULL; // record not found in main table
+    return &joined->columns[column_index - table->num_columns];
+}
+
+// bind column references to the schema and give literals their types. with
+// a joined table columns are numbered across both, as in the joined rows.
+static int resolve_expr(TableSchema* table, TableSchema* joined, Expr* expr) {
+    if (expr == NULL) {
+        return 0;
+    }
+    switch (expr->type) {
+        case EXPR_COLUMN:
+            expr->column_index = resolve_column(table, joined, expr);
+            return expr->column_index == -1 ? -1 : 0;
+        case EXPR_LITERAL:
+            return literal_value(&expr->value, expr, 0, COLUMN_TYPE_INT);
+        case EXPR_PARAMETER:
+            return 0;
+        case EXPR_COMPARE:
+            if (resolve_expr(table, joined, expr->left) != 0 || resolve_expr(table, joined, expr->right) != 0) {
+                return -1;
+            }
+            // compare a literal as the type of the column on the other side
+            if (expr->left->type == EXPR_COLUMN) {
+                return type_operand(expr->right, resolved_column(table, joined, expr->left->column_index)->type);
+            }
+            if (expr->right->type == EXPR_COLUMN) {
+                return type_operand(expr->left, resolved_column(table, joined, expr->right->column_index)->type);
+            }
+            return 0;
+        default:
+            if (resolve_expr(table, joined, expr->left) != 0 || resolve_expr(table, joined, expr->right) != 0) {
+                return -1;
+            }
+            return 0;
     }
-    
-    // create result with single row
-    Result* result = (Result*)malloc(sizeof(Result));
-    result->num_rows = 1;
-    result->rows = (char***)malloc(sizeof(char**));
-    result->rows[0] = (char**)malloc(sizeof(char*) * table->num_columns);
-    
-    // parse the record data
-    char* value_copy = strdup(record_data);
-    char* token = strtok(value_copy, "|");
-    int col = 0;
-    while (token != NULL && col < table->num_columns) {
-        result->rows[0][col] = (char*)malloc(strlen(token) + 1);
-        strcpy(result->rows[0][col], token);
-        token = strtok(NULL, "|");
-        col++;
-    }
-    free(value_copy);
-    free(record_data);
-    
-    return result;
 }
 
-Result* db_execute(Database* db, const char* query) {
-    if (strncmp(query, "BEGIN", 5) == 0) {
-        if (db->locked) {
-            fprintf(stderr, "error: another transaction is already in progress.\n");
-            return NULL;
+// the operator that gives the same answer with the operands swapped
+static CompareOp flip_compare(CompareOp op) {
+    switch (op) {
+        case COMPARE_LT: return COMPARE_GT;
+        case COMPARE_LE: return COMPARE_GE;
+        case COMPARE_GT: return COMPARE_LT;
+        case COMPARE_GE: return COMPARE_LE;
+        default: return op;
+    }
+}
+
+// collect the bounds the conjuncts of where put on a column. an equality sets
+// both sides, otherwise the first bound found on a side is kept; the filter
+// above the scan still checks every condition, so bounds only need to be safe.
+static void find_bounds(const Expr* where, int column_index, KeyBounds* bounds) {
+    if (where == NULL) {
+        return;
+    }
+    if (where->type == EXPR_AND) {
+        find_bounds(where->left, column_index, bounds);
+        find_bounds(where->right, column_index, bounds);
+        return;
+    }
+    if (where->type != EXPR_COMPARE) {
+        return;
+    }
+    const Expr* value;
+    CompareOp op = where->op;
+    if (where->left->type == EXPR_COLUMN && where->left->column_index == column_index) {
+        value = where->right;
+    } else if (where->right->type == EXPR_COLUMN && where->right->column_index == column_index) {
+        value = where->left;
+        op = flip_compare(op);
+    } else {
+        return;
+    }
+    if (value->type != EXPR_PARAMETER && (value->type != EXPR_LITERAL || value->value.is_null)) {
+        return;
+    }
+
+    switch (op) {
+        case COMPARE_EQ:
+            bounds->lower = value;
+            bounds->upper = value;
+            bounds->lower_inclusive = 1;
+            bounds->upper_inclusive = 1;
+            break;
+        case COMPARE_GT:
+        case COMPARE_GE:
+            if (bounds->lower == NULL) {
+                bounds->lower = value;
+                bounds->lower_inclusive = op == COMPARE_GE;
+            }
+            break;
+        case COMPARE_LT:
+        case COMPARE_LE:
+            if (bounds->upper == NULL) {
+                bounds->upper = value;
+                bounds->upper_inclusive = op == COMPARE_LE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// 3 for a single key, 2 for a closed range, 1 for a half-open one, 0 for none
+static int bounds_rank(const KeyBounds* bounds) {
+    if (bounds->lower != NULL && bounds->lower == bounds->upper) {
+        return 3;
+    }
+    return (bounds->lower != NULL) + (bounds->upper != NULL);
+}
+
+// planner cost units: reading a page in key order is 1, jumping to one is 4,
+// and checking a row is a small fraction of either
+#define SEQ_PAGE_COST 1.0
+#define RANDOM_PAGE_COST 4.0
+#define CPU_ROW_COST 0.01
+#define DEFAULT_RANGE_SELECTIVITY (1.0 / 3.0) // each side bounded by a placeholder
+
+// fraction of a table's rows an INT key's bounds select, from the column's
+// statistics. placeholders are unknown until execution and get a default.
+static double bounds_selectivity(const TableStats* stats, int column_index, const KeyBounds* bounds) {
+    const ColumnStats* column = &stats->columns[column_index];
+    double rows = stats->num_rows > 0 ? (double)stats->num_rows : 1;
+    double non_null = (rows - (double)column->num_nulls) / rows;
+    double selectivity;
+
+    if (bounds->lower != NULL && bounds->lower == bounds->upper) {
+        selectivity = column->num_distinct > 0 ? non_null / (double)column->num_distinct : 0;
+        // a literal outside the histogram matches next to nothing
+        if (bounds->lower->type == EXPR_LITERAL && column->num_bounds > 0) {
+            double key = (double)bounds->lower->value.int_value;
+            if (key < column->bounds[0] || key > column->bounds[column->num_bounds - 1]) {
+                selectivity = 0;
+            }
         }
-        db->locked = 1;
-        db->current_tx_id++;
-        wal_log_begin(db->wal, db->current_tx_id);
-        return NULL;
-    } else if (strncmp(query, "COMMIT", 6) == 0) {
-        if (!db->locked) {
-            fprintf(stderr, "error: no active transaction to commit.\n");
-            return NULL;
+    } else {
+        // the half-open interval [low, high) of integers the bounds admit
+        double low_fraction = 0;
+        double high_fraction = 1;
+        double unknown = 1;
+        if (bounds->lower != NULL) {
+            if (bounds->lower->type == EXPR_PARAMETER || column->num_bounds == 0) {
+                unknown *= DEFAULT_RANGE_SELECTIVITY;
+            } else {
+                double low = (double)bounds->lower->value.int_value + !bounds->lower_inclusive;
+                low_fraction = stats_fraction_below(column, low);
+            }
         }
-        wal_log_commit(db->wal, db->current_tx_id);
-        buffer_pool_flush_all(db->pool, db->pager);
-        db->locked = 0;
-        return NULL;
-    } else if (strncmp(query, "ROLLBACK", 8) == 0) {
-        if (!db->locked) {
-            fprintf(stderr, "error: no active transaction to rollback.\n");
-            return NULL;
+        if (bounds->upper != NULL) {
+            if (bounds->upper->type == EXPR_PARAMETER || column->num_bounds == 0) {
+                unknown *= DEFAULT_RANGE_SELECTIVITY;
+            } else {
+                double high = (double)bounds->upper->value.int_value + bounds->upper_inclusive;
+                high_fraction = stats_fraction_below(column, high);
+            }
         }
-        // rollback by reinitializing buffer pool
-        char filename_copy[256];
-        strcpy(filename_copy, db->pager->filename);
+        selectivity = high_fraction > low_fraction ? (high_fraction - low_fraction) * unknown * non_null : 0;
+    }
 
-        pager_close(db->pager);
-        free(db->pool);
+    // at least one row, so empty estimates still prefer the cheaper path
+    if (selectivity < 1 / rows) {
+        selectivity = 1 / rows;
+    }
+    return selectivity > 1 ? 1 : selectivity;
+}
 
-        db->pager = pager_open(filename_copy);
-        db->pool = buffer_pool_init();
-        
-        // reload catalog from disk after reopening pager
-        Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-        memcpy(db->catalog, catalog_page->data, sizeof(Catalog));
-        buffer_pool_unpin_page(db->pool, db->pager, 1, 0);
-        
-        // recover only committed transactions, excluding the current one being rolled back
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            wal_apply_committed_transactions(db->pool, db->pager, db->catalog->tables[i].root_page_id, db->current_tx_id);
+// estimated cost of reading the rows in bounds of a table's own tree: one
+// descent, then the leaves in order. an index reads its own leaves too, but
+// fetching each row it finds from the table is a random page read; an
+// index-only scan is costed like a primary key range, its entries are never
+// larger than the rows.
+static double access_cost(const TableStats* stats, AccessPath access, int index_only, double selectivity) {
+    double rows = (double)stats->num_rows;
+    double pages = stats->num_pages > 0 ? (double)stats->num_pages : 1;
+    if (access == ACCESS_INDEX && index_only) {
+        access = ACCESS_PRIMARY_KEY;
+    }
+    switch (access) {
+        case ACCESS_PRIMARY_KEY:
+            return RANDOM_PAGE_COST + selectivity * pages * SEQ_PAGE_COST + selectivity * rows * CPU_ROW_COST;
+        case ACCESS_INDEX:
+            return RANDOM_PAGE_COST + selectivity * rows * (RANDOM_PAGE_COST + CPU_ROW_COST);
+        default:
+            return pages * SEQ_PAGE_COST + rows * CPU_ROW_COST;
+    }
+}
+
+// choose how a SELECT reads its table: a full scan, or a range of a key column
+// the WHERE clause bounds, over an index or the primary key the table is
+// stored by. indexes only cover INT columns, and only UNIQUE ones every row. once ANALYZE has gathered
+// statistics the cheapest estimate wins, so a predicate that keeps most rows
+// scans rather than probing the table for each of them. before that the
+// tightest bounds win and, on a tie, the first index. an index whose entries
+// hold every column the query reads (a bit per column in columns) is scanned
+// without touching the table.
+static void plan_access_path(PreparedStatement* prepared, const Expr* where, uint32_t columns) {
+    TableSchema* table = prepared->table;
+    const TableStats* stats = &table->stats;
+    prepared->access = ACCESS_SEQ_SCAN;
+    prepared->index_only = 0;
+    prepared->estimated_rows = (double)stats->num_rows;
+    memset(&prepared->bounds, 0, sizeof(KeyBounds));
+
+    if (stats->analyzed) {
+        double best_cost = access_cost(stats, ACCESS_SEQ_SCAN, 0, 1);
+        for (int i = -1; i < table->num_indexes; i++) {
+            // only a path that returns every match is worth a cost
+            int column_index = i < 0 ? 0 : get_column_index(table, table->indexes[i].column_name);
+            if (column_index < 0 || table->columns[column_index].type != COLUMN_TYPE_INT ||
+                (i >= 0 && !index_holds_every_row(&table->indexes[i]))) {
+                continue;
+            }
+            KeyBounds bounds;
+            memset(&bounds, 0, sizeof(KeyBounds));
+            find_bounds(where, column_index, &bounds);
+            if (bounds_rank(&bounds) == 0) {
+                continue;
+            }
+            AccessPath access = i < 0 ? ACCESS_PRIMARY_KEY : ACCESS_INDEX;
+            int index_only = i >= 0 && (columns & ~index_columns(table, &table->indexes[i])) == 0;
+            double selectivity = bounds_selectivity(stats, column_index, &bounds);
+            double cost = access_cost(stats, access, index_only, selectivity);
+            if (cost < best_cost) {
+                best_cost = cost;
+                prepared->estimated_rows = selectivity * (double)stats->num_rows;
+                prepared->access = access;
+                prepared->index = i < 0 ? NULL : &table->indexes[i];
+                prepared->index_only = index_only;
+                prepared->bounds = bounds;
+            }
         }
+        return;
+    }
 
-        if (db->pager == NULL || db->pool == NULL) {
-            fprintf(stderr, "error during rollback: failed to re-initialize database components.\n");
-            exit(EXIT_FAILURE);
+    int best = 0;
+    for (int i = 0; i < table->num_indexes; i++) {
+        int column_index = get_column_index(table, table->indexes[i].column_name);
+        if (column_index < 0 || table->columns[column_index].type != COLUMN_TYPE_INT ||
+            !index_holds_every_row(&table->indexes[i])) {
+            continue;
+        }
+        KeyBounds bounds;
+        memset(&bounds, 0, sizeof(KeyBounds));
+        find_bounds(where, column_index, &bounds);
+        if (bounds_rank(&bounds) > best) {
+            best = bounds_rank(&bounds);
+            prepared->access = ACCESS_INDEX;
+            prepared->index = &table->indexes[i];
+            prepared->index_only = (columns & ~index_columns(table, &table->indexes[i])) == 0;
+            prepared->bounds = bounds;
         }
-        db->locked = 0;
-        return NULL;
-    } else if (strncmp(query, "CREATE TABLE", 12) == 0) {
-        if (db->locked) {
-            fprintf(stderr, "error: create table statements must not be within a transaction.\n");
-            return NULL;
+    }
+
+    if (table->columns[0].type == COLUMN_TYPE_INT) {
+        KeyBounds bounds;
+        memset(&bounds, 0, sizeof(KeyBounds));
+        find_bounds(where, 0, &bounds);
+        if (bounds_rank(&bounds) > best) {
+            prepared->access = ACCESS_PRIMARY_KEY;
+            prepared->index = NULL;
+            prepared->index_only = 0;
+            prepared->bounds = bounds;
         }
-        char table_name[MAX_NAME_LEN];
-        char column_defs[256];
-        
-        // find the opening parenthesis
-        char* start = strchr(query, '(');
-        if (start == NULL) {
-            fprintf(stderr, "error: invalid create table syntax.\n");
-            return NULL;
+    }
+}
+
+// append a row of num_columns cells, the rows array doubles in the result's arena
+static char** result_add_row(Result* result, int* capacity) {
+    if (result->num_rows == *capacity) {
+        int new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+        result->rows = (char***)arena_grow(&result->arena, result->rows, sizeof(char**) * *capacity, sizeof(char**) * new_capacity);
+        *capacity = new_capacity;
+    }
+    char** columns = (char**)arena_alloc(&result->arena, sizeof(char*) * (result->num_columns + 1));
+    result->rows[result->num_rows++] = columns;
+    return columns;
+}
+
+// decode every column of a stored row
+static void decode_row(const RowLayout* layout, const char* row, Value* values) {
+    for (int i = 0; i < layout->num_columns; i++) {
+        row_get_value(layout, row, i, &values[i]);
+    }
+}
+
+static int plan_table(PreparedStatement* prepared, const char* table_name) {
+    prepared->table = find_table(prepared->db, table_name);
+    if (prepared->table == NULL) {
+        fprintf(stderr, "error: table %s not found.\n", table_name);
+        return -1;
+    }
+    row_layout_init(&prepared->layout, prepared->table);
+    return 0;
+}
+
+// whether value_hash gives equal hashes to equal values of the two types
+static int hash_compatible(ColumnType a, ColumnType b) {
+    if (!value_is_numeric(a) || !value_is_numeric(b)) {
+        return value_is_numeric(a) == value_is_numeric(b);
+    }
+    int a_floating = a == COLUMN_TYPE_FLOAT || a == COLUMN_TYPE_DOUBLE;
+    int b_floating = b == COLUMN_TYPE_FLOAT || b == COLUMN_TYPE_DOUBLE;
+    return a_floating || b_floating ? a == b : 1;
+}
+
+// equalities the ON condition requires between a column of the table and
+// one of the joined table, the first of each kind
+typedef struct {
+    int hash;                  // the columns' types hash alike
+    int hash_keys[2];
+    int lookup;                // INT columns, the joined one its primary key or uniquely indexed
+    int lookup_keys[2];
+    IndexSchema* lookup_index; // NULL for the primary key
+} JoinKeys;
+
+static void find_join_keys(TableSchema* table, TableSchema* joined, const Expr* condition, JoinKeys* keys) {
+    if (condition == NULL) {
+        return;
+    }
+    if (condition->type == EXPR_AND) {
+        find_join_keys(table, joined, condition->left, keys);
+        find_join_keys(table, joined, condition->right, keys);
+        return;
+    }
+    if (condition->type != EXPR_COMPARE || condition->op != COMPARE_EQ || condition->left->type != EXPR_COLUMN ||
+        condition->right->type != EXPR_COLUMN) {
+        return;
+    }
+    int left = condition->left->column_index;
+    int right = condition->right->column_index;
+    if (left > right) {
+        int swap = left;
+        left = right;
+        right = swap;
+    }
+    if (left >= table->num_columns || right < table->num_columns) {
+        return;  // both columns of the same table
+    }
+    right -= table->num_columns;
+    ColumnType left_type = table->columns[left].type;
+    ColumnType right_type = joined->columns[right].type;
+    if (!keys->hash && hash_compatible(left_type, right_type)) {
+        keys->hash = 1;
+        keys->hash_keys[0] = left;
+        keys->hash_keys[1] = right;
+    }
+    if (keys->lookup || left_type != COLUMN_TYPE_INT || right_type != COLUMN_TYPE_INT) {
+        return;
+    }
+    // a lookup finds one row per key, so it must go through an index that
+    // holds them all
+    keys->lookup = right == 0;
+    for (int i = 0; i < joined->num_indexes && !keys->lookup; i++) {
+        if (index_holds_every_row(&joined->indexes[i]) &&
+            get_column_index(joined, joined->indexes[i].column_name) == right) {
+            keys->lookup = 1;
+            keys->lookup_index = &joined->indexes[i];
         }
-        start++; // skip the opening parenthesis
-        
-        // find the matching closing parenthesis
-        char* end = strrchr(query, ')');
-        if (end == NULL || end <= start) {
-            fprintf(stderr, "error: invalid create table syntax.\n");
-            return NULL;
+    }
+    if (keys->lookup) {
+        keys->lookup_keys[0] = left;
+        keys->lookup_keys[1] = right;
+    }
+}
+
+// choose how a SELECT joins its second table. an equality between an INT
+// column of the table and the joined table's primary key or an indexed
+// column looks each row up; with statistics for both tables only if that is
+// cheaper than hashing the joined table. other equalities hash, and an ON
+// condition without one compares every pair.
+static void plan_join(PreparedStatement* prepared, const Expr* condition) {
+    TableSchema* table = prepared->table;
+    TableSchema* joined = prepared->join_table;
+    prepared->join = JOIN_NESTED_LOOP;
+    prepared->join_index = NULL;
+
+    JoinKeys keys;
+    memset(&keys, 0, sizeof(JoinKeys));
+    find_join_keys(table, joined, condition, &keys);
+    int lookup = keys.lookup;
+    if (lookup && keys.hash && table->stats.analyzed && joined->stats.analyzed) {
+        // one or two descents per outer row against one pass over the joined table
+        double outer_rows = prepared->estimated_rows;
+        const TableStats* stats = &joined->stats;
+        double lookup_cost = outer_rows * (RANDOM_PAGE_COST * (keys.lookup_index != NULL ? 2 : 1) + CPU_ROW_COST);
+        double hash_cost = stats->num_pages * SEQ_PAGE_COST + stats->num_rows * CPU_ROW_COST * 2 + outer_rows * CPU_ROW_COST;
+        lookup = lookup_cost <= hash_cost;
+    }
+    if (lookup) {
+        prepared->join = JOIN_INDEX_NESTED_LOOP;
+        prepared->join_index = keys.lookup_index;
+        prepared->join_keys[0] = keys.lookup_keys[0];
+        prepared->join_keys[1] = keys.lookup_keys[1];
+    } else if (keys.hash) {
+        prepared->join = JOIN_HASH;
+        prepared->join_keys[0] = keys.hash_keys[0];
+        prepared->join_keys[1] = keys.hash_keys[1];
+    }
+}
+
+// bit i is set for each column i the expression reads
+static uint32_t expr_columns(const Expr* expr) {
+    if (expr == NULL) {
+        return 0;
+    }
+    if (expr->type == EXPR_COLUMN) {
+        return 1u << expr->column_index;
+    }
+    return expr_columns(expr->left) | expr_columns(expr->right);
+}
+
+static int contains_aggregate(const Expr* expr) {
+    if (expr == NULL) {
+        return 0;
+    }
+    return expr->type == EXPR_AGGREGATE || contains_aggregate(expr->left) || contains_aggregate(expr->right);
+}
+
+static const char* aggregate_name(AggregateFunction function) {
+    switch (function) {
+        case AGGREGATE_COUNT: return "COUNT";
+        case AGGREGATE_SUM: return "SUM";
+        case AGGREGATE_MIN: return "MIN";
+        case AGGREGATE_MAX: return "MAX";
+        default: return "AVG";
+    }
+}
+
+// the position of a selected or ORDER BY expression in the aggregate's rows:
+// a GROUP BY column, or an aggregate added to the plan unless an identical
+// one is already computed. -1 for anything else.
+static int plan_aggregate_column(PreparedStatement* prepared, Expr* expr) {
+    TableSchema* table = prepared->table;
+    TableSchema* joined = prepared->join_table;
+    if (expr->type == EXPR_COLUMN) {
+        if (resolve_expr(table, joined, expr) != 0) {
+            return -1;
+        }
+        for (int i = 0; i < prepared->num_group_columns; i++) {
+            if (prepared->group_columns[i] == expr->column_index) {
+                return i;
+            }
         }
-        
-        // extract table name
-        sscanf(query, "CREATE TABLE %s", table_name);
-        
-        // extract column definitions
-        int len = end - start;
-        if (len >= 256) {
-            fprintf(stderr, "error: column definitions too long.\n");
-            return NULL;
+        fprintf(stderr, "error: column %s must appear in GROUP BY or be used in an aggregate.\n", expr->name);
+        return -1;
+    }
+    if (expr->type != EXPR_AGGREGATE) {
+        fprintf(stderr, "error: only columns and aggregates can be selected.\n");
+        return -1;
+    }
+
+    AggregateSpec spec;
+    spec.function = expr->function;
+    spec.column = -1;
+    if (expr->left != NULL) {
+        if (expr->left->type != EXPR_COLUMN) {
+            fprintf(stderr, "error: aggregates cannot be nested.\n");
+            return -1;
         }
-        strncpy(column_defs, start, len);
-        column_defs[len] = '\0';
-
-        TableSchema new_table;
-        strcpy(new_table.table_name, table_name);
-        new_table.root_page_id = db->pager->next_page_id; // assign a new root page id
-        new_table.num_columns = 0;
-        new_table.num_indexes = 0;
-
-        // parse column definitions
-        char* token = strtok(column_defs, ",");
-        while (token != NULL && new_table.num_columns < MAX_COLUMNS_PER_TABLE) {
-            // trim leading whitespace
-            while (*token == ' ' || *token == '\t') {
-                token++;
-            }
-            
-            char col_name[MAX_NAME_LEN];
-            char col_type[MAX_NAME_LEN];
-            sscanf(token, "%s %s", col_name, col_type);
-
-            ColumnSchema new_column;
-            strcpy(new_column.name, col_name);
-            if (strcmp(col_type, "INT") == 0) {
-                new_column.type = COLUMN_TYPE_INT;
-                new_column.length = 0;
-            } else if (strncmp(col_type, "VARCHAR", 7) == 0) {
-                sscanf(col_type, "VARCHAR(%hu)", &new_column.length);
-                new_column.type = COLUMN_TYPE_VARCHAR;
-            } else if (strcmp(col_type, "FLOAT") == 0) {
-                new_column.type = COLUMN_TYPE_FLOAT;
-                new_column.length = 0;
-            } else if (strcmp(col_type, "DOUBLE") == 0) {
-                new_column.type = COLUMN_TYPE_DOUBLE;
-                new_column.length = 0;
-            } else if (strcmp(col_type, "TEXT") == 0) {
-                new_column.type = COLUMN_TYPE_TEXT;
-                new_column.length = 0;
-            } else if (strcmp(col_type, "DATE") == 0) {
-                new_column.type = COLUMN_TYPE_DATE;
-                new_column.length = 0;
-            } else if (strcmp(col_type, "TIMESTAMP") == 0) {
-                new_column.type = COLUMN_TYPE_TIMESTAMP;
-                new_column.length = 0;
-            } else if (strcmp(col_type, "BOOLEAN") == 0) {
-                new_column.type = COLUMN_TYPE_BOOLEAN;
-                new_column.length = 0;
-            }
-            new_column.is_primary_key = (strstr(token, "PRIMARY KEY") != NULL);
-
-            new_table.columns[new_table.num_columns++] = new_column;
-            token = strtok(NULL, ",");
-        }
-
-        // add table to catalog
-        if (db->catalog->num_tables < MAX_TABLES) {
-            db->catalog->tables[db->catalog->num_tables++] = new_table;
-
-            // create root page for new table
-            Page* root_page = buffer_pool_get_page(db->pool, db->pager, new_table.root_page_id);
-            BTreeLeafNode* root_node = (BTreeLeafNode*)root_page;
-            root_node->header.is_leaf = 1;
-            root_node->header.num_keys = 0;
-            root_node->next_leaf = 0;
-            db->pager->next_page_id++;
-            buffer_pool_unpin_page(db->pool, db->pager, new_table.root_page_id, 1);
-            
-            // save updated catalog to disk
-            Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-            memcpy(catalog_page->data, db->catalog, sizeof(Catalog));
-            buffer_pool_unpin_page(db->pool, db->pager, 1, 1);
-        } else {
-            fprintf(stderr, "error: maximum number of tables reached.\n");
+        if (resolve_expr(table, joined, expr->left) != 0) {
+            return -1;
         }
-        return NULL;
-    } else if (strncmp(query, "CREATE INDEX", 12) == 0 || strncmp(query, "CREATE UNIQUE INDEX", 19) == 0) {
-        if (db->locked) {
-            fprintf(stderr, "error: create index statements must not be within a transaction.\n");
-            return NULL;
+        spec.column = expr->left->column_index;
+        ColumnType type = resolved_column(table, joined, spec.column)->type;
+        if ((spec.function == AGGREGATE_SUM || spec.function == AGGREGATE_AVG) && !value_is_numeric(type)) {
+            fprintf(stderr, "error: %s needs a numeric column.\n", aggregate_name(spec.function));
+            return -1;
         }
-        
-        char index_name[MAX_NAME_LEN];
-        char table_name[MAX_NAME_LEN];
-        char column_name[MAX_NAME_LEN];
-        int is_unique = 0;
-        
-        // check for UNIQUE keyword
-        if (strstr(query, "UNIQUE") != NULL) {
-            is_unique = 1;
-            sscanf(query, "CREATE UNIQUE INDEX %s ON %s", index_name, table_name);
-        } else {
-            sscanf(query, "CREATE INDEX %s ON %s", index_name, table_name);
+    }
+    for (int i = 0; i < prepared->num_aggregates; i++) {
+        if (prepared->aggregates[i].function == spec.function && prepared->aggregates[i].column == spec.column) {
+            return prepared->num_group_columns + i;
         }
-        
-        // extract column name from parentheses
-        char* start = strchr(query, '(');
-        char* end = strchr(query, ')');
-        if (start == NULL || end == NULL || end <= start) {
-            fprintf(stderr, "error: invalid create index syntax - missing parentheses.\n");
-            return NULL;
+    }
+    if (prepared->num_aggregates == MAX_COLUMNS_PER_TABLE * 2) {
+        fprintf(stderr, "error: too many aggregates.\n");
+        return -1;
+    }
+    prepared->aggregates[prepared->num_aggregates++] = spec;
+    return prepared->num_group_columns + prepared->num_aggregates - 1;
+}
+
+// with aggregates or GROUP BY the rows are grouped after the filter, and the
+// select list and ORDER BY are numbered over the grouped rows instead
+static int plan_grouping(PreparedStatement* prepared, SelectStatement* select) {
+    TableSchema* table = prepared->table;
+    TableSchema* joined = prepared->join_table;
+    if (select->select_star) {
+        fprintf(stderr, "error: SELECT * cannot be used with GROUP BY or aggregates.\n");
+        return -1;
+    }
+    if (select->num_group_by > MAX_COLUMNS_PER_TABLE * 2) {
+        fprintf(stderr, "error: too many GROUP BY columns.\n");
+        return -1;
+    }
+    prepared->aggregated = 1;
+    for (int i = 0; i < select->num_group_by; i++) {
+        if (resolve_expr(table, joined, select->group_by[i]) != 0) {
+            return -1;
         }
-        start++; // skip opening parenthesis
-        int col_len = end - start;
-        if (col_len >= MAX_NAME_LEN) {
-            fprintf(stderr, "error: column name too long.\n");
-            return NULL;
+        prepared->group_columns[prepared->num_group_columns++] = select->group_by[i]->column_index;
+    }
+    for (int i = 0; i < select->num_columns; i++) {
+        prepared->columns[i] = plan_aggregate_column(prepared, select->columns[i]);
+        if (prepared->columns[i] == -1) {
+            return -1;
         }
-        strncpy(column_name, start, col_len);
-        column_name[col_len] = '\0';
-        
-        // trim whitespace from column name
-        while (*column_name == ' ' || *column_name == '\t') {
-            memmove(column_name, column_name + 1, strlen(column_name));
+    }
+    // the sort reads ORDER BY expressions from the grouped rows
+    for (int i = 0; i < select->num_order_by; i++) {
+        Expr* expr = select->order_by[i].expr;
+        int column = plan_aggregate_column(prepared, expr);
+        if (column == -1) {
+            return -1;
+        }
+        expr->column_index = column;
+    }
+    return 0;
+}
+
+// the input is in the order of the access path's key as long as the join,
+// if any, keeps the order of the table's rows
+static void plan_group_order(PreparedStatement* prepared) {
+    if (prepared->num_group_columns != 1 || (prepared->join_table != NULL && prepared->join == JOIN_HASH)) {
+        return;
+    }
+    int order_column = 0;
+    if (prepared->access == ACCESS_INDEX) {
+        order_column = get_column_index(prepared->table, prepared->index->column_name);
+    }
+    prepared->group_ordered = prepared->group_columns[0] == order_column;
+}
+
+// the column the access path returns rows in the order of: the key of the
+// index scanned, or the primary key for both the key range and the full scan
+static int scan_order_column(const PreparedStatement* prepared) {
+    if (prepared->access == ACCESS_INDEX) {
+        return get_column_index(prepared->table, prepared->index->column_name);
+    }
+    return 0;
+}
+
+// whether every conjunct of where is one of the bounds the key range
+// scan applies, so the filter would pass every row the scan returns
+static int where_within_bounds(const Expr* where, int column_index, const KeyBounds* bounds) {
+    if (where->type == EXPR_AND) {
+        return where_within_bounds(where->left, column_index, bounds) && where_within_bounds(where->right, column_index, bounds);
+    }
+    if (where->type != EXPR_COMPARE || where->op == COMPARE_NE) {
+        return 0;
+    }
+    const Expr* column = where->left->type == EXPR_COLUMN ? where->left : where->right;
+    const Expr* value = column == where->left ? where->right : where->left;
+    return column->type == EXPR_COLUMN && column->column_index == column_index &&
+           (value == bounds->lower || value == bounds->upper);
+}
+
+// skip the sort when the rows already come in ORDER BY order, and step over
+// OFFSET rows in the scan when nothing between it and the limit drops or
+// reorders rows
+static void plan_order(PreparedStatement* prepared, SelectStatement* select) {
+    int order_column = scan_order_column(prepared);
+    if (select->num_order_by > 0 && !prepared->aggregated && (prepared->join_table == NULL || prepared->join != JOIN_HASH)) {
+        const Expr* first = select->order_by[0].expr;
+        // a unique primary key decides the order alone
+        prepared->ordered = first->type == EXPR_COLUMN && first->column_index == order_column && !select->order_by[0].descending &&
+                            (select->num_order_by == 1 || (order_column == 0 && prepared->join_table == NULL));
+    }
+    if (select->offset > 0 && !prepared->aggregated && prepared->join_table == NULL &&
+        (select->num_order_by == 0 || prepared->ordered)) {
+        prepared->offset_in_scan = select->where == NULL ||
+                                   (prepared->access != ACCESS_SEQ_SCAN && where_within_bounds(select->where, order_column, &prepared->bounds));
+    }
+}
+
+static int plan_select(PreparedStatement* prepared, SelectStatement* select) {
+    if (plan_table(prepared, select->table_name) != 0) {
+        return -1;
+    }
+    TableSchema* table = prepared->table;
+    TableSchema* joined = NULL;
+    if (select->join_table_name[0] != '\0') {
+        joined = find_table(prepared->db, select->join_table_name);
+        if (joined == NULL) {
+            fprintf(stderr, "error: table %s not found.\n", select->join_table_name);
+            return -1;
         }
-        char* col_end = column_name + strlen(column_name) - 1;
-        while (col_end > column_name && (*col_end == ' ' || *col_end == '\t')) {
-            *col_end-- = '\0';
+    }
+    prepared->join_table = joined;
+
+    if (resolve_expr(table, joined, select->join_condition) != 0 || resolve_expr(table, joined, select->where) != 0) {
+        return -1;
+    }
+    if (contains_aggregate(select->join_condition) || contains_aggregate(select->where)) {
+        fprintf(stderr, "error: aggregates are not allowed in %s.\n", contains_aggregate(select->where) ? "WHERE" : "ON");
+        return -1;
+    }
+    int aggregated = select->num_group_by > 0;
+    for (int i = 0; i < select->num_columns; i++) {
+        aggregated |= contains_aggregate(select->columns[i]);
+    }
+    for (int i = 0; i < select->num_order_by; i++) {
+        aggregated |= contains_aggregate(select->order_by[i].expr);
+    }
+    int width = table->num_columns + (joined != NULL ? joined->num_columns : 0);
+    prepared->num_columns = select->select_star ? width : select->num_columns;
+    if (prepared->num_columns > MAX_COLUMNS_PER_TABLE * 2) {
+        fprintf(stderr, "error: too many columns in select list.\n");
+        return -1;
+    }
+    if (aggregated) {
+        if (plan_grouping(prepared, select) != 0) {
+            return -1;
         }
-        
-        // find the target table
-        TableSchema* target_table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                target_table = &db->catalog->tables[i];
-                break;
-            }
+    }
+    for (int i = 0; i < prepared->num_columns && !aggregated; i++) {
+        if (select->select_star) {
+            prepared->columns[i] = i;
+            continue;
         }
-        
-        if (target_table == NULL) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            return NULL;
+        if (select->columns[i]->type != EXPR_COLUMN) {
+            fprintf(stderr, "error: only columns can be selected.\n");
+            return -1;
         }
-        
-        // verify column exists
-        int column_found = 0;
-        for (int i = 0; i < target_table->num_columns; i++) {
-            if (strcmp(target_table->columns[i].name, column_name) == 0) {
-                column_found = 1;
-                break;
-            }
+        if (resolve_expr(table, joined, select->columns[i]) != 0) {
+            return -1;
         }
-        
-        if (!column_found) {
-            fprintf(stderr, "error: column %s not found in table %s.\n", column_name, table_name);
-            return NULL;
+        prepared->columns[i] = select->columns[i]->column_index;
+    }
+    uint32_t columns = expr_columns(select->where) | expr_columns(select->join_condition);
+    if (aggregated) {
+        for (int i = 0; i < prepared->num_group_columns; i++) {
+            columns |= 1u << prepared->group_columns[i];
+        }
+        for (int i = 0; i < prepared->num_aggregates; i++) {
+            if (prepared->aggregates[i].column >= 0) {
+                columns |= 1u << prepared->aggregates[i].column;
+            }
         }
-        
-        // check if we can add more indexes
-        if (target_table->num_indexes >= MAX_INDEXES_PER_TABLE) {
-            fprintf(stderr, "error: maximum number of indexes reached for table %s.\n", table_name);
-            return NULL;
+    } else {
+        for (int i = 0; i < prepared->num_columns; i++) {
+            columns |= 1u << prepared->columns[i];
         }
-        
-        // check for duplicate index name
-        for (int i = 0; i < target_table->num_indexes; i++) {
-            if (strcmp(target_table->indexes[i].name, index_name) == 0) {
-                fprintf(stderr, "error: index %s already exists.\n", index_name);
-                return NULL;
+        for (int i = 0; i < select->num_order_by; i++) {
+            if (resolve_expr(table, joined, select->order_by[i].expr) != 0) {
+                return -1;
             }
+            columns |= expr_columns(select->order_by[i].expr);
         }
-        
-        // create new index
-        IndexSchema new_index;
-        strcpy(new_index.name, index_name);
-        strcpy(new_index.table_name, table_name);
-        strcpy(new_index.column_name, column_name);
-        new_index.type = INDEX_TYPE_BTREE;
-        new_index.root_page_id = db->pager->next_page_id;
-        new_index.is_unique = is_unique;
-        new_index.is_primary = 0;
-        
-        // add index to table
-        target_table->indexes[target_table->num_indexes++] = new_index;
-        
-        // create root page for new index
-        Page* index_root_page = buffer_pool_get_page(db->pool, db->pager, new_index.root_page_id);
-        BTreeLeafNode* index_root_node = (BTreeLeafNode*)index_root_page;
-        index_root_node->header.is_leaf = 1;
-        index_root_node->header.num_keys = 0;
-        index_root_node->next_leaf = 0;
-        db->pager->next_page_id++;
-        buffer_pool_unpin_page(db->pool, db->pager, new_index.root_page_id, 1);
-        
-        // populate index with existing data
-        uint32_t current_page_id = target_table->root_page_id;
-        Page* current_page = buffer_pool_get_page(db->pool, db->pager, current_page_id);
-        BTreeLeafNode* leaf_node = (BTreeLeafNode*)current_page;
-        int records_indexed = 0;
-        
-        while (leaf_node != NULL) {
-            for (int i = 0; i < leaf_node->header.num_keys; i++) {
-                if (leaf_node->keys[i] == -1) continue; // skip deleted keys
-                
-                int primary_key = leaf_node->keys[i];
-                char* record_data = leaf_node->values[i];
-                
-                // add this record to the new index
-                int column_index = get_column_index(target_table, column_name);
-                if (column_index >= 0) {
-                    char* column_value = extract_column_value(record_data, column_index);
-                    if (column_value != NULL) {
-                        if (target_table->columns[column_index].type == COLUMN_TYPE_INT) {
-                            int index_key = atoi(column_value);
-                            char index_value[32];
-                            snprintf(index_value, sizeof(index_value), "%d", primary_key);
-                            btree_insert(db->pool, db->pager, new_index.root_page_id, index_key, index_value, 0);
-                            records_indexed++;
-                        }
-                        free(column_value);
-                    }
-                }
+    }
+
+    // the table is read by the access path, the joined one by the join, and
+    // neither decodes a column the query does not read
+    prepared->scan_columns = columns & ((1u << table->num_columns) - 1);
+    prepared->join_columns = columns >> table->num_columns;
+    plan_access_path(prepared, select->where, prepared->scan_columns);
+    if (joined != NULL) {
+        plan_join(prepared, select->join_condition);
+    }
+    if (aggregated) {
+        plan_group_order(prepared);
+    }
+    plan_order(prepared, select);
+    return 0;
+}
+
+static int plan_insert(PreparedStatement* prepared, InsertStatement* insert) {
+    if (plan_table(prepared, insert->table_name) != 0) {
+        return -1;
+    }
+    TableSchema* table = prepared->table;
+    if (insert->num_values != table->num_columns) {
+        fprintf(stderr, "error: table %s has %d columns.\n", table->table_name, table->num_columns);
+        return -1;
+    }
+    if (table->columns[0].type != COLUMN_TYPE_INT) {
+        fprintf(stderr, "error: the first column must be a non-null INT key.\n");
+        return -1;
+    }
+
+    // parse each literal as the type of its column
+    for (int i = 0; i < insert->num_rows; i++) {
+        for (int j = 0; j < table->num_columns; j++) {
+            Expr* expr = insert->rows[i][j];
+            if (expr->type != EXPR_LITERAL && expr->type != EXPR_PARAMETER) {
+                fprintf(stderr, "error: VALUES must be literals.\n");
+                return -1;
             }
-            
-            if (leaf_node->next_leaf != 0) {
-                buffer_pool_unpin_page(db->pool, db->pager, current_page_id, 0);
-                current_page_id = leaf_node->next_leaf;
-                current_page = buffer_pool_get_page(db->pool, db->pager, current_page_id);
-                leaf_node = (BTreeLeafNode*)current_page;
-            } else {
-                buffer_pool_unpin_page(db->pool, db->pager, current_page_id, 0);
-                leaf_node = NULL;
+            if (type_operand(expr, table->columns[j].type) != 0) {
+                return -1;
             }
         }
-        
-        // save updated catalog to disk
-        Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-        memcpy(catalog_page->data, db->catalog, sizeof(Catalog));
-        buffer_pool_unpin_page(db->pool, db->pager, 1, 1);
-        
-        printf("Index %s created successfully on %s.%s (%d records indexed)\n", index_name, table_name, column_name, records_indexed);
-        return NULL;
-    } else if (strncmp(query, "DROP INDEX", 10) == 0) {
-        if (db->locked) {
-            fprintf(stderr, "error: drop index statements must not be within a transaction.\n");
-            return NULL;
+    }
+    return 0;
+}
+
+// UPDATE and DELETE find their rows the way a SELECT with the same WHERE
+// clause would, reading only the primary key and the columns it tests
+static int plan_where(PreparedStatement* prepared, Expr* where) {
+    TableSchema* table = prepared->table;
+    if (resolve_expr(table, NULL, where) != 0) {
+        return -1;
+    }
+    if (contains_aggregate(where)) {
+        fprintf(stderr, "error: aggregates are not allowed in WHERE.\n");
+        return -1;
+    }
+    if (table->columns[0].type != COLUMN_TYPE_INT) {
+        fprintf(stderr, "error: the first column must be a non-null INT key.\n");
+        return -1;
+    }
+    prepared->scan_columns = expr_columns(where) | 1u << 0;
+    plan_access_path(prepared, where, prepared->scan_columns);
+    return 0;
+}
+
+static int plan_update(PreparedStatement* prepared, UpdateStatement* update) {
+    if (plan_table(prepared, update->table_name) != 0 || plan_where(prepared, update->where) != 0) {
+        return -1;
+    }
+    TableSchema* table = prepared->table;
+
+    prepared->num_columns = update->num_assignments;
+    if (prepared->num_columns > MAX_COLUMNS_PER_TABLE) {
+        fprintf(stderr, "error: too many assignments.\n");
+        return -1;
+    }
+    for (int i = 0; i < update->num_assignments; i++) {
+        int column = get_column_index(table, update->assignments[i].column_name);
+        if (column == -1) {
+            fprintf(stderr, "error: column %s not found.\n", update->assignments[i].column_name);
+            return -1;
         }
-        
-        char index_name[MAX_NAME_LEN];
-        char table_name[MAX_NAME_LEN];
-        
-        // simple parsing: DROP INDEX index_name ON table_name
-        sscanf(query, "DROP INDEX %s ON %s", index_name, table_name);
-        
-        // find the target table
-        TableSchema* target_table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                target_table = &db->catalog->tables[i];
-                break;
-            }
+        if (column == 0) {
+            fprintf(stderr, "error: the key column %s cannot be updated.\n", table->columns[0].name);
+            return -1;
         }
-        
-        if (target_table == NULL) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            return NULL;
+        Expr* value = update->assignments[i].value;
+        if (value->type != EXPR_LITERAL && value->type != EXPR_PARAMETER) {
+            fprintf(stderr, "error: SET values must be literals.\n");
+            return -1;
         }
-        
-        // find and remove the index
-        int index_found = 0;
-        for (int i = 0; i < target_table->num_indexes; i++) {
-            if (strcmp(target_table->indexes[i].name, index_name) == 0) {
-                // shift remaining indexes down
-                for (int j = i; j < target_table->num_indexes - 1; j++) {
-                    target_table->indexes[j] = target_table->indexes[j + 1];
-                }
-                target_table->num_indexes--;
-                index_found = 1;
-                break;
+        if (type_operand(value, table->columns[column].type) != 0) {
+            return -1;
+        }
+        prepared->columns[i] = column;
+    }
+    return 0;
+}
+
+// describe the plan chosen, printed once when the statement is planned
+static void print_plan(const PreparedStatement* prepared) {
+    if (prepared->access == ACCESS_INDEX) {
+        printf("Using index %s for query optimization%s\n", prepared->index->name, prepared->index_only ? " (index only)" : "");
+    } else if (prepared->access == ACCESS_PRIMARY_KEY) {
+        printf("Using primary key %s for query optimization\n", prepared->table->columns[0].name);
+    } else {
+        printf("Performing full table scan (no suitable index found)\n");
+    }
+
+    const TableSchema* joined = prepared->join_table;
+    if (joined != NULL) {
+        if (prepared->join == JOIN_INDEX_NESTED_LOOP) {
+            printf("Using %s %s for join with %s\n", prepared->join_index != NULL ? "index" : "primary key",
+                   prepared->join_index != NULL ? prepared->join_index->name : joined->columns[0].name, joined->table_name);
+        } else if (prepared->join == JOIN_HASH) {
+            printf("Using hash join with %s\n", joined->table_name);
+        } else {
+            printf("Using nested loop join with %s\n", joined->table_name);
+        }
+    }
+    if (prepared->group_ordered) {
+        printf("Using streaming aggregation for GROUP BY\n");
+    } else if (prepared->aggregated && prepared->num_group_columns > 0) {
+        printf("Using hash aggregation for GROUP BY\n");
+    }
+}
+
+// resolve names and choose the access path, once per schema version
+static int plan_statement(PreparedStatement* prepared) {
+    Statement* statement = prepared->statement;
+    prepared->schema_version = prepared->db->schema_version;
+    prepared->table = NULL;
+    prepared->num_columns = 0;
+    prepared->access = ACCESS_SEQ_SCAN;
+    prepared->index = NULL;
+    prepared->index_only = 0;
+    prepared->scan_columns = ALL_COLUMNS;
+    prepared->join_columns = ALL_COLUMNS;
+    prepared->join_table = NULL;
+    prepared->aggregated = 0;
+    prepared->num_group_columns = 0;
+    prepared->num_aggregates = 0;
+    prepared->group_ordered = 0;
+    prepared->ordered = 0;
+    prepared->offset_in_scan = 0;
+
+    int status;
+    switch (statement->type) {
+        case STATEMENT_SELECT:
+            status = plan_select(prepared, &statement->select);
+            break;
+        case STATEMENT_INSERT:
+            return plan_insert(prepared, &statement->insert);
+        case STATEMENT_COPY:
+            if (plan_table(prepared, statement->copy.table_name) != 0) {
+                return -1;
             }
+            if (prepared->table->columns[0].type != COLUMN_TYPE_INT) {
+                fprintf(stderr, "error: the first column must be a non-null INT key.\n");
+                return -1;
+            }
+            return 0;
+        case STATEMENT_UPDATE:
+            status = plan_update(prepared, &statement->update);
+            break;
+        case STATEMENT_DELETE:
+            if (plan_table(prepared, statement->delete_.table_name) != 0) {
+                return -1;
+            }
+            status = plan_where(prepared, statement->delete_.where);
+            break;
+        default:
+            return 0;
+    }
+    if (status == 0) {
+        print_plan(prepared);
+    }
+    return status;
+}
+
+// join the rows of the table's access path with the joined table
+static Operator* build_join(PreparedStatement* prepared, Arena* arena, Operator* left) {
+    Database* db = prepared->db;
+    TableSchema* joined = prepared->join_table;
+    const Expr* condition = prepared->statement->select.join_condition;
+    switch (prepared->join) {
+        case JOIN_INDEX_NESTED_LOOP:
+            return index_nested_loop_join_create(arena, db->pool, db->pager, left, prepared->join_keys[0], joined,
+                                                 prepared->join_index, condition, prepared->join_columns);
+        case JOIN_HASH:
+            return hash_join_create(arena, left, seq_scan_create(arena, db->pool, db->pager, joined, prepared->join_columns),
+                                    prepared->join_keys[0], prepared->join_keys[1], condition, HASH_JOIN_MEMORY_BUDGET);
+        default:
+            return nested_loop_join_create(arena, left, seq_scan_create(arena, db->pool, db->pager, joined, prepared->join_columns),
+                                           condition);
+    }
+}
+
+// the access path's scan over the key range planned for the WHERE clause,
+// stepping over offset rows before the first one it returns
+static Operator* build_scan(PreparedStatement* prepared, Arena* arena, int64_t offset) {
+    Database* db = prepared->db;
+
+    // bounds point at the literals and parameters, which hold their values by now
+    KeyRange* range = (KeyRange*)arena_calloc(arena, sizeof(KeyRange));
+    if (prepared->bounds.lower != NULL) {
+        range->lower = &prepared->bounds.lower->value;
+        range->lower_inclusive = prepared->bounds.lower_inclusive;
+    }
+    if (prepared->bounds.upper != NULL) {
+        range->upper = &prepared->bounds.upper->value;
+        range->upper_inclusive = prepared->bounds.upper_inclusive;
+    }
+    range->offset = offset;
+
+    if (prepared->access == ACCESS_INDEX) {
+        return index_scan_create(arena, db->pool, db->pager, prepared->table, prepared->index, range, prepared->index_only,
+                                 prepared->scan_columns);
+    }
+    if (prepared->access == ACCESS_PRIMARY_KEY) {
+        return index_scan_create(arena, db->pool, db->pager, prepared->table, NULL, range, 0, prepared->scan_columns);
+    }
+    if (offset > 0) {
+        // the primary key over its whole range is the same scan, and can skip
+        return index_scan_create(arena, db->pool, db->pager, prepared->table, NULL, range, 0, prepared->scan_columns);
+    }
+    return seq_scan_create(arena, db->pool, db->pager, prepared->table, prepared->scan_columns);
+}
+
+// scan (index, primary key range or full) -> join -> filter -> aggregate -> sort -> limit -> project.
+// the sort is left out when the scan's order is the ORDER BY order.
+static Operator* build_select(PreparedStatement* prepared, Arena* arena) {
+    Database* db = prepared->db;
+    SelectStatement* select = &prepared->statement->select;
+    int64_t offset = select->offset;
+    Operator* root = build_scan(prepared, arena, prepared->offset_in_scan ? offset : 0);
+    if (prepared->offset_in_scan) {
+        offset = 0;
+    }
+    if (prepared->join_table != NULL) {
+        root = build_join(prepared, arena, root);
+    }
+    if (select->where != NULL) {
+        root = filter_create(arena, root, select->where);
+    }
+    if (prepared->aggregated && prepared->num_group_columns == 0) {
+        root = aggregate_create(arena, root, prepared->aggregates, prepared->num_aggregates);
+    } else if (prepared->group_ordered) {
+        root = stream_aggregate_create(arena, root, prepared->group_columns, prepared->num_group_columns,
+                                       prepared->aggregates, prepared->num_aggregates);
+    } else if (prepared->aggregated) {
+        root = hash_aggregate_create(arena, root, prepared->group_columns, prepared->num_group_columns,
+                                     prepared->aggregates, prepared->num_aggregates);
+    }
+    if (select->num_order_by > 0 && !prepared->ordered) {
+        // with a LIMIT whose rows fit the sort's memory only those are kept
+        int64_t kept = select->limit + offset;
+        if (select->limit >= 0 && (double)kept * sizeof(Value) * root->num_columns <= (double)db->sort_memory) {
+            root = top_n_create(arena, root, select->order_by, select->num_order_by, kept);
+        } else {
+            root = sort_create(arena, root, select->order_by, select->num_order_by, db->sort_memory);
         }
-        
-        if (!index_found) {
-            fprintf(stderr, "error: index %s not found.\n", index_name);
-            return NULL;
+    }
+    if (select->limit >= 0 || offset > 0) {
+        root = limit_create(arena, root, select->limit, offset);
+    }
+    return project_create(arena, root, prepared->columns, prepared->num_columns);
+}
+
+static Cursor* cursor_create(PreparedStatement* prepared) {
+    Cursor* cursor = (Cursor*)calloc(1, sizeof(Cursor));
+    cursor->prepared = prepared;
+    arena_init(&cursor->arena);
+    cursor->root = build_select(prepared, &cursor->arena);
+    cursor->num_columns = cursor->root->num_columns;
+    batch_init(&cursor->batch, cursor->num_columns, &cursor->arena);
+    prepared->db->num_open_cursors++;
+    return cursor;
+}
+
+// db_execute keeps returning the whole result, drained from a cursor
+static Result* execute_select(PreparedStatement* prepared) {
+    Cursor* cursor = cursor_create(prepared);
+
+    Result* result = (Result*)malloc(sizeof(Result));
+    result->num_rows = 0;
+    result->num_columns = cursor->num_columns;
+    result->rows = NULL;
+    arena_init(&result->arena);
+
+    int capacity = 0;
+    const Value* values;
+    while ((values = db_cursor_next(cursor)) != NULL) {
+        char** columns = result_add_row(result, &capacity);
+        for (int j = 0; j < result->num_columns; j++) {
+            columns[j] = value_format(&result->arena, &values[j]);
         }
-        
-        // save updated catalog to disk
-        Page* catalog_page = buffer_pool_get_page(db->pool, db->pager, 1);
-        memcpy(catalog_page->data, db->catalog, sizeof(Catalog));
-        buffer_pool_unpin_page(db->pool, db->pager, 1, 1);
-        
-        printf("Index %s dropped successfully\n", index_name);
+    }
+    int failed = cursor->failed;
+    db_cursor_close(cursor);
+
+    // return NULL if no rows were found, or if only some were
+    if (result->num_rows == 0 || failed) {
+        db_result_free(result);
         return NULL;
-    } else if (strncmp(query, "INSERT INTO", 11) == 0) {
-        if (!db->locked) {
-            fprintf(stderr, "error: insert statements must be within a transaction.\n");
-            return NULL;
+    }
+    return result;
+}
+
+static int execute_insert(PreparedStatement* prepared) {
+    Database* db = prepared->db;
+    InsertStatement* insert = &prepared->statement->insert;
+    TableSchema* table = prepared->table;
+
+    // encode and check every row before inserting any, so a bad row inserts nothing
+    const char** rows = (const char**)arena_alloc(&prepared->scratch, sizeof(char*) * insert->num_rows);
+    uint16_t* lengths = (uint16_t*)arena_alloc(&prepared->scratch, sizeof(uint16_t) * insert->num_rows);
+    int32_t* keys = (int32_t*)arena_alloc(&prepared->scratch, sizeof(int32_t) * insert->num_rows);
+    for (int i = 0; i < insert->num_rows; i++) {
+        Value row_values[MAX_COLUMNS_PER_TABLE];
+        for (int j = 0; j < table->num_columns; j++) {
+            row_values[j] = insert->rows[i][j]->value;
+        }
+        if (row_values[0].is_null) {
+            fprintf(stderr, "error: the first column must be a non-null INT key.\n");
+            return -1;
+        }
+        keys[i] = (int32_t)row_values[0].int_value;
+        char* row = (char*)arena_alloc(&prepared->scratch, ROW_MAX_SIZE);
+        if (row_encode(&prepared->layout, row_values, row, &lengths[i]) != 0) {
+            return -1;
+        }
+        rows[i] = row;
+    }
+    if (unique_prefix(db, table, &prepared->layout, keys, rows, insert->num_rows, &prepared->scratch) < insert->num_rows) {
+        return -1;
+    }
+
+    insert_rows(db, table, &prepared->layout, keys, rows, lengths, insert->num_rows, &prepared->scratch);
+    return 0;
+}
+
+// the values of one CSV row, typed as the table's columns. an unquoted empty
+// field is null, a quoted one is empty text.
+static int copy_row_values(TableSchema* table, const RowLayout* layout, const CsvReader* reader, const CsvField* fields,
+                           int num_fields, Value* values) {
+    if (num_fields != table->num_columns) {
+        fprintf(stderr, "error: line %lld has %d fields, table %s has %d columns.\n", (long long)reader->line, num_fields,
+                table->table_name, table->num_columns);
+        return -1;
+    }
+    for (int i = 0; i < num_fields; i++) {
+        const CsvField* field = &fields[i];
+        if (field->length == 0 && !field->quoted) {
+            value_set_null(&values[i], layout->types[i]);
+        } else if (field->length > UINT16_MAX ||
+                   value_parse(&values[i], layout->types[i], field->text, (uint16_t)field->length) != 0) {
+            fprintf(stderr, "error: line %lld has a bad value for column %s.\n", (long long)reader->line, table->columns[i].name);
+            return -1;
         }
-        char table_name[MAX_NAME_LEN];
-        char values[256];
-        sscanf(query, "INSERT INTO %s VALUES (%[^)]s)", table_name, values);
+    }
+    if (values[0].is_null) {
+        fprintf(stderr, "error: line %lld has no key, the first column must be a non-null INT.\n", (long long)reader->line);
+        return -1;
+    }
+    return 0;
+}
 
-        uint32_t table_root_page_id = 0;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table_root_page_id = db->catalog->tables[i].root_page_id;
-                break;
+// COPY table FROM 'file': the file is read COPY_BATCH_ROWS rows at a time and
+// each batch is inserted together. a bad row stops the copy after inserting
+// the rows before it, for the transaction to keep or roll back.
+static int execute_copy(PreparedStatement* prepared) {
+    Database* db = prepared->db;
+    TableSchema* table = prepared->table;
+    const RowLayout* layout = &prepared->layout;
+    CsvReader reader;
+    if (csv_open(&reader, prepared->statement->copy.file_name) != 0) {
+        return -1;
+    }
+
+    char* data = (char*)arena_alloc(&prepared->scratch, (size_t)COPY_BATCH_ROWS * ROW_MAX_SIZE);
+    const char** rows = (const char**)arena_alloc(&prepared->scratch, sizeof(char*) * COPY_BATCH_ROWS);
+    uint16_t* lengths = (uint16_t*)arena_alloc(&prepared->scratch, sizeof(uint16_t) * COPY_BATCH_ROWS);
+    int32_t* keys = (int32_t*)arena_alloc(&prepared->scratch, sizeof(int32_t) * COPY_BATCH_ROWS);
+    Arena batch_arena;
+    arena_init(&batch_arena);
+
+    int64_t total = 0;
+    int count = 0;
+    int status = 0;
+    int num_fields;
+    do {
+        CsvField fields[MAX_COLUMNS_PER_TABLE];
+        num_fields = csv_next_row(&reader, fields, MAX_COLUMNS_PER_TABLE);
+        if (num_fields < 0) {
+            status = -1;
+        } else if (num_fields > 0) {
+            Value values[MAX_COLUMNS_PER_TABLE];
+            char* row = data + (size_t)count * ROW_MAX_SIZE;
+            status = copy_row_values(table, layout, &reader, fields, num_fields, values);
+            if (status == 0 && row_encode(layout, values, row, &lengths[count]) != 0) {
+                fprintf(stderr, "error: line %lld could not be stored.\n", (long long)reader.line);
+                status = -1;
+            }
+            if (status == 0) {
+                keys[count] = (int32_t)values[0].int_value;
+                rows[count++] = row;
+            }
+        }
+        if (count == COPY_BATCH_ROWS || (count > 0 && (num_fields == 0 || status != 0))) {
+            int prefix = unique_prefix(db, table, layout, keys, rows, count, &batch_arena);
+            if (prefix < count) {
+                status = -1;
+                count = prefix;
             }
+            insert_rows(db, table, layout, keys, rows, lengths, count, &batch_arena);
+            arena_reset(&batch_arena);
+            total += count;
+            count = 0;
         }
+    } while (num_fields > 0 && status == 0);
 
-        if (table_root_page_id == 0) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            return NULL;
+    arena_free(&batch_arena);
+    csv_close(&reader);
+    printf("Copied %lld rows into %s\n", (long long)total, table->table_name);
+    return status;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    int32_t x = *(const int32_t*)a;
+    int32_t y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// the primary keys of the rows an UPDATE or DELETE changes, in key order. all
+// of them are found before any row changes, so the scan never meets its own
+// changes. count is -1 if the scan failed.
+static int32_t* find_rows(PreparedStatement* prepared, const Expr* where, int* count) {
+    Arena arena;
+    arena_init(&arena);
+    Operator* root = build_scan(prepared, &arena, 0);
+    if (where != NULL) {
+        root = filter_create(&arena, root, where);
+    }
+    Batch batch;
+    batch_init(&batch, root->num_columns, &arena);
+
+    int32_t* keys = NULL;
+    int capacity = 0;
+    *count = 0;
+    while (root->next(root, &batch) > 0) {
+        if (*count + batch.num_rows > capacity) {
+            int new_capacity = capacity == 0 ? BATCH_SIZE : capacity * 2;
+            while (new_capacity < *count + batch.num_rows) {
+                new_capacity *= 2;
+            }
+            keys = (int32_t*)arena_grow(&prepared->scratch, keys, sizeof(int32_t) * capacity, sizeof(int32_t) * new_capacity);
+            capacity = new_capacity;
+        }
+        for (int i = 0; i < batch.num_rows; i++) {
+            keys[(*count)++] = (int32_t)batch_row(&batch, i)[0].int_value;
+        }
+    }
+    if (root->error) {
+        *count = -1;
+    }
+    operator_close(root);
+    arena_free(&arena);
+    if (*count > 0) {
+        qsort(keys, *count, sizeof(int32_t), compare_keys);
+    }
+    return keys;
+}
+
+// move the index entries of rows changing from old_rows to new_rows, or with
+// new_rows NULL being deleted. for each index the entries that go away are
+// deleted in key order and the new ones inserted together; entries a change
+// leaves as they were are not touched. a value shared by several rows has a
+// single entry, which only the row it points at removes.
+// whether the entry under key belongs to the row with primary key row_key;
+// in a UNIQUE index it always does
+static int owns_entry(Database* db, const RowLayout* layout, const IndexSchema* index, int32_t key, int32_t row_key) {
+    if (index->is_unique) {
+        return 1;
+    }
+    uint16_t length;
+    char* entry = btree_search(db->pool, db->pager, index->root_page_id, key, &length);
+    int owned = entry != NULL && index_entry_row(layout, index, entry) == row_key;
+    free(entry);
+    return owned;
+}
+
+static void update_indexes(Database* db, TableSchema* table, const RowLayout* layout, const int32_t* keys,
+                           const char* const* old_rows, const char* const* new_rows, const uint16_t* new_lengths, int count,
+                           Arena* arena) {
+    int32_t* deleted = (int32_t*)arena_alloc(arena, sizeof(int32_t) * count);
+    KeyedRow* order = (KeyedRow*)arena_alloc(arena, sizeof(KeyedRow) * count);
+    const char** entries = (const char**)arena_alloc(arena, sizeof(char*) * count);
+    uint16_t* entry_lengths = (uint16_t*)arena_alloc(arena, sizeof(uint16_t) * count);
+    for (int i = 0; i < table->num_indexes; i++) {
+        IndexSchema* index = &table->indexes[i];
+        int column_index = get_column_index(table, index->column_name);
+        uint32_t columns = index_columns(table, index);
+        int num_deleted = 0;
+        int n = 0;
+        for (int j = 0; j < count; j++) {
+            int old_key;
+            int new_key;
+            int has_old = index_key_for_row(layout, old_rows[j], column_index, &old_key);
+            int has_new = new_rows != NULL && index_key_for_row(layout, new_rows[j], column_index, &new_key);
+            int same_key = has_old && has_new && old_key == new_key;
+            if (has_old && !same_key && owns_entry(db, layout, index, old_key, keys[j])) {
+                deleted[num_deleted++] = old_key;
+            }
+            if (!has_new) {
+                continue;
+            }
+            char* entry = (char*)arena_alloc(arena, new_lengths[j] > sizeof(int32_t) ? new_lengths[j] : sizeof(int32_t));
+            index_entry(layout, index, columns, keys[j], new_rows[j], entry, &entry_lengths[n]);
+            if (same_key) {
+                // the entry is the primary key, or holds INCLUDE columns that may have changed
+                if (index->num_include_columns == 0) {
+                    continue;
+                }
+                char old_entry[ROW_MAX_SIZE];
+                uint16_t old_length;
+                index_entry(layout, index, columns, keys[j], old_rows[j], old_entry, &old_length);
+                if (old_length == entry_lengths[n] && memcmp(old_entry, entry, old_length) == 0) {
+                    continue;
+                }
+            }
+            entries[n] = entry;
+            order[n].key = new_key;
+            order[n].position = n;
+            n++;
+        }
+        qsort(deleted, num_deleted, sizeof(int32_t), compare_keys);
+        for (int j = 0; j < num_deleted; j++) {
+            btree_delete(db->pool, db->pager, db->wal, db->current_tx_id, index->root_page_id, deleted[j]);
         }
+        insert_sorted(db, index->root_page_id, order, entries, entry_lengths, n, arena);
+    }
+}
+
+// the stored rows under keys, copied into the arena. rows that are gone are
+// left out of both arrays; returns how many were found.
+static int fetch_rows(Database* db, TableSchema* table, int32_t* keys, int count, const char** rows, uint16_t* lengths,
+                      Arena* arena) {
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        uint16_t length;
+        char* row = btree_search(db->pool, db->pager, table->root_page_id, keys[i], &length);
+        if (row == NULL) {
+            continue;
+        }
+        rows[found] = arena_strndup(arena, row, length);
+        lengths[found] = length;
+        keys[found++] = keys[i];
+        free(row);
+    }
+    return found;
+}
+
+// the rows under up to MODIFY_BATCH_ROWS keys before and after an UPDATE's
+// assignments, re-encoded. rows that are gone are left out; returns how many
+// were found, or -1 if a changed row cannot be stored.
+static int update_batch(PreparedStatement* prepared, int32_t* keys, int count, const char** old_rows, uint16_t* old_lengths,
+                        const char** new_rows, uint16_t* new_lengths, Arena* arena) {
+    UpdateStatement* update = &prepared->statement->update;
+    const RowLayout* layout = &prepared->layout;
+    int n = fetch_rows(prepared->db, prepared->table, keys, count, old_rows, old_lengths, arena);
+    for (int i = 0; i < n; i++) {
+        Value row_values[MAX_COLUMNS_PER_TABLE];
+        decode_row(layout, old_rows[i], row_values);
+        for (int j = 0; j < update->num_assignments; j++) {
+            row_values[prepared->columns[j]] = update->assignments[j].value->value;
+        }
+        char* row = (char*)arena_alloc(arena, ROW_MAX_SIZE);
+        if (row_encode(layout, row_values, row, &new_lengths[i]) != 0) {
+            return -1;
+        }
+        new_rows[i] = row;
+    }
+    return n;
+}
 
-        int id;
-        char serialized_values[256] = "";
-        char* token = strtok(values, ",");
-        int first = 1;
-        while (token != NULL) {
-            // trim leading/trailing whitespace and quotes
-            while (*token == ' ' || *token == '\t' || *token == '\'') {
-                token++;
+// an UPDATE gives every row it changes the same values, so a UNIQUE index
+// column it assigns a value can take only one row, and not one another row
+// holds already. -1 if that is not so.
+static int check_unique_assignments(PreparedStatement* prepared, const int32_t* keys, int count) {
+    UpdateStatement* update = &prepared->statement->update;
+    TableSchema* table = prepared->table;
+    for (int i = 0; i < table->num_indexes; i++) {
+        IndexSchema* index = &table->indexes[i];
+        int column_index = get_column_index(table, index->column_name);
+        for (int j = 0; j < update->num_assignments && index->is_unique && count > 0; j++) {
+            const Value* value = &update->assignments[j].value->value;
+            if (prepared->columns[j] != column_index || value->is_null || table->columns[column_index].type != COLUMN_TYPE_INT) {
+                continue;
             }
-            char* end = token + strlen(token) - 1;
-            while (end > token && (*end == ' ' || *end == '\t' || *end == '\'')) {
-                *end-- = '\0';
+            int repeated = count > 1;
+            if (!repeated) {
+                uint16_t length;
+                char* entry = btree_search(prepared->db->pool, prepared->db->pager, index->root_page_id, (int32_t)value->int_value,
+                                           &length);
+                repeated = entry != NULL && index_entry_row(&prepared->layout, index, entry) != keys[0];
+                free(entry);
             }
-            if (first) {
-                id = atoi(token);
-                first = 0;
+            if (repeated) {
+                fprintf(stderr, "error: duplicate value %d in unique index %s.\n", (int32_t)value->int_value, index->name);
+                return -1;
             }
-            strcat(serialized_values, token);
-            strcat(serialized_values, "|");
-            token = strtok(NULL, ",");
         }
-        // remove trailing delimiter
-        if (strlen(serialized_values) > 0) {
-            serialized_values[strlen(serialized_values) - 1] = '\0';
+    }
+    return 0;
+}
+
+// UPDATE and DELETE change the rows they find MODIFY_BATCH_ROWS at a time:
+// each index in one sorted pass, then the table's rows in key order, a leaf
+// at a time. an UPDATE encodes a batch's rows before changing any of them; a
+// row that cannot be stored takes back the batches already changed, so the
+// statement changes every row or none.
+static int execute_update(PreparedStatement* prepared) {
+    Database* db = prepared->db;
+    TableSchema* table = prepared->table;
+    int count;
+    int32_t* keys = find_rows(prepared, prepared->statement->update.where, &count);
+    if (count < 0 || check_unique_assignments(prepared, keys, count) != 0) {
+        return -1;
+    }
+
+    Arena arena;
+    arena_init(&arena);
+    const char** old_rows = (const char**)arena_alloc(&prepared->scratch, sizeof(char*) * MODIFY_BATCH_ROWS);
+    const char** new_rows = (const char**)arena_alloc(&prepared->scratch, sizeof(char*) * MODIFY_BATCH_ROWS);
+    uint16_t* old_lengths = (uint16_t*)arena_alloc(&prepared->scratch, sizeof(uint16_t) * MODIFY_BATCH_ROWS);
+    uint16_t* new_lengths = (uint16_t*)arena_alloc(&prepared->scratch, sizeof(uint16_t) * MODIFY_BATCH_ROWS);
+    int savepoint = db->wal->undo.count;
+    int status = 0;
+    for (int start = 0; start < count; start += MODIFY_BATCH_ROWS) {
+        arena_reset(&arena);
+        int n = count - start < MODIFY_BATCH_ROWS ? count - start : MODIFY_BATCH_ROWS;
+        n = update_batch(prepared, keys + start, n, old_rows, old_lengths, new_rows, new_lengths, &arena);
+        if (n < 0) {
+            status = -1;
+            break;
         }
+        update_indexes(db, table, &prepared->layout, keys + start, old_rows, new_rows, new_lengths, n, &arena);
 
-        wal_log_insert(db->wal, db->current_tx_id, id, serialized_values);
-        btree_insert(db->pool, db->pager, table_root_page_id, id, serialized_values, db->locked);
-        
-        // maintain indexes
-        TableSchema* table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table = &db->catalog->tables[i];
-                break;
+        // only rows an assignment changed are written
+        int changed = 0;
+        for (int i = 0; i < n; i++) {
+            if (new_lengths[i] != old_lengths[i] || memcmp(new_rows[i], old_rows[i], old_lengths[i]) != 0) {
+                keys[start + changed] = keys[start + i];
+                new_rows[changed] = new_rows[i];
+                new_lengths[changed] = new_lengths[i];
+                changed++;
             }
         }
-        if (table != NULL) {
-            maintain_indexes_insert(db, table, id, serialized_values);
+        btree_update_batch(db->pool, db->pager, db->wal, db->current_tx_id, table->root_page_id, keys + start, new_rows,
+                           new_lengths, changed);
+    }
+    if (status != 0) {
+        wal_rollback_to(db->wal, db->pool, db->pager, db->current_tx_id, savepoint);
+    }
+    arena_free(&arena);
+    return status;
+}
+
+static int execute_delete(PreparedStatement* prepared) {
+    Database* db = prepared->db;
+    TableSchema* table = prepared->table;
+    int count;
+    int32_t* keys = find_rows(prepared, prepared->statement->delete_.where, &count);
+    if (count < 0) {
+        return -1;
+    }
+
+    Arena arena;
+    arena_init(&arena);
+    for (int start = 0; start < count; start += MODIFY_BATCH_ROWS) {
+        arena_reset(&arena);
+        int n = count - start < MODIFY_BATCH_ROWS ? count - start : MODIFY_BATCH_ROWS;
+        const char** old_rows = (const char**)arena_alloc(&arena, sizeof(char*) * n);
+        uint16_t* old_lengths = (uint16_t*)arena_alloc(&arena, sizeof(uint16_t) * n);
+        n = fetch_rows(db, table, keys + start, n, old_rows, old_lengths, &arena);
+
+        update_indexes(db, table, &prepared->layout, keys + start, old_rows, NULL, NULL, n, &arena);
+        for (int i = 0; i < n; i++) {
+            btree_delete(db->pool, db->pager, db->wal, db->current_tx_id, table->root_page_id, keys[start + i]);
         }
-        
-        return NULL;
-    } else if (strncmp(query, "UPDATE", 6) == 0) {
-        if (!db->locked) {
-            fprintf(stderr, "error: update statements must be within a transaction.\n");
-            return NULL;
+    }
+    arena_free(&arena);
+    return 0;
+}
+
+static void execute_create_table(Database* db, CreateTableStatement* create) {
+    if (find_table(db, create->table_name) != NULL) {
+        fprintf(stderr, "error: table %s already exists.\n", create->table_name);
+        return;
+    }
+    if (catalog_create_table(db->catalog, create->table_name, create->columns, create->num_columns) == NULL) {
+        return;
+    }
+    db->schema_version++;
+}
+
+static void execute_create_index(Database* db, CreateIndexStatement* create) {
+    TableSchema* target_table = find_table(db, create->table_name);
+    if (target_table == NULL) {
+        fprintf(stderr, "error: table %s not found.\n", create->table_name);
+        return;
+    }
+
+    // verify column exists
+    int column_index = get_column_index(target_table, create->column_name);
+    if (column_index == -1) {
+        fprintf(stderr, "error: column %s not found in table %s.\n", create->column_name, create->table_name);
+        return;
+    }
+
+    // check if we can add more indexes
+    if (target_table->num_indexes >= MAX_INDEXES_PER_TABLE) {
+        fprintf(stderr, "error: maximum number of indexes reached for table %s.\n", create->table_name);
+        return;
+    }
+
+    // check for duplicate index name
+    for (int i = 0; i < target_table->num_indexes; i++) {
+        if (strcmp(target_table->indexes[i].name, create->index_name) == 0) {
+            fprintf(stderr, "error: index %s already exists.\n", create->index_name);
+            return;
         }
-        char table_name[MAX_NAME_LEN];
-        int id;
-        char set_clause[256];
-        // parse UPDATE statement more carefully
-        if (sscanf(query, "UPDATE %s SET %[^WHERE] WHERE id = %d", table_name, set_clause, &id) != 3) {
-            fprintf(stderr, "error: invalid UPDATE syntax.\n");
-            return NULL;
+    }
+
+    // create new index
+    IndexSchema new_index;
+    memset(&new_index, 0, sizeof(IndexSchema));
+    for (int i = 0; i < create->num_include_columns; i++) {
+        int include_index = get_column_index(target_table, create->include_columns[i]);
+        if (include_index == -1) {
+            fprintf(stderr, "error: column %s not found in table %s.\n", create->include_columns[i], create->table_name);
+            return;
         }
-        
-        // trim trailing whitespace from set_clause
-        char* set_end = set_clause + strlen(set_clause) - 1;
-        while (set_end > set_clause && (*set_end == ' ' || *set_end == '\t')) {
-            *set_end-- = '\0';
+        new_index.include_columns[new_index.num_include_columns++] = (uint16_t)include_index;
+    }
+    strcpy(new_index.name, create->index_name);
+    strcpy(new_index.table_name, create->table_name);
+    strcpy(new_index.column_name, create->column_name);
+    new_index.type = INDEX_TYPE_BTREE;
+    new_index.root_page_id = btree_create(db->pool, db->pager, db->wal);
+    new_index.is_unique = create->is_unique;
+    new_index.is_primary = 0;
+
+    // add index to table
+    target_table->indexes[target_table->num_indexes++] = new_index;
+    db->schema_version++;
+
+    // populate index with existing data
+    BTreeCursor cursor;
+    int records_indexed = 0;
+    RowLayout layout;
+    row_layout_init(&layout, target_table);
+    uint32_t entry_columns = index_columns(target_table, &new_index);
+    int duplicate = 0;
+
+    for (btree_cursor_first(&cursor, db->pool, db->pager, target_table->root_page_id);
+         btree_cursor_valid(&cursor); btree_cursor_next(&cursor)) {
+        int32_t primary_key = btree_cursor_key(&cursor);
+        const char* record_data = btree_cursor_value(&cursor, NULL);
+
+        // add this record to the new index
+        int index_key;
+        if (index_key_for_row(&layout, record_data, column_index, &index_key)) {
+            char entry[ROW_MAX_SIZE];
+            uint16_t length;
+            if (new_index.is_unique) {
+                char* existing = btree_search(db->pool, db->pager, new_index.root_page_id, index_key, &length);
+                duplicate = existing != NULL;
+                free(existing);
+                if (duplicate) {
+                    fprintf(stderr, "error: duplicate value %d, unique index %s not created.\n", index_key, create->index_name);
+                    break;
+                }
+            }
+            index_entry(&layout, &new_index, entry_columns, primary_key, record_data, entry, &length);
+            btree_insert(db->pool, db->pager, db->wal, 0, new_index.root_page_id, index_key, entry, length);
+            records_indexed++;
         }
+    }
+    btree_cursor_close(&cursor);
+    if (duplicate) {
+        // the tree is left unused, as a dropped index's is
+        target_table->num_indexes--;
+        db->schema_version++;
+        return;
+    }
 
-        uint32_t table_root_page_id = 0;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table_root_page_id = db->catalog->tables[i].root_page_id;
-                break;
+    catalog_save_indexes(db->catalog, target_table, target_table->num_indexes - 1, 0);
+
+    printf("Index %s created successfully on %s.%s (%d records indexed)\n", create->index_name,
+           create->table_name, create->column_name, records_indexed);
+}
+
+static void execute_drop_index(Database* db, DropIndexStatement* drop) {
+    TableSchema* target_table = find_table(db, drop->table_name);
+    if (target_table == NULL) {
+        fprintf(stderr, "error: table %s not found.\n", drop->table_name);
+        return;
+    }
+
+    // find and remove the index
+    int index_found = -1;
+    for (int i = 0; i < target_table->num_indexes; i++) {
+        if (strcmp(target_table->indexes[i].name, drop->index_name) == 0) {
+            // shift remaining indexes down
+            for (int j = i; j < target_table->num_indexes - 1; j++) {
+                target_table->indexes[j] = target_table->indexes[j + 1];
             }
+            target_table->num_indexes--;
+            db->schema_version++;
+            index_found = i;
+            break;
         }
+    }
 
-        if (table_root_page_id == 0) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            return NULL;
-        }
+    if (index_found < 0) {
+        fprintf(stderr, "error: index %s not found.\n", drop->index_name);
+        return;
+    }
 
-        char* value = strchr(set_clause, '=');
-        if (value == NULL) {
-            fprintf(stderr, "error: invalid update syntax.\n");
-            return NULL;
-        }
-        value++; // skip the '='
-        // trim leading/trailing whitespace and quotes
-        while (*value == ' ' || *value == '\t' || *value == '\'') {
-            value++;
-        }
-        char* end = value + strlen(value) - 1;
-        while (end > value && (*end == ' ' || *end == '\t' || *end == '\'')) {
-            *end-- = '\0';
+    // the indexes after it moved down a position
+    catalog_save_indexes(db->catalog, target_table, index_found, 1);
+
+    printf("Index %s dropped successfully\n", drop->index_name);
+}
+
+// refresh the statistics of one table, or of every table, for the planner
+static void execute_analyze(Database* db, AnalyzeStatement* analyze) {
+    TableSchema* target_table = NULL;
+    if (analyze->table_name[0] != '\0') {
+        target_table = find_table(db, analyze->table_name);
+        if (target_table == NULL) {
+            fprintf(stderr, "error: table %s not found.\n", analyze->table_name);
+            return;
         }
+    }
 
-        // get old values for index maintenance
-        char* old_values = btree_search(db->pool, db->pager, table_root_page_id, id);
-        
-        if (old_values == NULL) {
-            fprintf(stderr, "error: record with id %d not found.\n", id);
+    int num_tables = 1;
+    TableSchema** tables = target_table != NULL ? &target_table : catalog_list_tables(db->catalog, &num_tables);
+    for (int i = 0; i < num_tables; i++) {
+        TableSchema* table = tables[i];
+        stats_analyze_table(db->pool, db->pager, table);
+        catalog_save_stats(db->catalog, table);
+        printf("Table %s analyzed (%lld rows)\n", table->table_name, (long long)table->stats.num_rows);
+    }
+    if (target_table == NULL) {
+        free(tables);
+    }
+    // plans made with the old statistics are out of date
+    db->schema_version++;
+}
+
+static const char* statement_name(StatementType type) {
+    switch (type) {
+        case STATEMENT_INSERT: return "insert";
+        case STATEMENT_COPY: return "copy";
+        case STATEMENT_UPDATE: return "update";
+        case STATEMENT_DELETE: return "delete";
+        case STATEMENT_CREATE_TABLE: return "create table";
+        case STATEMENT_CREATE_INDEX: return "create index";
+        case STATEMENT_DROP_INDEX: return "drop index";
+        case STATEMENT_ANALYZE: return "analyze";
+        default: return "";
+    }
+}
+
+// an open cursor keeps a leaf pinned and walks it, so tables must not change under it
+static int cursors_open(Database* db) {
+    if (db->num_open_cursors > 0) {
+        fprintf(stderr, "error: tables cannot be modified while a cursor is open.\n");
+        return 1;
+    }
+    return 0;
+}
+
+static Result* execute_statement(PreparedStatement* prepared) {
+    Database* db = prepared->db;
+    Statement* statement = prepared->statement;
+    switch (statement->type) {
+        case STATEMENT_BEGIN:
+            if (db->locked) {
+                fprintf(stderr, "error: another transaction is already in progress.\n");
+                return NULL;
+            }
+            db->locked = 1;
+            db->current_tx_id++;
+            wal_log_begin(db->wal, db->current_tx_id);
             return NULL;
-        }
-        
-        // find table schema to get column info
-        TableSchema* update_table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                update_table = &db->catalog->tables[i];
-                break;
+        case STATEMENT_COMMIT:
+            if (!db->locked) {
+                fprintf(stderr, "error: no active transaction to commit.\n");
+                return NULL;
             }
-        }
-        
-        if (update_table == NULL) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            free(old_values);
+            // no-force: dirty pages reach the data file on eviction or close, the
+            // commit record makes the transaction durable
+            wal_log_commit(db->wal, db->current_tx_id);
+            db->locked = 0;
             return NULL;
-        }
-        
-        // parse old values into array
-        char* old_values_copy = strdup(old_values);
-        char* old_columns[MAX_COLUMNS_PER_TABLE];
-        char* token = strtok(old_values_copy, "|");
-        int col_count = 0;
-        while (token != NULL && col_count < update_table->num_columns) {
-            old_columns[col_count] = strdup(token);
-            token = strtok(NULL, "|");
-            col_count++;
-        }
-        free(old_values_copy);
-        
-        // find which column to update
-        char column_to_update[MAX_NAME_LEN];
-        char* equals_pos = strchr(set_clause, '=');
-        if (equals_pos == NULL) {
-            fprintf(stderr, "error: invalid SET clause syntax.\n");
-            for (int i = 0; i < col_count; i++) free(old_columns[i]);
-            free(old_values);
+        case STATEMENT_ROLLBACK:
+            if (!db->locked) {
+                fprintf(stderr, "error: no active transaction to rollback.\n");
+                return NULL;
+            }
+            if (cursors_open(db)) {
+                return NULL;
+            }
+            // undo this transaction's changes in place, newest first
+            wal_rollback(db->wal, db->pool, db->pager, db->current_tx_id);
+            db->locked = 0;
             return NULL;
-        }
-        
-        int col_name_len = equals_pos - set_clause;
-        strncpy(column_to_update, set_clause, col_name_len);
-        column_to_update[col_name_len] = '\0';
-        
-        // trim whitespace from column name
-        while (*column_to_update == ' ' || *column_to_update == '\t') {
-            memmove(column_to_update, column_to_update + 1, strlen(column_to_update));
-        }
-        char* col_end = column_to_update + strlen(column_to_update) - 1;
-        while (col_end > column_to_update && (*col_end == ' ' || *col_end == '\t')) {
-            *col_end-- = '\0';
-        }
-        
-        // find column index
-        int update_col_index = -1;
-        for (int i = 0; i < update_table->num_columns; i++) {
-            if (strcmp(update_table->columns[i].name, column_to_update) == 0) {
-                update_col_index = i;
-                break;
+        case STATEMENT_CREATE_TABLE:
+        case STATEMENT_CREATE_INDEX:
+        case STATEMENT_DROP_INDEX:
+        case STATEMENT_ANALYZE:
+            if (db->locked) {
+                fprintf(stderr, "error: %s statements must not be within a transaction.\n", statement_name(statement->type));
+                return NULL;
             }
-        }
-        
-        if (update_col_index == -1) {
-            fprintf(stderr, "error: column %s not found.\n", column_to_update);
-            for (int i = 0; i < col_count; i++) free(old_columns[i]);
-            free(old_values);
+            if (cursors_open(db)) {
+                return NULL;
+            }
+            if (statement->type == STATEMENT_CREATE_TABLE) {
+                execute_create_table(db, &statement->create_table);
+            } else if (statement->type == STATEMENT_CREATE_INDEX) {
+                execute_create_index(db, &statement->create_index);
+            } else if (statement->type == STATEMENT_DROP_INDEX) {
+                execute_drop_index(db, &statement->drop_index);
+            } else {
+                execute_analyze(db, &statement->analyze);
+            }
+            // its pages are written back later, as a commit's are; the log
+            // makes it durable
+            wal_sync(db->wal);
             return NULL;
-        }
-        
-        // update the specific column
-        free(old_columns[update_col_index]);
-        old_columns[update_col_index] = strdup(value);
-        
-        // rebuild serialized values
-        char serialized_values[256] = "";
-        for (int i = 0; i < col_count; i++) {
-            if (i > 0) strcat(serialized_values, "|");
-            strcat(serialized_values, old_columns[i]);
-        }
-        
-        // cleanup
-        for (int i = 0; i < col_count; i++) {
-            free(old_columns[i]);
-        }
-
-        // find table schema for index maintenance
-        TableSchema* table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table = &db->catalog->tables[i];
-                break;
+        case STATEMENT_INSERT:
+        case STATEMENT_COPY:
+        case STATEMENT_UPDATE:
+        case STATEMENT_DELETE:
+            if (!db->locked) {
+                fprintf(stderr, "error: %s statements must be within a transaction.\n", statement_name(statement->type));
+                return NULL;
             }
-        }
-        
-        // remove old index entries
-        if (table != NULL && old_values != NULL) {
-            maintain_indexes_delete(db, table, id, old_values);
-        }
+            if (cursors_open(db)) {
+                return NULL;
+            }
+            if (statement->type == STATEMENT_INSERT) {
+                execute_insert(prepared);
+            } else if (statement->type == STATEMENT_COPY) {
+                execute_copy(prepared);
+            } else if (statement->type == STATEMENT_UPDATE) {
+                execute_update(prepared);
+            } else {
+                execute_delete(prepared);
+            }
+            return NULL;
+        case STATEMENT_SELECT:
+            return execute_select(prepared);
+    }
+    return NULL;
+}
 
-        wal_log_update(db->wal, db->current_tx_id, id, serialized_values);
-        btree_insert(db->pool, db->pager, table_root_page_id, id, serialized_values, db->locked);
-        
-        // add new index entries
-        if (table != NULL) {
-            maintain_indexes_insert(db, table, id, serialized_values);
-        }
-        
-        if (old_values != NULL) {
-            free(old_values);
-        }
-        
+Result* db_execute(Database* db, const char* query) {
+    PreparedStatement* prepared = db_prepare(db, query);
+    if (prepared == NULL) {
         return NULL;
-    } else if (strncmp(query, "DELETE FROM", 11) == 0) {
-        if (!db->locked) {
-            fprintf(stderr, "error: delete statements must be within a transaction.\n");
-            return NULL;
-        }
-        char table_name[MAX_NAME_LEN];
-        int id;
-        sscanf(query, "DELETE FROM %s WHERE id = %d", table_name, &id);
+    }
+    Result* result = db_step(prepared);
+    db_finalize(prepared);
+    return result;
+}
 
-        uint32_t table_root_page_id = 0;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table_root_page_id = db->catalog->tables[i].root_page_id;
-                break;
-            }
-        }
+static void collect_parameters(Expr* expr, Expr** parameters) {
+    if (expr == NULL) {
+        return;
+    }
+    if (expr->type == EXPR_PARAMETER) {
+        parameters[expr->parameter_index] = expr;
+    }
+    collect_parameters(expr->left, parameters);
+    collect_parameters(expr->right, parameters);
+}
 
-        if (table_root_page_id == 0) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            return NULL;
-        }
+PreparedStatement* db_prepare(Database* db, const char* sql) {
+    // the statement is parsed once, execution dispatches on the syntax tree
+    Statement* statement = parse_statement(sql);
+    if (statement == NULL) {
+        return NULL;
+    }
 
-        // get old values for index maintenance
-        char* old_values = btree_search(db->pool, db->pager, table_root_page_id, id);
-        
-        // find table schema for index maintenance
-        TableSchema* table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table = &db->catalog->tables[i];
-                break;
-            }
+    PreparedStatement* prepared = (PreparedStatement*)calloc(1, sizeof(PreparedStatement));
+    prepared->db = db;
+    prepared->statement = statement;
+    arena_init(&prepared->scratch);
+
+    // parameter state lives as long as the syntax tree, in the same arena
+    int num_parameters = statement->num_parameters;
+    prepared->parameters = (Expr**)arena_calloc(&statement->arena, sizeof(Expr*) * (num_parameters + 1));
+    prepared->bindings = (Binding*)arena_calloc(&statement->arena, sizeof(Binding) * (num_parameters + 1));
+    prepared->parameter_text = (char (*)[32])arena_alloc(&statement->arena, sizeof(*prepared->parameter_text) * (num_parameters + 1));
+
+    SelectStatement* select = &statement->select;
+    collect_parameters(select->where, prepared->parameters);
+    for (int i = 0; i < statement->insert.num_rows; i++) {
+        for (int j = 0; j < statement->insert.num_values; j++) {
+            collect_parameters(statement->insert.rows[i][j], prepared->parameters);
         }
-        
-        // remove index entries
-        if (table != NULL && old_values != NULL) {
-            maintain_indexes_delete(db, table, id, old_values);
+    }
+    for (int i = 0; i < statement->update.num_assignments; i++) {
+        collect_parameters(statement->update.assignments[i].value, prepared->parameters);
+    }
+    collect_parameters(statement->update.where, prepared->parameters);
+    collect_parameters(statement->delete_.where, prepared->parameters);
+    for (int i = 0; i < num_parameters; i++) {
+        if (prepared->parameters[i] == NULL) {
+            fprintf(stderr, "error: parameters are only supported in conditions and values.\n");
+            db_finalize(prepared);
+            return NULL;
         }
+    }
 
-        wal_log_delete(db->wal, db->current_tx_id, id);
-        btree_delete(db->pool, db->pager, table_root_page_id, id, db->locked);
-        
-        if (old_values != NULL) {
-            free(old_values);
-        }
-        
+    if (plan_statement(prepared) != 0) {
+        db_finalize(prepared);
         return NULL;
-    } else if (strncmp(query, "SELECT", 6) == 0) {
-        buffer_pool_flush_all(db->pool, db->pager);
-        for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-            db->pool->frames[i].page_id = -1;
-        }
+    }
+    return prepared;
+}
 
-        char table_name[MAX_NAME_LEN];
-        char where_clause[256] = "";
-        
-        // extract table name first
-        char* from_pos = strstr(query, "FROM");
-        if (from_pos == NULL) {
-            fprintf(stderr, "error: invalid select query format.\n");
-            return NULL;
-        }
-        from_pos += 5; // skip "FROM "
-        
-        // find the end of table name (either space, WHERE, or end of string)
-        char* where_pos = strstr(from_pos, "WHERE");
-        if (where_pos != NULL) {
-            // extract table name up to WHERE
-            int table_name_len = where_pos - from_pos;
-            strncpy(table_name, from_pos, table_name_len);
-            table_name[table_name_len] = '\0';
-            // trim trailing spaces
-            while (table_name_len > 0 && table_name[table_name_len - 1] == ' ') {
-                table_name[--table_name_len] = '\0';
-            }
-            // extract where clause
-            strcpy(where_clause, where_pos + 6); // skip "WHERE "
-        } else {
-            // no WHERE clause, extract table name to end of query
-            sscanf(from_pos, "%s", table_name);
-        }
-        
+static Binding* get_binding(PreparedStatement* prepared, int index) {
+    if (index < 1 || index > prepared->statement->num_parameters) {
+        fprintf(stderr, "error: parameter %d out of range.\n", index);
+        return NULL;
+    }
+    Binding* binding = &prepared->bindings[index - 1];
+    free(binding->text);
+    binding->text = NULL;
+    binding->bound = 1;
+    return binding;
+}
+
+int db_bind_int(PreparedStatement* prepared, int index, int64_t value) {
+    Binding* binding = get_binding(prepared, index);
+    if (binding == NULL) {
+        return -1;
+    }
+    binding->is_text = 0;
+    binding->int_value = value;
+    return 0;
+}
 
+// a NULL text binds a null value
+int db_bind_text(PreparedStatement* prepared, int index, const char* text) {
+    Binding* binding = get_binding(prepared, index);
+    if (binding == NULL) {
+        return -1;
+    }
+    binding->is_text = 1;
+    binding->text = text != NULL ? strdup(text) : NULL;
+    return 0;
+}
 
-        TableSchema* table = NULL;
-        for (int i = 0; i < db->catalog->num_tables; i++) {
-            if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-                table = &db->catalog->tables[i];
-                break;
+// convert the bound values to the types of the columns their placeholders
+// are used with. untyped placeholders keep the type they were bound as.
+static int apply_bindings(PreparedStatement* prepared) {
+    for (int i = 0; i < prepared->statement->num_parameters; i++) {
+        Expr* parameter = prepared->parameters[i];
+        Binding* binding = &prepared->bindings[i];
+        if (!binding->bound) {
+            fprintf(stderr, "error: parameter %d is not bound.\n", i + 1);
+            return -1;
+        }
+
+        ColumnType type = binding->is_text ? COLUMN_TYPE_TEXT : COLUMN_TYPE_INT;
+        if (parameter->has_type) {
+            type = parameter->value.type;
+        }
+        Value* value = &parameter->value;
+        if (binding->is_text) {
+            if (binding->text == NULL) {
+                value_set_null(value, type);
+            } else if (value_parse(value, type, binding->text, (uint16_t)strlen(binding->text)) != 0) {
+                return -1;
             }
+            continue;
         }
 
-        if (table == NULL) {
-            fprintf(stderr, "error: table %s not found.\n", table_name);
-            return NULL;
+        memset(value, 0, sizeof(Value));
+        value->type = type;
+        switch (type) {
+            case COLUMN_TYPE_VARCHAR:
+            case COLUMN_TYPE_TEXT:
+                value->text = prepared->parameter_text[i];
+                value->text_length = (uint16_t)snprintf(prepared->parameter_text[i], sizeof(prepared->parameter_text[i]),
+                                                        "%lld", (long long)binding->int_value);
+                break;
+            case COLUMN_TYPE_FLOAT:
+            case COLUMN_TYPE_DOUBLE:
+                value->double_value = (double)binding->int_value;
+                break;
+            case COLUMN_TYPE_BOOLEAN:
+                value->int_value = binding->int_value != 0;
+                break;
+            case COLUMN_TYPE_INT:
+                if (binding->int_value < INT32_MIN || binding->int_value > INT32_MAX) {
+                    fprintf(stderr, "error: integer %lld is out of range.\n", (long long)binding->int_value);
+                    return -1;
+                }
+                value->int_value = binding->int_value;
+                break;
+            default:
+                value->int_value = binding->int_value;
+                break;
         }
+    }
+    return 0;
+}
 
-        // try to use index optimization for WHERE conditions
-        if (strlen(where_clause) > 0) {
-            char col_name[MAX_NAME_LEN];
-            char op[4];
-            char value_str[256];
-            sscanf(where_clause, "%s %s %s", col_name, op, value_str);
-            
-            IndexSchema* usable_index = find_usable_index(table, col_name, op);
-            if (usable_index != NULL) {
-                // use index for optimized lookup
-                printf("Using index %s for query optimization\n", usable_index->name);
-                return execute_index_lookup(db, table, usable_index, value_str);
-            }
-        }
-        
-        // fall back to full table scan
-        printf("Performing full table scan (no suitable index found)\n");
-        Result* result = (Result*)malloc(sizeof(Result));
-        result->num_rows = 0;
-        result->rows = NULL;
-
-        // start from the leftmost leaf node (assumes root is leaf)
-        uint32_t current_page_id = table->root_page_id;
-        Page* current_page = buffer_pool_get_page(db->pool, db->pager, current_page_id);
-        BTreeLeafNode* leaf_node = (BTreeLeafNode*)current_page;
-        while (leaf_node != NULL) {
-            for (int i = 0; i < leaf_node->header.num_keys; i++) {
-                if (leaf_node->keys[i] == -1) continue; // skip deleted keys
-
-                int matches = 1;
-                if (strlen(where_clause) > 0) {
-                    char col_name[MAX_NAME_LEN];
-                    char op[4];
-                    char value_str[256];
-                    sscanf(where_clause, "%s %s %s", col_name, op, value_str);
-
-                    int col_idx = -1;
-                    for (int j = 0; j < table->num_columns; j++) {
-                        if (strcmp(table->columns[j].name, col_name) == 0) {
-                            col_idx = j;
-                            break;
-                        }
-                    }
+static int begin_step(PreparedStatement* prepared) {
+    if (prepared->stepped) {
+        fprintf(stderr, "error: statement must be reset before it is stepped again.\n");
+        return -1;
+    }
+    prepared->stepped = 1;
+    arena_reset(&prepared->scratch);
 
-                    if (col_idx != -1) {
-                        char* value_copy = strdup(leaf_node->values[i]);
-                        char* token = strtok(value_copy, "|");
-                        int col = 0;
-                        char* cell_value = NULL;
-                        while (token != NULL && col <= col_idx) {
-                            if (col == col_idx) {
-                                cell_value = token;
-                                break;
-                            }
-                            token = strtok(NULL, "|");
-                            col++;
-                        }
-
-                        if (cell_value != NULL) {
-                            if (strcmp(op, "=") == 0) {
-                                if (strcmp(cell_value, value_str) != 0) matches = 0;
-                            } else if (strcmp(op, "!=") == 0) {
-                                if (strcmp(cell_value, value_str) == 0) matches = 0;
-                            } else if (strcmp(op, "<") == 0) {
-                                if (atof(cell_value) >= atof(value_str)) matches = 0;
-                            } else if (strcmp(op, ">") == 0) {
-                                if (atof(cell_value) <= atof(value_str)) matches = 0;
-                            } else if (strcmp(op, "<=") == 0) {
-                                if (atof(cell_value) > atof(value_str)) matches = 0;
-                            } else if (strcmp(op, ">=") == 0) {
-                                if (atof(cell_value) < atof(value_str)) matches = 0;
-                            }
-                        } else {
-                            matches = 0;
-                        }
-                        free(value_copy);
-                    } else {
-                        matches = 0;
-                    }
-                }
+    // ddl since the last plan may have moved or dropped what it points at
+    if (prepared->schema_version != prepared->db->schema_version && plan_statement(prepared) != 0) {
+        return -1;
+    }
+    return apply_bindings(prepared);
+}
 
-                if (matches) {
-                    result->num_rows++;
-                    result->rows = (char***)realloc(result->rows, sizeof(char**) * result->num_rows);
-                    result->rows[result->num_rows - 1] = (char**)malloc(sizeof(char*) * table->num_columns);
-
-                    char* value_copy = strdup(leaf_node->values[i]);
-                    char* token = strtok(value_copy, "|");
-                    int col = 0;
-                    while (token != NULL && col < table->num_columns) {
-                        result->rows[result->num_rows - 1][col] = (char*)malloc(strlen(token) + 1);
-                        strcpy(result->rows[result->num_rows - 1][col], token);
-                        token = strtok(NULL, "|");
-                        col++;
-                    }
-                    free(value_copy);
-                }
-            }
+Result* db_step(PreparedStatement* prepared) {
+    if (begin_step(prepared) != 0) {
+        return NULL;
+    }
+    return execute_statement(prepared);
+}
 
-            if (leaf_node->next_leaf != 0) {
-                buffer_pool_unpin_page(db->pool, db->pager, current_page_id, 0);
-                current_page_id = leaf_node->next_leaf;
-                current_page = buffer_pool_get_page(db->pool, db->pager, current_page_id);
-                leaf_node = (BTreeLeafNode*)current_page;
-            } else {
-                buffer_pool_unpin_page(db->pool, db->pager, current_page_id, 0);
-                leaf_node = NULL;
-            }
-        }
-        
-        // return NULL if no rows were found
-        if (result->num_rows == 0) {
-            free(result);
+// make the statement ready to step again, bindings are kept
+void db_reset(PreparedStatement* prepared) {
+    prepared->stepped = 0;
+}
+
+Cursor* db_cursor_open(PreparedStatement* prepared) {
+    if (prepared->statement->type != STATEMENT_SELECT) {
+        fprintf(stderr, "error: only SELECT statements return rows.\n");
+        return NULL;
+    }
+    if (begin_step(prepared) != 0) {
+        return NULL;
+    }
+    return cursor_create(prepared);
+}
+
+Cursor* db_query(Database* db, const char* sql) {
+    PreparedStatement* prepared = db_prepare(db, sql);
+    if (prepared == NULL) {
+        return NULL;
+    }
+    if (prepared->statement->type != STATEMENT_SELECT) {
+        db_step(prepared);
+        db_finalize(prepared);
+        return NULL;
+    }
+
+    Cursor* cursor = db_cursor_open(prepared);
+    if (cursor == NULL) {
+        db_finalize(prepared);
+        return NULL;
+    }
+    cursor->owns_statement = 1;
+    return cursor;
+}
+
+const Value* db_cursor_next(Cursor* cursor) {
+    // refill from the operator tree once the current batch is used up
+    if (cursor->position >= cursor->batch.num_rows) {
+        cursor->position = 0;
+        if (cursor->root->next(cursor->root, &cursor->batch) == 0) {
+            cursor->failed = cursor->root->error;
             return NULL;
         }
-        
-        return result;
     }
+    return batch_row(&cursor->batch, cursor->position++);
+}
 
-    return NULL;
+void db_cursor_close(Cursor* cursor) {
+    if (cursor == NULL) {
+        return;
+    }
+    operator_close(cursor->root);
+    arena_free(&cursor->arena);
+    cursor->prepared->db->num_open_cursors--;
+    if (cursor->owns_statement) {
+        db_finalize(cursor->prepared);
+    }
+    free(cursor);
+}
+
+void db_finalize(PreparedStatement* prepared) {
+    if (prepared == NULL) {
+        return;
+    }
+    for (int i = 0; i < prepared->statement->num_parameters; i++) {
+        free(prepared->bindings[i].text);
+    }
+    arena_free(&prepared->scratch);
+    statement_free(prepared->statement);
+    free(prepared);
+}
+
+void db_result_free(Result* result) {
+    if (result == NULL) {
+        return;
+    }
+    arena_free(&result->arena);
+    free(result);
 }
 
 // Table printing utility implementation
@@ -1319,15 +2510,18 @@ void db_list_tables(Database* db) {
     table_printer_add_header(printer, 2, "Type");
     table_printer_add_header(printer, 3, "Owner");
     
-    for (int i = 0; i < db->catalog->num_tables; i++) {
+    int num_tables;
+    TableSchema** tables = catalog_list_tables(db->catalog, &num_tables);
+    for (int i = 0; i < num_tables; i++) {
         char* row_data[4] = {
             "public",
-            db->catalog->tables[i].table_name,
+            tables[i]->table_name,
             "table",
             "user"
         };
         table_printer_add_row(printer, row_data);
     }
+    free(tables);
     
     table_printer_print(printer);
     table_printer_free(printer);
@@ -1339,13 +2533,7 @@ void db_describe_table(Database* db, const char* table_name) {
         return;
     }
 
-    TableSchema* table = NULL;
-    for (int i = 0; i < db->catalog->num_tables; i++) {
-        if (strcmp(db->catalog->tables[i].table_name, table_name) == 0) {
-            table = &db->catalog->tables[i];
-            break;
-        }
-    }
+    TableSchema* table = find_table(db, table_name);
 
     if (table == NULL) {
         printf("did not find any relation named \"%s\".\n", table_name);
@@ -1412,6 +2600,14 @@ void db_describe_table(Database* db, const char* table_name) {
                    table->table_name, table->columns[i].name);
         }
     }
+    for (int i = 0; i < table->num_indexes; i++) {
+        IndexSchema* index = &table->indexes[i];
+        printf("    \"%s\" %sbtree (%s)", index->name, index->is_unique ? "UNIQUE, " : "", index->column_name);
+        for (int j = 0; j < index->num_include_columns; j++) {
+            printf("%s%s", j == 0 ? " INCLUDE (" : ", ", table->columns[index->include_columns[j]].name);
+        }
+        printf("%s\n", index->num_include_columns > 0 ? ")" : "");
+    }
     printf("\n");
 }
 
@@ -1439,10 +2635,12 @@ void db_describe_all(Database* db) {
     table_printer_add_header(printer, 4, "Size");
     table_printer_add_header(printer, 5, "Description");
     
-    for (int i = 0; i < db->catalog->num_tables; i++) {
+    int num_tables;
+    TableSchema** tables = catalog_list_tables(db->catalog, &num_tables);
+    for (int i = 0; i < num_tables; i++) {
         char* row_data[6] = {
             "public",
-            db->catalog->tables[i].table_name,
+            tables[i]->table_name,
             "table",
             "user",
             "8192 bytes",
@@ -1450,6 +2648,7 @@ void db_describe_all(Database* db) {
         };
         table_printer_add_row(printer, row_data);
     }
+    free(tables);
     
     table_printer_print(printer);
     table_printer_free(printer);
@@ -4,6 +4,12 @@
 #include "buffer.h"
 #include "wal.h"
 #include "catalog.h"
+#include "parser.h"
+#include "row.h"
+#include "executor.h"
+
+#define COPY_BATCH_ROWS 4096   // rows COPY parses before inserting them together
+#define MODIFY_BATCH_ROWS 1024 // rows UPDATE and DELETE change per pass over the indexes
 
 typedef struct {
     BufferPool* pool;
@@ -13,17 +19,124 @@ typedef struct {
     uint32_t current_tx_id;
     int locked;
     Catalog* catalog;
+    uint32_t schema_version; // bumped by ddl, prepared statements re-plan when it changes
+    int num_open_cursors;    // tables cannot be modified while any are open
+    size_t sort_memory;      // bytes ORDER BY sorts in memory before spilling, SORT_MEMORY_BUDGET unless changed
 } Database;
 
 
+// rows and cells are allocated from the result's arena, db_result_free
+// releases all of them
 typedef struct {
     int num_rows;
-    char*** rows;
+    int num_columns;
+    char*** rows;        // rows[i][j] is column j of row i, NULL for a null value
+    Arena arena;
 } Result;
 
+typedef enum {
+    ACCESS_SEQ_SCAN,
+    ACCESS_PRIMARY_KEY,   // key range over the table's own tree
+    ACCESS_INDEX          // key range over an index
+} AccessPath;
+
+typedef enum {
+    JOIN_NESTED_LOOP,       // every pair of rows
+    JOIN_HASH,              // the joined table hashed on its join column
+    JOIN_INDEX_NESTED_LOOP  // each row looked up in the joined table's index or primary key
+} JoinMethod;
+
+// bounds the WHERE clause puts on a key column, literals or placeholders.
+// NULL sides are open; an equality has the same expression on both sides.
+typedef struct {
+    const Expr* lower;
+    int lower_inclusive;
+    const Expr* upper;
+    int upper_inclusive;
+} KeyBounds;
+
+// a value bound to a ? placeholder, converted to the parameter's type on step
+typedef struct {
+    int bound;
+    int is_text;
+    int64_t int_value;
+    char* text;           // owned copy, NULL binds a null value
+} Binding;
+
+// a statement parsed and planned once, executed with db_step any number of
+// times. the plan caches the table, the row layout, the selected columns and
+// the access path, and is rebuilt when ddl changes the schema.
+typedef struct {
+    Database* db;
+    Statement* statement;
+    uint32_t schema_version;
+    int stepped;
+
+    TableSchema* table;
+    RowLayout layout;
+    int columns[MAX_COLUMNS_PER_TABLE * 2]; // SELECT: projected columns, UPDATE: assigned columns
+    int num_columns;
+    int aggregated;                     // SELECT with aggregates or GROUP BY: columns and ORDER BY read the aggregate's rows
+    int group_columns[MAX_COLUMNS_PER_TABLE * 2]; // GROUP BY columns, the first columns of the aggregate's rows
+    int num_group_columns;
+    AggregateSpec aggregates[MAX_COLUMNS_PER_TABLE * 2]; // the aggregates, following the group columns
+    int num_aggregates;
+    int group_ordered;                  // GROUP BY: the rows of each group arrive together
+    int ordered;                        // ORDER BY is the order the access path returns rows in, no sort is needed
+    int offset_in_scan;                 // OFFSET rows are stepped over by the scan, unread
+    AccessPath access;                  // SELECT, UPDATE, DELETE
+    IndexSchema* index;                 // ACCESS_INDEX: the index scanned, else NULL
+    int index_only;                     // ACCESS_INDEX: the index entries hold every column read
+    uint32_t scan_columns;              // SELECT, UPDATE, DELETE: a bit per column of the table the query reads, only those are decoded
+    double estimated_rows;              // rows the access path reads, from statistics
+    TableSchema* join_table;            // SELECT ... JOIN: the second table, else NULL
+    JoinMethod join;
+    IndexSchema* join_index;            // JOIN_INDEX_NESTED_LOOP: the index looked up, NULL for the primary key
+    int join_keys[2];                   // JOIN_HASH, JOIN_INDEX_NESTED_LOOP: the table's and the joined table's key column
+    uint32_t join_columns;              // as scan_columns, for the joined table
+    KeyBounds bounds;                   // ACCESS_PRIMARY_KEY, ACCESS_INDEX: the key range read
+
+    Expr** parameters;                  // placeholder nodes by position
+    Binding* bindings;
+    char (*parameter_text)[32];         // integers bound to text parameters are formatted here
+    Arena scratch;                      // memory for one step, reset by the next
+} PreparedStatement;
+
+// streams the rows of a SELECT one batch at a time, so memory does not grow
+// with the size of the result. the operator tree and its batches live in the
+// cursor's arena and are released together on close.
+typedef struct {
+    PreparedStatement* prepared;
+    int owns_statement;      // opened by db_query, finalized on close
+    Operator* root;
+    Batch batch;
+    int position;
+    int num_columns;
+    int failed;              // the query failed part way, the rows returned are incomplete
+    Arena arena;
+} Cursor;
+
 Database* db_open(const char* filename);
 void db_close(Database* db);
 Result* db_execute(Database* db, const char* query);
+void db_result_free(Result* result);
+
+// parameters are numbered from 1 in the order the ? placeholders appear
+PreparedStatement* db_prepare(Database* db, const char* sql);
+int db_bind_int(PreparedStatement* statement, int index, int64_t value);
+int db_bind_text(PreparedStatement* statement, int index, const char* text);
+Result* db_step(PreparedStatement* statement);
+void db_reset(PreparedStatement* statement);
+void db_finalize(PreparedStatement* statement);
+
+// db_query returns a cursor for a SELECT and runs any other statement,
+// returning NULL. db_cursor_next returns the next row as num_columns values,
+// borrowed until the following call, or NULL after the last row. failed is
+// set when the NULL is an error rather than the end of the rows.
+Cursor* db_query(Database* db, const char* sql);
+Cursor* db_cursor_open(PreparedStatement* statement);
+const Value* db_cursor_next(Cursor* cursor);
+void db_cursor_close(Cursor* cursor);
 
 typedef struct {
     char** headers;
@@ -0,0 +1,2268 @@
+#include "executor.h"
+#include "btree.h"
+#include "simd.h"
+#include "spill.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void batch_init(Batch* batch, int num_columns, Arena* arena) {
+    batch->num_rows = 0;
+    batch->num_columns = num_columns;
+    batch->values = (Value*)arena_alloc(arena, sizeof(Value) * BATCH_SIZE * (num_columns > 0 ? num_columns : 1));
+    batch->data = (char*)arena_alloc(arena, BATCH_DATA_SIZE);
+    batch->data_used = 0;
+}
+
+Value* batch_row(const Batch* batch, int row) {
+    return &batch->values[(size_t)row * batch->num_columns];
+}
+
+// next of one of op's inputs, passing its failure on to op
+static int operator_pull(Operator* op, Operator* input, Batch* batch) {
+    int num_rows = input->next(input, batch);
+    if (input->error) {
+        op->error = 1;
+        return 0;
+    }
+    return num_rows;
+}
+
+void operator_close(Operator* op) {
+    if (op != NULL) {
+        op->close(op);
+    }
+}
+
+// copy a row and the text it points to into one arena allocation
+static Value* copy_row(Arena* arena, const Value* row, int num_columns) {
+    size_t text_size = 0;
+    for (int i = 0; i < num_columns; i++) {
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            text_size += row[i].text_length;
+        }
+    }
+
+    Value* copy = (Value*)arena_alloc(arena, sizeof(Value) * num_columns + text_size);
+    char* text = (char*)(copy + num_columns);
+    for (int i = 0; i < num_columns; i++) {
+        copy[i] = row[i];
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            memcpy(text, row[i].text, row[i].text_length);
+            copy[i].text = text;
+            text += row[i].text_length;
+        }
+    }
+    return copy;
+}
+
+// copy the text of a row into the batch's data, 0 if it does not fit
+static int batch_copy_text(Batch* batch, Value* row, int num_columns) {
+    size_t size = 0;
+    for (int i = 0; i < num_columns; i++) {
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            size += row[i].text_length;
+        }
+    }
+    if (batch->data_used + size > BATCH_DATA_SIZE) {
+        return 0;
+    }
+    for (int i = 0; i < num_columns; i++) {
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            char* text = batch->data + batch->data_used;
+            memcpy(text, row[i].text, row[i].text_length);
+            row[i].text = text;
+            batch->data_used += row[i].text_length;
+        }
+    }
+    return 1;
+}
+
+
+// aggregates are read from the rows of the operator that computed them
+static void expr_value(const Expr* expr, const Value* row, Value* value) {
+    if (expr->type == EXPR_COLUMN || expr->type == EXPR_AGGREGATE) {
+        *value = row[expr->column_index];
+    } else {
+        *value = expr->value;
+    }
+}
+
+int expr_evaluate(const Expr* expr, const Value* row) {
+    switch (expr->type) {
+        case EXPR_AND: {
+            int left = expr_evaluate(expr->left, row);
+            if (left == 0) {
+                return 0;
+            }
+            int right = expr_evaluate(expr->right, row);
+            return right == 0 ? 0 : (left == 1 && right == 1 ? 1 : -1);
+        }
+        case EXPR_OR: {
+            int left = expr_evaluate(expr->left, row);
+            if (left == 1) {
+                return 1;
+            }
+            int right = expr_evaluate(expr->right, row);
+            return right == 1 ? 1 : (left == 0 && right == 0 ? 0 : -1);
+        }
+        case EXPR_NOT: {
+            int operand = expr_evaluate(expr->left, row);
+            return operand == -1 ? -1 : !operand;
+        }
+        case EXPR_IS_NULL: {
+            Value value;
+            expr_value(expr->left, row, &value);
+            return value.is_null != expr->negated;
+        }
+        case EXPR_COMPARE: {
+            Value left;
+            Value right;
+            expr_value(expr->left, row, &left);
+            expr_value(expr->right, row, &right);
+            if (left.is_null || right.is_null) {
+                return -1;
+            }
+            int cmp = value_compare(&left, &right);
+            switch (expr->op) {
+                case COMPARE_EQ: return cmp == 0;
+                case COMPARE_NE: return cmp != 0;
+                case COMPARE_LT: return cmp < 0;
+                case COMPARE_LE: return cmp <= 0;
+                case COMPARE_GT: return cmp > 0;
+                case COMPARE_GE: return cmp >= 0;
+            }
+            return 0;
+        }
+        default: {
+            // a bare column or literal is true when it is a non-zero value
+            Value value;
+            expr_value(expr, row, &value);
+            if (value.is_null) {
+                return -1;
+            }
+            return value_is_numeric(value.type) ? (value.int_value != 0 || value.double_value != 0) : value.text_length > 0;
+        }
+    }
+}
+
+
+// compiled predicates. comparisons of a column with a constant get an
+// evaluator per operator and per type class, so a row is tested with one
+// indirect call and a native comparison. a column whose value does not have
+// the constant's type (only possible for hand-built trees) falls back to
+// value_compare.
+
+static int compare_result(CompareOp op, int cmp) {
+    switch (op) {
+        case COMPARE_EQ: return cmp == 0;
+        case COMPARE_NE: return cmp != 0;
+        case COMPARE_LT: return cmp < 0;
+        case COMPARE_LE: return cmp <= 0;
+        case COMPARE_GT: return cmp > 0;
+        case COMPARE_GE: return cmp >= 0;
+    }
+    return 0;
+}
+
+static int compare_text(const Value* a, const Value* b) {
+    uint16_t length = a->text_length < b->text_length ? a->text_length : b->text_length;
+    int cmp = memcmp(a->text, b->text, length);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (a->text_length > b->text_length) - (a->text_length < b->text_length);
+}
+
+static int evaluate_mixed(const Predicate* predicate, const Value* value) {
+    return compare_result(predicate->op, value_compare(value, &predicate->constant));
+}
+
+#define DEFINE_COMPARE(kind, name, expression)                                          \
+    static int evaluate_##kind##_##name(const Predicate* predicate, const Value* row) { \
+        const Value* value = &row[predicate->column];                                   \
+        if (value->is_null) {                                                           \
+            return -1;                                                                  \
+        }                                                                               \
+        if (value->type != predicate->constant.type) {                                  \
+            return evaluate_mixed(predicate, value);                                    \
+        }                                                                               \
+        const Value* constant = &predicate->constant;                                   \
+        return expression;                                                              \
+    }
+
+#define DEFINE_COMPARES(kind, lhs, rhs)      \
+    DEFINE_COMPARE(kind, eq, (lhs) == (rhs)) \
+    DEFINE_COMPARE(kind, ne, (lhs) != (rhs)) \
+    DEFINE_COMPARE(kind, lt, (lhs) < (rhs))  \
+    DEFINE_COMPARE(kind, le, (lhs) <= (rhs)) \
+    DEFINE_COMPARE(kind, gt, (lhs) > (rhs))  \
+    DEFINE_COMPARE(kind, ge, (lhs) >= (rhs))
+
+// INT, BOOLEAN, DATE and TIMESTAMP are all held in int_value
+DEFINE_COMPARES(int, value->int_value, constant->int_value)
+DEFINE_COMPARES(double, value->double_value, constant->double_value)
+// FLOAT columns compare at the precision they are stored with
+DEFINE_COMPARES(float, (float)value->double_value, (float)constant->double_value)
+DEFINE_COMPARES(text, compare_text(value, constant), 0)
+
+#undef DEFINE_COMPARES
+#undef DEFINE_COMPARE
+
+typedef int (*PredicateFunction)(const Predicate* predicate, const Value* row);
+
+// indexed by CompareOp
+static const PredicateFunction int_compares[] = {
+    evaluate_int_eq, evaluate_int_ne, evaluate_int_lt, evaluate_int_le, evaluate_int_gt, evaluate_int_ge,
+};
+static const PredicateFunction double_compares[] = {
+    evaluate_double_eq, evaluate_double_ne, evaluate_double_lt, evaluate_double_le, evaluate_double_gt, evaluate_double_ge,
+};
+static const PredicateFunction float_compares[] = {
+    evaluate_float_eq, evaluate_float_ne, evaluate_float_lt, evaluate_float_le, evaluate_float_gt, evaluate_float_ge,
+};
+static const PredicateFunction text_compares[] = {
+    evaluate_text_eq, evaluate_text_ne, evaluate_text_lt, evaluate_text_le, evaluate_text_gt, evaluate_text_ge,
+};
+
+static int evaluate_columns(const Predicate* predicate, const Value* row) {
+    const Value* left = &row[predicate->column];
+    const Value* right = &row[predicate->other_column];
+    if (left->is_null || right->is_null) {
+        return -1;
+    }
+    return compare_result(predicate->op, value_compare(left, right));
+}
+
+static int evaluate_unknown(const Predicate* predicate, const Value* row) {
+    (void)predicate;
+    (void)row;
+    return -1;
+}
+
+static int evaluate_is_null(const Predicate* predicate, const Value* row) {
+    return row[predicate->column].is_null;
+}
+
+static int evaluate_is_not_null(const Predicate* predicate, const Value* row) {
+    return !row[predicate->column].is_null;
+}
+
+static int evaluate_and(const Predicate* predicate, const Value* row) {
+    int left = predicate->left->evaluate(predicate->left, row);
+    if (left == 0) {
+        return 0;
+    }
+    int right = predicate->right->evaluate(predicate->right, row);
+    return right == 0 ? 0 : (left == 1 && right == 1 ? 1 : -1);
+}
+
+static int evaluate_or(const Predicate* predicate, const Value* row) {
+    int left = predicate->left->evaluate(predicate->left, row);
+    if (left == 1) {
+        return 1;
+    }
+    int right = predicate->right->evaluate(predicate->right, row);
+    return right == 1 ? 1 : (left == 0 && right == 0 ? 0 : -1);
+}
+
+static int evaluate_not(const Predicate* predicate, const Value* row) {
+    int operand = predicate->left->evaluate(predicate->left, row);
+    return operand == -1 ? -1 : !operand;
+}
+
+static int evaluate_expr(const Predicate* predicate, const Value* row) {
+    return expr_evaluate(predicate->expr, row);
+}
+
+// the operator that gives the same answer with the operands swapped
+static CompareOp flip_compare(CompareOp op) {
+    switch (op) {
+        case COMPARE_LT: return COMPARE_GT;
+        case COMPARE_LE: return COMPARE_GE;
+        case COMPARE_GT: return COMPARE_LT;
+        case COMPARE_GE: return COMPARE_LE;
+        default: return op;
+    }
+}
+
+static void compile_compare(Predicate* predicate, const Expr* expr) {
+    const Expr* column = expr->left;
+    const Expr* constant = expr->right;
+    CompareOp op = expr->op;
+    if (column->type != EXPR_COLUMN) {
+        column = expr->right;
+        constant = expr->left;
+        op = flip_compare(op);
+    }
+    if (column->type != EXPR_COLUMN) {
+        predicate->evaluate = evaluate_expr;
+        return;
+    }
+
+    predicate->column = column->column_index;
+    predicate->op = op;
+    if (constant->type == EXPR_COLUMN) {
+        predicate->other_column = constant->column_index;
+        predicate->evaluate = evaluate_columns;
+        return;
+    }
+
+    predicate->constant = constant->value;
+    if (constant->value.is_null) {
+        predicate->evaluate = evaluate_unknown;
+        return;
+    }
+    switch (constant->value.type) {
+        case COLUMN_TYPE_DOUBLE: predicate->evaluate = double_compares[op]; break;
+        case COLUMN_TYPE_FLOAT: predicate->evaluate = float_compares[op]; break;
+        case COLUMN_TYPE_VARCHAR:
+        case COLUMN_TYPE_TEXT: predicate->evaluate = text_compares[op]; break;
+        default: predicate->evaluate = int_compares[op]; break;
+    }
+}
+
+Predicate* predicate_compile(Arena* arena, const Expr* expr) {
+    if (expr == NULL) {
+        return NULL;
+    }
+    Predicate* predicate = (Predicate*)arena_calloc(arena, sizeof(Predicate));
+    predicate->expr = expr;
+    switch (expr->type) {
+        case EXPR_AND:
+        case EXPR_OR:
+            predicate->left = predicate_compile(arena, expr->left);
+            predicate->right = predicate_compile(arena, expr->right);
+            predicate->evaluate = expr->type == EXPR_AND ? evaluate_and : evaluate_or;
+            break;
+        case EXPR_NOT:
+            predicate->left = predicate_compile(arena, expr->left);
+            predicate->evaluate = evaluate_not;
+            break;
+        case EXPR_IS_NULL:
+            if (expr->left->type == EXPR_COLUMN) {
+                predicate->column = expr->left->column_index;
+                predicate->evaluate = expr->negated ? evaluate_is_not_null : evaluate_is_null;
+            } else {
+                predicate->evaluate = evaluate_expr;
+            }
+            break;
+        case EXPR_COMPARE:
+            compile_compare(predicate, expr);
+            break;
+        default:
+            predicate->evaluate = evaluate_expr;
+            break;
+    }
+    return predicate;
+}
+
+
+// 1 if any column whose bit is set in columns is text, which points into the row
+static int reads_text(const RowLayout* layout, uint32_t columns) {
+    for (int i = 0; i < layout->num_columns; i++) {
+        if ((columns & (1u << i)) && !value_is_numeric(layout->types[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// decode the columns whose bit is set in columns into values, the others are
+// left null without being read
+static void decode_columns(const RowLayout* layout, uint32_t columns, const char* row, Value* values) {
+    for (int i = 0; i < layout->num_columns; i++) {
+        if (columns & (1u << i)) {
+            row_get_value(layout, row, i, &values[i]);
+        } else {
+            value_set_null(&values[i], layout->types[i]);
+        }
+    }
+}
+
+// decode a stored row into the batch. the row is copied into the batch's data
+// only when copy_text is set, numbers are read straight from the page.
+static void batch_add_stored_row(Batch* batch, const RowLayout* layout, uint32_t columns, int copy_text, const char* row,
+                                 uint16_t length) {
+    if (copy_text) {
+        char* copy = batch->data + batch->data_used;
+        memcpy(copy, row, length);
+        batch->data_used += length;
+        row = copy;
+    }
+    decode_columns(layout, columns, row, batch_row(batch, batch->num_rows++));
+}
+
+typedef struct {
+    Operator base;
+    BufferPool* pool;
+    Pager* pager;
+    uint32_t root_page_id;
+    RowLayout layout;
+    uint32_t columns;
+    int copy_text;
+    BTreeCursor cursor;
+    int started;
+} SeqScan;
+
+static int seq_scan_next(Operator* op, Batch* batch) {
+    SeqScan* scan = (SeqScan*)op;
+    batch->num_rows = 0;
+    batch->data_used = 0;
+    if (!scan->started) {
+        btree_cursor_first(&scan->cursor, scan->pool, scan->pager, scan->root_page_id);
+        scan->started = 1;
+    }
+
+    // walk the leaf level, the cursor keeps its leaf pinned between batches
+    while (btree_cursor_valid(&scan->cursor) && batch->num_rows < BATCH_SIZE) {
+        uint16_t length;
+        const char* row = btree_cursor_value(&scan->cursor, &length);
+        if (batch->data_used + length > BATCH_DATA_SIZE) {
+            break;
+        }
+        batch_add_stored_row(batch, &scan->layout, scan->columns, scan->copy_text, row, length);
+        btree_cursor_next(&scan->cursor);
+    }
+    return batch->num_rows;
+}
+
+static void seq_scan_close(Operator* op) {
+    SeqScan* scan = (SeqScan*)op;
+    if (scan->started) {
+        btree_cursor_close(&scan->cursor);
+    }
+}
+
+Operator* seq_scan_create(Arena* arena, BufferPool* pool, Pager* pager, const TableSchema* table, uint32_t columns) {
+    SeqScan* scan = (SeqScan*)arena_calloc(arena, sizeof(SeqScan));
+    scan->base.next = seq_scan_next;
+    scan->base.close = seq_scan_close;
+    scan->base.num_columns = table->num_columns;
+    scan->pool = pool;
+    scan->pager = pager;
+    scan->root_page_id = table->root_page_id;
+    row_layout_init(&scan->layout, table);
+    scan->columns = columns;
+    scan->copy_text = reads_text(&scan->layout, columns);
+    return &scan->base;
+}
+
+
+typedef struct {
+    Operator base;
+    BufferPool* pool;
+    Pager* pager;
+    uint32_t table_root_page_id;
+    uint32_t index_root_page_id;
+    int on_table;      // walking the table's own tree, keyed by the primary key
+    int entry_is_row;  // index entries are rows holding the INCLUDE columns, not bare primary keys
+    int index_only;    // rows come from the index entries alone
+    int key_column;
+    RowLayout layout;
+    uint32_t columns;
+    int copy_text;
+    KeyRange range;
+    BTreeCursor cursor;
+    int64_t high;      // last key in range, inclusive
+    int started;
+    int done;
+} IndexScan;
+
+// position the cursor at the first key in range and work out the last one,
+// bounds that cannot match leave the scan done
+static void index_scan_start(IndexScan* scan) {
+    scan->started = 1;
+    const KeyRange* range = &scan->range;
+    if ((range->lower != NULL && range->lower->is_null) || (range->upper != NULL && range->upper->is_null)) {
+        scan->done = 1;
+        return;
+    }
+    int64_t low = INT32_MIN;
+    scan->high = INT32_MAX;
+    if (range->lower != NULL) {
+        low = range->lower->int_value + (range->lower_inclusive ? 0 : 1);
+    }
+    if (range->upper != NULL) {
+        scan->high = range->upper->int_value - (range->upper_inclusive ? 0 : 1);
+    }
+    if (low > scan->high || low > INT32_MAX || scan->high < INT32_MIN) {
+        scan->done = 1;
+        return;
+    }
+    if (low < INT32_MIN) {
+        low = INT32_MIN;
+    }
+    uint32_t root_page_id = scan->on_table ? scan->table_root_page_id : scan->index_root_page_id;
+    btree_cursor_seek(&scan->cursor, scan->pool, scan->pager, root_page_id, (int)low);
+    // every entry in range is a row, so skipped entries past the range only
+    // mean the offset leaves nothing
+    if (range->offset > 0) {
+        btree_cursor_skip(&scan->cursor, range->offset);
+    }
+}
+
+static int index_scan_next(Operator* op, Batch* batch) {
+    IndexScan* scan = (IndexScan*)op;
+    batch->num_rows = 0;
+    batch->data_used = 0;
+    if (!scan->started) {
+        index_scan_start(scan);
+    }
+    if (scan->done) {
+        return 0;
+    }
+
+    // keys come in order, so the scan ends at the first one past the range
+    while (btree_cursor_valid(&scan->cursor) && batch->num_rows < BATCH_SIZE) {
+        if (btree_cursor_key(&scan->cursor) > scan->high) {
+            scan->done = 1;
+            break;
+        }
+        uint16_t length;
+        const char* value = btree_cursor_value(&scan->cursor, &length);
+        if (scan->on_table) {
+            if (batch->data_used + length > BATCH_DATA_SIZE) {
+                break;
+            }
+            batch_add_stored_row(batch, &scan->layout, scan->columns, scan->copy_text, value, length);
+            btree_cursor_next(&scan->cursor);
+            continue;
+        }
+
+        // index entries map the key to the primary key, one row per key
+        if (scan->index_only && scan->entry_is_row) {
+            if (batch->data_used + length > BATCH_DATA_SIZE) {
+                break;
+            }
+            batch_add_stored_row(batch, &scan->layout, scan->columns, scan->copy_text, value, length);
+            btree_cursor_next(&scan->cursor);
+            continue;
+        }
+        int32_t primary_key;
+        if (scan->entry_is_row) {
+            primary_key = row_get_int(&scan->layout, value, 0);
+        } else {
+            memcpy(&primary_key, value, sizeof(int32_t));
+        }
+        if (scan->index_only) {
+            Value* values = batch_row(batch, batch->num_rows++);
+            for (int i = 0; i < scan->layout.num_columns; i++) {
+                value_set_null(&values[i], scan->layout.types[i]);
+            }
+            values[0].is_null = 0;
+            values[0].int_value = primary_key;
+            values[scan->key_column].is_null = 0;
+            values[scan->key_column].int_value = btree_cursor_key(&scan->cursor);
+            btree_cursor_next(&scan->cursor);
+            continue;
+        }
+
+        // fetch the full record from the main table using the primary key
+        char* row = btree_search(scan->pool, scan->pager, scan->table_root_page_id, primary_key, &length);
+        if (row != NULL) {
+            if (batch->data_used + length > BATCH_DATA_SIZE) {
+                free(row);
+                break;
+            }
+            batch_add_stored_row(batch, &scan->layout, scan->columns, scan->copy_text, row, length);
+            free(row);
+        }
+        btree_cursor_next(&scan->cursor);
+    }
+    return batch->num_rows;
+}
+
+static void index_scan_close(Operator* op) {
+    IndexScan* scan = (IndexScan*)op;
+    if (scan->started) {
+        btree_cursor_close(&scan->cursor);
+    }
+}
+
+Operator* index_scan_create(Arena* arena, BufferPool* pool, Pager* pager, const TableSchema* table, const IndexSchema* index,
+                            const KeyRange* range, int index_only, uint32_t columns) {
+    IndexScan* scan = (IndexScan*)arena_calloc(arena, sizeof(IndexScan));
+    scan->base.next = index_scan_next;
+    scan->base.close = index_scan_close;
+    scan->base.num_columns = table->num_columns;
+    scan->pool = pool;
+    scan->pager = pager;
+    scan->table_root_page_id = table->root_page_id;
+    scan->on_table = index == NULL;
+    if (index != NULL) {
+        scan->index_root_page_id = index->root_page_id;
+        scan->entry_is_row = index->num_include_columns > 0;
+        scan->index_only = index_only;
+        for (int i = 0; i < table->num_columns; i++) {
+            if (strcmp(table->columns[i].name, index->column_name) == 0) {
+                scan->key_column = i;
+            }
+        }
+    }
+    scan->range = *range;
+    row_layout_init(&scan->layout, table);
+    scan->columns = columns;
+    scan->copy_text = reads_text(&scan->layout, columns);
+    return &scan->base;
+}
+
+
+#define FILTER_MAX_CONJUNCTS 16
+#define SELECTION_WORDS (BATCH_SIZE / 64)
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    const Predicate* predicate;
+    Batch input;
+
+    // when the predicate has "numeric column op constant" conjuncts they run
+    // as simd kernels over the column gathered out of the batch, each
+    // narrowing a selection bitmap. the other conjuncts are then evaluated
+    // row by row, only for rows still selected.
+    const Predicate* terms[FILTER_MAX_CONJUNCTS];
+    int num_terms;
+    const Predicate* residual[FILTER_MAX_CONJUNCTS];
+    int num_residual;
+    int64_t ints[BATCH_SIZE];
+    double doubles[BATCH_SIZE];
+} Filter;
+
+// a comparison a kernel can run: a column against a non-null numeric constant
+static int is_kernel_term(const Predicate* predicate) {
+    return predicate->evaluate == int_compares[predicate->op] || predicate->evaluate == double_compares[predicate->op] ||
+           predicate->evaluate == float_compares[predicate->op];
+}
+
+// split a conjunction into kernel terms and the rest, 0 if it has too many parts
+static int filter_split(Filter* filter, const Predicate* predicate) {
+    if (predicate->evaluate == evaluate_and) {
+        return filter_split(filter, predicate->left) && filter_split(filter, predicate->right);
+    }
+    if (is_kernel_term(predicate)) {
+        if (filter->num_terms == FILTER_MAX_CONJUNCTS) {
+            return 0;
+        }
+        filter->terms[filter->num_terms++] = predicate;
+    } else {
+        if (filter->num_residual == FILTER_MAX_CONJUNCTS) {
+            return 0;
+        }
+        filter->residual[filter->num_residual++] = predicate;
+    }
+    return 1;
+}
+
+// narrow the selection to the rows that satisfy one kernel term
+static void filter_select_term(Filter* filter, const Predicate* term, uint64_t* selection) {
+    const Batch* input = &filter->input;
+    int num_words = (input->num_rows + 63) / 64;
+    int floating = term->constant.type == COLUMN_TYPE_DOUBLE || term->constant.type == COLUMN_TYPE_FLOAT;
+    uint64_t nulls[SELECTION_WORDS];
+    memset(nulls, 0, sizeof(uint64_t) * num_words);
+
+    // gather the column, nulls get a placeholder and are masked out below
+    for (int i = 0; i < input->num_rows; i++) {
+        const Value* value = &batch_row(input, i)[term->column];
+        if (value->is_null) {
+            nulls[i / 64] |= (uint64_t)1 << (i % 64);
+            filter->ints[i] = 0;
+            filter->doubles[i] = 0;
+        } else if (value->type != term->constant.type) {
+            // a hand-built tree comparing across types, leave it to the predicate
+            for (int j = 0; j < input->num_rows; j++) {
+                if (term->evaluate(term, batch_row(input, j)) != 1) {
+                    selection[j / 64] &= ~((uint64_t)1 << (j % 64));
+                }
+            }
+            return;
+        } else if (term->constant.type == COLUMN_TYPE_FLOAT) {
+            filter->doubles[i] = (float)value->double_value;
+        } else if (floating) {
+            filter->doubles[i] = value->double_value;
+        } else {
+            filter->ints[i] = value->int_value;
+        }
+    }
+
+    if (term->constant.type == COLUMN_TYPE_FLOAT) {
+        simd_select_double(filter->doubles, input->num_rows, term->op, (float)term->constant.double_value, selection);
+    } else if (floating) {
+        simd_select_double(filter->doubles, input->num_rows, term->op, term->constant.double_value, selection);
+    } else {
+        simd_select_int64(filter->ints, input->num_rows, term->op, term->constant.int_value, selection);
+    }
+    for (int w = 0; w < num_words; w++) {
+        selection[w] &= ~nulls[w];
+    }
+}
+
+static void filter_select(Filter* filter, uint64_t* selection) {
+    const Batch* input = &filter->input;
+    int num_words = (input->num_rows + 63) / 64;
+    for (int w = 0; w < num_words; w++) {
+        selection[w] = ~(uint64_t)0;
+    }
+    for (int t = 0; t < filter->num_terms; t++) {
+        filter_select_term(filter, filter->terms[t], selection);
+    }
+    if (filter->num_residual == 0) {
+        return;
+    }
+    for (int w = 0; w < num_words; w++) {
+        uint64_t word = selection[w];
+        while (word != 0) {
+            int bit = __builtin_ctzll(word);
+            word &= word - 1;
+            const Value* row = batch_row(input, w * 64 + bit);
+            for (int r = 0; r < filter->num_residual; r++) {
+                if (filter->residual[r]->evaluate(filter->residual[r], row) != 1) {
+                    selection[w] &= ~((uint64_t)1 << bit);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static int filter_next(Operator* op, Batch* batch) {
+    Filter* filter = (Filter*)op;
+    batch->num_rows = 0;
+
+    // an input batch fits the output, return as soon as one has a match
+    while (batch->num_rows == 0 && operator_pull(&filter->base, filter->child, &filter->input) > 0) {
+        if (filter->num_terms == 0) {
+            for (int i = 0; i < filter->input.num_rows; i++) {
+                const Value* row = batch_row(&filter->input, i);
+                if (filter->predicate->evaluate(filter->predicate, row) == 1) {
+                    memcpy(batch_row(batch, batch->num_rows++), row, sizeof(Value) * op->num_columns);
+                }
+            }
+            continue;
+        }
+
+        uint64_t selection[SELECTION_WORDS];
+        filter_select(filter, selection);
+        for (int i = 0; i < filter->input.num_rows; i++) {
+            if (selection[i / 64] & ((uint64_t)1 << (i % 64))) {
+                memcpy(batch_row(batch, batch->num_rows++), batch_row(&filter->input, i), sizeof(Value) * op->num_columns);
+            }
+        }
+    }
+    return batch->num_rows;
+}
+
+static void filter_close(Operator* op) {
+    Filter* filter = (Filter*)op;
+    operator_close(filter->child);
+}
+
+Operator* filter_create(Arena* arena, Operator* child, const Expr* predicate) {
+    Filter* filter = (Filter*)arena_calloc(arena, sizeof(Filter));
+    filter->base.next = filter_next;
+    filter->base.close = filter_close;
+    filter->base.num_columns = child->num_columns;
+    filter->child = child;
+    filter->predicate = predicate_compile(arena, predicate);
+    if (!filter_split(filter, filter->predicate)) {
+        filter->num_terms = 0;
+    }
+    batch_init(&filter->input, child->num_columns, arena);
+    return &filter->base;
+}
+
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    int columns[MAX_COLUMNS_PER_TABLE * 2];
+    Batch input;
+} Project;
+
+static int project_next(Operator* op, Batch* batch) {
+    Project* project = (Project*)op;
+    batch->num_rows = operator_pull(&project->base, project->child, &project->input);
+    for (int i = 0; i < batch->num_rows; i++) {
+        const Value* in = batch_row(&project->input, i);
+        Value* out = batch_row(batch, i);
+        for (int j = 0; j < op->num_columns; j++) {
+            out[j] = in[project->columns[j]];
+        }
+    }
+    return batch->num_rows;
+}
+
+static void project_close(Operator* op) {
+    Project* project = (Project*)op;
+    operator_close(project->child);
+}
+
+Operator* project_create(Arena* arena, Operator* child, const int* columns, int num_columns) {
+    Project* project = (Project*)arena_calloc(arena, sizeof(Project));
+    project->base.next = project_next;
+    project->base.close = project_close;
+    project->base.num_columns = num_columns;
+    project->child = child;
+    memcpy(project->columns, columns, sizeof(int) * num_columns);
+    batch_init(&project->input, child->num_columns, arena);
+    return &project->base;
+}
+
+
+// ORDER BY comparison, nulls sort first
+static int compare_rows(const OrderByItem* items, int num_items, const Value* a, const Value* b) {
+    for (int i = 0; i < num_items; i++) {
+        Value left;
+        Value right;
+        expr_value(items[i].expr, a, &left);
+        expr_value(items[i].expr, b, &right);
+        int cmp;
+        if (left.is_null || right.is_null) {
+            cmp = right.is_null - left.is_null;
+        } else {
+            cmp = value_compare(&left, &right);
+        }
+        if (cmp != 0) {
+            return items[i].descending ? -cmp : cmp;
+        }
+    }
+    return 0;
+}
+
+
+// a sorted run written to a temporary file, and while runs are merged the
+// row at its front
+typedef struct {
+    SpillFile file;
+    Value* row;        // NULL once the run is exhausted
+    Arena arena;       // the front row's text
+} SortRun;
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    Arena* arena;
+    const OrderByItem* items;
+    int num_items;
+    size_t memory_budget;
+    Arena rows_arena;  // the rows of the run being collected
+    Value** rows;      // that run, sorted before it is returned or written out
+    int num_rows;
+    int rows_capacity;
+    size_t memory_used;
+    int position;
+    int sorted;
+    SortRun* runs;     // spilled runs, merged once the input is exhausted
+    int num_runs;
+    int runs_capacity;
+    int* heap;         // runs being merged, a min-heap on their front rows
+    int heap_size;
+} Sort;
+
+typedef struct {
+    const Value* row;
+    const Sort* sort;
+} SortEntry;
+
+static int compare_sort_entries(const void* a, const void* b) {
+    const SortEntry* x = (const SortEntry*)a;
+    const SortEntry* y = (const SortEntry*)b;
+    return compare_rows(x->sort->items, x->sort->num_items, x->row, y->row);
+}
+
+static void sort_rows(Sort* sort) {
+    SortEntry* entries = (SortEntry*)arena_alloc(&sort->rows_arena, sizeof(SortEntry) * (sort->num_rows + 1));
+    for (int i = 0; i < sort->num_rows; i++) {
+        entries[i].row = sort->rows[i];
+        entries[i].sort = sort;
+    }
+    qsort(entries, sort->num_rows, sizeof(SortEntry), compare_sort_entries);
+    for (int i = 0; i < sort->num_rows; i++) {
+        sort->rows[i] = (Value*)entries[i].row;
+    }
+}
+
+static SortRun* sort_add_run(Sort* sort) {
+    if (sort->num_runs == sort->runs_capacity) {
+        int capacity = sort->runs_capacity > 0 ? sort->runs_capacity * 2 : 16;
+        sort->runs = (SortRun*)arena_grow(sort->arena, sort->runs, sizeof(SortRun) * sort->runs_capacity, sizeof(SortRun) * capacity);
+        sort->runs_capacity = capacity;
+    }
+    SortRun* run = &sort->runs[sort->num_runs];
+    if (spill_open(&run->file) != 0) {
+        return NULL;
+    }
+    sort->num_runs++;
+    run->row = (Value*)arena_alloc(sort->arena, sizeof(Value) * (sort->base.num_columns > 0 ? sort->base.num_columns : 1));
+    arena_init(&run->arena);
+    return run;
+}
+
+static void sort_close_run(SortRun* run) {
+    spill_close(&run->file);
+    arena_free(&run->arena);
+}
+
+// drop the last run, one that could not be written in full
+static void sort_drop_run(Sort* sort) {
+    sort_close_run(&sort->runs[--sort->num_runs]);
+}
+
+// sort the rows collected so far and write them out as a run. -1 if no
+// temporary file could be used, the rows then stay in memory and the partial
+// run is dropped.
+static int sort_spill_run(Sort* sort) {
+    SortRun* run = sort_add_run(sort);
+    if (run == NULL) {
+        return -1;
+    }
+    sort_rows(sort);
+    for (int i = 0; i < sort->num_rows; i++) {
+        if (spill_write(&run->file, sort->rows[i], sort->base.num_columns) != 0) {
+            sort_drop_run(sort);
+            return -1;
+        }
+    }
+    sort->num_rows = 0;
+    sort->memory_used = 0;
+    arena_reset(&sort->rows_arena);
+    return 0;
+}
+
+static int heap_less(const Sort* sort, int a, int b) {
+    return compare_rows(sort->items, sort->num_items, sort->runs[sort->heap[a]].row, sort->runs[sort->heap[b]].row) < 0;
+}
+
+static void heap_sift_down(Sort* sort, int i) {
+    while (1) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < sort->heap_size && heap_less(sort, left, smallest)) {
+            smallest = left;
+        }
+        if (right < sort->heap_size && heap_less(sort, right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        int swap = sort->heap[i];
+        sort->heap[i] = sort->heap[smallest];
+        sort->heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+// read a run's next row over its previous one, 0 at the end of the run
+static int sort_run_advance(Sort* sort, SortRun* run) {
+    arena_reset(&run->arena);
+    return spill_read(&run->file, run->row, sort->base.num_columns, &run->arena);
+}
+
+// start merging runs [first, first + count). -1 if a run was not written in full
+static int merge_start(Sort* sort, int first, int count) {
+    sort->heap_size = 0;
+    for (int i = first; i < first + count; i++) {
+        if (spill_rewind(&sort->runs[i].file) != 0) {
+            return -1;
+        }
+        if (sort_run_advance(sort, &sort->runs[i])) {
+            sort->heap[sort->heap_size++] = i;
+        }
+    }
+    for (int i = sort->heap_size / 2 - 1; i >= 0; i--) {
+        heap_sift_down(sort, i);
+    }
+    return 0;
+}
+
+// the smallest front row among the runs being merged, NULL when all are done
+static const Value* merge_peek(const Sort* sort) {
+    return sort->heap_size > 0 ? sort->runs[sort->heap[0]].row : NULL;
+}
+
+static void merge_advance(Sort* sort) {
+    if (!sort_run_advance(sort, &sort->runs[sort->heap[0]])) {
+        sort->heap[0] = sort->heap[--sort->heap_size];
+    }
+    heap_sift_down(sort, 0);
+}
+
+// merge the first runs into one until at most SORT_MERGE_FAN_IN are left, so
+// the final merge reads a bounded number of files at once
+static int sort_reduce_runs(Sort* sort) {
+    while (sort->num_runs > SORT_MERGE_FAN_IN) {
+        SortRun* merged = sort_add_run(sort);
+        if (merged == NULL) {
+            return -1;
+        }
+        if (merge_start(sort, 0, SORT_MERGE_FAN_IN) != 0) {
+            sort_drop_run(sort);
+            return -1;
+        }
+        const Value* row;
+        while ((row = merge_peek(sort)) != NULL) {
+            if (spill_write(&merged->file, row, sort->base.num_columns) != 0) {
+                sort_drop_run(sort);
+                return -1;
+            }
+            merge_advance(sort);
+        }
+        for (int i = 0; i < SORT_MERGE_FAN_IN; i++) {
+            sort_close_run(&sort->runs[i]);
+        }
+        sort->num_runs -= SORT_MERGE_FAN_IN;
+        memmove(sort->runs, sort->runs + SORT_MERGE_FAN_IN, sizeof(SortRun) * sort->num_runs);
+    }
+    return 0;
+}
+
+// collect the input in runs of up to the memory budget. a single run is
+// sorted in memory; otherwise every run is written out and they are merged.
+// sets error if the runs cannot all be written.
+static void sort_input(Sort* sort) {
+    sort->sorted = 1;
+    Batch input;
+    batch_init(&input, sort->child->num_columns, sort->arena);
+    int spill_failed = 0;  // without temporary files whatever is left is sorted in memory
+    while (operator_pull(&sort->base, sort->child, &input) > 0) {
+        if (sort->num_rows + input.num_rows > sort->rows_capacity) {
+            int capacity = (sort->num_rows + input.num_rows) * 2;
+            sort->rows = (Value**)arena_grow(sort->arena, sort->rows, sizeof(Value*) * sort->rows_capacity, sizeof(Value*) * capacity);
+            sort->rows_capacity = capacity;
+        }
+        for (int i = 0; i < input.num_rows; i++) {
+            const Value* row = batch_row(&input, i);
+            sort->rows[sort->num_rows++] = copy_row(&sort->rows_arena, row, input.num_columns);
+            sort->memory_used += sizeof(Value*) + sizeof(Value) * input.num_columns;
+            for (int j = 0; j < input.num_columns; j++) {
+                if (!row[j].is_null && !value_is_numeric(row[j].type)) {
+                    sort->memory_used += row[j].text_length;
+                }
+            }
+        }
+        if (sort->memory_used > sort->memory_budget && !spill_failed) {
+            spill_failed = sort_spill_run(sort) != 0;
+        }
+    }
+
+    if (sort->base.error) {
+        return;
+    }
+    if (sort->num_runs == 0) {
+        sort_rows(sort);
+        return;
+    }
+    sort->heap = (int*)arena_alloc(sort->arena, sizeof(int) * SORT_MERGE_FAN_IN);
+    // rows held back once spilling failed cannot be merged with the runs
+    if ((sort->num_rows > 0 && sort_spill_run(sort) != 0) || sort_reduce_runs(sort) != 0 ||
+        merge_start(sort, 0, sort->num_runs) != 0) {
+        fprintf(stderr, "error: unable to sort, temporary files could not be written.\n");
+        sort->heap_size = 0;
+        sort->base.error = 1;
+    }
+}
+
+static int sort_next(Operator* op, Batch* batch) {
+    Sort* sort = (Sort*)op;
+    if (!sort->sorted) {
+        sort_input(sort);
+    }
+    batch->num_rows = 0;
+    if (op->error) {
+        return 0;
+    }
+    if (sort->heap == NULL) {
+        while (sort->position < sort->num_rows && batch->num_rows < BATCH_SIZE) {
+            memcpy(batch_row(batch, batch->num_rows++), sort->rows[sort->position++], sizeof(Value) * op->num_columns);
+        }
+        return batch->num_rows;
+    }
+
+    // merged rows are overwritten as their runs advance, so their text is copied
+    batch->data_used = 0;
+    const Value* row;
+    while (batch->num_rows < BATCH_SIZE && (row = merge_peek(sort)) != NULL) {
+        Value* out = batch_row(batch, batch->num_rows);
+        memcpy(out, row, sizeof(Value) * op->num_columns);
+        if (!batch_copy_text(batch, out, op->num_columns)) {
+            break;
+        }
+        batch->num_rows++;
+        merge_advance(sort);
+    }
+    return batch->num_rows;
+}
+
+static void sort_close(Operator* op) {
+    Sort* sort = (Sort*)op;
+    operator_close(sort->child);
+    for (int i = 0; i < sort->num_runs; i++) {
+        sort_close_run(&sort->runs[i]);
+    }
+    sort->num_runs = 0;
+    arena_free(&sort->rows_arena);
+}
+
+Operator* sort_create(Arena* arena, Operator* child, const OrderByItem* items, int num_items, size_t memory_budget) {
+    Sort* sort = (Sort*)arena_calloc(arena, sizeof(Sort));
+    sort->base.next = sort_next;
+    sort->base.close = sort_close;
+    sort->base.num_columns = child->num_columns;
+    sort->child = child;
+    sort->arena = arena;
+    sort->items = items;
+    sort->num_items = num_items;
+    sort->memory_budget = memory_budget;
+    arena_init(&sort->rows_arena);
+    return &sort->base;
+}
+
+
+// ORDER BY ... LIMIT n keeps the first n rows in a max-heap: a row that sorts
+// before the last of them replaces it, anything else is dropped
+typedef struct {
+    Value* values;
+    char* text;        // the values' text, reused when the row is replaced
+    size_t text_capacity;
+} TopNRow;
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    Arena* arena;
+    const OrderByItem* items;
+    int num_items;
+    int64_t limit;
+    TopNRow* heap;
+    int size;
+    int position;
+    int sorted;
+} TopN;
+
+static int top_n_less(const TopN* top, int a, int b) {
+    return compare_rows(top->items, top->num_items, top->heap[a].values, top->heap[b].values) < 0;
+}
+
+static void top_n_swap(TopN* top, int a, int b) {
+    TopNRow swap = top->heap[a];
+    top->heap[a] = top->heap[b];
+    top->heap[b] = swap;
+}
+
+// restore the heap below i among its first size rows, the last row in sort
+// order on top
+static void top_n_sift_down(TopN* top, int i, int size) {
+    while (1) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && top_n_less(top, largest, left)) {
+            largest = left;
+        }
+        if (right < size && top_n_less(top, largest, right)) {
+            largest = right;
+        }
+        if (largest == i) {
+            return;
+        }
+        top_n_swap(top, i, largest);
+        i = largest;
+    }
+}
+
+static void top_n_store(TopN* top, TopNRow* slot, const Value* row) {
+    int num_columns = top->base.num_columns;
+    size_t size = 0;
+    for (int i = 0; i < num_columns; i++) {
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            size += row[i].text_length;
+        }
+    }
+    if (slot->values == NULL) {
+        slot->values = (Value*)arena_alloc(top->arena, sizeof(Value) * num_columns);
+    }
+    if (size > slot->text_capacity) {
+        slot->text_capacity = size * 2;
+        slot->text = (char*)arena_alloc(top->arena, slot->text_capacity);
+    }
+    char* text = slot->text;
+    for (int i = 0; i < num_columns; i++) {
+        slot->values[i] = row[i];
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            memcpy(text, row[i].text, row[i].text_length);
+            slot->values[i].text = text;
+            text += row[i].text_length;
+        }
+    }
+}
+
+static void top_n_input(TopN* top) {
+    top->sorted = 1;
+    if (top->limit == 0) {
+        return;
+    }
+    Batch input;
+    batch_init(&input, top->child->num_columns, top->arena);
+    while (operator_pull(&top->base, top->child, &input) > 0) {
+        for (int i = 0; i < input.num_rows; i++) {
+            const Value* row = batch_row(&input, i);
+            if (top->size < top->limit) {
+                // sift the new row up
+                int j = top->size++;
+                top_n_store(top, &top->heap[j], row);
+                while (j > 0 && top_n_less(top, (j - 1) / 2, j)) {
+                    top_n_swap(top, j, (j - 1) / 2);
+                    j = (j - 1) / 2;
+                }
+            } else if (compare_rows(top->items, top->num_items, row, top->heap[0].values) < 0) {
+                top_n_store(top, &top->heap[0], row);
+                top_n_sift_down(top, 0, top->size);
+            }
+        }
+    }
+
+    // heapsort: move the largest remaining row to the end each time
+    for (int end = top->size - 1; end > 0; end--) {
+        top_n_swap(top, 0, end);
+        top_n_sift_down(top, 0, end);
+    }
+}
+
+static int top_n_next(Operator* op, Batch* batch) {
+    TopN* top = (TopN*)op;
+    if (!top->sorted) {
+        top_n_input(top);
+    }
+    batch->num_rows = 0;
+    while (top->position < top->size && batch->num_rows < BATCH_SIZE) {
+        memcpy(batch_row(batch, batch->num_rows++), top->heap[top->position++].values, sizeof(Value) * op->num_columns);
+    }
+    return batch->num_rows;
+}
+
+static void top_n_close(Operator* op) {
+    TopN* top = (TopN*)op;
+    operator_close(top->child);
+}
+
+Operator* top_n_create(Arena* arena, Operator* child, const OrderByItem* items, int num_items, int64_t limit) {
+    TopN* top = (TopN*)arena_calloc(arena, sizeof(TopN));
+    top->base.next = top_n_next;
+    top->base.close = top_n_close;
+    top->base.num_columns = child->num_columns;
+    top->child = child;
+    top->arena = arena;
+    top->items = items;
+    top->num_items = num_items;
+    top->limit = limit > 0 ? limit : 0;
+    top->heap = (TopNRow*)arena_calloc(arena, sizeof(TopNRow) * (top->limit > 0 ? top->limit : 1));
+    return &top->base;
+}
+
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    int64_t remaining;  // negative without a limit
+    int64_t skip;
+} Limit;
+
+static int limit_next(Operator* op, Batch* batch) {
+    Limit* limit = (Limit*)op;
+    batch->num_rows = 0;
+    // stop pulling once the limit is reached so the scan below ends early
+    while (limit->remaining != 0) {
+        int num_rows = operator_pull(&limit->base, limit->child, batch);
+        if (num_rows == 0) {
+            return 0;
+        }
+        int first = 0;
+        if (limit->skip > 0) {
+            first = limit->skip < num_rows ? (int)limit->skip : num_rows;
+            limit->skip -= first;
+            if (first == num_rows) {
+                continue;
+            }
+            memmove(batch_row(batch, 0), batch_row(batch, first), sizeof(Value) * batch->num_columns * (num_rows - first));
+        }
+        num_rows -= first;
+        if (limit->remaining > 0 && num_rows > limit->remaining) {
+            num_rows = (int)limit->remaining;
+        }
+        batch->num_rows = num_rows;
+        if (limit->remaining > 0) {
+            limit->remaining -= num_rows;
+        }
+        return num_rows;
+    }
+    return 0;
+}
+
+static void limit_close(Operator* op) {
+    Limit* limit = (Limit*)op;
+    operator_close(limit->child);
+}
+
+Operator* limit_create(Arena* arena, Operator* child, int64_t limit_count, int64_t offset) {
+    Limit* limit = (Limit*)arena_calloc(arena, sizeof(Limit));
+    limit->base.next = limit_next;
+    limit->base.close = limit_close;
+    limit->base.num_columns = child->num_columns;
+    limit->child = child;
+    limit->remaining = limit_count;
+    limit->skip = offset;
+    return &limit->base;
+}
+
+
+typedef struct {
+    int64_t count;
+    int64_t int_sum;
+    double double_sum;
+    int is_floating;
+    Value extreme;     // MIN and MAX, text copied into extreme_text
+    char* extreme_text;
+    size_t extreme_capacity;
+} AggregateState;
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    Arena* arena;
+    AggregateSpec aggregates[MAX_COLUMNS_PER_TABLE * 2];
+    AggregateState states[MAX_COLUMNS_PER_TABLE * 2];
+    int done;
+} Aggregate;
+
+static void aggregate_update(Arena* arena, const AggregateSpec* spec, AggregateState* state, const Value* row) {
+    if (spec->column < 0) {
+        state->count++;
+        return;
+    }
+    const Value* value = &row[spec->column];
+    if (value->is_null) {
+        return;
+    }
+
+    switch (spec->function) {
+        case AGGREGATE_COUNT:
+            break;
+        case AGGREGATE_SUM:
+        case AGGREGATE_AVG:
+            if (!value_is_numeric(value->type)) {
+                return;
+            }
+            if (value->type == COLUMN_TYPE_FLOAT || value->type == COLUMN_TYPE_DOUBLE) {
+                state->is_floating = 1;
+                state->double_sum += value->double_value;
+            } else {
+                state->int_sum += value->int_value;
+            }
+            break;
+        case AGGREGATE_MIN:
+        case AGGREGATE_MAX: {
+            if (state->count > 0) {
+                int cmp = value_compare(value, &state->extreme);
+                if (spec->function == AGGREGATE_MIN ? cmp >= 0 : cmp <= 0) {
+                    state->count++;
+                    return;
+                }
+            }
+            state->extreme = *value;
+            if (!value_is_numeric(value->type)) {
+                // the buffer only grows, a new extreme rarely needs more arena memory
+                if (value->text_length + 1u > state->extreme_capacity) {
+                    state->extreme_capacity = (value->text_length + 1u) * 2;
+                    state->extreme_text = (char*)arena_alloc(arena, state->extreme_capacity);
+                }
+                memcpy(state->extreme_text, value->text, value->text_length);
+                state->extreme.text = state->extreme_text;
+            }
+            break;
+        }
+    }
+    state->count++;
+}
+
+static void aggregate_result(const AggregateSpec* spec, const AggregateState* state, Value* result) {
+    if (spec->function == AGGREGATE_COUNT) {
+        memset(result, 0, sizeof(Value));
+        result->type = COLUMN_TYPE_INT;
+        result->int_value = state->count;
+        return;
+    }
+    if (state->count == 0) {
+        value_set_null(result, COLUMN_TYPE_INT);
+        return;
+    }
+    if (spec->function == AGGREGATE_MIN || spec->function == AGGREGATE_MAX) {
+        *result = state->extreme;
+        return;
+    }
+
+    memset(result, 0, sizeof(Value));
+    double sum = state->double_sum + (double)state->int_sum;
+    if (spec->function == AGGREGATE_AVG) {
+        result->type = COLUMN_TYPE_DOUBLE;
+        result->double_value = sum / state->count;
+    } else if (state->is_floating) {
+        result->type = COLUMN_TYPE_DOUBLE;
+        result->double_value = sum;
+    } else {
+        result->type = COLUMN_TYPE_INT;
+        result->int_value = state->int_sum;
+    }
+}
+
+// start over for the next group, keeping the MIN and MAX text buffer
+static void aggregate_reset(AggregateState* state) {
+    char* extreme_text = state->extreme_text;
+    size_t extreme_capacity = state->extreme_capacity;
+    memset(state, 0, sizeof(AggregateState));
+    state->extreme_text = extreme_text;
+    state->extreme_capacity = extreme_capacity;
+}
+
+static int aggregate_next(Operator* op, Batch* batch) {
+    Aggregate* aggregate = (Aggregate*)op;
+    batch->num_rows = 0;
+    if (aggregate->done) {
+        return 0;
+    }
+    aggregate->done = 1;
+
+    Batch input;
+    batch_init(&input, aggregate->child->num_columns, aggregate->arena);
+    while (operator_pull(&aggregate->base, aggregate->child, &input) > 0) {
+        for (int i = 0; i < input.num_rows; i++) {
+            const Value* row = batch_row(&input, i);
+            for (int j = 0; j < op->num_columns; j++) {
+                aggregate_update(aggregate->arena, &aggregate->aggregates[j], &aggregate->states[j], row);
+            }
+        }
+    }
+
+    Value* out = batch_row(batch, batch->num_rows++);
+    for (int j = 0; j < op->num_columns; j++) {
+        aggregate_result(&aggregate->aggregates[j], &aggregate->states[j], &out[j]);
+    }
+    return batch->num_rows;
+}
+
+static void aggregate_close(Operator* op) {
+    Aggregate* aggregate = (Aggregate*)op;
+    operator_close(aggregate->child);
+}
+
+Operator* aggregate_create(Arena* arena, Operator* child, const AggregateSpec* aggregates, int num_aggregates) {
+    Aggregate* aggregate = (Aggregate*)arena_calloc(arena, sizeof(Aggregate));
+    aggregate->base.next = aggregate_next;
+    aggregate->base.close = aggregate_close;
+    aggregate->base.num_columns = num_aggregates;
+    aggregate->child = child;
+    aggregate->arena = arena;
+    memcpy(aggregate->aggregates, aggregates, sizeof(AggregateSpec) * num_aggregates);
+    return &aggregate->base;
+}
+
+
+// GROUP BY. a group is its key, the values of the group columns with the
+// text copied, and a state per aggregate.
+typedef struct {
+    Value* keys;
+    AggregateState* states;
+    uint64_t hash;
+} Group;
+
+// a slot of the open addressing table: part of the group's hash, so most
+// probes that do not match are rejected without touching the group, and
+// the group's position + 1, 0 for an empty slot
+typedef struct {
+    uint32_t hash;
+    uint32_t group;
+} GroupSlot;
+
+typedef struct {
+    Operator base;
+    Operator* child;
+    Arena* arena;
+    int group_columns[MAX_COLUMNS_PER_TABLE * 2];
+    int num_group_columns;
+    AggregateSpec aggregates[MAX_COLUMNS_PER_TABLE * 2];
+    int num_aggregates;
+    Batch input;
+
+    // hash_aggregate_create: every group, in the order they first appear
+    Group* groups;
+    int num_groups;
+    int groups_capacity;
+    GroupSlot* slots;
+    uint32_t mask;          // number of slots - 1, a power of two
+    int built;
+    int position;
+
+    // stream_aggregate_create: the group being accumulated
+    Group current;
+    int has_group;
+    char* key_text;
+    size_t key_capacity;
+    int input_position;
+    int input_done;
+} GroupAggregate;
+
+static uint64_t group_hash(const GroupAggregate* aggregate, const Value* row) {
+    uint64_t hash = 0;
+    for (int i = 0; i < aggregate->num_group_columns; i++) {
+        const Value* value = &row[aggregate->group_columns[i]];
+        hash = (hash ^ (value->is_null ? 0x6A09E667F3BCC908ULL : value_hash(value))) * 0x9E3779B97F4A7C15ULL;
+    }
+    return hash;
+}
+
+// whether a row belongs to a group, nulls grouping together
+static int group_matches(const GroupAggregate* aggregate, const Group* group, const Value* row) {
+    for (int i = 0; i < aggregate->num_group_columns; i++) {
+        const Value* key = &group->keys[i];
+        const Value* value = &row[aggregate->group_columns[i]];
+        if (key->is_null || value->is_null) {
+            if (key->is_null != value->is_null) {
+                return 0;
+            }
+        } else if (value_compare(key, value) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// copy a row's group columns into keys, text into buffer
+static void group_copy_keys(const GroupAggregate* aggregate, const Value* row, Value* keys, char* buffer) {
+    for (int i = 0; i < aggregate->num_group_columns; i++) {
+        keys[i] = row[aggregate->group_columns[i]];
+        if (!keys[i].is_null && !value_is_numeric(keys[i].type)) {
+            memcpy(buffer, keys[i].text, keys[i].text_length);
+            keys[i].text = buffer;
+            buffer += keys[i].text_length;
+        }
+    }
+}
+
+static size_t group_key_size(const GroupAggregate* aggregate, const Value* row) {
+    size_t size = 0;
+    for (int i = 0; i < aggregate->num_group_columns; i++) {
+        const Value* value = &row[aggregate->group_columns[i]];
+        if (!value->is_null && !value_is_numeric(value->type)) {
+            size += value->text_length;
+        }
+    }
+    return size;
+}
+
+static void group_update(GroupAggregate* aggregate, Group* group, const Value* row) {
+    for (int j = 0; j < aggregate->num_aggregates; j++) {
+        aggregate_update(aggregate->arena, &aggregate->aggregates[j], &group->states[j], row);
+    }
+}
+
+static void group_result(const GroupAggregate* aggregate, const Group* group, Value* out) {
+    memcpy(out, group->keys, sizeof(Value) * aggregate->num_group_columns);
+    for (int j = 0; j < aggregate->num_aggregates; j++) {
+        aggregate_result(&aggregate->aggregates[j], &group->states[j], &out[aggregate->num_group_columns + j]);
+    }
+}
+
+// double the slots and reinsert every group
+static void hash_aggregate_grow(GroupAggregate* aggregate) {
+    uint32_t num_slots = (aggregate->mask + 1) * 2;
+    aggregate->slots = (GroupSlot*)arena_calloc(aggregate->arena, sizeof(GroupSlot) * num_slots);
+    aggregate->mask = num_slots - 1;
+    for (int i = 0; i < aggregate->num_groups; i++) {
+        uint64_t hash = aggregate->groups[i].hash;
+        uint32_t slot = (uint32_t)hash & aggregate->mask;
+        while (aggregate->slots[slot].group != 0) {
+            slot = (slot + 1) & aggregate->mask;
+        }
+        aggregate->slots[slot].hash = (uint32_t)(hash >> 32);
+        aggregate->slots[slot].group = (uint32_t)i + 1;
+    }
+}
+
+// the row's group, created when it is the first row of it
+static Group* hash_aggregate_lookup(GroupAggregate* aggregate, const Value* row) {
+    uint64_t hash = group_hash(aggregate, row);
+    uint32_t slot = (uint32_t)hash & aggregate->mask;
+    while (aggregate->slots[slot].group != 0) {
+        Group* group = &aggregate->groups[aggregate->slots[slot].group - 1];
+        if (aggregate->slots[slot].hash == (uint32_t)(hash >> 32) && group_matches(aggregate, group, row)) {
+            return group;
+        }
+        slot = (slot + 1) & aggregate->mask;
+    }
+
+    if (aggregate->num_groups == aggregate->groups_capacity) {
+        int capacity = aggregate->groups_capacity * 2;
+        aggregate->groups = (Group*)arena_grow(aggregate->arena, aggregate->groups, sizeof(Group) * aggregate->groups_capacity,
+                                               sizeof(Group) * capacity);
+        aggregate->groups_capacity = capacity;
+    }
+    Group* group = &aggregate->groups[aggregate->num_groups++];
+    // keys, their text and the states in one allocation
+    size_t keys_size = sizeof(Value) * aggregate->num_group_columns;
+    size_t states_size = sizeof(AggregateState) * aggregate->num_aggregates;
+    char* memory = (char*)arena_calloc(aggregate->arena, states_size + keys_size + group_key_size(aggregate, row));
+    group->states = (AggregateState*)memory;
+    group->keys = (Value*)(memory + states_size);
+    group->hash = hash;
+    group_copy_keys(aggregate, row, group->keys, memory + states_size + keys_size);
+    aggregate->slots[slot].hash = (uint32_t)(hash >> 32);
+    aggregate->slots[slot].group = (uint32_t)aggregate->num_groups;
+
+    // keep the table at most half full so probe sequences stay short
+    if ((uint32_t)aggregate->num_groups * 2 > aggregate->mask + 1) {
+        hash_aggregate_grow(aggregate);
+        return &aggregate->groups[aggregate->num_groups - 1];
+    }
+    return group;
+}
+
+static int hash_aggregate_next(Operator* op, Batch* batch) {
+    GroupAggregate* aggregate = (GroupAggregate*)op;
+    if (!aggregate->built) {
+        aggregate->built = 1;
+        while (operator_pull(&aggregate->base, aggregate->child, &aggregate->input) > 0) {
+            for (int i = 0; i < aggregate->input.num_rows; i++) {
+                const Value* row = batch_row(&aggregate->input, i);
+                group_update(aggregate, hash_aggregate_lookup(aggregate, row), row);
+            }
+        }
+    }
+    batch->num_rows = 0;
+    while (aggregate->position < aggregate->num_groups && batch->num_rows < BATCH_SIZE) {
+        group_result(aggregate, &aggregate->groups[aggregate->position++], batch_row(batch, batch->num_rows++));
+    }
+    return batch->num_rows;
+}
+
+// finish the current group into the batch. its key and MIN and MAX text are
+// reused by the next group, so the text is copied. 0 if it does not fit.
+static int stream_aggregate_emit(GroupAggregate* aggregate, Batch* batch) {
+    Value* out = batch_row(batch, batch->num_rows);
+    group_result(aggregate, &aggregate->current, out);
+    if (!batch_copy_text(batch, out, aggregate->base.num_columns)) {
+        return 0;
+    }
+    batch->num_rows++;
+    aggregate->has_group = 0;
+    return 1;
+}
+
+static void stream_aggregate_start(GroupAggregate* aggregate, const Value* row) {
+    size_t size = group_key_size(aggregate, row);
+    if (size > aggregate->key_capacity) {
+        aggregate->key_capacity = size * 2;
+        aggregate->key_text = (char*)arena_alloc(aggregate->arena, aggregate->key_capacity);
+    }
+    group_copy_keys(aggregate, row, aggregate->current.keys, aggregate->key_text);
+    for (int j = 0; j < aggregate->num_aggregates; j++) {
+        aggregate_reset(&aggregate->current.states[j]);
+    }
+    aggregate->has_group = 1;
+}
+
+static int stream_aggregate_next(Operator* op, Batch* batch) {
+    GroupAggregate* aggregate = (GroupAggregate*)op;
+    Batch* input = &aggregate->input;
+    batch->num_rows = 0;
+    batch->data_used = 0;
+    while (batch->num_rows < BATCH_SIZE) {
+        if (aggregate->input_position == input->num_rows) {
+            aggregate->input_position = 0;
+            if (!aggregate->input_done && operator_pull(&aggregate->base, aggregate->child, input) > 0) {
+                continue;
+            }
+            input->num_rows = 0;
+            aggregate->input_done = 1;
+            if (aggregate->has_group) {
+                stream_aggregate_emit(aggregate, batch);
+            }
+            break;
+        }
+        const Value* row = batch_row(input, aggregate->input_position);
+        if (aggregate->has_group && !group_matches(aggregate, &aggregate->current, row) &&
+            !stream_aggregate_emit(aggregate, batch)) {
+            break;  // out of text space, the row starts the next batch
+        }
+        if (!aggregate->has_group) {
+            stream_aggregate_start(aggregate, row);
+        }
+        group_update(aggregate, &aggregate->current, row);
+        aggregate->input_position++;
+    }
+    return batch->num_rows;
+}
+
+static void group_aggregate_close(Operator* op) {
+    GroupAggregate* aggregate = (GroupAggregate*)op;
+    operator_close(aggregate->child);
+}
+
+static GroupAggregate* group_aggregate_new(Arena* arena, Operator* child, const int* group_columns, int num_group_columns,
+                                           const AggregateSpec* aggregates, int num_aggregates) {
+    GroupAggregate* aggregate = (GroupAggregate*)arena_calloc(arena, sizeof(GroupAggregate));
+    aggregate->base.close = group_aggregate_close;
+    aggregate->base.num_columns = num_group_columns + num_aggregates;
+    aggregate->child = child;
+    aggregate->arena = arena;
+    memcpy(aggregate->group_columns, group_columns, sizeof(int) * num_group_columns);
+    aggregate->num_group_columns = num_group_columns;
+    memcpy(aggregate->aggregates, aggregates, sizeof(AggregateSpec) * num_aggregates);
+    aggregate->num_aggregates = num_aggregates;
+    batch_init(&aggregate->input, child->num_columns, arena);
+    return aggregate;
+}
+
+Operator* hash_aggregate_create(Arena* arena, Operator* child, const int* group_columns, int num_group_columns,
+                                const AggregateSpec* aggregates, int num_aggregates) {
+    GroupAggregate* aggregate = group_aggregate_new(arena, child, group_columns, num_group_columns, aggregates, num_aggregates);
+    aggregate->base.next = hash_aggregate_next;
+    aggregate->groups_capacity = 64;
+    aggregate->groups = (Group*)arena_alloc(arena, sizeof(Group) * aggregate->groups_capacity);
+    aggregate->mask = 127;
+    aggregate->slots = (GroupSlot*)arena_calloc(arena, sizeof(GroupSlot) * (aggregate->mask + 1));
+    return &aggregate->base;
+}
+
+Operator* stream_aggregate_create(Arena* arena, Operator* child, const int* group_columns, int num_group_columns,
+                                  const AggregateSpec* aggregates, int num_aggregates) {
+    GroupAggregate* aggregate = group_aggregate_new(arena, child, group_columns, num_group_columns, aggregates, num_aggregates);
+    aggregate->base.next = stream_aggregate_next;
+    aggregate->current.keys = (Value*)arena_calloc(arena, sizeof(Value) * (num_group_columns > 0 ? num_group_columns : 1));
+    aggregate->current.states = (AggregateState*)arena_calloc(arena, sizeof(AggregateState) * (num_aggregates > 0 ? num_aggregates : 1));
+    return &aggregate->base;
+}
+
+
+typedef struct {
+    Operator base;
+    Operator* left;
+    Operator* right;
+    Arena* arena;
+    const Predicate* condition;
+    Value** right_rows;  // the right input, materialized on the first call
+    int num_right_rows;
+    int materialized;
+    Batch left_batch;
+    int left_row;
+    int right_row;
+} NestedLoopJoin;
+
+static void join_materialize_right(NestedLoopJoin* join) {
+    Batch input;
+    batch_init(&input, join->right->num_columns, join->arena);
+    int capacity = 0;
+    while (operator_pull(&join->base, join->right, &input) > 0) {
+        if (join->num_right_rows + input.num_rows > capacity) {
+            int new_capacity = (join->num_right_rows + input.num_rows) * 2;
+            join->right_rows = (Value**)arena_grow(join->arena, join->right_rows, sizeof(Value*) * capacity, sizeof(Value*) * new_capacity);
+            capacity = new_capacity;
+        }
+        for (int i = 0; i < input.num_rows; i++) {
+            join->right_rows[join->num_right_rows++] = copy_row(join->arena, batch_row(&input, i), input.num_columns);
+        }
+    }
+    join->materialized = 1;
+}
+
+static int nested_loop_join_next(Operator* op, Batch* batch) {
+    NestedLoopJoin* join = (NestedLoopJoin*)op;
+    if (!join->materialized) {
+        join_materialize_right(join);
+    }
+
+    int left_columns = join->left->num_columns;
+    int right_columns = join->right->num_columns;
+    batch->num_rows = 0;
+    while (batch->num_rows < BATCH_SIZE) {
+        if (join->left_row >= join->left_batch.num_rows) {
+            // text in the rows already joined points into the left batch
+            if (batch->num_rows > 0) {
+                break;
+            }
+            if (join->num_right_rows == 0 || operator_pull(&join->base, join->left, &join->left_batch) == 0) {
+                break;
+            }
+            join->left_row = 0;
+            join->right_row = 0;
+        }
+        if (join->right_row >= join->num_right_rows) {
+            join->left_row++;
+            join->right_row = 0;
+            continue;
+        }
+
+        // build the joined row in place and keep it if the condition holds
+        Value* out = batch_row(batch, batch->num_rows);
+        memcpy(out, batch_row(&join->left_batch, join->left_row), sizeof(Value) * left_columns);
+        memcpy(out + left_columns, join->right_rows[join->right_row++], sizeof(Value) * right_columns);
+        if (join->condition == NULL || join->condition->evaluate(join->condition, out) == 1) {
+            batch->num_rows++;
+        }
+    }
+    return batch->num_rows;
+}
+
+static void nested_loop_join_close(Operator* op) {
+    NestedLoopJoin* join = (NestedLoopJoin*)op;
+    operator_close(join->left);
+    operator_close(join->right);
+}
+
+Operator* nested_loop_join_create(Arena* arena, Operator* left, Operator* right, const Expr* condition) {
+    NestedLoopJoin* join = (NestedLoopJoin*)arena_calloc(arena, sizeof(NestedLoopJoin));
+    join->base.next = nested_loop_join_next;
+    join->base.close = nested_loop_join_close;
+    join->base.num_columns = left->num_columns + right->num_columns;
+    join->left = left;
+    join->right = right;
+    join->arena = arena;
+    join->condition = predicate_compile(arena, condition);
+    batch_init(&join->left_batch, left->num_columns, arena);
+    return &join->base;
+}
+
+
+typedef struct {
+    Value* row;
+    uint64_t hash;
+    int next;          // next entry in the bucket, -1 at the end
+} HashEntry;
+
+// build rows are hashed on their key into chained buckets. once they take
+// more than the memory budget every row is instead written to one of
+// HASH_JOIN_PARTITIONS temporary files by its hash, the probe rows likewise,
+// and matching partitions are joined one pair at a time. a partition's build
+// rows are loaded a budget's worth at a time, its probe rows read once per
+// load, so keys that repeat past the budget still join within it.
+typedef struct {
+    Operator base;
+    Operator* left;    // probe side
+    Operator* right;   // build side
+    int left_key;
+    int right_key;
+    const Predicate* condition;
+    size_t memory_budget;
+    Arena* arena;
+    Arena table_arena; // the hash table and build rows of the partition being joined
+    Arena probe_arena; // text of probe rows read back from a partition
+    HashEntry* entries;
+    int num_entries;
+    int capacity;
+    int* buckets;
+    uint64_t bucket_mask;
+    size_t memory_used;
+    int built;
+    int spilled;
+    SpillFile build_partitions[HASH_JOIN_PARTITIONS];
+    SpillFile probe_partitions[HASH_JOIN_PARTITIONS];
+    int partition;     // partition being joined when spilled, -1 before the first
+    Batch probe;
+    int probe_row;
+    int entry;         // next candidate for the current probe row, -1 for none
+} HashJoin;
+
+static void hash_join_add(HashJoin* join, const Value* row, uint64_t hash) {
+    if (join->num_entries == join->capacity) {
+        int new_capacity = join->capacity > 0 ? join->capacity * 2 : 1024;
+        join->entries = (HashEntry*)arena_grow(&join->table_arena, join->entries, sizeof(HashEntry) * join->capacity,
+                                               sizeof(HashEntry) * new_capacity);
+        join->capacity = new_capacity;
+    }
+    HashEntry* entry = &join->entries[join->num_entries++];
+    entry->row = copy_row(&join->table_arena, row, join->right->num_columns);
+    entry->hash = hash;
+    join->memory_used += sizeof(HashEntry) + sizeof(Value) * join->right->num_columns;
+    for (int i = 0; i < join->right->num_columns; i++) {
+        if (!row[i].is_null && !value_is_numeric(row[i].type)) {
+            join->memory_used += row[i].text_length;
+        }
+    }
+}
+
+// chain the entries into a power of two buckets, at least two per entry
+static void hash_join_index(HashJoin* join) {
+    uint64_t num_buckets = 16;
+    while (num_buckets < (uint64_t)join->num_entries * 2) {
+        num_buckets *= 2;
+    }
+    join->bucket_mask = num_buckets - 1;
+    join->buckets = (int*)arena_alloc(&join->table_arena, sizeof(int) * num_buckets);
+    memset(join->buckets, 0xFF, sizeof(int) * num_buckets);
+    for (int i = 0; i < join->num_entries; i++) {
+        int* bucket = &join->buckets[join->entries[i].hash & join->bucket_mask];
+        join->entries[i].next = *bucket;
+        *bucket = i;
+    }
+}
+
+static void hash_join_clear(HashJoin* join) {
+    arena_reset(&join->table_arena);
+    join->entries = NULL;
+    join->num_entries = 0;
+    join->capacity = 0;
+    join->buckets = NULL;
+    join->memory_used = 0;
+}
+
+static int hash_join_partition(uint64_t hash) {
+    // the bucket uses the low bits, partitions the high ones
+    return (int)(hash >> 60) % HASH_JOIN_PARTITIONS;
+}
+
+// move the rows held in memory to the partitions, from now on build rows go
+// straight there
+static int hash_join_spill(HashJoin* join) {
+    for (int i = 0; i < HASH_JOIN_PARTITIONS; i++) {
+        if (spill_open(&join->build_partitions[i]) != 0 || spill_open(&join->probe_partitions[i]) != 0) {
+            return -1;
+        }
+    }
+    join->spilled = 1;
+    for (int i = 0; i < join->num_entries; i++) {
+        const HashEntry* entry = &join->entries[i];
+        if (spill_write(&join->build_partitions[hash_join_partition(entry->hash)], entry->row, join->right->num_columns) != 0) {
+            return -1;
+        }
+    }
+    hash_join_clear(join);
+    return 0;
+}
+
+// load the partition's next build rows into the hash table, as many as the
+// memory budget holds, and rewind its probe rows to meet them. 1 if there
+// were any, 0 once its build rows are used up, -1 if a file was not written
+// in full.
+static int hash_join_load(HashJoin* join) {
+    hash_join_clear(join);
+    SpillFile* build = &join->build_partitions[join->partition];
+    Value row[MAX_COLUMNS_PER_TABLE * 2];
+    while (join->memory_used <= join->memory_budget &&
+           spill_read(build, row, join->right->num_columns, &join->table_arena)) {
+        hash_join_add(join, row, value_hash(&row[join->right_key]));
+    }
+    if (join->num_entries == 0) {
+        return 0;
+    }
+    hash_join_index(join);
+    return spill_rewind(&join->probe_partitions[join->partition]) != 0 ? -1 : 1;
+}
+
+// move on to the next partition with build rows and load them; a partition
+// without any has nothing to join. 0 after the last partition.
+static int hash_join_next_partition(HashJoin* join) {
+    while (++join->partition < HASH_JOIN_PARTITIONS) {
+        if (spill_rewind(&join->build_partitions[join->partition]) != 0) {
+            return -1;
+        }
+        int loaded = hash_join_load(join);
+        if (loaded != 0) {
+            return loaded;
+        }
+    }
+    return 0;
+}
+
+static int hash_join_build(HashJoin* join) {
+    join->built = 1;
+    Batch input;
+    batch_init(&input, join->right->num_columns, join->arena);
+    while (operator_pull(&join->base, join->right, &input) > 0) {
+        for (int i = 0; i < input.num_rows; i++) {
+            const Value* row = batch_row(&input, i);
+            const Value* key = &row[join->right_key];
+            if (key->is_null) {
+                continue;  // matches nothing
+            }
+            uint64_t hash = value_hash(key);
+            if (join->spilled) {
+                if (spill_write(&join->build_partitions[hash_join_partition(hash)], row, join->right->num_columns) != 0) {
+                    return -1;
+                }
+                continue;
+            }
+            hash_join_add(join, row, hash);
+            if (join->memory_used > join->memory_budget && hash_join_spill(join) != 0) {
+                return -1;
+            }
+        }
+    }
+    if (join->base.error) {
+        return -1;
+    }
+    if (!join->spilled) {
+        hash_join_index(join);
+        return 0;
+    }
+
+    // partition the probe side the same way, then join the first pair
+    batch_init(&input, join->left->num_columns, join->arena);
+    while (operator_pull(&join->base, join->left, &input) > 0) {
+        for (int i = 0; i < input.num_rows; i++) {
+            const Value* row = batch_row(&input, i);
+            if (row[join->left_key].is_null) {
+                continue;
+            }
+            int partition = hash_join_partition(value_hash(&row[join->left_key]));
+            if (spill_write(&join->probe_partitions[partition], row, join->left->num_columns) != 0) {
+                return -1;
+            }
+        }
+    }
+    if (join->base.error) {
+        return -1;
+    }
+    join->partition = -1;
+    return hash_join_next_partition(join) < 0 ? -1 : 0;
+}
+
+// the next batch of probe rows, from the probe input or from the partitions
+// in turn. 0 once every one has been probed.
+static int hash_join_next_probe(HashJoin* join) {
+    join->probe_row = 0;
+    if (!join->spilled) {
+        return operator_pull(&join->base, join->left, &join->probe);
+    }
+    arena_reset(&join->probe_arena);
+    join->probe.num_rows = 0;
+    while (join->partition < HASH_JOIN_PARTITIONS) {
+        SpillFile* probe = &join->probe_partitions[join->partition];
+        while (join->probe.num_rows < BATCH_SIZE &&
+               spill_read(probe, batch_row(&join->probe, join->probe.num_rows), join->left->num_columns, &join->probe_arena)) {
+            join->probe.num_rows++;
+        }
+        if (join->probe.num_rows > 0) {
+            return join->probe.num_rows;
+        }
+        // every probe row has met the build rows loaded
+        int loaded = hash_join_load(join);
+        if (loaded == 0) {
+            loaded = hash_join_next_partition(join);
+        }
+        if (loaded < 0) {
+            fprintf(stderr, "error: unable to join, temporary files could not be written.\n");
+            join->base.error = 1;
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int hash_join_next(Operator* op, Batch* batch) {
+    HashJoin* join = (HashJoin*)op;
+    batch->num_rows = 0;
+    if (!join->built && hash_join_build(join) != 0) {
+        if (!op->error) {
+            fprintf(stderr, "error: unable to join, temporary files could not be written.\n");
+        }
+        op->error = 1;
+    }
+    if (op->error) {
+        return 0;
+    }
+
+    int left_columns = join->left->num_columns;
+    int right_columns = join->right->num_columns;
+    while (batch->num_rows < BATCH_SIZE) {
+        if (join->probe_row >= join->probe.num_rows) {
+            // rows already joined point into the probe batch and, across
+            // partitions, into the hash table
+            if (batch->num_rows > 0 || hash_join_next_probe(join) == 0) {
+                break;
+            }
+            join->entry = -1;
+        }
+        const Value* probe = batch_row(&join->probe, join->probe_row);
+        const Value* key = &probe[join->left_key];
+        if (join->entry == -1) {
+            if (key->is_null || join->num_entries == 0) {
+                join->probe_row++;
+                continue;
+            }
+            join->entry = join->buckets[value_hash(key) & join->bucket_mask];
+            if (join->entry == -1) {
+                join->probe_row++;
+                continue;
+            }
+        }
+
+        const HashEntry* entry = &join->entries[join->entry];
+        join->entry = entry->next;
+        if (join->entry == -1) {
+            join->probe_row++;
+        }
+        if (value_compare(key, &entry->row[join->right_key]) != 0) {
+            continue;
+        }
+        Value* out = batch_row(batch, batch->num_rows);
+        memcpy(out, probe, sizeof(Value) * left_columns);
+        memcpy(out + left_columns, entry->row, sizeof(Value) * right_columns);
+        if (join->condition == NULL || join->condition->evaluate(join->condition, out) == 1) {
+            batch->num_rows++;
+        }
+    }
+    return batch->num_rows;
+}
+
+static void hash_join_close(Operator* op) {
+    HashJoin* join = (HashJoin*)op;
+    operator_close(join->left);
+    operator_close(join->right);
+    for (int i = 0; i < HASH_JOIN_PARTITIONS; i++) {
+        spill_close(&join->build_partitions[i]);
+        spill_close(&join->probe_partitions[i]);
+    }
+    arena_free(&join->table_arena);
+    arena_free(&join->probe_arena);
+}
+
+Operator* hash_join_create(Arena* arena, Operator* left, Operator* right, int left_key, int right_key, const Expr* condition,
+                           size_t memory_budget) {
+    HashJoin* join = (HashJoin*)arena_calloc(arena, sizeof(HashJoin));
+    join->base.next = hash_join_next;
+    join->base.close = hash_join_close;
+    join->base.num_columns = left->num_columns + right->num_columns;
+    join->left = left;
+    join->right = right;
+    join->left_key = left_key;
+    join->right_key = right_key;
+    join->condition = predicate_compile(arena, condition);
+    join->memory_budget = memory_budget;
+    join->arena = arena;
+    join->entry = -1;
+    arena_init(&join->table_arena);
+    arena_init(&join->probe_arena);
+    batch_init(&join->probe, left->num_columns, arena);
+    return &join->base;
+}
+
+
+typedef struct {
+    Operator base;
+    Operator* left;
+    int left_key;
+    BufferPool* pool;
+    Pager* pager;
+    uint32_t table_root_page_id;
+    uint32_t index_root_page_id;
+    int on_table;      // the key is the table's primary key
+    int entry_is_row;
+    RowLayout layout;
+    uint32_t columns;
+    int copy_text;
+    const Predicate* condition;
+    Batch left_batch;
+    int left_row;
+} IndexNestedLoopJoin;
+
+// the stored row of table whose key column holds key, NULL if there is none.
+// the caller frees it.
+static char* index_join_lookup(IndexNestedLoopJoin* join, int key, uint16_t* length) {
+    if (join->on_table) {
+        return btree_search(join->pool, join->pager, join->table_root_page_id, key, length);
+    }
+    char* entry = btree_search(join->pool, join->pager, join->index_root_page_id, key, NULL);
+    if (entry == NULL) {
+        return NULL;
+    }
+    int32_t primary_key;
+    if (join->entry_is_row) {
+        primary_key = row_get_int(&join->layout, entry, 0);
+    } else {
+        memcpy(&primary_key, entry, sizeof(int32_t));
+    }
+    free(entry);
+    return btree_search(join->pool, join->pager, join->table_root_page_id, primary_key, length);
+}
+
+static int index_nested_loop_join_next(Operator* op, Batch* batch) {
+    IndexNestedLoopJoin* join = (IndexNestedLoopJoin*)op;
+    int left_columns = join->left->num_columns;
+    batch->num_rows = 0;
+    batch->data_used = 0;
+    while (batch->num_rows < BATCH_SIZE) {
+        if (join->left_row >= join->left_batch.num_rows) {
+            if (batch->num_rows > 0 || operator_pull(&join->base, join->left, &join->left_batch) == 0) {
+                break;
+            }
+            join->left_row = 0;
+        }
+        const Value* left = batch_row(&join->left_batch, join->left_row);
+        const Value* key = &left[join->left_key];
+        if (key->is_null || key->int_value < INT32_MIN || key->int_value > INT32_MAX) {
+            join->left_row++;
+            continue;
+        }
+
+        uint16_t length;
+        char* row = index_join_lookup(join, (int)key->int_value, &length);
+        if (row == NULL) {
+            join->left_row++;
+            continue;
+        }
+        if (!join->copy_text) {
+            length = 0;
+        }
+        if (batch->data_used + length > BATCH_DATA_SIZE) {
+            free(row);  // looked up again on the next call
+            break;
+        }
+        const char* stored = row;
+        if (join->copy_text) {
+            memcpy(batch->data + batch->data_used, row, length);
+            stored = batch->data + batch->data_used;
+        }
+
+        Value* out = batch_row(batch, batch->num_rows);
+        memcpy(out, left, sizeof(Value) * left_columns);
+        decode_columns(&join->layout, join->columns, stored, &out[left_columns]);
+        free(row);
+        join->left_row++;
+        if (join->condition == NULL || join->condition->evaluate(join->condition, out) == 1) {
+            batch->data_used += length;
+            batch->num_rows++;
+        }
+    }
+    return batch->num_rows;
+}
+
+static void index_nested_loop_join_close(Operator* op) {
+    IndexNestedLoopJoin* join = (IndexNestedLoopJoin*)op;
+    operator_close(join->left);
+}
+
+Operator* index_nested_loop_join_create(Arena* arena, BufferPool* pool, Pager* pager, Operator* left, int left_key,
+                                        const TableSchema* table, const IndexSchema* index, const Expr* condition,
+                                        uint32_t columns) {
+    IndexNestedLoopJoin* join = (IndexNestedLoopJoin*)arena_calloc(arena, sizeof(IndexNestedLoopJoin));
+    join->base.next = index_nested_loop_join_next;
+    join->base.close = index_nested_loop_join_close;
+    join->base.num_columns = left->num_columns + table->num_columns;
+    join->left = left;
+    join->left_key = left_key;
+    join->pool = pool;
+    join->pager = pager;
+    join->table_root_page_id = table->root_page_id;
+    join->on_table = index == NULL;
+    if (index != NULL) {
+        join->index_root_page_id = index->root_page_id;
+        join->entry_is_row = index->num_include_columns > 0;
+    }
+    row_layout_init(&join->layout, table);
+    join->columns = columns;
+    join->copy_text = reads_text(&join->layout, columns);
+    join->condition = predicate_compile(arena, condition);
+    batch_init(&join->left_batch, left->num_columns, arena);
+    return &join->base;
+}
@@ -0,0 +1,141 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "buffer.h"
+#include "catalog.h"
+#include "parser.h"
+#include "row.h"
+
+#define BATCH_SIZE 1024              // rows passed between operators per call
+#define BATCH_DATA_SIZE (64 * 1024)  // bytes of row data a scan copies per batch
+#define HASH_JOIN_MEMORY_BUDGET (4 * 1024 * 1024) // build side bytes held in memory before spilling
+#define HASH_JOIN_PARTITIONS 16
+#define SORT_MEMORY_BUDGET (4 * 1024 * 1024)      // rows a sort holds in memory before writing sorted runs
+#define SORT_MERGE_FAN_IN 16                      // runs merged at once
+#define ALL_COLUMNS 0xFFFFFFFFu                   // column mask that reads every column
+
+
+// a batch of rows as typed values, row-major. text values point into data or
+// into memory owned by the operator that filled the batch, and stay valid
+// until that operator's next call.
+typedef struct {
+    int num_rows;
+    int num_columns;
+    Value* values;     // BATCH_SIZE x num_columns
+    char* data;
+    size_t data_used;
+} Batch;
+
+void batch_init(Batch* batch, int num_columns, Arena* arena);
+Value* batch_row(const Batch* batch, int row);
+
+
+// a condition compiled once per query into a tree of evaluators specialized on
+// the comparison operator and the constant's type, so testing a row neither
+// walks the expression nor dispatches on value types. evaluate answers as
+// expr_evaluate does. constants are copied when the predicate is compiled, so
+// literals must be typed and parameters bound by then.
+typedef struct Predicate {
+    int (*evaluate)(const struct Predicate* predicate, const Value* row);
+    const struct Predicate* left;   // AND, OR, NOT
+    const struct Predicate* right;
+    int column;
+    int other_column;               // column to column comparisons
+    CompareOp op;
+    Value constant;                 // column to constant comparisons
+    const Expr* expr;               // the source, evaluated directly when nothing specialized applies
+} Predicate;
+
+// NULL for a NULL expression
+Predicate* predicate_compile(Arena* arena, const Expr* expr);
+
+
+// operators form a tree that is pulled from the root. next fills the batch with
+// up to BATCH_SIZE rows and returns how many, 0 once the input is exhausted.
+// an operator that fails (a temporary file cannot be written) sets error and
+// returns 0, and so does every operator above it, so the root tells a failed
+// query from a finished one. close unpins whatever the operator and its inputs
+// hold. operators, their batches and materialized rows live in the arena they
+// were created with and are released with it.
+typedef struct Operator {
+    int (*next)(struct Operator* op, Batch* batch);
+    void (*close)(struct Operator* op);
+    int num_columns;   // width of the rows it produces
+    int error;         // next failed, the rows returned so far are incomplete
+} Operator;
+
+typedef struct {
+    AggregateFunction function;
+    int column;        // input column, -1 for COUNT(*)
+} AggregateSpec;
+
+// bounds on an INT key, read on the first call to next so they can point at
+// parameters. a NULL bound is open, a null value matches nothing. offset rows
+// in range are stepped over without being read before the first one returned.
+typedef struct {
+    const Value* lower;
+    int lower_inclusive;
+    const Value* upper;
+    int upper_inclusive;
+    int64_t offset;
+} KeyRange;
+
+// scans produce every column of the table in schema order. only the columns
+// whose bit is set in columns are decoded, the others are null; stored rows
+// are copied into the batch only when one of those columns is text.
+Operator* seq_scan_create(Arena* arena, BufferPool* pool, Pager* pager, const TableSchema* table, uint32_t columns);
+// the rows whose key is in range, in key order: an index's rows, or with a
+// NULL index the rows of the table's own tree by primary key. stops at the
+// upper bound. index_only answers from the index entries without reading the
+// table; only the key, the primary key and the INCLUDE columns are filled in
+// and the other columns are null.
+Operator* index_scan_create(Arena* arena, BufferPool* pool, Pager* pager, const TableSchema* table, const IndexSchema* index,
+                            const KeyRange* range, int index_only, uint32_t columns);
+
+// expressions reference columns of the operator's input rows by position.
+// filter and join conditions are compiled when the operator is created.
+Operator* filter_create(Arena* arena, Operator* child, const Expr* predicate);
+Operator* project_create(Arena* arena, Operator* child, const int* columns, int num_columns);
+// input beyond memory_budget bytes is sorted in runs written to temporary
+// files, which are merged SORT_MERGE_FAN_IN at a time
+Operator* sort_create(Arena* arena, Operator* child, const OrderByItem* items, int num_items, size_t memory_budget);
+// the first limit rows in sort order, holding only those
+Operator* top_n_create(Arena* arena, Operator* child, const OrderByItem* items, int num_items, int64_t limit);
+// skips offset rows, then returns up to limit, or all with a negative limit
+Operator* limit_create(Arena* arena, Operator* child, int64_t limit, int64_t offset);
+// one output row over the whole input, nulls are skipped
+Operator* aggregate_create(Arena* arena, Operator* child, const AggregateSpec* aggregates, int num_aggregates);
+// GROUP BY: a row per distinct combination of the group columns, those
+// columns first and the aggregates after them. null keys group together.
+// the hash version finds groups in an open addressing table holding all of
+// them and returns them in the order they first appear. the stream version
+// needs the rows of each group to be adjacent, as in a scan ordered on the
+// group column, and holds only the current group.
+Operator* hash_aggregate_create(Arena* arena, Operator* child, const int* group_columns, int num_group_columns,
+                                const AggregateSpec* aggregates, int num_aggregates);
+Operator* stream_aggregate_create(Arena* arena, Operator* child, const int* group_columns, int num_group_columns,
+                                  const AggregateSpec* aggregates, int num_aggregates);
+// rows are the left columns followed by the right ones; a NULL condition joins every pair
+Operator* nested_loop_join_create(Arena* arena, Operator* left, Operator* right, const Expr* condition);
+// equi-join on left row column left_key = right row column right_key, the
+// keys of the same type. the right input is hashed, in memory while it fits
+// the budget and in partitions written to temporary files after that; the
+// left input probes it. condition is checked on each pair with equal keys.
+Operator* hash_join_create(Arena* arena, Operator* left, Operator* right, int left_key, int right_key, const Expr* condition,
+                           size_t memory_budget);
+// for each left row, the row of table whose INT key equals column left_key,
+// looked up through index or with a NULL index by the table's primary key.
+// columns selects the table's columns that are decoded, as for the scans.
+Operator* index_nested_loop_join_create(Arena* arena, BufferPool* pool, Pager* pager, Operator* left, int left_key,
+                                        const TableSchema* table, const IndexSchema* index, const Expr* condition,
+                                        uint32_t columns);
+
+void operator_close(Operator* op);
+
+// 1 true, 0 false, -1 unknown (a null was involved)
+int expr_evaluate(const Expr* expr, const Value* row);
+
+#endif // EXECUTOR_H
@@ -0,0 +1,161 @@
+#include "lexer.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+typedef struct {
+    const char* text;
+    Keyword keyword;
+} KeywordEntry;
+
+static const KeywordEntry keywords[] = {
+    {"SELECT", KEYWORD_SELECT}, {"FROM", KEYWORD_FROM}, {"WHERE", KEYWORD_WHERE},
+    {"AND", KEYWORD_AND}, {"OR", KEYWORD_OR}, {"NOT", KEYWORD_NOT},
+    {"ORDER", KEYWORD_ORDER}, {"BY", KEYWORD_BY}, {"ASC", KEYWORD_ASC},
+    {"DESC", KEYWORD_DESC}, {"LIMIT", KEYWORD_LIMIT}, {"INSERT", KEYWORD_INSERT},
+    {"INTO", KEYWORD_INTO}, {"VALUES", KEYWORD_VALUES}, {"UPDATE", KEYWORD_UPDATE},
+    {"SET", KEYWORD_SET}, {"DELETE", KEYWORD_DELETE}, {"CREATE", KEYWORD_CREATE},
+    {"TABLE", KEYWORD_TABLE}, {"INDEX", KEYWORD_INDEX}, {"UNIQUE", KEYWORD_UNIQUE},
+    {"ON", KEYWORD_ON}, {"DROP", KEYWORD_DROP}, {"PRIMARY", KEYWORD_PRIMARY},
+    {"KEY", KEYWORD_KEY}, {"NULL", KEYWORD_NULL}, {"TRUE", KEYWORD_TRUE},
+    {"FALSE", KEYWORD_FALSE}, {"IS", KEYWORD_IS}, {"BEGIN", KEYWORD_BEGIN},
+    {"COMMIT", KEYWORD_COMMIT}, {"ROLLBACK", KEYWORD_ROLLBACK}, {"BETWEEN", KEYWORD_BETWEEN},
+    {"ANALYZE", KEYWORD_ANALYZE}, {"INCLUDE", KEYWORD_INCLUDE},
+    {"JOIN", KEYWORD_JOIN}, {"INNER", KEYWORD_INNER}, {"GROUP", KEYWORD_GROUP},
+    {"OFFSET", KEYWORD_OFFSET}, {"COPY", KEYWORD_COPY},
+};
+
+void lexer_init(Lexer* lexer, const char* input) {
+    lexer->input = input;
+    lexer->current = input;
+}
+
+static Keyword lookup_keyword(const char* start, int length) {
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        if ((int)strlen(keywords[i].text) == length && strncasecmp(keywords[i].text, start, length) == 0) {
+            return keywords[i].keyword;
+        }
+    }
+    return KEYWORD_NONE;
+}
+
+static Token make_token(Lexer* lexer, TokenType type, const char* start) {
+    Token token;
+    token.type = type;
+    token.keyword = KEYWORD_NONE;
+    token.start = start;
+    token.length = (uint16_t)(lexer->current - start);
+    token.position = (int)(start - lexer->input);
+    return token;
+}
+
+Token lexer_next(Lexer* lexer) {
+    while (isspace((unsigned char)*lexer->current)) {
+        lexer->current++;
+    }
+
+    const char* start = lexer->current;
+    char c = *lexer->current;
+    if (c == '\0') {
+        return make_token(lexer, TOKEN_EOF, start);
+    }
+
+    if (isalpha((unsigned char)c) || c == '_') {
+        while (isalnum((unsigned char)*lexer->current) || *lexer->current == '_') {
+            lexer->current++;
+        }
+        Token token = make_token(lexer, TOKEN_IDENTIFIER, start);
+        token.keyword = lookup_keyword(start, token.length);
+        if (token.keyword != KEYWORD_NONE) {
+            token.type = TOKEN_KEYWORD;
+        }
+        return token;
+    }
+
+    if (isdigit((unsigned char)c) || (c == '.' && isdigit((unsigned char)lexer->current[1]))) {
+        TokenType type = TOKEN_INTEGER;
+        while (isdigit((unsigned char)*lexer->current)) {
+            lexer->current++;
+        }
+        if (*lexer->current == '.') {
+            type = TOKEN_FLOAT;
+            lexer->current++;
+            while (isdigit((unsigned char)*lexer->current)) {
+                lexer->current++;
+            }
+        }
+        if (*lexer->current == 'e' || *lexer->current == 'E') {
+            const char* exponent = lexer->current + 1;
+            if (*exponent == '+' || *exponent == '-') {
+                exponent++;
+            }
+            if (isdigit((unsigned char)*exponent)) {
+                type = TOKEN_FLOAT;
+                lexer->current = exponent;
+                while (isdigit((unsigned char)*lexer->current)) {
+                    lexer->current++;
+                }
+            }
+        }
+        return make_token(lexer, type, start);
+    }
+
+    if (c == '\'') {
+        lexer->current++;
+        while (*lexer->current != '\0') {
+            if (*lexer->current == '\'') {
+                if (lexer->current[1] != '\'') {
+                    break;
+                }
+                lexer->current++; // '' is an escaped quote
+            }
+            lexer->current++;
+        }
+        if (*lexer->current != '\'') {
+            return make_token(lexer, TOKEN_ERROR, start);
+        }
+        Token token = make_token(lexer, TOKEN_STRING, start + 1);
+        lexer->current++;
+        token.position = (int)(start - lexer->input);
+        return token;
+    }
+
+    lexer->current++;
+    switch (c) {
+        case '(': return make_token(lexer, TOKEN_LPAREN, start);
+        case ')': return make_token(lexer, TOKEN_RPAREN, start);
+        case ',': return make_token(lexer, TOKEN_COMMA, start);
+        case '.': return make_token(lexer, TOKEN_DOT, start);
+        case ';': return make_token(lexer, TOKEN_SEMICOLON, start);
+        case '*': return make_token(lexer, TOKEN_STAR, start);
+        case '+': return make_token(lexer, TOKEN_PLUS, start);
+        case '-': return make_token(lexer, TOKEN_MINUS, start);
+        case '?': return make_token(lexer, TOKEN_PARAMETER, start);
+        case '=': return make_token(lexer, TOKEN_EQ, start);
+        case '!':
+            if (*lexer->current == '=') {
+                lexer->current++;
+                return make_token(lexer, TOKEN_NE, start);
+            }
+            break;
+        case '<':
+            if (*lexer->current == '=') {
+                lexer->current++;
+                return make_token(lexer, TOKEN_LE, start);
+            }
+            if (*lexer->current == '>') {
+                lexer->current++;
+                return make_token(lexer, TOKEN_NE, start);
+            }
+            return make_token(lexer, TOKEN_LT, start);
+        case '>':
+            if (*lexer->current == '=') {
+                lexer->current++;
+                return make_token(lexer, TOKEN_GE, start);
+            }
+            return make_token(lexer, TOKEN_GT, start);
+        default:
+            break;
+    }
+    return make_token(lexer, TOKEN_ERROR, start);
+}
@@ -0,0 +1,60 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stdint.h>
+
+typedef enum {
+    TOKEN_EOF,
+    TOKEN_IDENTIFIER,
+    TOKEN_KEYWORD,
+    TOKEN_INTEGER,
+    TOKEN_FLOAT,
+    TOKEN_STRING,     // contents without the quotes, '' not yet unescaped
+    TOKEN_PARAMETER,  // ?
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_COMMA,
+    TOKEN_DOT,
+    TOKEN_SEMICOLON,
+    TOKEN_STAR,
+    TOKEN_PLUS,
+    TOKEN_MINUS,
+    TOKEN_EQ,
+    TOKEN_NE,
+    TOKEN_LT,
+    TOKEN_LE,
+    TOKEN_GT,
+    TOKEN_GE,
+    TOKEN_ERROR
+} TokenType;
+
+typedef enum {
+    KEYWORD_NONE,
+    KEYWORD_SELECT, KEYWORD_FROM, KEYWORD_WHERE, KEYWORD_AND, KEYWORD_OR, KEYWORD_NOT,
+    KEYWORD_ORDER, KEYWORD_BY, KEYWORD_ASC, KEYWORD_DESC, KEYWORD_LIMIT,
+    KEYWORD_INSERT, KEYWORD_INTO, KEYWORD_VALUES, KEYWORD_UPDATE, KEYWORD_SET,
+    KEYWORD_DELETE, KEYWORD_CREATE, KEYWORD_TABLE, KEYWORD_INDEX, KEYWORD_UNIQUE,
+    KEYWORD_ON, KEYWORD_DROP, KEYWORD_PRIMARY, KEYWORD_KEY, KEYWORD_NULL,
+    KEYWORD_TRUE, KEYWORD_FALSE, KEYWORD_IS, KEYWORD_BETWEEN, KEYWORD_ANALYZE, KEYWORD_INCLUDE,
+    KEYWORD_JOIN, KEYWORD_INNER, KEYWORD_GROUP, KEYWORD_OFFSET, KEYWORD_COPY,
+    KEYWORD_BEGIN, KEYWORD_COMMIT, KEYWORD_ROLLBACK
+} Keyword;
+
+// a token points into the statement text, nothing is copied
+typedef struct {
+    TokenType type;
+    Keyword keyword;
+    const char* start;
+    uint16_t length;
+    int position;      // byte offset in the statement, for error messages
+} Token;
+
+typedef struct {
+    const char* input;
+    const char* current;
+} Lexer;
+
+void lexer_init(Lexer* lexer, const char* input);
+Token lexer_next(Lexer* lexer);
+
+#endif // LEXER_H
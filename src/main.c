@@ -18,10 +18,14 @@ int main(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    char query[256];
+    // getline grows the buffer to fit each line, however long
+    char* query = NULL;
+    size_t query_capacity = 0;
     while (1) {
         printf("db > ");
-        fgets(query, 256, stdin);
+        if (getline(&query, &query_capacity, stdin) == -1) {
+            break;
+        }
         
         // remove newline character
         query[strcspn(query, "\n")] = 0;
@@ -48,7 +52,7 @@ int main(int argc, char* argv[]) {
                 continue;
             } else if (strncmp(query, "\\d ", 3) == 0) {
                 char table_name[64];
-                sscanf(query, "\\d %s", table_name);
+                sscanf(query, "\\d %63s", table_name);
                 db_describe_table(db, table_name);
                 continue;
             } else {
@@ -57,19 +61,25 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        Result* result = db_execute(db, query);
-        if (result != NULL) {
-            for (int i = 0; i < result->num_rows; i++) {
-                printf("(%s, %s)\n", result->rows[i][0], result->rows[i][1]);
-                free(result->rows[i][0]);
-                free(result->rows[i][1]);
-                free(result->rows[i]);
+        // rows are printed as they are produced, nothing is held per row
+        Cursor* cursor = db_query(db, query);
+        if (cursor != NULL) {
+            const Value* row;
+            while ((row = db_cursor_next(cursor)) != NULL) {
+                printf("(");
+                for (int j = 0; j < cursor->num_columns; j++) {
+                    if (j > 0) {
+                        printf(", ");
+                    }
+                    value_print(stdout, &row[j]);
+                }
+                printf(")\n");
             }
-            free(result->rows);
-            free(result);
+            db_cursor_close(cursor);
         }
     }
 
+    free(query);
     db_close(db);
     return 0;
 }
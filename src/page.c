@@ -2,6 +2,10 @@
 
 #include <string.h>
 
+static CellPointer* page_cells(const Page* page) {
+    return (CellPointer*)page->data;
+}
+
 // initialize a new page
 void page_init(Page* page, PageType page_type) {
     if (page == NULL) {
@@ -9,6 +13,119 @@ void page_init(Page* page, PageType page_type) {
     }
     memset(page, 0, PAGE_SIZE);
     page->header.page_type = page_type;
-    page->header.free_space_offset = sizeof(PageHeader);
+    page->header.free_space_offset = PAGE_SIZE;
     page->header.num_cells = 0;
+    page->header.next_page_id = 0;
+    page->header.page_lsn = 0;
+}
+
+// bytes left between the slot directory and the cell content area
+uint16_t page_free_space(const Page* page) {
+    uint32_t directory_end = sizeof(PageHeader) + page->header.num_cells * sizeof(CellPointer);
+    if (page->header.free_space_offset < directory_end) {
+        return 0;
+    }
+    return page->header.free_space_offset - directory_end;
+}
+
+// binary search for key, returns the slot holding it or the slot it would be inserted at
+int page_find_cell(const Page* page, int key, int* found) {
+    CellPointer* cells = page_cells(page);
+    int low = 0;
+    int high = page->header.num_cells;
+
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (cells[mid].key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (found != NULL) {
+        *found = (low < page->header.num_cells && cells[low].key == key);
+    }
+    return low;
+}
+
+int page_cell_key(const Page* page, int slot) {
+    return page_cells(page)[slot].key;
+}
+
+const char* page_cell_value(const Page* page, int slot, uint16_t* length) {
+    CellPointer* cell = &page_cells(page)[slot];
+    if (length != NULL) {
+        *length = cell->length;
+    }
+    return (const char*)page + cell->offset;
+}
+
+int page_insert_cell(Page* page, int slot, int key, const char* value, uint16_t length) {
+    if (slot < 0 || slot > page->header.num_cells) {
+        return -1;
+    }
+    if (page_free_space(page) < length + sizeof(CellPointer)) {
+        return -1;
+    }
+
+    CellPointer* cells = page_cells(page);
+    memmove(&cells[slot + 1], &cells[slot], (page->header.num_cells - slot) * sizeof(CellPointer));
+
+    page->header.free_space_offset -= length;
+    memcpy((char*)page + page->header.free_space_offset, value, length);
+
+    cells[slot].key = key;
+    cells[slot].offset = page->header.free_space_offset;
+    cells[slot].length = length;
+    page->header.num_cells++;
+    return 0;
+}
+
+// release the content bytes of a cell, keeping the content area contiguous
+static void page_release_content(Page* page, int slot) {
+    CellPointer* cells = page_cells(page);
+    uint16_t offset = cells[slot].offset;
+    uint16_t length = cells[slot].length;
+    uint16_t start = page->header.free_space_offset;
+
+    memmove((char*)page + start + length, (char*)page + start, offset - start);
+    for (int i = 0; i < page->header.num_cells; i++) {
+        if (cells[i].offset < offset) {
+            cells[i].offset += length;
+        }
+    }
+    page->header.free_space_offset += length;
+    cells[slot].length = 0;
+    cells[slot].offset = page->header.free_space_offset;
+}
+
+void page_delete_cell(Page* page, int slot) {
+    if (slot < 0 || slot >= page->header.num_cells) {
+        return;
+    }
+
+    page_release_content(page, slot);
+
+    CellPointer* cells = page_cells(page);
+    memmove(&cells[slot], &cells[slot + 1], (page->header.num_cells - slot - 1) * sizeof(CellPointer));
+    page->header.num_cells--;
+}
+
+int page_update_cell(Page* page, int slot, const char* value, uint16_t length) {
+    if (slot < 0 || slot >= page->header.num_cells) {
+        return -1;
+    }
+
+    CellPointer* cells = page_cells(page);
+    if (page_free_space(page) + cells[slot].length < length) {
+        return -1;
+    }
+
+    page_release_content(page, slot);
+    page->header.free_space_offset -= length;
+    memcpy((char*)page + page->header.free_space_offset, value, length);
+    cells[slot].offset = page->header.free_space_offset;
+    cells[slot].length = length;
+    return 0;
 }
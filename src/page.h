@@ -15,8 +15,10 @@ typedef enum {
 
 typedef struct {
     PageType page_type;
-    uint16_t free_space_offset;
+    uint16_t free_space_offset; // start of the cell content area, grows down from PAGE_SIZE
     uint16_t num_cells;
+    uint32_t next_page_id;      // right sibling for leaf pages, 0 if none
+    uint64_t page_lsn;          // lsn of the last log record applied to this page
 } PageHeader;
 
 
@@ -25,4 +27,21 @@ typedef struct {
     char data[PAGE_SIZE - sizeof(PageHeader)];
 } Page;
 
+
+// slot directory entry, stored at the start of page->data in key order
+typedef struct {
+    int32_t key;
+    uint16_t offset; // from the start of the page
+    uint16_t length;
+} CellPointer;
+
+void page_init(Page* page, PageType page_type);
+uint16_t page_free_space(const Page* page);
+int page_find_cell(const Page* page, int key, int* found);
+int page_cell_key(const Page* page, int slot);
+const char* page_cell_value(const Page* page, int slot, uint16_t* length);
+int page_insert_cell(Page* page, int slot, int key, const char* value, uint16_t length);
+void page_delete_cell(Page* page, int slot);
+int page_update_cell(Page* page, int slot, const char* value, uint16_t length);
+
 #endif // PAGE_H
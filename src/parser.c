@@ -0,0 +1,633 @@
+#include "parser.h"
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef struct {
+    Lexer lexer;
+    Token current;
+    Token previous;
+    int failed;
+    int num_parameters;
+    Arena* arena;      // the statement's, every node is allocated from it
+} Parser;
+
+static void advance(Parser* parser) {
+    parser->previous = parser->current;
+    parser->current = lexer_next(&parser->lexer);
+}
+
+static void parse_error(Parser* parser, const char* message) {
+    if (parser->failed) {
+        return;
+    }
+    parser->failed = 1;
+    if (parser->current.type == TOKEN_EOF) {
+        fprintf(stderr, "error: %s at end of statement.\n", message);
+    } else {
+        fprintf(stderr, "error: %s near '%.*s'.\n", message, parser->current.length, parser->current.start);
+    }
+}
+
+static int check(Parser* parser, TokenType type) {
+    return parser->current.type == type;
+}
+
+static int check_keyword(Parser* parser, Keyword keyword) {
+    return parser->current.type == TOKEN_KEYWORD && parser->current.keyword == keyword;
+}
+
+static int match(Parser* parser, TokenType type) {
+    if (!check(parser, type)) {
+        return 0;
+    }
+    advance(parser);
+    return 1;
+}
+
+static int match_keyword(Parser* parser, Keyword keyword) {
+    if (!check_keyword(parser, keyword)) {
+        return 0;
+    }
+    advance(parser);
+    return 1;
+}
+
+static void expect(Parser* parser, TokenType type, const char* message) {
+    if (!match(parser, type)) {
+        parse_error(parser, message);
+    }
+}
+
+static void expect_keyword(Parser* parser, Keyword keyword, const char* message) {
+    if (!match_keyword(parser, keyword)) {
+        parse_error(parser, message);
+    }
+}
+
+// copy an identifier into a MAX_NAME_LEN buffer
+static void expect_identifier(Parser* parser, char* name, const char* message) {
+    if (!check(parser, TOKEN_IDENTIFIER) || parser->current.length >= MAX_NAME_LEN) {
+        parse_error(parser, message);
+        name[0] = '\0';
+        return;
+    }
+    memcpy(name, parser->current.start, parser->current.length);
+    name[parser->current.length] = '\0';
+    advance(parser);
+}
+
+static Expr* expr_new(Parser* parser, ExprType type) {
+    Expr* expr = (Expr*)arena_calloc(parser->arena, sizeof(Expr));
+    expr->type = type;
+    expr->column_index = -1;
+    return expr;
+}
+
+// make room for one more item in an arena array, doubling its capacity
+static void* list_grow(Parser* parser, void* list, int count, int* capacity, size_t item_size) {
+    if (count < *capacity) {
+        return list;
+    }
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 4;
+    list = arena_grow(parser->arena, list, item_size * *capacity, item_size * new_capacity);
+    *capacity = new_capacity;
+    return list;
+}
+
+static Expr* literal_new(Parser* parser, LiteralKind kind, const char* text, int length, int negative) {
+    Expr* expr = expr_new(parser, EXPR_LITERAL);
+    expr->literal_kind = kind;
+    expr->text = (char*)arena_alloc(parser->arena, length + 2);
+    int out = 0;
+    if (negative) {
+        expr->text[out++] = '-';
+    }
+    for (int i = 0; i < length; i++) {
+        expr->text[out++] = text[i];
+        if (kind == LITERAL_STRING && text[i] == '\'' && i + 1 < length && text[i + 1] == '\'') {
+            i++; // '' is an escaped quote
+        }
+    }
+    expr->text[out] = '\0';
+    expr->text_length = (uint16_t)out;
+    return expr;
+}
+
+static Expr* parse_expression(Parser* parser);
+static Expr* parse_operand(Parser* parser);
+
+// an identifier followed by '(' names an aggregate function, so columns may
+// still be called count or sum
+static int check_aggregate(Parser* parser, AggregateFunction* function) {
+    static const struct {
+        const char* name;
+        AggregateFunction function;
+    } functions[] = {
+        {"COUNT", AGGREGATE_COUNT}, {"SUM", AGGREGATE_SUM}, {"MIN", AGGREGATE_MIN},
+        {"MAX", AGGREGATE_MAX}, {"AVG", AGGREGATE_AVG},
+    };
+
+    Token token = parser->current;
+    if (token.type != TOKEN_IDENTIFIER) {
+        return 0;
+    }
+    Lexer lookahead = parser->lexer;
+    if (lexer_next(&lookahead).type != TOKEN_LPAREN) {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++) {
+        if (strlen(functions[i].name) == token.length && strncasecmp(functions[i].name, token.start, token.length) == 0) {
+            *function = functions[i].function;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// COUNT(*) or function(column)
+static Expr* parse_aggregate(Parser* parser, AggregateFunction function) {
+    Expr* expr = expr_new(parser, EXPR_AGGREGATE);
+    expr->function = function;
+    advance(parser);
+    expect(parser, TOKEN_LPAREN, "expected '('");
+    if (function == AGGREGATE_COUNT && match(parser, TOKEN_STAR)) {
+        expect(parser, TOKEN_RPAREN, "expected ')'");
+        return expr;
+    }
+    if (!check(parser, TOKEN_IDENTIFIER)) {
+        parse_error(parser, "expected column name");
+        return NULL;
+    }
+    expr->left = parse_operand(parser);
+    expect(parser, TOKEN_RPAREN, "expected ')'");
+    return expr;
+}
+
+// column reference, aggregate, literal, parameter or parenthesized expression
+static Expr* parse_operand(Parser* parser) {
+    if (match(parser, TOKEN_LPAREN)) {
+        Expr* expr = parse_expression(parser);
+        expect(parser, TOKEN_RPAREN, "expected ')'");
+        return expr;
+    }
+
+    AggregateFunction function;
+    if (check_aggregate(parser, &function)) {
+        return parse_aggregate(parser, function);
+    }
+
+    if (check(parser, TOKEN_IDENTIFIER)) {
+        Expr* expr = expr_new(parser, EXPR_COLUMN);
+        expect_identifier(parser, expr->name, "expected column name");
+        if (match(parser, TOKEN_DOT)) {
+            memcpy(expr->table_name, expr->name, MAX_NAME_LEN);
+            expect_identifier(parser, expr->name, "expected column name");
+        }
+        return expr;
+    }
+
+    if (match(parser, TOKEN_PARAMETER)) {
+        Expr* expr = expr_new(parser, EXPR_PARAMETER);
+        expr->parameter_index = parser->num_parameters++;
+        return expr;
+    }
+
+    int negative = match(parser, TOKEN_MINUS);
+    if (!negative) {
+        match(parser, TOKEN_PLUS);
+    }
+    Token token = parser->current;
+    if (match(parser, TOKEN_INTEGER)) {
+        return literal_new(parser, LITERAL_INTEGER, token.start, token.length, negative);
+    }
+    if (match(parser, TOKEN_FLOAT)) {
+        return literal_new(parser, LITERAL_FLOAT, token.start, token.length, negative);
+    }
+    if (!negative && match(parser, TOKEN_STRING)) {
+        return literal_new(parser, LITERAL_STRING, token.start, token.length, 0);
+    }
+    if (!negative && match_keyword(parser, KEYWORD_NULL)) {
+        return literal_new(parser, LITERAL_NULL, "", 0, 0);
+    }
+    if (!negative && (match_keyword(parser, KEYWORD_TRUE) || match_keyword(parser, KEYWORD_FALSE))) {
+        return literal_new(parser, LITERAL_BOOLEAN, token.keyword == KEYWORD_TRUE ? "true" : "false",
+                           token.keyword == KEYWORD_TRUE ? 4 : 5, 0);
+    }
+
+    parse_error(parser, "expected an expression");
+    return NULL;
+}
+
+static int compare_op(TokenType type, CompareOp* op) {
+    switch (type) {
+        case TOKEN_EQ: *op = COMPARE_EQ; return 1;
+        case TOKEN_NE: *op = COMPARE_NE; return 1;
+        case TOKEN_LT: *op = COMPARE_LT; return 1;
+        case TOKEN_LE: *op = COMPARE_LE; return 1;
+        case TOKEN_GT: *op = COMPARE_GT; return 1;
+        case TOKEN_GE: *op = COMPARE_GE; return 1;
+        default: return 0;
+    }
+}
+
+static Expr* parse_predicate(Parser* parser) {
+    Expr* left = parse_operand(parser);
+    if (left == NULL) {
+        return NULL;
+    }
+
+    CompareOp op;
+    if (compare_op(parser->current.type, &op)) {
+        advance(parser);
+        Expr* expr = expr_new(parser, EXPR_COMPARE);
+        expr->op = op;
+        expr->left = left;
+        expr->right = parse_operand(parser);
+        return expr;
+    }
+
+    // a BETWEEN b AND c is a >= b AND a <= c, NOT BETWEEN negates it
+    int negated = check_keyword(parser, KEYWORD_NOT);
+    if (negated) {
+        advance(parser);
+        if (!match_keyword(parser, KEYWORD_BETWEEN)) {
+            parse_error(parser, "expected BETWEEN");
+            return NULL;
+        }
+    }
+    if (negated || match_keyword(parser, KEYWORD_BETWEEN)) {
+        Expr* lower = expr_new(parser, EXPR_COMPARE);
+        lower->op = COMPARE_GE;
+        lower->left = left;
+        lower->right = parse_operand(parser);
+        expect_keyword(parser, KEYWORD_AND, "expected AND");
+        Expr* upper = expr_new(parser, EXPR_COMPARE);
+        upper->op = COMPARE_LE;
+        upper->left = left;
+        upper->right = parse_operand(parser);
+
+        Expr* expr = expr_new(parser, EXPR_AND);
+        expr->left = lower;
+        expr->right = upper;
+        if (negated) {
+            Expr* not_expr = expr_new(parser, EXPR_NOT);
+            not_expr->left = expr;
+            return not_expr;
+        }
+        return expr;
+    }
+
+    if (match_keyword(parser, KEYWORD_IS)) {
+        Expr* expr = expr_new(parser, EXPR_IS_NULL);
+        expr->negated = match_keyword(parser, KEYWORD_NOT);
+        expect_keyword(parser, KEYWORD_NULL, "expected NULL");
+        expr->left = left;
+        return expr;
+    }
+    return left;
+}
+
+static Expr* parse_not(Parser* parser) {
+    if (match_keyword(parser, KEYWORD_NOT)) {
+        Expr* expr = expr_new(parser, EXPR_NOT);
+        expr->left = parse_not(parser);
+        return expr;
+    }
+    return parse_predicate(parser);
+}
+
+static Expr* parse_and(Parser* parser) {
+    Expr* left = parse_not(parser);
+    while (!parser->failed && match_keyword(parser, KEYWORD_AND)) {
+        Expr* expr = expr_new(parser, EXPR_AND);
+        expr->left = left;
+        expr->right = parse_not(parser);
+        left = expr;
+    }
+    return left;
+}
+
+static Expr* parse_expression(Parser* parser) {
+    Expr* left = parse_and(parser);
+    while (!parser->failed && match_keyword(parser, KEYWORD_OR)) {
+        Expr* expr = expr_new(parser, EXPR_OR);
+        expr->left = left;
+        expr->right = parse_and(parser);
+        left = expr;
+    }
+    return left;
+}
+
+static int64_t parse_integer(Parser* parser, const char* message) {
+    Token token = parser->current;
+    if (!match(parser, TOKEN_INTEGER)) {
+        parse_error(parser, message);
+        return 0;
+    }
+    return strtoll(token.start, NULL, 10);
+}
+
+static void parse_select(Parser* parser, SelectStatement* select) {
+    select->limit = -1;
+    int capacity = 0;
+
+    if (match(parser, TOKEN_STAR)) {
+        select->select_star = 1;
+    } else {
+        do {
+            Expr* column = parse_operand(parser);
+            if (column == NULL) {
+                return;
+            }
+            select->columns = (Expr**)list_grow(parser, select->columns, select->num_columns, &capacity, sizeof(Expr*));
+            select->columns[select->num_columns++] = column;
+        } while (match(parser, TOKEN_COMMA));
+    }
+
+    expect_keyword(parser, KEYWORD_FROM, "expected FROM");
+    expect_identifier(parser, select->table_name, "expected table name");
+
+    int inner = match_keyword(parser, KEYWORD_INNER);
+    if (inner || match_keyword(parser, KEYWORD_JOIN)) {
+        if (inner) {
+            expect_keyword(parser, KEYWORD_JOIN, "expected JOIN");
+        }
+        expect_identifier(parser, select->join_table_name, "expected table name");
+        expect_keyword(parser, KEYWORD_ON, "expected ON");
+        select->join_condition = parse_expression(parser);
+    }
+
+    if (match_keyword(parser, KEYWORD_WHERE)) {
+        select->where = parse_expression(parser);
+    }
+
+    if (match_keyword(parser, KEYWORD_GROUP)) {
+        expect_keyword(parser, KEYWORD_BY, "expected BY");
+        capacity = 0;
+        do {
+            if (!check(parser, TOKEN_IDENTIFIER)) {
+                parse_error(parser, "expected column name");
+                return;
+            }
+            Expr* column = parse_operand(parser);
+            if (column == NULL || column->type != EXPR_COLUMN) {
+                parse_error(parser, "expected column name");
+                return;
+            }
+            select->group_by = (Expr**)list_grow(parser, select->group_by, select->num_group_by, &capacity, sizeof(Expr*));
+            select->group_by[select->num_group_by++] = column;
+        } while (!parser->failed && match(parser, TOKEN_COMMA));
+    }
+
+    if (match_keyword(parser, KEYWORD_ORDER)) {
+        expect_keyword(parser, KEYWORD_BY, "expected BY");
+        capacity = 0;
+        do {
+            Expr* expr = parse_operand(parser);
+            if (expr == NULL) {
+                return;
+            }
+            select->order_by = (OrderByItem*)list_grow(parser, select->order_by, select->num_order_by, &capacity, sizeof(OrderByItem));
+            OrderByItem* item = &select->order_by[select->num_order_by++];
+            item->expr = expr;
+            item->descending = 0;
+            if (match_keyword(parser, KEYWORD_DESC)) {
+                item->descending = 1;
+            } else {
+                match_keyword(parser, KEYWORD_ASC);
+            }
+        } while (!parser->failed && match(parser, TOKEN_COMMA));
+    }
+
+    if (match_keyword(parser, KEYWORD_LIMIT)) {
+        select->limit = parse_integer(parser, "expected LIMIT count");
+    }
+    if (match_keyword(parser, KEYWORD_OFFSET)) {
+        select->offset = parse_integer(parser, "expected OFFSET count");
+    }
+}
+
+static void parse_insert(Parser* parser, InsertStatement* insert) {
+    expect_keyword(parser, KEYWORD_INTO, "expected INTO");
+    expect_identifier(parser, insert->table_name, "expected table name");
+    expect_keyword(parser, KEYWORD_VALUES, "expected VALUES");
+
+    int capacity = 0;
+    do {
+        Expr* row[MAX_COLUMNS_PER_TABLE];
+        expect(parser, TOKEN_LPAREN, "expected '('");
+        int num_values = 0;
+        while (!parser->failed) {
+            if (num_values == MAX_COLUMNS_PER_TABLE) {
+                parse_error(parser, "too many values");
+                break;
+            }
+            row[num_values] = parse_operand(parser);
+            if (row[num_values] == NULL) {
+                break;
+            }
+            num_values++;
+            if (!match(parser, TOKEN_COMMA)) {
+                break;
+            }
+        }
+        expect(parser, TOKEN_RPAREN, "expected ')'");
+
+        insert->rows = (Expr***)list_grow(parser, insert->rows, insert->num_rows, &capacity, sizeof(Expr**));
+        insert->rows[insert->num_rows] = (Expr**)arena_alloc(parser->arena, sizeof(Expr*) * (num_values + 1));
+        memcpy(insert->rows[insert->num_rows++], row, sizeof(Expr*) * num_values);
+        if (insert->num_rows == 1) {
+            insert->num_values = num_values;
+        } else if (num_values != insert->num_values) {
+            parse_error(parser, "all VALUES rows must have the same number of values");
+        }
+    } while (!parser->failed && match(parser, TOKEN_COMMA));
+}
+
+static void parse_update(Parser* parser, UpdateStatement* update) {
+    expect_identifier(parser, update->table_name, "expected table name");
+    expect_keyword(parser, KEYWORD_SET, "expected SET");
+
+    int capacity = 0;
+    do {
+        update->assignments = (Assignment*)list_grow(parser, update->assignments, update->num_assignments, &capacity, sizeof(Assignment));
+        Assignment* assignment = &update->assignments[update->num_assignments++];
+        assignment->value = NULL;
+        expect_identifier(parser, assignment->column_name, "expected column name");
+        expect(parser, TOKEN_EQ, "expected '='");
+        if (!parser->failed) {
+            assignment->value = parse_operand(parser);
+        }
+    } while (!parser->failed && match(parser, TOKEN_COMMA));
+
+    if (match_keyword(parser, KEYWORD_WHERE)) {
+        update->where = parse_expression(parser);
+    }
+}
+
+static void parse_delete(Parser* parser, DeleteStatement* delete_) {
+    expect_keyword(parser, KEYWORD_FROM, "expected FROM");
+    expect_identifier(parser, delete_->table_name, "expected table name");
+    if (match_keyword(parser, KEYWORD_WHERE)) {
+        delete_->where = parse_expression(parser);
+    }
+}
+
+static int parse_column_type(Parser* parser, ColumnSchema* column) {
+    static const struct {
+        const char* name;
+        ColumnType type;
+    } types[] = {
+        {"INT", COLUMN_TYPE_INT}, {"INTEGER", COLUMN_TYPE_INT}, {"VARCHAR", COLUMN_TYPE_VARCHAR},
+        {"FLOAT", COLUMN_TYPE_FLOAT}, {"DOUBLE", COLUMN_TYPE_DOUBLE}, {"TEXT", COLUMN_TYPE_TEXT},
+        {"DATE", COLUMN_TYPE_DATE}, {"TIMESTAMP", COLUMN_TYPE_TIMESTAMP}, {"BOOLEAN", COLUMN_TYPE_BOOLEAN},
+    };
+
+    Token token = parser->current;
+    if (token.type == TOKEN_IDENTIFIER) {
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+            if (strlen(types[i].name) == token.length && strncasecmp(types[i].name, token.start, token.length) == 0) {
+                advance(parser);
+                column->type = types[i].type;
+                column->length = 0;
+                if (column->type == COLUMN_TYPE_VARCHAR && match(parser, TOKEN_LPAREN)) {
+                    column->length = (uint16_t)parse_integer(parser, "expected VARCHAR length");
+                    expect(parser, TOKEN_RPAREN, "expected ')'");
+                }
+                return 0;
+            }
+        }
+    }
+    parse_error(parser, "unknown column type");
+    return -1;
+}
+
+static void parse_create(Parser* parser, Statement* statement) {
+    if (match_keyword(parser, KEYWORD_TABLE)) {
+        CreateTableStatement* create = &statement->create_table;
+        statement->type = STATEMENT_CREATE_TABLE;
+        expect_identifier(parser, create->table_name, "expected table name");
+        expect(parser, TOKEN_LPAREN, "expected '('");
+        do {
+            if (create->num_columns == MAX_COLUMNS_PER_TABLE) {
+                parse_error(parser, "too many columns");
+                return;
+            }
+            ColumnSchema* column = &create->columns[create->num_columns++];
+            memset(column, 0, sizeof(ColumnSchema));
+            expect_identifier(parser, column->name, "expected column name");
+            if (parser->failed || parse_column_type(parser, column) != 0) {
+                return;
+            }
+            if (match_keyword(parser, KEYWORD_PRIMARY)) {
+                expect_keyword(parser, KEYWORD_KEY, "expected KEY");
+                column->is_primary_key = 1;
+            }
+        } while (!parser->failed && match(parser, TOKEN_COMMA));
+        expect(parser, TOKEN_RPAREN, "expected ')'");
+        return;
+    }
+
+    CreateIndexStatement* create = &statement->create_index;
+    statement->type = STATEMENT_CREATE_INDEX;
+    create->is_unique = match_keyword(parser, KEYWORD_UNIQUE);
+    expect_keyword(parser, KEYWORD_INDEX, "expected TABLE or INDEX");
+    expect_identifier(parser, create->index_name, "expected index name");
+    expect_keyword(parser, KEYWORD_ON, "expected ON");
+    expect_identifier(parser, create->table_name, "expected table name");
+    expect(parser, TOKEN_LPAREN, "expected '('");
+    expect_identifier(parser, create->column_name, "expected column name");
+    expect(parser, TOKEN_RPAREN, "expected ')'");
+    if (!parser->failed && match_keyword(parser, KEYWORD_INCLUDE)) {
+        expect(parser, TOKEN_LPAREN, "expected '('");
+        do {
+            if (create->num_include_columns == MAX_COLUMNS_PER_TABLE) {
+                parse_error(parser, "too many columns");
+                return;
+            }
+            expect_identifier(parser, create->include_columns[create->num_include_columns++], "expected column name");
+        } while (!parser->failed && match(parser, TOKEN_COMMA));
+        expect(parser, TOKEN_RPAREN, "expected ')'");
+    }
+}
+
+Statement* parse_statement(const char* sql) {
+    Statement* statement = (Statement*)calloc(1, sizeof(Statement));
+    if (statement == NULL) {
+        return NULL;
+    }
+    arena_init(&statement->arena);
+
+    Parser parser;
+    memset(&parser, 0, sizeof(Parser));
+    parser.arena = &statement->arena;
+    lexer_init(&parser.lexer, sql);
+    advance(&parser);
+
+    if (match_keyword(&parser, KEYWORD_SELECT)) {
+        statement->type = STATEMENT_SELECT;
+        parse_select(&parser, &statement->select);
+    } else if (match_keyword(&parser, KEYWORD_INSERT)) {
+        statement->type = STATEMENT_INSERT;
+        parse_insert(&parser, &statement->insert);
+    } else if (match_keyword(&parser, KEYWORD_COPY)) {
+        statement->type = STATEMENT_COPY;
+        expect_identifier(&parser, statement->copy.table_name, "expected table name");
+        expect_keyword(&parser, KEYWORD_FROM, "expected FROM");
+        Token token = parser.current;
+        expect(&parser, TOKEN_STRING, "expected a file name");
+        if (!parser.failed) {
+            statement->copy.file_name = literal_new(&parser, LITERAL_STRING, token.start, token.length, 0)->text;
+        }
+    } else if (match_keyword(&parser, KEYWORD_UPDATE)) {
+        statement->type = STATEMENT_UPDATE;
+        parse_update(&parser, &statement->update);
+    } else if (match_keyword(&parser, KEYWORD_DELETE)) {
+        statement->type = STATEMENT_DELETE;
+        parse_delete(&parser, &statement->delete_);
+    } else if (match_keyword(&parser, KEYWORD_CREATE)) {
+        parse_create(&parser, statement);
+    } else if (match_keyword(&parser, KEYWORD_DROP)) {
+        statement->type = STATEMENT_DROP_INDEX;
+        expect_keyword(&parser, KEYWORD_INDEX, "expected INDEX");
+        expect_identifier(&parser, statement->drop_index.index_name, "expected index name");
+        expect_keyword(&parser, KEYWORD_ON, "expected ON");
+        expect_identifier(&parser, statement->drop_index.table_name, "expected table name");
+    } else if (match_keyword(&parser, KEYWORD_ANALYZE)) {
+        statement->type = STATEMENT_ANALYZE;
+        if (check(&parser, TOKEN_IDENTIFIER)) {
+            expect_identifier(&parser, statement->analyze.table_name, "expected table name");
+        }
+    } else if (match_keyword(&parser, KEYWORD_BEGIN)) {
+        statement->type = STATEMENT_BEGIN;
+    } else if (match_keyword(&parser, KEYWORD_COMMIT)) {
+        statement->type = STATEMENT_COMMIT;
+    } else if (match_keyword(&parser, KEYWORD_ROLLBACK)) {
+        statement->type = STATEMENT_ROLLBACK;
+    } else {
+        parse_error(&parser, "unknown statement");
+    }
+
+    match(&parser, TOKEN_SEMICOLON);
+    if (!parser.failed && !check(&parser, TOKEN_EOF)) {
+        parse_error(&parser, "unexpected input");
+    }
+
+    statement->num_parameters = parser.num_parameters;
+    if (parser.failed) {
+        statement_free(statement);
+        return NULL;
+    }
+    return statement;
+}
+
+void statement_free(Statement* statement) {
+    if (statement == NULL) {
+        return;
+    }
+    arena_free(&statement->arena);
+    free(statement);
+}
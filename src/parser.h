@@ -0,0 +1,179 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdint.h>
+#include "arena.h"
+#include "catalog.h"
+#include "row.h"
+
+typedef enum {
+    EXPR_COLUMN,
+    EXPR_LITERAL,
+    EXPR_PARAMETER,
+    EXPR_COMPARE,
+    EXPR_AND,
+    EXPR_OR,
+    EXPR_NOT,
+    EXPR_IS_NULL,
+    EXPR_AGGREGATE
+} ExprType;
+
+typedef enum {
+    LITERAL_INTEGER,
+    LITERAL_FLOAT,
+    LITERAL_STRING,
+    LITERAL_BOOLEAN,
+    LITERAL_NULL
+} LiteralKind;
+
+typedef enum {
+    COMPARE_EQ,
+    COMPARE_NE,
+    COMPARE_LT,
+    COMPARE_LE,
+    COMPARE_GT,
+    COMPARE_GE
+} CompareOp;
+
+typedef enum {
+    AGGREGATE_COUNT,
+    AGGREGATE_SUM,
+    AGGREGATE_MIN,
+    AGGREGATE_MAX,
+    AGGREGATE_AVG
+} AggregateFunction;
+
+
+// expression tree node. literals keep their text untyped; the executor gives
+// them the type of the column they are compared with when it resolves column
+// references against the schema (column_index and value).
+typedef struct Expr {
+    ExprType type;
+    CompareOp op;             // EXPR_COMPARE
+    int negated;              // EXPR_IS_NULL: IS NOT NULL
+    struct Expr* left;        // EXPR_COMPARE, EXPR_AND, EXPR_OR, EXPR_NOT, EXPR_IS_NULL, EXPR_AGGREGATE (NULL for COUNT(*))
+    struct Expr* right;
+    AggregateFunction function;    // EXPR_AGGREGATE
+    char table_name[MAX_NAME_LEN]; // EXPR_COLUMN qualifier, empty if none
+    char name[MAX_NAME_LEN];       // EXPR_COLUMN
+    LiteralKind literal_kind;      // EXPR_LITERAL
+    char* text;                    // EXPR_LITERAL, unescaped
+    uint16_t text_length;
+    int parameter_index;           // EXPR_PARAMETER, from 0 in statement order
+
+    // filled in by the executor
+    int column_index;
+    Value value;
+    int has_type;             // EXPR_PARAMETER: value.type is the type of the column it is used with
+} Expr;
+
+
+typedef struct {
+    Expr* expr;
+    int descending;
+} OrderByItem;
+
+typedef struct {
+    int select_star;
+    Expr** columns;
+    int num_columns;
+    char table_name[MAX_NAME_LEN];
+    char join_table_name[MAX_NAME_LEN]; // [INNER] JOIN, empty if none
+    Expr* join_condition;               // its ON condition
+    Expr* where;
+    Expr** group_by;          // columns
+    int num_group_by;
+    OrderByItem* order_by;
+    int num_order_by;
+    int64_t limit;            // -1 without LIMIT
+    int64_t offset;           // 0 without OFFSET
+} SelectStatement;
+
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    Expr*** rows;             // rows[i][j] is value j of row i
+    int num_rows;
+    int num_values;
+} InsertStatement;
+
+typedef struct {
+    char column_name[MAX_NAME_LEN];
+    Expr* value;
+} Assignment;
+
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    char* file_name;
+} CopyStatement;
+
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    Assignment* assignments;
+    int num_assignments;
+    Expr* where;
+} UpdateStatement;
+
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    Expr* where;
+} DeleteStatement;
+
+typedef struct {
+    char table_name[MAX_NAME_LEN];
+    ColumnSchema columns[MAX_COLUMNS_PER_TABLE];
+    int num_columns;
+} CreateTableStatement;
+
+typedef struct {
+    char index_name[MAX_NAME_LEN];
+    char table_name[MAX_NAME_LEN];
+    char column_name[MAX_NAME_LEN];
+    int is_unique;
+    char include_columns[MAX_COLUMNS_PER_TABLE][MAX_NAME_LEN];
+    int num_include_columns;
+} CreateIndexStatement;
+
+typedef struct {
+    char index_name[MAX_NAME_LEN];
+    char table_name[MAX_NAME_LEN];
+} DropIndexStatement;
+
+typedef struct {
+    char table_name[MAX_NAME_LEN]; // empty for every table
+} AnalyzeStatement;
+
+typedef enum {
+    STATEMENT_SELECT,
+    STATEMENT_INSERT,
+    STATEMENT_COPY,
+    STATEMENT_UPDATE,
+    STATEMENT_DELETE,
+    STATEMENT_CREATE_TABLE,
+    STATEMENT_CREATE_INDEX,
+    STATEMENT_DROP_INDEX,
+    STATEMENT_ANALYZE,
+    STATEMENT_BEGIN,
+    STATEMENT_COMMIT,
+    STATEMENT_ROLLBACK
+} StatementType;
+
+// the whole tree lives in the statement's arena and is freed with it
+typedef struct {
+    StatementType type;
+    int num_parameters;
+    Arena arena;
+    SelectStatement select;
+    InsertStatement insert;
+    CopyStatement copy;
+    UpdateStatement update;
+    DeleteStatement delete_;
+    CreateTableStatement create_table;
+    CreateIndexStatement create_index;
+    DropIndexStatement drop_index;
+    AnalyzeStatement analyze;
+} Statement;
+
+Statement* parse_statement(const char* sql);
+void statement_free(Statement* statement);
+
+#endif // PARSER_H
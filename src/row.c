@@ -0,0 +1,425 @@
+#include "row.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int is_variable_length(ColumnType type) {
+    return type == COLUMN_TYPE_VARCHAR || type == COLUMN_TYPE_TEXT;
+}
+
+static uint16_t fixed_width(ColumnType type) {
+    switch (type) {
+        case COLUMN_TYPE_INT:
+        case COLUMN_TYPE_DATE:
+        case COLUMN_TYPE_FLOAT:
+            return 4;
+        case COLUMN_TYPE_DOUBLE:
+        case COLUMN_TYPE_TIMESTAMP:
+            return 8;
+        case COLUMN_TYPE_BOOLEAN:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void row_layout_init(RowLayout* layout, const TableSchema* table) {
+    layout->num_columns = table->num_columns;
+    layout->num_var_columns = 0;
+
+    uint16_t offset = (table->num_columns + 7) / 8;
+    for (int i = 0; i < table->num_columns; i++) {
+        ColumnType type = table->columns[i].type;
+        layout->types[i] = type;
+        layout->max_lengths[i] = type == COLUMN_TYPE_VARCHAR ? table->columns[i].length : 0;
+        if (is_variable_length(type)) {
+            layout->offsets[i] = layout->num_var_columns++;
+        } else {
+            layout->offsets[i] = offset;
+            offset += fixed_width(type);
+        }
+    }
+    layout->var_table_offset = offset;
+    layout->header_size = offset + layout->num_var_columns * sizeof(uint16_t);
+}
+
+int row_is_null(const RowLayout* layout, const char* row, int column) {
+    (void)layout;
+    return (row[column / 8] >> (column % 8)) & 1;
+}
+
+// start and end of a variable-length column, from the row start
+static void var_bounds(const RowLayout* layout, const char* row, int column, uint16_t* start, uint16_t* end) {
+    uint16_t slot = layout->offsets[column];
+    const char* table = row + layout->var_table_offset;
+    memcpy(end, table + slot * sizeof(uint16_t), sizeof(uint16_t));
+    if (slot == 0) {
+        *start = layout->header_size;
+    } else {
+        memcpy(start, table + (slot - 1) * sizeof(uint16_t), sizeof(uint16_t));
+    }
+}
+
+int32_t row_get_int(const RowLayout* layout, const char* row, int column) {
+    int32_t value;
+    memcpy(&value, row + layout->offsets[column], sizeof(int32_t));
+    return value;
+}
+
+void row_get_value(const RowLayout* layout, const char* row, int column, Value* value) {
+    ColumnType type = layout->types[column];
+    value->type = type;
+    value->is_null = row_is_null(layout, row, column);
+    if (value->is_null) {
+        return;
+    }
+
+    const char* field = row + layout->offsets[column];
+    switch (type) {
+        case COLUMN_TYPE_INT:
+        case COLUMN_TYPE_DATE: {
+            int32_t v;
+            memcpy(&v, field, sizeof(int32_t));
+            value->int_value = v;
+            break;
+        }
+        case COLUMN_TYPE_TIMESTAMP: {
+            int64_t v;
+            memcpy(&v, field, sizeof(int64_t));
+            value->int_value = v;
+            break;
+        }
+        case COLUMN_TYPE_BOOLEAN:
+            value->int_value = field[0] != 0;
+            break;
+        case COLUMN_TYPE_FLOAT: {
+            float v;
+            memcpy(&v, field, sizeof(float));
+            value->double_value = v;
+            break;
+        }
+        case COLUMN_TYPE_DOUBLE:
+            memcpy(&value->double_value, field, sizeof(double));
+            break;
+        case COLUMN_TYPE_VARCHAR:
+        case COLUMN_TYPE_TEXT: {
+            uint16_t start;
+            uint16_t end;
+            var_bounds(layout, row, column, &start, &end);
+            value->text = row + start;
+            value->text_length = end - start;
+            break;
+        }
+    }
+}
+
+// encode one value per column into row, returns -1 if the row does not fit
+int row_encode(const RowLayout* layout, const Value* values, char* row, uint16_t* length) {
+    memset(row, 0, layout->header_size);
+    uint32_t end = layout->header_size;
+
+    for (int i = 0; i < layout->num_columns; i++) {
+        const Value* value = &values[i];
+        ColumnType type = layout->types[i];
+        if (value->is_null) {
+            row[i / 8] |= (char)(1 << (i % 8));
+        }
+
+        if (is_variable_length(type)) {
+            if (!value->is_null) {
+                if (layout->max_lengths[i] > 0 && value->text_length > layout->max_lengths[i]) {
+                    fprintf(stderr, "error: value too long for VARCHAR(%u) column.\n", layout->max_lengths[i]);
+                    return -1;
+                }
+                if (end + value->text_length > ROW_MAX_SIZE) {
+                    fprintf(stderr, "error: row exceeds %d bytes.\n", ROW_MAX_SIZE);
+                    return -1;
+                }
+                memcpy(row + end, value->text, value->text_length);
+                end += value->text_length;
+            }
+            uint16_t offset = (uint16_t)end;
+            memcpy(row + layout->var_table_offset + layout->offsets[i] * sizeof(uint16_t), &offset, sizeof(uint16_t));
+            continue;
+        }
+
+        if (value->is_null) {
+            continue;
+        }
+        char* field = row + layout->offsets[i];
+        if (type == COLUMN_TYPE_INT || type == COLUMN_TYPE_DATE) {
+            int32_t v = (int32_t)value->int_value;
+            memcpy(field, &v, sizeof(int32_t));
+        } else if (type == COLUMN_TYPE_TIMESTAMP) {
+            memcpy(field, &value->int_value, sizeof(int64_t));
+        } else if (type == COLUMN_TYPE_BOOLEAN) {
+            field[0] = value->int_value != 0;
+        } else if (type == COLUMN_TYPE_FLOAT) {
+            float v = (float)value->double_value;
+            memcpy(field, &v, sizeof(float));
+        } else if (type == COLUMN_TYPE_DOUBLE) {
+            memcpy(field, &value->double_value, sizeof(double));
+        }
+    }
+
+    *length = (uint16_t)end;
+    return 0;
+}
+
+// days between 1970-01-01 and a proleptic gregorian date
+static int64_t days_from_civil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static void civil_from_days(int64_t days, int64_t* year, int* month, int* day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t day_of_era = days - era * 146097;
+    int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64_t mp = (5 * day_of_year + 2) / 153;
+    *day = (int)(day_of_year - (153 * mp + 2) / 5 + 1);
+    *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *year = year_of_era + era * 400 + (*month <= 2);
+}
+
+static int days_in_month(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days[month - 1] + (month == 2 && leap);
+}
+
+static int parse_date(const char* text, int64_t* days, int* consumed) {
+    int year;
+    int month;
+    int day;
+    if (sscanf(text, "%d-%d-%d%n", &year, &month, &day, consumed) != 3 ||
+        month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+        return -1;
+    }
+    *days = days_from_civil(year, month, day);
+    return 0;
+}
+
+void value_set_null(Value* value, ColumnType type) {
+    memset(value, 0, sizeof(Value));
+    value->type = type;
+    value->is_null = 1;
+}
+
+// parse an unquoted literal as a value of the given column type
+int value_parse(Value* value, ColumnType type, const char* text, uint16_t text_length) {
+    memset(value, 0, sizeof(Value));
+    value->type = type;
+
+    if (type == COLUMN_TYPE_VARCHAR || type == COLUMN_TYPE_TEXT) {
+        value->text = text;
+        value->text_length = text_length;
+        return 0;
+    }
+
+    char buffer[64];
+    if (text_length >= sizeof(buffer)) {
+        fprintf(stderr, "error: invalid literal.\n");
+        return -1;
+    }
+    memcpy(buffer, text, text_length);
+    buffer[text_length] = '\0';
+
+    char* end = buffer;
+    switch (type) {
+        case COLUMN_TYPE_INT:
+            // stored as an int32, a wider value must not wrap
+            errno = 0;
+            value->int_value = strtoll(buffer, &end, 10);
+            if (end != buffer && (errno == ERANGE || value->int_value < INT32_MIN || value->int_value > INT32_MAX)) {
+                fprintf(stderr, "error: integer '%s' is out of range.\n", buffer);
+                return -1;
+            }
+            break;
+        case COLUMN_TYPE_FLOAT:
+        case COLUMN_TYPE_DOUBLE:
+            value->double_value = strtod(buffer, &end);
+            break;
+        case COLUMN_TYPE_BOOLEAN:
+            if (strcmp(buffer, "true") == 0 || strcmp(buffer, "TRUE") == 0 || strcmp(buffer, "1") == 0) {
+                value->int_value = 1;
+                end = buffer + text_length;
+            } else if (strcmp(buffer, "false") == 0 || strcmp(buffer, "FALSE") == 0 || strcmp(buffer, "0") == 0) {
+                value->int_value = 0;
+                end = buffer + text_length;
+            }
+            break;
+        case COLUMN_TYPE_DATE: {
+            int consumed = 0;
+            if (parse_date(buffer, &value->int_value, &consumed) == 0) {
+                end = buffer + consumed;
+            }
+            break;
+        }
+        case COLUMN_TYPE_TIMESTAMP: {
+            int64_t days;
+            int consumed = 0;
+            if (parse_date(buffer, &days, &consumed) != 0) {
+                break;
+            }
+            int hour = 0;
+            int minute = 0;
+            int second = 0;
+            int time_consumed = 0;
+            if (buffer[consumed] != '\0' &&
+                sscanf(buffer + consumed, " %d:%d:%d%n", &hour, &minute, &second, &time_consumed) != 3) {
+                break;
+            }
+            value->int_value = days * 86400 + hour * 3600 + minute * 60 + second;
+            end = buffer + consumed + time_consumed;
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (end == buffer || *end != '\0') {
+        fprintf(stderr, "error: invalid literal '%s'.\n", buffer);
+        return -1;
+    }
+    return 0;
+}
+
+int value_is_numeric(ColumnType type) {
+    return type != COLUMN_TYPE_VARCHAR && type != COLUMN_TYPE_TEXT;
+}
+
+static int is_floating(ColumnType type) {
+    return type == COLUMN_TYPE_FLOAT || type == COLUMN_TYPE_DOUBLE;
+}
+
+// order two non-null values: numbers numerically, text bytewise
+int value_compare(const Value* a, const Value* b) {
+    if (!value_is_numeric(a->type) || !value_is_numeric(b->type)) {
+        if (value_is_numeric(a->type) != value_is_numeric(b->type)) {
+            return value_is_numeric(a->type) ? -1 : 1;
+        }
+        uint16_t length = a->text_length < b->text_length ? a->text_length : b->text_length;
+        int cmp = memcmp(a->text, b->text, length);
+        if (cmp != 0) {
+            return cmp;
+        }
+        return (a->text_length > b->text_length) - (a->text_length < b->text_length);
+    }
+
+    if (is_floating(a->type) || is_floating(b->type)) {
+        double x = is_floating(a->type) ? a->double_value : (double)a->int_value;
+        double y = is_floating(b->type) ? b->double_value : (double)b->int_value;
+        // compare floats at the precision they are stored with
+        if (a->type == COLUMN_TYPE_FLOAT || b->type == COLUMN_TYPE_FLOAT) {
+            x = (float)x;
+            y = (float)y;
+        }
+        return (x > y) - (x < y);
+    }
+    return (a->int_value > b->int_value) - (a->int_value < b->int_value);
+}
+
+uint64_t value_hash(const Value* value) {
+    uint64_t hash;
+    if (!value_is_numeric(value->type)) {
+        // fnv-1a
+        hash = 14695981039346656037ULL;
+        for (uint16_t i = 0; i < value->text_length; i++) {
+            hash ^= (unsigned char)value->text[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+    if (is_floating(value->type)) {
+        double number = value->double_value == 0 ? 0 : value->double_value; // -0 equals 0
+        memcpy(&hash, &number, sizeof(uint64_t));
+    } else {
+        hash = (uint64_t)value->int_value;
+    }
+    // splitmix64 finalizer, so nearby keys spread over the whole range
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+// render a non-text value into buffer
+static void format_scalar(const Value* value, char* buffer, size_t size) {
+    switch (value->type) {
+        case COLUMN_TYPE_INT:
+            snprintf(buffer, size, "%lld", (long long)value->int_value);
+            break;
+        case COLUMN_TYPE_FLOAT:
+            snprintf(buffer, size, "%g", value->double_value);
+            break;
+        case COLUMN_TYPE_DOUBLE:
+            snprintf(buffer, size, "%.15g", value->double_value);
+            break;
+        case COLUMN_TYPE_BOOLEAN:
+            snprintf(buffer, size, "%s", value->int_value ? "true" : "false");
+            break;
+        case COLUMN_TYPE_DATE: {
+            int64_t year;
+            int month;
+            int day;
+            civil_from_days(value->int_value, &year, &month, &day);
+            snprintf(buffer, size, "%04lld-%02d-%02d", (long long)year, month, day);
+            break;
+        }
+        case COLUMN_TYPE_TIMESTAMP: {
+            int64_t days = value->int_value / 86400;
+            int64_t seconds = value->int_value % 86400;
+            if (seconds < 0) {
+                seconds += 86400;
+                days--;
+            }
+            int64_t year;
+            int month;
+            int day;
+            civil_from_days(days, &year, &month, &day);
+            snprintf(buffer, size, "%04lld-%02d-%02d %02d:%02d:%02d", (long long)year, month, day,
+                     (int)(seconds / 3600), (int)(seconds / 60 % 60), (int)(seconds % 60));
+            break;
+        }
+        default:
+            buffer[0] = '\0';
+            break;
+    }
+}
+
+// render a value as text in the arena, returns NULL for a null value
+char* value_format(Arena* arena, const Value* value) {
+    if (value->is_null) {
+        return NULL;
+    }
+    if (value->type == COLUMN_TYPE_VARCHAR || value->type == COLUMN_TYPE_TEXT) {
+        return arena_strndup(arena, value->text, value->text_length);
+    }
+
+    char buffer[64];
+    format_scalar(value, buffer, sizeof(buffer));
+    return arena_strndup(arena, buffer, strlen(buffer));
+}
+
+// write a value as text without allocating, NULL for a null value
+void value_print(FILE* out, const Value* value) {
+    if (value->is_null) {
+        fputs("NULL", out);
+    } else if (value->type == COLUMN_TYPE_VARCHAR || value->type == COLUMN_TYPE_TEXT) {
+        fwrite(value->text, 1, value->text_length, out);
+    } else {
+        char buffer[64];
+        format_scalar(value, buffer, sizeof(buffer));
+        fputs(buffer, out);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef ROW_H
+#define ROW_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "arena.h"
+#include "catalog.h"
+
+#define ROW_MAX_SIZE 1000 // matches BTREE_MAX_VALUE_SIZE, a row is one b-tree cell
+
+
+// rows are stored in the table b-tree in a binary format driven by the schema:
+//
+//   [null bitmap, one bit per column]
+//   [fixed-width columns at offsets precomputed from the schema]
+//   [uint16_t end offset of each variable-length column, from the row start]
+//   [variable-length column bytes]
+//
+// INT and DATE (days since 1970-01-01) are int32, TIMESTAMP is int64 seconds
+// since the epoch, FLOAT and DOUBLE are stored as such and BOOLEAN is one byte.
+// VARCHAR and TEXT are not NUL terminated. null columns keep their fixed slot
+// and have an empty variable-length part.
+typedef struct {
+    uint16_t num_columns;
+    uint16_t num_var_columns;
+    uint16_t var_table_offset;  // start of the variable-length offset table
+    uint16_t header_size;       // bytes before the first variable-length byte
+    ColumnType types[MAX_COLUMNS_PER_TABLE];
+    uint16_t max_lengths[MAX_COLUMNS_PER_TABLE]; // declared VARCHAR length, 0 if unbounded
+    uint16_t offsets[MAX_COLUMNS_PER_TABLE];     // fixed: byte offset, variable: slot in the offset table
+} RowLayout;
+
+
+// a single typed column value. text points into the row or literal it was read
+// from and is not NUL terminated.
+typedef struct {
+    ColumnType type;
+    int is_null;
+    int64_t int_value;    // INT, DATE, TIMESTAMP, BOOLEAN
+    double double_value;  // FLOAT, DOUBLE
+    const char* text;     // VARCHAR, TEXT
+    uint16_t text_length;
+} Value;
+
+void row_layout_init(RowLayout* layout, const TableSchema* table);
+
+int row_is_null(const RowLayout* layout, const char* row, int column);
+void row_get_value(const RowLayout* layout, const char* row, int column, Value* value);
+int32_t row_get_int(const RowLayout* layout, const char* row, int column);
+int row_encode(const RowLayout* layout, const Value* values, char* row, uint16_t* length);
+
+int value_parse(Value* value, ColumnType type, const char* text, uint16_t text_length);
+void value_set_null(Value* value, ColumnType type);
+int value_compare(const Value* a, const Value* b);
+// non-null values of the same type that compare equal hash the same
+uint64_t value_hash(const Value* value);
+char* value_format(Arena* arena, const Value* value);
+void value_print(FILE* out, const Value* value);
+int value_is_numeric(ColumnType type);
+
+#endif // ROW_H
@@ -0,0 +1,238 @@
+#include "simd.h"
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*SelectInt64Function)(const int64_t* values, int count, CompareOp op, int64_t constant, uint64_t* selection);
+typedef void (*SelectDoubleFunction)(const double* values, int count, CompareOp op, double constant, uint64_t* selection);
+
+// one selection word's worth of values at a time, the body sets bit i of word
+#define SELECT_SCALAR(condition)                       \
+    for (int base = 0; base < count; base += 64) {     \
+        int n = count - base < 64 ? count - base : 64; \
+        uint64_t word = 0;                             \
+        for (int i = 0; i < n; i++) {                  \
+            word |= (uint64_t)(condition) << i;        \
+        }                                              \
+        selection[base / 64] &= word;                  \
+    }
+
+static void select_int64_scalar(const int64_t* values, int count, CompareOp op, int64_t constant, uint64_t* selection) {
+    switch (op) {
+        case COMPARE_EQ: SELECT_SCALAR(values[base + i] == constant); break;
+        case COMPARE_NE: SELECT_SCALAR(values[base + i] != constant); break;
+        case COMPARE_LT: SELECT_SCALAR(values[base + i] < constant); break;
+        case COMPARE_LE: SELECT_SCALAR(values[base + i] <= constant); break;
+        case COMPARE_GT: SELECT_SCALAR(values[base + i] > constant); break;
+        case COMPARE_GE: SELECT_SCALAR(values[base + i] >= constant); break;
+    }
+}
+
+static void select_double_scalar(const double* values, int count, CompareOp op, double constant, uint64_t* selection) {
+    switch (op) {
+        case COMPARE_EQ: SELECT_SCALAR(values[base + i] == constant); break;
+        case COMPARE_NE: SELECT_SCALAR(values[base + i] != constant); break;
+        case COMPARE_LT: SELECT_SCALAR(values[base + i] < constant); break;
+        case COMPARE_LE: SELECT_SCALAR(values[base + i] <= constant); break;
+        case COMPARE_GT: SELECT_SCALAR(values[base + i] > constant); break;
+        case COMPARE_GE: SELECT_SCALAR(values[base + i] >= constant); break;
+    }
+}
+
+#undef SELECT_SCALAR
+
+#ifdef SIMD_HAVE_X86
+
+// integer compares only come as equal and greater than: the rest swap the
+// operands and/or invert the lane mask
+typedef struct {
+    int equal;
+    int swap;
+    int invert;
+} IntegerCompare;
+
+static IntegerCompare integer_compare(CompareOp op) {
+    IntegerCompare compare = {0, 0, 0};
+    switch (op) {
+        case COMPARE_EQ: compare.equal = 1; break;
+        case COMPARE_NE: compare.equal = 1; compare.invert = 1; break;
+        case COMPARE_GT: break;
+        case COMPARE_LE: compare.invert = 1; break;
+        case COMPARE_LT: compare.swap = 1; break;
+        case COMPARE_GE: compare.swap = 1; compare.invert = 1; break;
+    }
+    return compare;
+}
+
+// full selection words in vector registers, the tail of a batch in the scalar loop
+#define SELECT_VECTOR(lanes, lane_mask)         \
+    int base = 0;                               \
+    for (; base + 64 <= count; base += 64) {    \
+        uint64_t word = 0;                      \
+        for (int i = 0; i < 64; i += (lanes)) { \
+            word |= (uint64_t)(lane_mask) << i; \
+        }                                       \
+        selection[base / 64] &= word;           \
+    }
+
+__attribute__((target("avx2")))
+static void select_int64_avx2(const int64_t* values, int count, CompareOp op, int64_t constant, uint64_t* selection) {
+    IntegerCompare compare = integer_compare(op);
+    int invert = compare.invert ? 0xF : 0;
+    __m256i c = _mm256_set1_epi64x(constant);
+    if (compare.equal) {
+        SELECT_VECTOR(4, invert ^ _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(
+            _mm256_loadu_si256((const __m256i*)(values + base + i)), c))))
+        select_int64_scalar(values + base, count - base, op, constant, selection + base / 64);
+    } else if (compare.swap) {
+        SELECT_VECTOR(4, invert ^ _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(
+            c, _mm256_loadu_si256((const __m256i*)(values + base + i))))))
+        select_int64_scalar(values + base, count - base, op, constant, selection + base / 64);
+    } else {
+        SELECT_VECTOR(4, invert ^ _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(
+            _mm256_loadu_si256((const __m256i*)(values + base + i)), c))))
+        select_int64_scalar(values + base, count - base, op, constant, selection + base / 64);
+    }
+}
+
+#define SELECT_DOUBLE_AVX2(predicate)                                                                         \
+    {                                                                                                         \
+        SELECT_VECTOR(4, _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + base + i), c, predicate))) \
+        select_double_scalar(values + base, count - base, op, constant, selection + base / 64);               \
+    }
+
+__attribute__((target("avx2")))
+static void select_double_avx2(const double* values, int count, CompareOp op, double constant, uint64_t* selection) {
+    __m256d c = _mm256_set1_pd(constant);
+    // ordered predicates are false for NaN, NEQ_UQ is true, as in C
+    switch (op) {
+        case COMPARE_EQ: SELECT_DOUBLE_AVX2(_CMP_EQ_OQ); break;
+        case COMPARE_NE: SELECT_DOUBLE_AVX2(_CMP_NEQ_UQ); break;
+        case COMPARE_LT: SELECT_DOUBLE_AVX2(_CMP_LT_OQ); break;
+        case COMPARE_LE: SELECT_DOUBLE_AVX2(_CMP_LE_OQ); break;
+        case COMPARE_GT: SELECT_DOUBLE_AVX2(_CMP_GT_OQ); break;
+        case COMPARE_GE: SELECT_DOUBLE_AVX2(_CMP_GE_OQ); break;
+    }
+}
+
+__attribute__((target("sse4.2")))
+static void select_int64_sse42(const int64_t* values, int count, CompareOp op, int64_t constant, uint64_t* selection) {
+    IntegerCompare compare = integer_compare(op);
+    int invert = compare.invert ? 0x3 : 0;
+    __m128i c = _mm_set1_epi64x(constant);
+    if (compare.equal) {
+        SELECT_VECTOR(2, invert ^ _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(
+            _mm_loadu_si128((const __m128i*)(values + base + i)), c))))
+        select_int64_scalar(values + base, count - base, op, constant, selection + base / 64);
+    } else if (compare.swap) {
+        SELECT_VECTOR(2, invert ^ _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(
+            c, _mm_loadu_si128((const __m128i*)(values + base + i))))))
+        select_int64_scalar(values + base, count - base, op, constant, selection + base / 64);
+    } else {
+        SELECT_VECTOR(2, invert ^ _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(
+            _mm_loadu_si128((const __m128i*)(values + base + i)), c))))
+        select_int64_scalar(values + base, count - base, op, constant, selection + base / 64);
+    }
+}
+
+#define SELECT_DOUBLE_SSE(compare)                                                              \
+    {                                                                                           \
+        SELECT_VECTOR(2, _mm_movemask_pd(compare(_mm_loadu_pd(values + base + i), c)))          \
+        select_double_scalar(values + base, count - base, op, constant, selection + base / 64); \
+    }
+
+__attribute__((target("sse4.2")))
+static void select_double_sse42(const double* values, int count, CompareOp op, double constant, uint64_t* selection) {
+    __m128d c = _mm_set1_pd(constant);
+    switch (op) {
+        case COMPARE_EQ: SELECT_DOUBLE_SSE(_mm_cmpeq_pd); break;
+        case COMPARE_NE: SELECT_DOUBLE_SSE(_mm_cmpneq_pd); break;
+        case COMPARE_LT: SELECT_DOUBLE_SSE(_mm_cmplt_pd); break;
+        case COMPARE_LE: SELECT_DOUBLE_SSE(_mm_cmple_pd); break;
+        case COMPARE_GT: SELECT_DOUBLE_SSE(_mm_cmpgt_pd); break;
+        case COMPARE_GE: SELECT_DOUBLE_SSE(_mm_cmpge_pd); break;
+    }
+}
+
+#undef SELECT_DOUBLE_SSE
+#undef SELECT_DOUBLE_AVX2
+#undef SELECT_VECTOR
+
+#endif // SIMD_HAVE_X86
+
+static SimdLevel simd_detected = SIMD_SCALAR;
+static SimdLevel simd_active = SIMD_SCALAR;
+static SelectInt64Function select_int64 = select_int64_scalar;
+static SelectDoubleFunction select_double = select_double_scalar;
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+static void simd_set(SimdLevel level) {
+    simd_active = level;
+    switch (level) {
+#ifdef SIMD_HAVE_X86
+        case SIMD_AVX2:
+            select_int64 = select_int64_avx2;
+            select_double = select_double_avx2;
+            return;
+        case SIMD_SSE42:
+            select_int64 = select_int64_sse42;
+            select_double = select_double_sse42;
+            return;
+#endif
+        default:
+            select_int64 = select_int64_scalar;
+            select_double = select_double_scalar;
+            return;
+    }
+}
+
+static void simd_select(void) {
+#ifdef SIMD_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        simd_detected = SIMD_AVX2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        simd_detected = SIMD_SSE42;
+    }
+#endif
+    simd_set(simd_detected);
+}
+
+SimdLevel simd_level(void) {
+    pthread_once(&simd_once, simd_select);
+    return simd_detected;
+}
+
+SimdLevel simd_active_level(void) {
+    pthread_once(&simd_once, simd_select);
+    return simd_active;
+}
+
+int simd_use_level(SimdLevel level) {
+    if (level > simd_level()) {
+        return -1;
+    }
+    simd_set(level);
+    return 0;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+void simd_select_int64(const int64_t* values, int count, CompareOp op, int64_t constant, uint64_t* selection) {
+    pthread_once(&simd_once, simd_select);
+    select_int64(values, count, op, constant, selection);
+}
+
+void simd_select_double(const double* values, int count, CompareOp op, double constant, uint64_t* selection) {
+    pthread_once(&simd_once, simd_select);
+    select_double(values, count, op, constant, selection);
+}
@@ -0,0 +1,30 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include "parser.h"
+
+// filter kernels that compare a column of values against a constant and narrow
+// a selection bitmap, one bit per value (bit i of word i / 64). they use avx2 or
+// sse4.2 when the cpu has it, detected once at runtime, and plain loops
+// otherwise. every level gives the same answers.
+typedef enum {
+    SIMD_SCALAR,
+    SIMD_SSE42,
+    SIMD_AVX2
+} SimdLevel;
+
+// the best level this cpu supports
+SimdLevel simd_level(void);
+// the level the kernels below run at, the best one unless simd_use_level changed it
+SimdLevel simd_active_level(void);
+// run at a lower level, for tests and benchmarks. -1 if the cpu lacks it.
+int simd_use_level(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+// clear the bits of values for which "value op constant" is false. bits past
+// count in the last word touched are cleared too.
+void simd_select_int64(const int64_t* values, int count, CompareOp op, int64_t constant, uint64_t* selection);
+void simd_select_double(const double* values, int count, CompareOp op, double constant, uint64_t* selection);
+
+#endif // SIMD_H
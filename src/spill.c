@@ -0,0 +1,96 @@
+#include "spill.h"
+#include <stdlib.h>
+#include <string.h>
+
+// each value is its type and null flag, then for non-null values an int64,
+// a double or a uint16 length and the text bytes
+
+int spill_open(SpillFile* spill) {
+    memset(spill, 0, sizeof(SpillFile));
+    spill->file = tmpfile();
+    if (spill->file == NULL) {
+        fprintf(stderr, "error: unable to create a temporary file.\n");
+        return -1;
+    }
+    spill->buffer = (char*)malloc(SPILL_BUFFER_SIZE);
+    if (spill->buffer != NULL) {
+        setvbuf(spill->file, spill->buffer, _IOFBF, SPILL_BUFFER_SIZE);
+    }
+    return 0;
+}
+
+void spill_close(SpillFile* spill) {
+    if (spill->file != NULL) {
+        fclose(spill->file);
+    }
+    free(spill->buffer);
+    memset(spill, 0, sizeof(SpillFile));
+}
+
+int spill_write(SpillFile* spill, const Value* row, int num_columns) {
+    for (int i = 0; i < num_columns; i++) {
+        const Value* value = &row[i];
+        unsigned char header[2] = {(unsigned char)value->type, (unsigned char)value->is_null};
+        fwrite(header, 1, sizeof(header), spill->file);
+        if (value->is_null) {
+            continue;
+        }
+        if (!value_is_numeric(value->type)) {
+            fwrite(&value->text_length, sizeof(uint16_t), 1, spill->file);
+            fwrite(value->text, 1, value->text_length, spill->file);
+        } else if (value->type == COLUMN_TYPE_FLOAT || value->type == COLUMN_TYPE_DOUBLE) {
+            fwrite(&value->double_value, sizeof(double), 1, spill->file);
+        } else {
+            fwrite(&value->int_value, sizeof(int64_t), 1, spill->file);
+        }
+    }
+    if (ferror(spill->file)) {
+        fprintf(stderr, "error: unable to write a temporary file.\n");
+        return -1;
+    }
+    spill->num_rows++;
+    return 0;
+}
+
+int spill_rewind(SpillFile* spill) {
+    if (fflush(spill->file) != 0) {
+        fprintf(stderr, "error: unable to write a temporary file.\n");
+        return -1;
+    }
+    rewind(spill->file);
+    spill->reading = 1;
+    return 0;
+}
+
+int spill_read(SpillFile* spill, Value* row, int num_columns, Arena* arena) {
+    for (int i = 0; i < num_columns; i++) {
+        Value* value = &row[i];
+        unsigned char header[2];
+        if (fread(header, 1, sizeof(header), spill->file) != sizeof(header)) {
+            return 0;
+        }
+        memset(value, 0, sizeof(Value));
+        value->type = (ColumnType)header[0];
+        value->is_null = header[1];
+        if (value->is_null) {
+            continue;
+        }
+        size_t read;
+        if (!value_is_numeric(value->type)) {
+            if (fread(&value->text_length, sizeof(uint16_t), 1, spill->file) != 1) {
+                return 0;
+            }
+            char* text = (char*)arena_alloc(arena, value->text_length + 1u);
+            read = fread(text, 1, value->text_length, spill->file) == value->text_length;
+            value->text = text;
+        } else if (value->type == COLUMN_TYPE_FLOAT || value->type == COLUMN_TYPE_DOUBLE) {
+            read = fread(&value->double_value, sizeof(double), 1, spill->file);
+        } else {
+            read = fread(&value->int_value, sizeof(int64_t), 1, spill->file);
+        }
+        if (read != 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "arena.h"
+#include "row.h"
+
+#define SPILL_BUFFER_SIZE (16 * 4096) // written and read back in runs of pages
+
+
+// rows of typed values written to an anonymous temporary file and read back
+// in the order they were written, for operators whose input outgrows their
+// memory budget. the file is removed when it is closed.
+typedef struct {
+    FILE* file;
+    char* buffer;
+    int64_t num_rows;
+    int reading;
+} SpillFile;
+
+// 0 on success, -1 if no temporary file could be created
+int spill_open(SpillFile* spill);
+void spill_close(SpillFile* spill);
+
+int spill_write(SpillFile* spill, const Value* row, int num_columns);
+// switch from writing to reading from the first row. -1 if the rows written
+// could not all be flushed to the file.
+int spill_rewind(SpillFile* spill);
+// the next row, text copied into the arena. 1 if a row was read, 0 at the end.
+int spill_read(SpillFile* spill, Value* row, int num_columns, Arena* arena);
+
+#endif // SPILL_H
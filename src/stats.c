@@ -0,0 +1,194 @@
+#include "stats.h"
+#include "arena.h"
+#include "btree.h"
+#include "row.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// one column of the sample. key identifies a value for distinct counting:
+// integers as themselves, floating point by its bits and text by its hash.
+typedef struct {
+    uint64_t* keys;
+    double* numbers;
+    char* nulls;
+} SampleColumn;
+
+// xorshift64, enough to pick reservoir slots
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static int is_floating(ColumnType type) {
+    return type == COLUMN_TYPE_FLOAT || type == COLUMN_TYPE_DOUBLE;
+}
+
+static void sample_value(const Value* value, SampleColumn* column, int slot) {
+    column->nulls[slot] = (char)value->is_null;
+    column->numbers[slot] = 0;
+    if (value->is_null) {
+        column->keys[slot] = 0;
+    } else if (!value_is_numeric(value->type)) {
+        column->keys[slot] = value_hash(value);
+    } else if (is_floating(value->type)) {
+        double number = value->double_value == 0 ? 0 : value->double_value; // -0 equals 0
+        memcpy(&column->keys[slot], &number, sizeof(uint64_t));
+        column->numbers[slot] = number;
+    } else {
+        column->keys[slot] = (uint64_t)value->int_value;
+        column->numbers[slot] = (double)value->int_value;
+    }
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_numbers(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// distinct values among n sampled ones out of a population of total. a sample
+// of the whole table is counted exactly, otherwise the Duj1 estimator scales
+// the sample's distinct count by how many values it saw only once.
+static int64_t estimate_distinct(uint64_t* keys, int n, int64_t total) {
+    if (n == 0) {
+        return 0;
+    }
+    qsort(keys, n, sizeof(uint64_t), compare_keys);
+    int distinct = 0;
+    int singletons = 0;
+    for (int i = 0; i < n;) {
+        int j = i + 1;
+        while (j < n && keys[j] == keys[i]) {
+            j++;
+        }
+        distinct++;
+        singletons += j - i == 1;
+        i = j;
+    }
+    if (n >= total) {
+        return distinct;
+    }
+    double estimate = (double)n * distinct / (n - singletons + (double)singletons * n / total);
+    if (estimate > total) {
+        estimate = (double)total;
+    }
+    return estimate < distinct ? distinct : (int64_t)(estimate + 0.5);
+}
+
+// bounds[i] is the value i/HISTOGRAM_BUCKETS of the way through the sorted
+// sample, so each bucket holds about the same number of rows
+static void build_histogram(double* numbers, int n, ColumnStats* stats) {
+    stats->num_bounds = 0;
+    if (n == 0) {
+        return;
+    }
+    qsort(numbers, n, sizeof(double), compare_numbers);
+    for (int i = 0; i <= HISTOGRAM_BUCKETS; i++) {
+        stats->bounds[i] = numbers[(int64_t)i * (n - 1) / HISTOGRAM_BUCKETS];
+    }
+    stats->num_bounds = HISTOGRAM_BUCKETS + 1;
+}
+
+void stats_analyze_table(BufferPool* pool, Pager* pager, TableSchema* table) {
+    TableStats* stats = &table->stats;
+    RowLayout layout;
+    row_layout_init(&layout, table);
+    Arena arena;
+    arena_init(&arena);
+
+    SampleColumn columns[MAX_COLUMNS_PER_TABLE];
+    for (int c = 0; c < table->num_columns; c++) {
+        columns[c].keys = (uint64_t*)arena_alloc(&arena, sizeof(uint64_t) * ANALYZE_SAMPLE_SIZE);
+        columns[c].numbers = (double*)arena_alloc(&arena, sizeof(double) * ANALYZE_SAMPLE_SIZE);
+        columns[c].nulls = (char*)arena_alloc(&arena, ANALYZE_SAMPLE_SIZE);
+    }
+
+    // reservoir sampling: row k replaces a random slot with probability size / (k + 1)
+    uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+    int64_t num_rows = 0;
+    uint32_t num_pages = 0;
+    uint32_t last_page_id = 0;
+    BTreeCursor cursor;
+    for (btree_cursor_first(&cursor, pool, pager, table->root_page_id); btree_cursor_valid(&cursor);
+         btree_cursor_next(&cursor)) {
+        if (num_pages == 0 || cursor.page_id != last_page_id) {
+            num_pages++;
+            last_page_id = cursor.page_id;
+        }
+        int64_t slot = num_rows < ANALYZE_SAMPLE_SIZE ? num_rows : (int64_t)(next_random(&random_state) % (uint64_t)(num_rows + 1));
+        num_rows++;
+        if (slot >= ANALYZE_SAMPLE_SIZE) {
+            continue;
+        }
+        const char* row = btree_cursor_value(&cursor, NULL);
+        for (int c = 0; c < table->num_columns; c++) {
+            Value value;
+            row_get_value(&layout, row, c, &value);
+            sample_value(&value, &columns[c], (int)slot);
+        }
+    }
+    btree_cursor_close(&cursor);
+
+    memset(stats, 0, sizeof(TableStats));
+    stats->analyzed = 1;
+    stats->num_rows = num_rows;
+    stats->num_pages = num_pages;
+    int sample_size = num_rows < ANALYZE_SAMPLE_SIZE ? (int)num_rows : ANALYZE_SAMPLE_SIZE;
+    for (int c = 0; c < table->num_columns; c++) {
+        // pack the non-null values to the front
+        SampleColumn* column = &columns[c];
+        int n = 0;
+        int numbers = 0;
+        for (int i = 0; i < sample_size; i++) {
+            if (column->nulls[i]) {
+                continue;
+            }
+            column->keys[n++] = column->keys[i];
+            if (value_is_numeric(layout.types[c]) && !isnan(column->numbers[i])) {
+                column->numbers[numbers++] = column->numbers[i];
+            }
+        }
+        ColumnStats* column_stats = &stats->columns[c];
+        int64_t non_null = sample_size > 0 ? (int64_t)((double)n * num_rows / sample_size + 0.5) : 0;
+        column_stats->num_nulls = num_rows - non_null;
+        column_stats->num_distinct = estimate_distinct(column->keys, n, non_null);
+        if (value_is_numeric(layout.types[c])) {
+            build_histogram(column->numbers, numbers, column_stats);
+        }
+    }
+    arena_free(&arena);
+}
+
+double stats_fraction_below(const ColumnStats* stats, double x) {
+    if (stats->num_bounds < 2) {
+        return -1;
+    }
+    // whole buckets below x, plus the part of the one x falls in assuming
+    // its values are spread evenly
+    int buckets = stats->num_bounds - 1;
+    double below = 0;
+    for (int i = 0; i < buckets; i++) {
+        double low = stats->bounds[i];
+        double high = stats->bounds[i + 1];
+        if (x > high) {
+            below += 1;
+        } else {
+            if (x > low) {
+                below += (x - low) / (high - low);
+            }
+            break;
+        }
+    }
+    return below / buckets;
+}
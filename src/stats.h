@@ -0,0 +1,21 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "buffer.h"
+#include "catalog.h"
+
+#define ANALYZE_SAMPLE_SIZE 30000 // rows sampled per table, smaller tables are read whole
+
+
+// read a table once and refresh its statistics: the row and leaf page counts
+// are exact, distinct and null counts and the histograms come from a uniform
+// sample of the rows. the sample is seeded the same way on every run, so the
+// same table always gets the same statistics.
+void stats_analyze_table(BufferPool* pool, Pager* pager, TableSchema* table);
+
+// estimated fraction of a column's non-null values below x, from its histogram.
+// -1 if the column has none.
+double stats_fraction_below(const ColumnStats* stats, double x);
+
+#endif // STATS_H
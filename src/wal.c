@@ -1,12 +1,22 @@
 #include "wal.h"
-#include "btree.h"
+#include "page.h"
 #include "buffer.h"
+#include "btree.h"
+#include "crc32c.h"
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+#define WAL_READ_BUFFER_SIZE (1024 * 1024)
+#define WAL_MAX_RECORD_SIZE (64 * 1024 * 1024)
+#define WAL_REDO_BATCH_SIZE (256 * 1024)
+#define WAL_REDO_QUEUE_DEPTH 4
+
 Wal* wal_init(const char* filename) {
     int fd = open(filename, O_RDWR | O_CREAT | O_APPEND, S_IWUSR | S_IRUSR);
     if (fd == -1) {
@@ -19,205 +29,891 @@ Wal* wal_init(const char* filename) {
         return NULL;
     }
 
+    // the lsns of a log cut by a checkpoint are only known once recovery reads it
     wal->fd = fd;
-    wal->lsn = 0;
+    snprintf(wal->filename, sizeof(wal->filename), "%s", filename);
+    wal->base = 0;
+    wal->lsn = lseek(fd, 0, SEEK_END);
+    wal->last_tx_id = 0;
+    wal->buffer = NULL;
+    wal->buffer_capacity = 0;
+    memset(&wal->undo, 0, sizeof(UndoLog));
+    wal->undo_lsn = 0;
 
     return wal;
 }
 
+static void undo_log_clear(UndoLog* undo) {
+    for (int i = 0; i < undo->count; i++) {
+        free(undo->records[i].before_image);
+    }
+    undo->count = 0;
+}
+
+static void undo_log_free(UndoLog* undo) {
+    undo_log_clear(undo);
+    free(undo->records);
+    memset(undo, 0, sizeof(UndoLog));
+}
+
+static void undo_log_push(UndoLog* undo, const LogRecordHeader* header, const char* before_image) {
+    if (undo->count == undo->capacity) {
+        int capacity = undo->capacity == 0 ? 64 : undo->capacity * 2;
+        UndoRecord* records = (UndoRecord*)realloc(undo->records, sizeof(UndoRecord) * capacity);
+        if (records == NULL) {
+            fprintf(stderr, "error: unable to grow undo log of transaction %u.\n", header->tx_id);
+            return;
+        }
+        undo->records = records;
+        undo->capacity = capacity;
+    }
+
+    UndoRecord* record = &undo->records[undo->count++];
+    record->lsn = header->lsn;
+    record->type = header->type;
+    record->root_page_id = header->root_page_id;
+    record->key = header->key;
+    record->length = header->undo_len;
+    record->before_image = NULL;
+    if (header->undo_len > 0) {
+        record->before_image = (char*)malloc(header->undo_len);
+        memcpy(record->before_image, before_image, header->undo_len);
+    }
+}
+
+// each cell of an INSERT_BATCH or UPDATE_BATCH record is undone like an
+// insert or update of its own, so rollback and recovery reverse them one key
+// at a time, newest first
+static void undo_log_push_batch(UndoLog* undo, const LogRecordHeader* header, const char* payload) {
+    int update = (LogRecordType)header->type == LOG_RECORD_TYPE_UPDATE_BATCH;
+    const char* before_images = payload + header->value_len;
+    LogRecordHeader cell = *header;
+    cell.type = update ? LOG_RECORD_TYPE_UPDATE : LOG_RECORD_TYPE_INSERT;
+    cell.undo_len = 0;
+    uint32_t pos = 0;
+    uint32_t undo_pos = 0;
+    for (int i = 0; i < header->key && pos + sizeof(int32_t) + sizeof(uint16_t) <= header->value_len; i++) {
+        uint16_t length;
+        memcpy(&cell.key, payload + pos, sizeof(int32_t));
+        memcpy(&length, payload + pos + sizeof(int32_t), sizeof(uint16_t));
+        pos += sizeof(int32_t) + sizeof(uint16_t) + length;
+        if (!update) {
+            undo_log_push(undo, &cell, NULL);
+            continue;
+        }
+        if (undo_pos + sizeof(int32_t) + sizeof(uint16_t) > header->undo_len) {
+            break;
+        }
+        uint16_t old_length;
+        memcpy(&old_length, before_images + undo_pos + sizeof(int32_t), sizeof(uint16_t));
+        cell.undo_len = old_length;
+        undo_log_push(undo, &cell, before_images + undo_pos + sizeof(int32_t) + sizeof(uint16_t));
+        undo_pos += sizeof(int32_t) + sizeof(uint16_t) + old_length;
+    }
+}
+
 void wal_close(Wal* wal) {
     if (wal != NULL) {
         close(wal->fd);
+        free(wal->buffer);
+        undo_log_free(&wal->undo);
         free(wal);
     }
 }
 
-void wal_log_insert(Wal* wal, uint32_t tx_id, int key, const char* value) {
-    uint16_t value_len = strlen(value) + 1;
-    LogRecordHeader header = {wal->lsn++, (uint32_t)LOG_RECORD_TYPE_INSERT, tx_id, value_len};
-    write(wal->fd, &header, sizeof(LogRecordHeader));
-    write(wal->fd, &key, sizeof(int));
-    write(wal->fd, value, value_len);
+// discard the whole log, used when the data file it belongs to is created from scratch
+void wal_truncate(Wal* wal) {
+    ftruncate(wal->fd, 0);
+    wal->base = 0;
+    wal->lsn = 0;
+    wal->last_tx_id = 0;
+}
+
+static int wal_reserve(Wal* wal, uint32_t size) {
+    if (size <= wal->buffer_capacity) {
+        return 0;
+    }
+    char* buffer = (char*)realloc(wal->buffer, size);
+    if (buffer == NULL) {
+        return -1;
+    }
+    wal->buffer = buffer;
+    wal->buffer_capacity = size;
+    return 0;
+}
+
+static int is_row_record(LogRecordType type) {
+    return type == LOG_RECORD_TYPE_INSERT || type == LOG_RECORD_TYPE_DELETE || type == LOG_RECORD_TYPE_UPDATE;
+}
+
+static int is_batch_record(LogRecordType type) {
+    return type == LOG_RECORD_TYPE_INSERT_BATCH || type == LOG_RECORD_TYPE_UPDATE_BATCH;
+}
+
+static uint64_t record_length(const LogRecordHeader* header) {
+    return sizeof(LogRecordHeader) + (uint64_t)header->value_len + header->undo_len;
+}
+
+// write one record with a single write call. if value is NULL the payload has
+// already been staged in wal->buffer right after the header, and the
+// before-image after it if before_image is NULL too. row changes of
+// the running transaction are remembered in its undo log.
+static uint64_t wal_append(Wal* wal, LogRecordType type, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key,
+                           const char* value, uint32_t value_len, const char* before_image, uint32_t undo_len) {
+    uint32_t record_len = sizeof(LogRecordHeader) + value_len + undo_len;
+    if (wal_reserve(wal, record_len) != 0) {
+        fprintf(stderr, "error: unable to allocate wal record buffer.\n");
+        return wal->lsn;
+    }
+
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(LogRecordHeader));
+    header.lsn = wal->lsn + record_len;
+    header.length = record_len;
+    header.type = (uint32_t)type;
+    header.tx_id = tx_id;
+    header.page_id = page_id;
+    header.root_page_id = root_page_id;
+    header.key = key;
+    header.value_len = value_len;
+    header.undo_len = undo_len;
+    if (is_row_record(type)) {
+        header.undo_lsn = wal->undo_lsn;
+    }
+
+    memcpy(wal->buffer, &header, sizeof(LogRecordHeader));
+    if (value != NULL && value_len > 0) {
+        memcpy(wal->buffer + sizeof(LogRecordHeader), value, value_len);
+    }
+    if (before_image != NULL && undo_len > 0) {
+        memcpy(wal->buffer + sizeof(LogRecordHeader) + value_len, before_image, undo_len);
+    }
+    header.crc = crc32c(0, wal->buffer, record_len);
+    memcpy(wal->buffer + offsetof(LogRecordHeader, crc), &header.crc, sizeof(uint32_t));
+    write(wal->fd, wal->buffer, record_len);
+    wal->lsn = header.lsn;
+
+    if (is_row_record(type) && header.undo_lsn == 0 && tx_id != 0 && tx_id == wal->undo.tx_id) {
+        undo_log_push(&wal->undo, &header, before_image);
+    }
+    return header.lsn;
+}
+
+uint64_t wal_log_insert(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key, const char* value, uint16_t value_len) {
+    return wal_append(wal, LOG_RECORD_TYPE_INSERT, tx_id, root_page_id, page_id, key, value, value_len, NULL, 0);
+}
+
+uint64_t wal_log_delete(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key, const char* old_value, uint16_t old_len) {
+    return wal_append(wal, LOG_RECORD_TYPE_DELETE, tx_id, root_page_id, page_id, key, NULL, 0, old_value, old_len);
+}
+
+uint64_t wal_log_update(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key, const char* value, uint16_t value_len, const char* old_value, uint16_t old_len) {
+    return wal_append(wal, LOG_RECORD_TYPE_UPDATE, tx_id, root_page_id, page_id, key, value, value_len, old_value, old_len);
+}
+
+static uint32_t cells_length(const uint16_t* lengths, int count) {
+    uint32_t length = 0;
+    for (int i = 0; i < count; i++) {
+        length += sizeof(int32_t) + sizeof(uint16_t) + lengths[i];
+    }
+    return length;
+}
+
+// stage (key, length, value) cells at out, returns the end of them
+static char* stage_cells(char* out, const int* keys, const char* const* values, const uint16_t* lengths, int count) {
+    for (int i = 0; i < count; i++) {
+        int32_t key = keys[i];
+        memcpy(out, &key, sizeof(int32_t));
+        memcpy(out + sizeof(int32_t), &lengths[i], sizeof(uint16_t));
+        memcpy(out + sizeof(int32_t) + sizeof(uint16_t), values[i], lengths[i]);
+        out += sizeof(int32_t) + sizeof(uint16_t) + lengths[i];
+    }
+    return out;
 }
 
-void wal_log_delete(Wal* wal, uint32_t tx_id, int key) {
-    LogRecordHeader header = {wal->lsn++, (uint32_t)LOG_RECORD_TYPE_DELETE, tx_id, 0};
-    write(wal->fd, &header, sizeof(LogRecordHeader));
-    write(wal->fd, &key, sizeof(int));
+// append a batch record whose cells are staged in wal->buffer and remember its
+// cells in the running transaction's undo log
+static uint64_t wal_append_batch(Wal* wal, LogRecordType type, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id,
+                                 int count, uint32_t value_len, uint32_t undo_len) {
+    uint64_t lsn = wal_append(wal, type, tx_id, root_page_id, page_id, count, NULL, value_len, NULL, undo_len);
+    if (tx_id != 0 && tx_id == wal->undo.tx_id) {
+        LogRecordHeader header;
+        memcpy(&header, wal->buffer, sizeof(LogRecordHeader));
+        undo_log_push_batch(&wal->undo, &header, wal->buffer + sizeof(LogRecordHeader));
+    }
+    return lsn;
 }
 
-void wal_log_update(Wal* wal, uint32_t tx_id, int key, const char* value) {
-    uint16_t value_len = strlen(value) + 1;
-    LogRecordHeader header = {wal->lsn++, (uint32_t)LOG_RECORD_TYPE_UPDATE, tx_id, value_len};
-    write(wal->fd, &header, sizeof(LogRecordHeader));
-    write(wal->fd, &key, sizeof(int));
-    write(wal->fd, value, value_len);
+uint64_t wal_log_insert_batch(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, const int* keys,
+                              const char* const* values, const uint16_t* lengths, int count) {
+    uint32_t value_len = cells_length(lengths, count);
+    if (wal_reserve(wal, sizeof(LogRecordHeader) + value_len) != 0) {
+        fprintf(stderr, "error: unable to allocate wal record buffer.\n");
+        return wal->lsn;
+    }
+    stage_cells(wal->buffer + sizeof(LogRecordHeader), keys, values, lengths, count);
+    return wal_append_batch(wal, LOG_RECORD_TYPE_INSERT_BATCH, tx_id, root_page_id, page_id, count, value_len, 0);
+}
+
+uint64_t wal_log_update_batch(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, const int* keys,
+                              const char* const* values, const uint16_t* lengths, const char* const* old_values,
+                              const uint16_t* old_lengths, int count) {
+    uint32_t value_len = cells_length(lengths, count);
+    uint32_t undo_len = cells_length(old_lengths, count);
+    if (wal_reserve(wal, sizeof(LogRecordHeader) + value_len + undo_len) != 0) {
+        fprintf(stderr, "error: unable to allocate wal record buffer.\n");
+        return wal->lsn;
+    }
+    char* before_images = stage_cells(wal->buffer + sizeof(LogRecordHeader), keys, values, lengths, count);
+    stage_cells(before_images, keys, old_values, old_lengths, count);
+    return wal_append_batch(wal, LOG_RECORD_TYPE_UPDATE_BATCH, tx_id, root_page_id, page_id, count, value_len, undo_len);
+}
+
+uint64_t wal_log_page_images(Wal* wal, uint32_t tx_id, const uint32_t* page_ids, Page** pages, int count) {
+    uint32_t value_len = count * (sizeof(uint32_t) + PAGE_SIZE);
+    if (wal_reserve(wal, sizeof(LogRecordHeader) + value_len) != 0) {
+        fprintf(stderr, "error: unable to allocate wal record buffer.\n");
+        return wal->lsn;
+    }
+
+    char* payload = wal->buffer + sizeof(LogRecordHeader);
+    for (int i = 0; i < count; i++) {
+        memcpy(payload, &page_ids[i], sizeof(uint32_t));
+        memcpy(payload + sizeof(uint32_t), pages[i], PAGE_SIZE);
+        payload += sizeof(uint32_t) + PAGE_SIZE;
+    }
+
+    return wal_append(wal, LOG_RECORD_TYPE_PAGE_IMAGE, tx_id, 0, page_ids[0], 0, NULL, value_len, NULL, 0);
 }
 
 void wal_log_commit(Wal* wal, uint32_t tx_id) {
-    LogRecordHeader header = {wal->lsn++, (uint32_t)LOG_RECORD_TYPE_COMMIT, tx_id, 0};
-    write(wal->fd, &header, sizeof(LogRecordHeader));
+    wal_append(wal, LOG_RECORD_TYPE_COMMIT, tx_id, 0, 0, 0, NULL, 0, NULL, 0);
+    // pages are written back later, so only the log makes the commit durable
+    wal_sync(wal);
+    if (tx_id == wal->undo.tx_id) {
+        undo_log_clear(&wal->undo);
+        wal->undo.tx_id = 0;
+    }
+}
+
+int wal_sync(Wal* wal) {
+    if (fsync(wal->fd) != 0) {
+        fprintf(stderr, "error: unable to sync %s.\n", wal->filename);
+        return -1;
+    }
+    return 0;
 }
 
 void wal_log_begin(Wal* wal, uint32_t tx_id) {
-    LogRecordHeader header = {wal->lsn++, LOG_RECORD_TYPE_BEGIN, tx_id, 0};
-    write(wal->fd, &header, sizeof(LogRecordHeader));
+    if (tx_id > wal->last_tx_id) {
+        wal->last_tx_id = tx_id;
+    }
+    undo_log_clear(&wal->undo);
+    wal->undo.tx_id = tx_id;
+    wal_append(wal, LOG_RECORD_TYPE_BEGIN, tx_id, 0, 0, 0, NULL, 0, NULL, 0);
 }
 
-uint32_t* wal_get_committed_tx_ids(Wal* wal, int* count) {
-    lseek(wal->fd, 0, SEEK_SET);
-    uint32_t* committed_tx_ids = NULL;
-    *count = 0;
+void wal_log_abort(Wal* wal, uint32_t tx_id) {
+    wal_append(wal, LOG_RECORD_TYPE_ABORT, tx_id, 0, 0, 0, NULL, 0, NULL, 0);
+    if (tx_id == wal->undo.tx_id) {
+        undo_log_clear(&wal->undo);
+        wal->undo.tx_id = 0;
+    }
+}
 
-    LogRecordHeader header;
-    while (read(wal->fd, &header, sizeof(LogRecordHeader)) > 0) {
-        
-        if ((LogRecordType)header.type == LOG_RECORD_TYPE_COMMIT) {
-            (*count)++;
-            committed_tx_ids = (uint32_t*)realloc(committed_tx_ids, sizeof(uint32_t) * (*count));
-            committed_tx_ids[*count - 1] = header.tx_id;
-        } else if ((LogRecordType)header.type == LOG_RECORD_TYPE_INSERT) {
-            int key;
-            char value[256];
-            read(wal->fd, &key, sizeof(int));
-            if (header.value_len > 0) {
-                if (header.value_len > 255) {
-                    // skip oversized value
-                    lseek(wal->fd, header.value_len, SEEK_CUR);
-                } else {
-                    read(wal->fd, value, header.value_len);
-                    value[header.value_len] = '\0'; 
-                }
+// make a rename in the directory holding the log durable
+static int sync_directory(const Wal* wal) {
+    char directory[sizeof(wal->filename)];
+    snprintf(directory, sizeof(directory), "%s", wal->filename);
+    char* slash = strrchr(directory, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else {
+        slash[slash == directory ? 1 : 0] = '\0';
+    }
+    int fd = open(directory, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+    int status = fsync(fd);
+    close(fd);
+    return status;
+}
+
+// nothing logged so far is needed any more, so the log is replaced by the
+// CHECKPOINT record alone. it is written to a file of its own, synced and
+// renamed over the log, so a crash leaves either log whole. if that fails the
+// record is appended to the log instead.
+void wal_log_checkpoint(Wal* wal) {
+    char filename[sizeof(wal->filename) + 4];
+    snprintf(filename, sizeof(filename), "%s.new", wal->filename);
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, S_IWUSR | S_IRUSR);
+    if (fd != -1) {
+        int log_fd = wal->fd;
+        uint64_t log_lsn = wal->lsn;
+        wal->fd = fd;
+        uint64_t lsn = wal_append(wal, LOG_RECORD_TYPE_CHECKPOINT, wal->last_tx_id, 0, 0, 0, NULL, 0, NULL, 0);
+        if (lseek(fd, 0, SEEK_END) == (off_t)sizeof(LogRecordHeader) && fsync(fd) == 0 &&
+            rename(filename, wal->filename) == 0) {
+            close(log_fd);
+            wal->base = lsn - sizeof(LogRecordHeader);
+            if (sync_directory(wal) != 0) {
+                fprintf(stderr, "warning: unable to sync the directory of %s.\n", wal->filename);
             }
-        } else if ((LogRecordType)header.type == LOG_RECORD_TYPE_DELETE) {
-            int key;
-            read(wal->fd, &key, sizeof(int));
+            return;
         }
+        close(fd);
+        unlink(filename);
+        wal->fd = log_fd;
+        wal->lsn = log_lsn;
     }
-    return committed_tx_ids;
+    wal_append(wal, LOG_RECORD_TYPE_CHECKPOINT, wal->last_tx_id, 0, 0, 0, NULL, 0, NULL, 0);
 }
 
-void wal_recover(BufferPool* pool, Pager* pager, Wal* wal, uint32_t root_page_id) {
-    int num_committed_tx = 0;
-    uint32_t* committed_tx_ids = wal_get_committed_tx_ids(wal, &num_committed_tx);
+// reverse the running transaction's changes newest first through the b-tree,
+// logging each reversal as a compensation record, then log the abort. the
+// work is proportional to the size of the transaction and leaves the buffer
+// pool warm.
+void wal_rollback(Wal* wal, BufferPool* pool, Pager* pager, uint32_t tx_id) {
+    UndoLog* undo = &wal->undo;
+    if (undo->tx_id != tx_id) {
+        undo_log_clear(undo);
+    }
+    wal_rollback_to(wal, pool, pager, tx_id, 0);
+    undo->tx_id = tx_id;
+    wal_log_abort(wal, tx_id);
+}
 
-    
+void wal_rollback_to(Wal* wal, BufferPool* pool, Pager* pager, uint32_t tx_id, int count) {
+    UndoLog* undo = &wal->undo;
+    while (undo->count > count) {
+        UndoRecord* record = &undo->records[undo->count - 1];
+        wal->undo_lsn = record->lsn;
+        if (record->before_image == NULL) {
+            btree_delete(pool, pager, wal, tx_id, record->root_page_id, record->key);
+        } else {
+            btree_insert(pool, pager, wal, tx_id, record->root_page_id, record->key, record->before_image, (uint16_t)record->length);
+        }
+        wal->undo_lsn = 0;
+        free(record->before_image);
+        undo->count--;
+    }
+}
 
-    lseek(wal->fd, 0, SEEK_SET);
+// sequential reader that hands out whole records from a large buffer
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    uint64_t offset; // log offset of buffer[start]
+    uint64_t base;   // lsn at log offset 0
+} WalReader;
 
-    LogRecordHeader header;
-    while (read(wal->fd, &header, sizeof(LogRecordHeader)) > 0) {
-        
-        int is_committed = 0;
-        for (int i = 0; i < num_committed_tx; i++) {
-            if (header.tx_id == committed_tx_ids[i]) {
-                is_committed = 1;
-                break;
+// read the log from offset, which is the end of a valid record or 0. base is
+// the log's lsn at offset 0; read from 0 it is taken from a leading checkpoint.
+static int wal_reader_init(WalReader* reader, int fd, uint64_t base, uint64_t offset) {
+    reader->fd = fd;
+    reader->base = base;
+    reader->buffer = (char*)malloc(WAL_READ_BUFFER_SIZE);
+    reader->capacity = WAL_READ_BUFFER_SIZE;
+    reader->start = 0;
+    reader->end = 0;
+    reader->offset = offset;
+    return reader->buffer == NULL ? -1 : 0;
+}
+
+// make at least size bytes available at buffer[start], returns 0 at end of log
+static int wal_reader_fill(WalReader* reader, size_t size) {
+    if (reader->end - reader->start >= size) {
+        return 1;
+    }
+
+    memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+    reader->end -= reader->start;
+    reader->start = 0;
+
+    if (size > reader->capacity) {
+        char* buffer = (char*)realloc(reader->buffer, size);
+        if (buffer == NULL) {
+            return 0;
+        }
+        reader->buffer = buffer;
+        reader->capacity = size;
+    }
+
+    while (reader->end < size) {
+        ssize_t bytes = pread(reader->fd, reader->buffer + reader->end, reader->capacity - reader->end,
+                              reader->offset + reader->end);
+        if (bytes <= 0) {
+            return 0;
+        }
+        reader->end += bytes;
+    }
+    return 1;
+}
+
+// returns 1 and the next record, or 0 at the end of the log or at the first
+// record that is incomplete, inconsistent with its position or fails its crc.
+// reader->offset is then the end of the valid part of the log.
+static int wal_reader_next(WalReader* reader, LogRecordHeader* header, const char** payload) {
+    if (!wal_reader_fill(reader, sizeof(LogRecordHeader))) {
+        return 0;
+    }
+    memcpy(header, reader->buffer + reader->start, sizeof(LogRecordHeader));
+
+    uint64_t record_len = record_length(header);
+    if (reader->offset == 0 && (LogRecordType)header->type == LOG_RECORD_TYPE_CHECKPOINT && header->lsn >= record_len) {
+        reader->base = header->lsn - record_len;
+    }
+    if (header->value_len > WAL_MAX_RECORD_SIZE || header->undo_len > WAL_MAX_RECORD_SIZE ||
+        header->length != record_len || header->lsn != reader->base + reader->offset + record_len) {
+        return 0;
+    }
+    if (!wal_reader_fill(reader, record_len)) {
+        return 0;
+    }
+
+    char* record = reader->buffer + reader->start;
+    uint32_t zero = 0;
+    uint32_t crc = crc32c(0, record, offsetof(LogRecordHeader, crc));
+    crc = crc32c(crc, &zero, sizeof(uint32_t));
+    crc = crc32c(crc, record + offsetof(LogRecordHeader, crc) + sizeof(uint32_t),
+                 record_len - offsetof(LogRecordHeader, crc) - sizeof(uint32_t));
+    if (crc != header->crc) {
+        return 0;
+    }
+
+    *payload = record + sizeof(LogRecordHeader);
+    reader->start += record_len;
+    reader->offset += record_len;
+    return 1;
+}
+
+static void wal_reader_free(WalReader* reader) {
+    free(reader->buffer);
+}
+
+static void ensure_page_allocated(Pager* pager, uint32_t page_id) {
+    if (page_id >= pager->next_page_id) {
+        pager->next_page_id = page_id + 1;
+    }
+}
+
+static int is_data_record(LogRecordType type) {
+    return is_row_record(type) || type == LOG_RECORD_TYPE_PAGE_IMAGE || is_batch_record(type);
+}
+
+// transactions that began but have not committed or aborted yet, with the
+// changes still to be undone if they never do
+typedef struct {
+    UndoLog* logs;
+    int count;
+    int capacity;
+} ActiveTransactions;
+
+static UndoLog* active_find(ActiveTransactions* active, uint32_t tx_id) {
+    for (int i = 0; i < active->count; i++) {
+        if (active->logs[i].tx_id == tx_id) {
+            return &active->logs[i];
+        }
+    }
+    return NULL;
+}
+
+static void active_begin(ActiveTransactions* active, uint32_t tx_id) {
+    if (active_find(active, tx_id) != NULL) {
+        return;
+    }
+    if (active->count == active->capacity) {
+        active->capacity = active->capacity == 0 ? 4 : active->capacity * 2;
+        active->logs = (UndoLog*)realloc(active->logs, sizeof(UndoLog) * active->capacity);
+    }
+    memset(&active->logs[active->count], 0, sizeof(UndoLog));
+    active->logs[active->count].tx_id = tx_id;
+    active->count++;
+}
+
+static void active_end(ActiveTransactions* active, uint32_t tx_id) {
+    UndoLog* undo = active_find(active, tx_id);
+    if (undo == NULL) {
+        return;
+    }
+    undo_log_free(undo);
+    *undo = active->logs[--active->count];
+}
+
+// track what a row change means for its transaction's pending undo work. a
+// compensation record retires the newest change it reverses.
+static void active_track(ActiveTransactions* active, const LogRecordHeader* header, const char* payload) {
+    UndoLog* undo = active_find(active, header->tx_id);
+    if (undo == NULL) {
+        return;
+    }
+    if (is_batch_record((LogRecordType)header->type)) {
+        undo_log_push_batch(undo, header, payload);
+    } else if (header->undo_lsn == 0) {
+        undo_log_push(undo, header, payload + header->value_len);
+    } else if (undo->count > 0 && undo->records[undo->count - 1].lsn == header->undo_lsn) {
+        free(undo->records[undo->count - 1].before_image);
+        undo->count--;
+    }
+}
+
+// grow the file to cover every page a record touches. done by the reading
+// thread so redo workers never modify the pager.
+static void allocate_record_pages(Pager* pager, const LogRecordHeader* header, const char* payload) {
+    if ((LogRecordType)header->type != LOG_RECORD_TYPE_PAGE_IMAGE) {
+        ensure_page_allocated(pager, header->page_id);
+        return;
+    }
+    uint32_t image_size = sizeof(uint32_t) + PAGE_SIZE;
+    for (uint32_t pos = 0; pos + image_size <= header->value_len; pos += image_size) {
+        uint32_t page_id;
+        memcpy(&page_id, payload + pos, sizeof(uint32_t));
+        ensure_page_allocated(pager, page_id);
+    }
+}
+
+// apply one data record to its page unless the page already reflects it. with
+// num_workers > 1 only the pages owned by worker (page_id % num_workers) are touched.
+// -1 if a page could not be read.
+static int wal_redo_record(BufferPool* pool, Pager* pager, const LogRecordHeader* header, const char* payload, int worker, int num_workers) {
+    LogRecordType type = (LogRecordType)header->type;
+
+    if (type == LOG_RECORD_TYPE_PAGE_IMAGE) {
+        uint32_t image_size = sizeof(uint32_t) + PAGE_SIZE;
+        for (uint32_t pos = 0; pos + image_size <= header->value_len; pos += image_size) {
+            uint32_t page_id;
+            memcpy(&page_id, payload + pos, sizeof(uint32_t));
+            if ((int)(page_id % num_workers) != worker) {
+                continue;
+            }
+
+            Page* page = buffer_pool_get_page(pool, pager, page_id);
+            if (page == NULL) {
+                return -1;
             }
+            if (page->header.page_lsn >= header->lsn) {
+                buffer_pool_unpin_page(pool, pager, page_id, 0);
+                continue;
+            }
+            memcpy(page, payload + pos + sizeof(uint32_t), PAGE_SIZE);
+            page->header.page_lsn = header->lsn;
+            buffer_pool_unpin_page(pool, pager, page_id, 1);
         }
+        return 0;
+    }
+
+    if (!is_data_record(type) || (int)(header->page_id % num_workers) != worker) {
+        return 0;
+    }
+
+    Page* page = buffer_pool_get_page(pool, pager, header->page_id);
+    if (page == NULL) {
+        return -1;
+    }
+    if (page->header.page_lsn >= header->lsn) {
+        buffer_pool_unpin_page(pool, pager, header->page_id, 0);
+        return 0;
+    }
 
-        if (is_committed) {
-            
-            if ((LogRecordType)header.type == LOG_RECORD_TYPE_INSERT) {
-                int key;
-                char value[256];
-                read(wal->fd, &key, sizeof(int));
-                if (header.value_len > 0) {
-                    if (header.value_len > 255) {
-                        // skip oversized value
-                        lseek(wal->fd, header.value_len, SEEK_CUR);
-                        value[0] = '\0'; 
-                    } else {
-                        read(wal->fd, value, header.value_len);
-                        value[header.value_len] = '\0'; 
-                    }
-                }
-                
-                btree_insert(pool, pager, root_page_id, key, value, 0);
-            } else if ((LogRecordType)header.type == LOG_RECORD_TYPE_DELETE) {
-                int key;
-                read(wal->fd, &key, sizeof(int));
-                btree_delete(pool, pager, root_page_id, key, 0);
-            } else if ((LogRecordType)header.type == LOG_RECORD_TYPE_UPDATE) {
-                int key;
-                char value[256];
-                read(wal->fd, &key, sizeof(int));
-                if (header.value_len > 0) {
-                    if (header.value_len > 255) {
-                        // skip oversized value
-                        lseek(wal->fd, header.value_len, SEEK_CUR);
-                        value[0] = '\0'; 
-                    } else {
-                        read(wal->fd, value, header.value_len);
-                        value[header.value_len] = '\0'; 
-                    }
-                }
-                btree_delete(pool, pager, root_page_id, key, 0);
-                btree_insert(pool, pager, root_page_id, key, value, 0);
+    if (is_batch_record(type)) {
+        uint32_t pos = 0;
+        for (int i = 0; i < header->key && pos + sizeof(int32_t) + sizeof(uint16_t) <= header->value_len; i++) {
+            int32_t key;
+            uint16_t length;
+            memcpy(&key, payload + pos, sizeof(int32_t));
+            memcpy(&length, payload + pos + sizeof(int32_t), sizeof(uint16_t));
+            const char* value = payload + pos + sizeof(int32_t) + sizeof(uint16_t);
+            pos += sizeof(int32_t) + sizeof(uint16_t) + length;
+            int found;
+            int slot = page_find_cell(page, key, &found);
+            if (found) {
+                page_update_cell(page, slot, value, length);
+            } else {
+                page_insert_cell(page, slot, key, value, length);
             }
-        } else { // skip uncommitted data
-            
-            if ((LogRecordType)header.type == LOG_RECORD_TYPE_INSERT) {
-                int key;
-                char value[256];
-                read(wal->fd, &key, sizeof(int));
-                if (header.value_len > 0) {
-                    read(wal->fd, value, header.value_len);
-                }
-            } else if ((LogRecordType)header.type == LOG_RECORD_TYPE_DELETE) {
-                int key;
-                read(wal->fd, &key, sizeof(int));
+        }
+        page->header.page_lsn = header->lsn;
+        buffer_pool_unpin_page(pool, pager, header->page_id, 1);
+        return 0;
+    }
+
+    int found;
+    int slot = page_find_cell(page, header->key, &found);
+    if (type == LOG_RECORD_TYPE_DELETE) {
+        if (found) {
+            page_delete_cell(page, slot);
+        }
+    } else if (found) {
+        page_update_cell(page, slot, payload, (uint16_t)header->value_len);
+    } else {
+        page_insert_cell(page, slot, header->key, payload, (uint16_t)header->value_len);
+    }
+    page->header.page_lsn = header->lsn;
+    buffer_pool_unpin_page(pool, pager, header->page_id, 1);
+    return 0;
+}
+
+// records destined for one redo worker, stored back to back as header + payload
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} RedoBatch;
+
+typedef struct {
+    pthread_t thread;
+    BufferPool* pool;
+    Pager* pager;
+    int worker;
+    int num_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    RedoBatch* queue[WAL_REDO_QUEUE_DEPTH];
+    int queue_head;
+    int queue_count;
+    int finished;
+    int failed;         // a record could not be redone; later batches are only drained
+    RedoBatch* pending; // batch currently being filled by the reader
+} RedoWorker;
+
+static void* redo_worker_main(void* arg) {
+    RedoWorker* worker = (RedoWorker*)arg;
+
+    while (1) {
+        pthread_mutex_lock(&worker->lock);
+        while (worker->queue_count == 0 && !worker->finished) {
+            pthread_cond_wait(&worker->cond, &worker->lock);
+        }
+        if (worker->queue_count == 0) {
+            pthread_mutex_unlock(&worker->lock);
+            break;
+        }
+        RedoBatch* batch = worker->queue[worker->queue_head];
+        worker->queue_head = (worker->queue_head + 1) % WAL_REDO_QUEUE_DEPTH;
+        worker->queue_count--;
+        pthread_cond_signal(&worker->cond);
+        pthread_mutex_unlock(&worker->lock);
+
+        size_t pos = 0;
+        while (pos < batch->length && !worker->failed) {
+            LogRecordHeader header;
+            memcpy(&header, batch->data + pos, sizeof(LogRecordHeader));
+            if (wal_redo_record(worker->pool, worker->pager, &header, batch->data + pos + sizeof(LogRecordHeader),
+                                worker->worker, worker->num_workers) != 0) {
+                worker->failed = 1;
             }
+            pos += record_length(&header);
         }
+        free(batch->data);
+        free(batch);
+    }
+    return NULL;
+}
+
+// hand the pending batch to the worker, waiting while its queue is full
+static void redo_worker_submit(RedoWorker* worker) {
+    if (worker->pending == NULL || worker->pending->length == 0) {
+        return;
     }
-    if (committed_tx_ids != NULL) {
-        free(committed_tx_ids);
+    pthread_mutex_lock(&worker->lock);
+    while (worker->queue_count == WAL_REDO_QUEUE_DEPTH) {
+        pthread_cond_wait(&worker->cond, &worker->lock);
     }
+    worker->queue[(worker->queue_head + worker->queue_count) % WAL_REDO_QUEUE_DEPTH] = worker->pending;
+    worker->queue_count++;
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->lock);
+    worker->pending = NULL;
 }
 
-void wal_apply_committed_transactions(BufferPool* pool, Pager* pager, uint32_t root_page_id, uint32_t tx_id) {
-    lseek(pager->fd, 0, SEEK_SET);
+static void redo_worker_append(RedoWorker* worker, const LogRecordHeader* header, const char* payload) {
+    size_t record_len = record_length(header);
+    if (worker->pending == NULL) {
+        worker->pending = (RedoBatch*)calloc(1, sizeof(RedoBatch));
+    }
+    RedoBatch* batch = worker->pending;
+    if (batch->length + record_len > batch->capacity) {
+        size_t capacity = batch->capacity == 0 ? WAL_REDO_BATCH_SIZE : batch->capacity;
+        while (capacity < batch->length + record_len) {
+            capacity *= 2;
+        }
+        batch->data = (char*)realloc(batch->data, capacity);
+        batch->capacity = capacity;
+    }
+    memcpy(batch->data + batch->length, header, sizeof(LogRecordHeader));
+    memcpy(batch->data + batch->length + sizeof(LogRecordHeader), payload, record_len - sizeof(LogRecordHeader));
+    batch->length += record_len;
+
+    if (batch->length >= WAL_REDO_BATCH_SIZE) {
+        redo_worker_submit(worker);
+    }
+}
+
+// route a record to every worker that owns one of its pages. records for a
+// page always go to the same worker in log order, which makes parallel redo
+// produce exactly the pages serial redo would.
+static void redo_dispatch(RedoWorker* workers, int num_workers, const LogRecordHeader* header, const char* payload) {
+    if ((LogRecordType)header->type != LOG_RECORD_TYPE_PAGE_IMAGE) {
+        redo_worker_append(&workers[header->page_id % num_workers], header, payload);
+        return;
+    }
+
+    int targets[WAL_MAX_RECOVERY_WORKERS] = {0};
+    uint32_t image_size = sizeof(uint32_t) + PAGE_SIZE;
+    for (uint32_t pos = 0; pos + image_size <= header->value_len; pos += image_size) {
+        uint32_t page_id;
+        memcpy(&page_id, payload + pos, sizeof(uint32_t));
+        targets[page_id % num_workers] = 1;
+    }
+    for (int i = 0; i < num_workers; i++) {
+        if (targets[i]) {
+            redo_worker_append(&workers[i], header, payload);
+        }
+    }
+}
 
+// -1 if any record could not be redone
+static int wal_redo_all(BufferPool* pool, Pager* pager, WalReader* reader, int num_workers) {
     LogRecordHeader header;
-    while (read(pager->fd, &header, sizeof(LogRecordHeader)) > 0) {
-        
-        if (header.tx_id == tx_id && (LogRecordType)header.type == LOG_RECORD_TYPE_INSERT) {
-            int key;
-            char value[256];
-            read(pager->fd, &key, sizeof(int));
-            if (header.value_len > 0) {
-                if (header.value_len > 255) {
-                    // skip oversized value
-                    lseek(pager->fd, header.value_len, SEEK_CUR);
-                    value[0] = '\0'; 
-                } else {
-                    read(pager->fd, value, header.value_len);
-                    value[header.value_len] = '\0'; 
-                }
+    const char* payload;
+
+    RedoWorker* workers = NULL;
+    if (num_workers > 1) {
+        workers = (RedoWorker*)calloc(num_workers, sizeof(RedoWorker));
+        for (int i = 0; i < num_workers; i++) {
+            workers[i].pool = pool;
+            workers[i].pager = pager;
+            workers[i].worker = i;
+            workers[i].num_workers = num_workers;
+            pthread_mutex_init(&workers[i].lock, NULL);
+            pthread_cond_init(&workers[i].cond, NULL);
+            pthread_create(&workers[i].thread, NULL, redo_worker_main, &workers[i]);
+        }
+    }
+
+    int status = 0;
+    while (status == 0 && wal_reader_next(reader, &header, &payload)) {
+        if (!is_data_record((LogRecordType)header.type)) {
+            continue;
+        }
+        allocate_record_pages(pager, &header, payload);
+        if (workers == NULL) {
+            status = wal_redo_record(pool, pager, &header, payload, 0, 1);
+        } else {
+            redo_dispatch(workers, num_workers, &header, payload);
+        }
+    }
+
+    if (workers != NULL) {
+        for (int i = 0; i < num_workers; i++) {
+            redo_worker_submit(&workers[i]);
+            pthread_mutex_lock(&workers[i].lock);
+            workers[i].finished = 1;
+            pthread_cond_signal(&workers[i].cond);
+            pthread_mutex_unlock(&workers[i].lock);
+        }
+        for (int i = 0; i < num_workers; i++) {
+            pthread_join(workers[i].thread, NULL);
+            pthread_mutex_destroy(&workers[i].lock);
+            pthread_cond_destroy(&workers[i].cond);
+            if (workers[i].failed) {
+                status = -1;
             }
-            
-            btree_insert(pool, pager, root_page_id, key, value, 0);
-        } else if (header.tx_id == tx_id && (LogRecordType)header.type == LOG_RECORD_TYPE_DELETE) {
-            int key;
-            read(pager->fd, &key, sizeof(int));
-            
-            btree_delete(pool, pager, root_page_id, key, 0);
-        } else if (header.tx_id == tx_id && (LogRecordType)header.type == LOG_RECORD_TYPE_UPDATE) {
-            int key;
-            char value[256];
-            read(pager->fd, &key, sizeof(int));
-            if (header.value_len > 0) {
-                if (header.value_len > 255) {
-                    // skip oversized value
-                    lseek(pager->fd, header.value_len, SEEK_CUR);
-                    value[0] = '\0'; 
-                } else {
-                    read(pager->fd, value, header.value_len);
-                    value[header.value_len] = '\0'; 
-                }
+        }
+        free(workers);
+    }
+    return status;
+}
+
+int wal_recover(BufferPool* pool, Pager* pager, Wal* wal) {
+    return wal_recover_parallel(pool, pager, wal, 1);
+}
+
+int wal_recover_parallel(BufferPool* pool, Pager* pager, Wal* wal, int num_workers) {
+    WalReader reader;
+    LogRecordHeader header;
+    const char* payload;
+
+    if (num_workers < 1) {
+        num_workers = 1;
+    }
+    if (num_workers > WAL_MAX_RECOVERY_WORKERS) {
+        num_workers = WAL_MAX_RECOVERY_WORKERS;
+    }
+
+    // analysis pass: find the highest tx id and the transactions that never
+    // finished, along with the changes they still need undone
+    if (wal_reader_init(&reader, wal->fd, 0, 0) != 0) {
+        fprintf(stderr, "error: unable to allocate wal read buffer.\n");
+        return -1;
+    }
+
+    ActiveTransactions active;
+    memset(&active, 0, sizeof(ActiveTransactions));
+    int num_data_records = 0;
+    uint64_t redo_start = 0;  // just past the last checkpoint
+
+    while (wal_reader_next(&reader, &header, &payload)) {
+        LogRecordType type = (LogRecordType)header.type;
+        if (header.tx_id > wal->last_tx_id) {
+            wal->last_tx_id = header.tx_id;
+        }
+        if (type == LOG_RECORD_TYPE_BEGIN) {
+            active_begin(&active, header.tx_id);
+        } else if (type == LOG_RECORD_TYPE_COMMIT || type == LOG_RECORD_TYPE_ABORT) {
+            active_end(&active, header.tx_id);
+        } else if (type == LOG_RECORD_TYPE_CHECKPOINT) {
+            redo_start = reader.offset;
+            num_data_records = 0;
+        } else if (is_data_record(type)) {
+            if (is_row_record(type) || is_batch_record(type)) {
+                active_track(&active, &header, payload);
             }
-            btree_delete(pool, pager, root_page_id, key, 0);
-            btree_insert(pool, pager, root_page_id, key, value, 0);
+            num_data_records++;
+        }
+    }
+    wal_reader_free(&reader);
+
+    // cut off a torn tail so new records follow the last valid one
+    uint64_t end = wal->lsn - wal->base;
+    if (reader.offset < end) {
+        fprintf(stderr, "warning: discarding %llu bytes of incomplete log records.\n",
+                (unsigned long long)(end - reader.offset));
+        ftruncate(wal->fd, reader.offset);
+    }
+    wal->base = reader.base;
+    wal->lsn = reader.base + reader.offset;
+
+    // redo pass: repeat history page by page since the last checkpoint,
+    // including the changes and compensations of rolled back transactions.
+    // a page that cannot be redone fails recovery: nothing after it can be trusted
+    int status = 0;
+    if (num_data_records > 0) {
+        status = wal_reader_init(&reader, wal->fd, wal->base, redo_start);
+        if (status == 0) {
+            status = wal_redo_all(pool, pager, &reader, num_workers);
+            wal_reader_free(&reader);
+        }
+    }
+    if (status != 0) {
+        fprintf(stderr, "error: unable to redo the log, recovery failed.\n");
+        for (int i = 0; i < active.count; i++) {
+            undo_log_free(&active.logs[i]);
         }
+        free(active.logs);
+        return -1;
     }
-}
\ No newline at end of file
+
+    // undo pass: roll back every transaction that was still running at the crash
+    for (int i = active.count - 1; i >= 0; i--) {
+        undo_log_free(&wal->undo);
+        wal->undo = active.logs[i];
+        wal_rollback(wal, pool, pager, wal->undo.tx_id);
+    }
+    free(active.logs);
+    return 0;
+}
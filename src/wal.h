@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include "buffer.h"
 
+#define WAL_MAX_RECOVERY_WORKERS 64
+
 
 typedef enum {
     LOG_RECORD_TYPE_INSERT,
@@ -11,33 +13,113 @@ typedef enum {
     LOG_RECORD_TYPE_UPDATE,
     LOG_RECORD_TYPE_COMMIT,
     LOG_RECORD_TYPE_BEGIN,
-    LOG_RECORD_TYPE_CHECKPOINT
+    LOG_RECORD_TYPE_CHECKPOINT,
+    LOG_RECORD_TYPE_ABORT,
+    LOG_RECORD_TYPE_PAGE_IMAGE,
+    LOG_RECORD_TYPE_INSERT_BATCH,
+    LOG_RECORD_TYPE_UPDATE_BATCH
 } LogRecordType;
 
 
+// records are physiological: each data record names the page it changes and
+// describes the change by key within that page. PAGE_IMAGE records carry full
+// after-images of every page touched by a structural change (split, new root)
+// as a sequence of (uint32_t page_id, Page) pairs, so they replay atomically.
+// INSERT_BATCH records add several new keys to one leaf as a sequence of
+// (int32_t key, uint16_t length, value) cells; key holds the number of cells.
+// UPDATE_BATCH records replace the values of several keys of one leaf the
+// same way, with the old values as the same kind of cells in the before-image.
+//
+// data records also carry what is needed to undo them logically: the tree they
+// belong to and the before-image of the value, stored after the redo payload.
+// records written while rolling back are compensation records: undo_lsn names
+// the change they reverse and they are never undone themselves.
+//
+// a CHECKPOINT record marks a point where every change logged before it is
+// in the data file and no transaction is running, so recovery redoes only
+// what follows the last one. a clean close replaces the log with a lone
+// CHECKPOINT record, whose lsn carries the log's lsns on from where they
+// were; its tx_id does the same for transaction ids.
+//
+// every record is framed by its total length and a crc32c over the header
+// (with crc set to 0) and payload. recovery stops at the first record that
+// does not check out, which is where a crash tore the tail of the log.
+typedef struct {
+    uint64_t lsn;          // log offset just past the end of this record
+    uint64_t undo_lsn;     // compensation records only, 0 otherwise
+    uint32_t length;       // header plus payload
+    uint32_t crc;
+    uint32_t type;
+    uint32_t tx_id;
+    uint32_t page_id;
+    uint32_t root_page_id;
+    int32_t key;
+    uint32_t value_len;    // redo payload length
+    uint32_t undo_len;     // before-image length
+    uint32_t reserved;
+} LogRecordHeader;
+
+
+// one change of a running transaction, reversed through the b-tree on rollback
 typedef struct {
     uint64_t lsn;
     uint32_t type;
+    uint32_t root_page_id;
+    int32_t key;
+    uint32_t length;
+    char* before_image; // NULL when the change inserted a new key
+} UndoRecord;
+
+typedef struct {
     uint32_t tx_id;
-    uint16_t value_len;
-} LogRecordHeader; __attribute__((packed)); __attribute__((packed));
+    UndoRecord* records;
+    int count;
+    int capacity;
+} UndoLog;
 
 
 typedef struct {
     int fd;
-    uint64_t lsn;
+    char filename[512];
+    uint64_t base;       // lsn at log offset 0, past 0 once a checkpoint has cut the log
+    uint64_t lsn;        // end of the log, lsn of the last record written
+    uint32_t last_tx_id; // highest transaction id seen in the log
+    char* buffer;
+    uint32_t buffer_capacity;
+    UndoLog undo;        // changes of the running transaction, newest last
+    uint64_t undo_lsn;   // set while rolling back, marks records as compensation
 } Wal;
 
 Wal* wal_init(const char* filename);
 void wal_close(Wal* wal);
-void wal_log_insert(Wal* wal, uint32_t tx_id, int key, const char* value);
-void wal_log_delete(Wal* wal, uint32_t tx_id, int key);
-void wal_log_update(Wal* wal, uint32_t tx_id, int key, const char* value);
+void wal_truncate(Wal* wal);
+uint64_t wal_log_insert(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key, const char* value, uint16_t value_len);
+uint64_t wal_log_delete(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key, const char* old_value, uint16_t old_len);
+uint64_t wal_log_update(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, int key, const char* value, uint16_t value_len, const char* old_value, uint16_t old_len);
+// cells inserted into a single leaf, none of whose keys it held before
+uint64_t wal_log_insert_batch(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, const int* keys,
+                              const char* const* values, const uint16_t* lengths, int count);
+// new values for keys a single leaf holds, old_values what they replace
+uint64_t wal_log_update_batch(Wal* wal, uint32_t tx_id, uint32_t root_page_id, uint32_t page_id, const int* keys,
+                              const char* const* values, const uint16_t* lengths, const char* const* old_values,
+                              const uint16_t* old_lengths, int count);
+uint64_t wal_log_page_images(Wal* wal, uint32_t tx_id, const uint32_t* page_ids, Page** pages, int count);
+// forces the log to disk, the commit is durable once it returns
 void wal_log_commit(Wal* wal, uint32_t tx_id);
+// force the records written so far to disk, -1 if they may not all be there
+int wal_sync(Wal* wal);
 void wal_log_begin(Wal* wal, uint32_t tx_id);
-void wal_recover(BufferPool* pool, Pager* pager, Wal* wal, uint32_t root_page_id);
-void wal_apply_committed_transactions(BufferPool* pool, Pager* pager, uint32_t root_page_id, uint32_t tx_id);
-uint32_t* wal_get_committed_tx_ids(Wal* wal, int* count);
+void wal_log_abort(Wal* wal, uint32_t tx_id);
+// the caller has written every dirty page to the data file and synced it, and
+// no transaction is running
+void wal_log_checkpoint(Wal* wal);
+void wal_rollback(Wal* wal, BufferPool* pool, Pager* pager, uint32_t tx_id);
+// undo the running transaction's changes past the first count of its undo
+// log, leaving the transaction open; used to take back a failed statement
+void wal_rollback_to(Wal* wal, BufferPool* pool, Pager* pager, uint32_t tx_id, int count);
+// -1 if the log could not be replayed, leaving the pages unusable
+int wal_recover(BufferPool* pool, Pager* pager, Wal* wal);
+int wal_recover_parallel(BufferPool* pool, Pager* pager, Wal* wal, int num_workers);
 
 
 #endif // WAL_H
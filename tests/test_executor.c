@@ -0,0 +1,799 @@
+#include "../src/database.h"
+#include "../src/executor.h"
+#include "../src/simd.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+void cleanup_test_files() {
+    system("rm -f test_executor*.db test_executor*.db.wal");
+}
+
+TableSchema* get_table(Database* db, const char* name) {
+    return catalog_find_table(db->catalog, name);
+}
+
+Expr make_column(int column_index) {
+    Expr expr;
+    memset(&expr, 0, sizeof(Expr));
+    expr.type = EXPR_COLUMN;
+    expr.column_index = column_index;
+    return expr;
+}
+
+Expr make_int(int64_t value) {
+    Expr expr;
+    memset(&expr, 0, sizeof(Expr));
+    expr.type = EXPR_LITERAL;
+    expr.value.type = COLUMN_TYPE_INT;
+    expr.value.int_value = value;
+    return expr;
+}
+
+Expr make_double(double value) {
+    Expr expr;
+    memset(&expr, 0, sizeof(Expr));
+    expr.type = EXPR_LITERAL;
+    expr.value.type = COLUMN_TYPE_DOUBLE;
+    expr.value.double_value = value;
+    return expr;
+}
+
+Expr make_logical(ExprType type, Expr* left, Expr* right) {
+    Expr expr;
+    memset(&expr, 0, sizeof(Expr));
+    expr.type = type;
+    expr.left = left;
+    expr.right = right;
+    return expr;
+}
+
+Expr make_compare(CompareOp op, Expr* left, Expr* right) {
+    Expr expr;
+    memset(&expr, 0, sizeof(Expr));
+    expr.type = EXPR_COMPARE;
+    expr.op = op;
+    expr.left = left;
+    expr.right = right;
+    return expr;
+}
+
+// pull every batch, check each holds at most BATCH_SIZE rows and return the total
+int drain(Operator* root, int* num_batches) {
+    Arena arena;
+    arena_init(&arena);
+    Batch batch;
+    batch_init(&batch, root->num_columns, &arena);
+    int total = 0;
+    *num_batches = 0;
+    while (root->next(root, &batch) > 0) {
+        assert(batch.num_rows <= BATCH_SIZE);
+        total += batch.num_rows;
+        (*num_batches)++;
+    }
+    arena_free(&arena);
+    return total;
+}
+
+Database* create_test_db() {
+    cleanup_test_files();
+    Database* db = db_open("test_executor.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE orders (id INT, customer INT, amount DOUBLE)");
+    db_execute(db, "CREATE TABLE customers (id INT, name VARCHAR(20))");
+
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO orders VALUES (?, ?, ?)");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 3000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i % 5);
+        if (i % 100 == 0) {
+            db_bind_text(insert, 3, NULL);
+        } else {
+            db_bind_int(insert, 3, i);
+        }
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_finalize(insert);
+    db_execute(db, "INSERT INTO customers VALUES (1, 'ann'), (2, 'bo'), (3, 'cy')");
+    db_execute(db, "COMMIT");
+    return db;
+}
+
+void test_scan_filter_limit(Database* db) {
+    printf("Testing scan, filter and limit operators...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+
+    int num_batches;
+    Operator* scan = seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS);
+    assert(scan->num_columns == 3);
+    assert(drain(scan, &num_batches) == 3000);
+    assert(num_batches == 3);
+    operator_close(scan);
+
+    // columns left out of the mask are null and numbers are not copied
+    Batch batch;
+    batch_init(&batch, 3, &arena);
+    scan = seq_scan_create(&arena, db->pool, db->pager, orders, 1u << 2);
+    assert(scan->next(scan, &batch) == 1024 && batch.data_used == 0);
+    assert(batch_row(&batch, 1)[0].is_null && batch_row(&batch, 1)[1].is_null);
+    assert(!batch_row(&batch, 1)[2].is_null && batch_row(&batch, 1)[2].double_value == 2);
+    operator_close(scan);
+    TableSchema* customers = get_table(db, "customers");
+    scan = seq_scan_create(&arena, db->pool, db->pager, customers, 1u << 0);
+    assert(scan->next(scan, &batch) == 3 && batch.data_used == 0 && batch_row(&batch, 2)[1].is_null);
+    operator_close(scan);
+    scan = seq_scan_create(&arena, db->pool, db->pager, customers, 1u << 1);
+    assert(scan->next(scan, &batch) == 3 && batch.data_used > 0);
+    assert(batch_row(&batch, 2)[0].is_null && memcmp(batch_row(&batch, 2)[1].text, "cy", 2) == 0);
+    operator_close(scan);
+
+    // customer = 2 holds for every fifth row
+    Expr column = make_column(1);
+    Expr two = make_int(2);
+    Expr predicate = make_compare(COMPARE_EQ, &column, &two);
+    Operator* filter = filter_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &predicate);
+    assert(drain(filter, &num_batches) == 600);
+    operator_close(filter);
+
+    Operator* limit = limit_create(&arena, filter_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS),
+                                                         &predicate), 7, 0);
+    assert(drain(limit, &num_batches) == 7 && num_batches == 1);
+    operator_close(limit);
+
+    // an offset spanning batches, with and without a limit after it
+    limit = limit_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), 5, 1500);
+    assert(limit->next(limit, &batch) == 5 && batch_row(&batch, 0)[0].int_value == 1501);
+    assert(limit->next(limit, &batch) == 0);
+    operator_close(limit);
+    limit = limit_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), -1, 2990);
+    assert(drain(limit, &num_batches) == 10);
+    operator_close(limit);
+
+    // a key range scan steps over its offset leaf by leaf
+    Value low = make_int(1000).value;
+    KeyRange range = {&low, 0, NULL, 0, 1500};
+    Operator* scan_range = index_scan_create(&arena, db->pool, db->pager, orders, NULL, &range, 0, ALL_COLUMNS);
+    assert(scan_range->next(scan_range, &batch) == 500 && batch_row(&batch, 0)[0].int_value == 2501);
+    operator_close(scan_range);
+
+    arena_free(&arena);
+
+    printf("✓ Scan, filter and limit test passed.\n");
+}
+
+// a compiled predicate must agree with the expression it came from on every row
+void test_compiled_predicates(Database* db) {
+    printf("Testing compiled predicates...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+
+    Expr id = make_column(0);
+    Expr customer = make_column(1);
+    Expr amount = make_column(2);
+    Expr three = make_int(3);
+    Expr half = make_double(1500.5);
+    Expr null = make_int(0);
+    null.value.is_null = 1;
+
+    Expr cases[] = {
+        make_compare(COMPARE_EQ, &customer, &three),
+        make_compare(COMPARE_LT, &amount, &half),
+        make_compare(COMPARE_GE, &half, &amount),  // constant on the left
+        make_compare(COMPARE_NE, &id, &null),      // always unknown
+        make_compare(COMPARE_LE, &id, &amount),    // column to column
+        make_compare(COMPARE_GT, &amount, &three), // int constant against a double column
+    };
+    int num_cases = sizeof(cases) / sizeof(cases[0]);
+    Expr is_null = make_logical(EXPR_IS_NULL, &amount, NULL);
+    Expr either = make_logical(EXPR_OR, &cases[0], &is_null);
+    Expr both = make_logical(EXPR_AND, &cases[1], &cases[4]);
+    Expr negated = make_logical(EXPR_NOT, &cases[1], NULL);
+
+    Expr* expressions[16];
+    for (int i = 0; i < num_cases; i++) {
+        expressions[i] = &cases[i];
+    }
+    expressions[num_cases++] = &is_null;
+    expressions[num_cases++] = &either;
+    expressions[num_cases++] = &both;
+    expressions[num_cases++] = &negated;
+
+    Operator* scan = seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS);
+    Batch batch;
+    batch_init(&batch, scan->num_columns, &arena);
+    int matches[16] = {0};
+    while (scan->next(scan, &batch) > 0) {
+        for (int i = 0; i < num_cases; i++) {
+            Predicate* predicate = predicate_compile(&arena, expressions[i]);
+            for (int r = 0; r < batch.num_rows; r++) {
+                const Value* row = batch_row(&batch, r);
+                int result = predicate->evaluate(predicate, row);
+                assert(result == expr_evaluate(expressions[i], row));
+                matches[i] += result == 1;
+            }
+        }
+    }
+    operator_close(scan);
+    assert(matches[0] == 600);
+    assert(matches[3] == 0);
+    assert(matches[6] == 30); // every 100th amount is null
+    assert(predicate_compile(&arena, NULL) == NULL);
+    arena_free(&arena);
+
+    printf("✓ Compiled predicate test passed.\n");
+}
+
+int expected_compare(double value, CompareOp op, double constant) {
+    switch (op) {
+        case COMPARE_EQ: return value == constant;
+        case COMPARE_NE: return value != constant;
+        case COMPARE_LT: return value < constant;
+        case COMPARE_LE: return value <= constant;
+        case COMPARE_GT: return value > constant;
+        case COMPARE_GE: return value >= constant;
+    }
+    return 0;
+}
+
+// every kernel level this cpu has must agree with a plain comparison
+void test_simd_kernels() {
+    printf("Testing simd filter kernels (cpu supports %s)...\n", simd_level_name(simd_level()));
+    int64_t ints[BATCH_SIZE];
+    double doubles[BATCH_SIZE];
+    srand(38);
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        ints[i] = (rand() % 200 - 100) * 1000003LL;
+        doubles[i] = (rand() % 2000 - 1000) / 8.0;
+    }
+
+    int counts[] = {BATCH_SIZE, 1000, 64, 37, 1};
+    for (int level = SIMD_SCALAR; level <= (int)simd_level(); level++) {
+        assert(simd_use_level((SimdLevel)level) == 0);
+        for (int c = 0; c < 5; c++) {
+            int count = counts[c];
+            for (int op = COMPARE_EQ; op <= COMPARE_GE; op++) {
+                uint64_t int_selection[BATCH_SIZE / 64];
+                uint64_t double_selection[BATCH_SIZE / 64];
+                memset(int_selection, 0xff, sizeof(int_selection));
+                memset(double_selection, 0xff, sizeof(double_selection));
+                // an even row cleared beforehand must stay cleared
+                int_selection[0] &= ~(uint64_t)1;
+                simd_select_int64(ints, count, (CompareOp)op, ints[count / 2], int_selection);
+                simd_select_double(doubles, count, (CompareOp)op, doubles[count / 3], double_selection);
+                for (int i = 0; i < count; i++) {
+                    int int_bit = (int)((int_selection[i / 64] >> (i % 64)) & 1);
+                    int double_bit = (int)((double_selection[i / 64] >> (i % 64)) & 1);
+                    int int_expected = i != 0 && expected_compare((double)ints[i], (CompareOp)op, (double)ints[count / 2]);
+                    assert(int_bit == int_expected);
+                    assert(double_bit == expected_compare(doubles[i], (CompareOp)op, doubles[count / 3]));
+                }
+            }
+        }
+    }
+    assert(simd_use_level(simd_level()) == 0);
+    assert(simd_active_level() == simd_level());
+
+    printf("✓ SIMD kernel test passed.\n");
+}
+
+// filters run their numeric conjuncts through the kernels at every level
+void test_vectorized_filter(Database* db) {
+    printf("Testing vectorized filters...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+
+    Expr id = make_column(0);
+    Expr customer = make_column(1);
+    Expr amount = make_column(2);
+    Expr three = make_int(3);
+    Expr half = make_double(1500.5);
+    Expr low = make_int(100);
+    Expr below = make_compare(COMPARE_LT, &amount, &half);
+    Expr is_three = make_compare(COMPARE_EQ, &customer, &three);
+    Expr above = make_compare(COMPARE_GT, &id, &low);
+    Expr below_three = make_logical(EXPR_AND, &below, &is_three);
+    Expr kernels_only = make_logical(EXPR_AND, &below_three, &above);
+    // an OR cannot run as a kernel and is checked on the rows kernels selected
+    Expr is_null = make_logical(EXPR_IS_NULL, &amount, NULL);
+    Expr either = make_logical(EXPR_OR, &is_three, &is_null);
+    Expr mixed = make_logical(EXPR_AND, &above, &either);
+
+    for (int level = SIMD_SCALAR; level <= (int)simd_level(); level++) {
+        simd_use_level((SimdLevel)level);
+        int num_batches;
+        // ids 1..1500 with customer 3, none of them has a null amount
+        Operator* filter = filter_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &below_three);
+        assert(drain(filter, &num_batches) == 300);
+        operator_close(filter);
+
+        filter = filter_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &kernels_only);
+        assert(drain(filter, &num_batches) == 280);
+        operator_close(filter);
+
+        // ids above 100: 580 with customer 3, plus 29 null amounts on other customers
+        filter = filter_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &mixed);
+        assert(drain(filter, &num_batches) == 580 + 29);
+        operator_close(filter);
+    }
+    simd_use_level(simd_level());
+    arena_free(&arena);
+
+    printf("✓ Vectorized filter test passed.\n");
+}
+
+void test_sort_project(Database* db) {
+    printf("Testing sort and project operators...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+
+    Expr amount = make_column(2);
+    OrderByItem order = {&amount, 1};
+    int columns[] = {2, 0};
+    Operator* root = project_create(&arena, sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &order, 1,
+                                                      SORT_MEMORY_BUDGET), columns, 2);
+    assert(root->num_columns == 2);
+
+    Batch batch;
+    batch_init(&batch, root->num_columns, &arena);
+    assert(root->next(root, &batch) == BATCH_SIZE);
+    assert(batch_row(&batch, 0)[0].double_value == 2999 && batch_row(&batch, 0)[1].int_value == 2999);
+    assert(batch_row(&batch, 1)[1].int_value == 2998);
+    int total = batch.num_rows;
+    Value last = batch_row(&batch, 0)[0];
+    while (root->next(root, &batch) > 0) {
+        total += batch.num_rows;
+        last = batch_row(&batch, batch.num_rows - 1)[0];
+    }
+    assert(total == 3000 && last.is_null); // nulls sort first, so last descending
+    operator_close(root);
+
+    // a budget of a few dozen rows spills about 90 runs, merged in two passes;
+    // customer then id descending is a total order to compare against
+    Expr customer = make_column(1);
+    Expr id = make_column(0);
+    OrderByItem orders_by[] = {{&customer, 0}, {&id, 1}};
+    Operator* in_memory = sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), orders_by, 2, SORT_MEMORY_BUDGET);
+    Operator* external = sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), orders_by, 2, 4096);
+    Batch expected;
+    batch_init(&expected, 3, &arena);
+    batch_init(&batch, 3, &arena);
+    total = 0;
+    while (in_memory->next(in_memory, &expected) > 0) {
+        assert(external->next(external, &batch) == expected.num_rows);
+        for (int i = 0; i < batch.num_rows; i++) {
+            for (int j = 0; j < 3; j++) {
+                const Value* a = &batch_row(&batch, i)[j];
+                const Value* b = &batch_row(&expected, i)[j];
+                assert(a->is_null == b->is_null && (a->is_null || value_compare(a, b) == 0));
+            }
+        }
+        total += batch.num_rows;
+        last = batch_row(&batch, batch.num_rows - 1)[0];
+    }
+    assert(total == 3000 && external->next(external, &batch) == 0);
+    assert(last.int_value == 4);
+    operator_close(in_memory);
+    operator_close(external);
+
+    // text survives being spilled and merged, one row per run
+    TableSchema* customers = get_table(db, "customers");
+    Expr name = make_column(1);
+    OrderByItem by_name = {&name, 1};
+    root = sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS), &by_name, 1, 1);
+    batch_init(&batch, 2, &arena);
+    assert(root->next(root, &batch) == 3);
+    assert(batch_row(&batch, 0)[0].int_value == 3 && memcmp(batch_row(&batch, 0)[1].text, "cy", 2) == 0);
+    assert(batch_row(&batch, 2)[0].int_value == 1 && memcmp(batch_row(&batch, 2)[1].text, "ann", 3) == 0);
+    operator_close(root);
+
+    // ORDER BY ... LIMIT keeps only the first rows
+    root = top_n_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &order, 1, 5);
+    batch_init(&batch, 3, &arena);
+    assert(root->next(root, &batch) == 5);
+    for (int i = 0; i < 5; i++) {
+        assert(batch_row(&batch, i)[0].int_value == 2999 - i);
+    }
+    assert(root->next(root, &batch) == 0);
+    operator_close(root);
+    root = top_n_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), orders_by, 2, 0);
+    assert(root->next(root, &batch) == 0);
+    operator_close(root);
+
+    // through SQL with a small budget
+    db->sort_memory = 4096;
+    Result* result = db_execute(db, "SELECT id, customer FROM orders WHERE id > 10 ORDER BY customer DESC, id");
+    assert(result != NULL && result->num_rows == 2990);
+    assert(strcmp(result->rows[0][0], "14") == 0 && strcmp(result->rows[2989][0], "3000") == 0);
+    db_result_free(result);
+    result = db_execute(db, "SELECT id FROM orders ORDER BY amount DESC LIMIT 2");
+    assert(result != NULL && result->num_rows == 2 && strcmp(result->rows[1][0], "2998") == 0);
+    db_result_free(result);
+    db->sort_memory = SORT_MEMORY_BUDGET;
+
+    arena_free(&arena);
+
+    printf("✓ Sort and project test passed.\n");
+}
+
+void test_aggregate(Database* db) {
+    printf("Testing aggregate operator...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+
+    AggregateSpec aggregates[] = {
+        {AGGREGATE_COUNT, -1}, {AGGREGATE_COUNT, 2}, {AGGREGATE_SUM, 1},
+        {AGGREGATE_MIN, 2}, {AGGREGATE_MAX, 0}, {AGGREGATE_AVG, 1},
+    };
+    Operator* root = aggregate_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), aggregates, 6);
+
+    Batch batch;
+    batch_init(&batch, root->num_columns, &arena);
+    assert(root->next(root, &batch) == 1);
+    const Value* row = batch_row(&batch, 0);
+    assert(row[0].int_value == 3000);
+    assert(row[1].int_value == 2970); // nulls are not counted
+    assert(row[2].int_value == 6000);
+    assert(row[3].double_value == 1);
+    assert(row[4].int_value == 3000);
+    assert(row[5].type == COLUMN_TYPE_DOUBLE && row[5].double_value == 2);
+    assert(root->next(root, &batch) == 0);
+    operator_close(root);
+
+    // over no rows COUNT is 0 and the rest are null
+    Expr column = make_column(0);
+    Expr none = make_int(-1);
+    Expr predicate = make_compare(COMPARE_EQ, &column, &none);
+    root = aggregate_create(&arena, filter_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &predicate), aggregates, 6);
+    batch_init(&batch, root->num_columns, &arena);
+    assert(root->next(root, &batch) == 1);
+    assert(batch_row(&batch, 0)[0].int_value == 0 && batch_row(&batch, 0)[3].is_null);
+    operator_close(root);
+
+    arena_free(&arena);
+
+    printf("✓ Aggregate test passed.\n");
+}
+
+void test_group_aggregate(Database* db) {
+    printf("Testing group aggregate operators...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+    TableSchema* customers = get_table(db, "customers");
+
+    // customer is id % 5: groups come out in the order they first appear
+    AggregateSpec aggregates[] = {{AGGREGATE_COUNT, -1}, {AGGREGATE_COUNT, 2}, {AGGREGATE_SUM, 0}, {AGGREGATE_MAX, 2}};
+    int by_customer[] = {1};
+    Operator* root = hash_aggregate_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), by_customer, 1, aggregates, 4);
+    assert(root->num_columns == 5);
+    Batch hashed;
+    batch_init(&hashed, root->num_columns, &arena);
+    assert(root->next(root, &hashed) == 5);
+    assert(batch_row(&hashed, 0)[0].int_value == 1 && batch_row(&hashed, 4)[0].int_value == 0);
+    assert(batch_row(&hashed, 4)[1].int_value == 600 && batch_row(&hashed, 4)[2].int_value == 570);
+    assert(batch_row(&hashed, 0)[3].int_value == 600 * 1 + 5 * (599 * 600 / 2));
+    assert(root->next(root, &hashed) == 0);
+    operator_close(root);
+
+    // the same groups streamed from input sorted on the group column
+    Expr customer = make_column(1);
+    OrderByItem order = {&customer, 0};
+    Operator* sorted = sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &order, 1, SORT_MEMORY_BUDGET);
+    root = stream_aggregate_create(&arena, sorted, by_customer, 1, aggregates, 4);
+    Batch streamed;
+    batch_init(&streamed, root->num_columns, &arena);
+    assert(root->next(root, &streamed) == 5);
+    for (int i = 0; i < 5; i++) {
+        const Value* row = batch_row(&streamed, i);
+        const Value* expected = batch_row(&hashed, (i + 4) % 5);
+        assert(row[0].int_value == i);
+        for (int j = 1; j < 5; j++) {
+            assert(value_compare(&row[j], &expected[j]) == 0);
+        }
+    }
+    assert(root->next(root, &streamed) == 0 && root->next(root, &streamed) == 0);
+    operator_close(root);
+
+    // a group per row grows the table past its initial slots and spans batches
+    int by_id[] = {0};
+    root = hash_aggregate_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), by_id, 1, aggregates, 1);
+    int num_batches;
+    assert(drain(root, &num_batches) == 3000 && num_batches == 3);
+    operator_close(root);
+    root = stream_aggregate_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), by_id, 1, aggregates, 1);
+    assert(drain(root, &num_batches) == 3000 && num_batches == 3);
+    operator_close(root);
+
+    // text keys are copied out of the scan's pages
+    AggregateSpec min_id = {AGGREGATE_MIN, 0};
+    int by_name[] = {1};
+    root = hash_aggregate_create(&arena, seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS), by_name, 1, &min_id, 1);
+    batch_init(&hashed, root->num_columns, &arena);
+    assert(root->next(root, &hashed) == 3);
+    assert(batch_row(&hashed, 2)[0].text_length == 2 && memcmp(batch_row(&hashed, 2)[0].text, "cy", 2) == 0);
+    assert(batch_row(&hashed, 2)[1].int_value == 3);
+    operator_close(root);
+
+    arena_free(&arena);
+
+    printf("✓ Group aggregate test passed.\n");
+}
+
+void test_nested_loop_join(Database* db) {
+    printf("Testing nested loop join operator...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+    TableSchema* customers = get_table(db, "customers");
+
+    // orders.customer = customers.id, customers columns start at 3
+    Expr customer = make_column(1);
+    Expr id = make_column(3);
+    Expr condition = make_compare(COMPARE_EQ, &customer, &id);
+    Operator* join = nested_loop_join_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS),
+                                                     seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS), &condition);
+    assert(join->num_columns == 5);
+
+    Batch batch;
+    batch_init(&batch, join->num_columns, &arena);
+    int total = 0;
+    while (join->next(join, &batch) > 0) {
+        for (int i = 0; i < batch.num_rows; i++) {
+            const Value* row = batch_row(&batch, i);
+            assert(row[1].int_value == row[3].int_value);
+            assert(row[4].text_length == (row[3].int_value == 1 ? 3 : 2));
+        }
+        total += batch.num_rows;
+    }
+    assert(total == 1800);
+    operator_close(join);
+
+    int num_batches;
+    join = nested_loop_join_create(&arena, seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS),
+                                           seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS), NULL);
+    assert(drain(join, &num_batches) == 9);
+    operator_close(join);
+
+    arena_free(&arena);
+
+    printf("✓ Nested loop join test passed.\n");
+}
+
+void test_hash_join(Database* db) {
+    printf("Testing hash and index nested loop joins...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+    TableSchema* customers = get_table(db, "customers");
+
+    // orders.customer = customers.id, customers hashed in memory
+    Operator* join = hash_join_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS),
+                                      seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS), 1, 0, NULL,
+                                      HASH_JOIN_MEMORY_BUDGET);
+    assert(join->num_columns == 5);
+    int num_batches;
+    assert(drain(join, &num_batches) == 1800);
+    operator_close(join);
+
+    // hashing the orders overflows a small budget: both sides are partitioned
+    // to temporary files and joined a partition at a time. with three keys
+    // every partition is over budget too, and is joined in pieces that fit
+    join = hash_join_create(&arena, seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS),
+                            seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), 0, 1, NULL, 4096);
+    Batch batch;
+    batch_init(&batch, join->num_columns, &arena);
+    int total = 0;
+    double amounts = 0;
+    while (join->next(join, &batch) > 0) {
+        for (int i = 0; i < batch.num_rows; i++) {
+            const Value* row = batch_row(&batch, i);
+            assert(row[0].int_value == row[3].int_value);
+            assert(row[1].text_length == (row[0].int_value == 1 ? 3 : 2));
+            assert(memcmp(row[1].text, row[0].int_value == 1 ? "ann" : row[0].int_value == 2 ? "bo" : "cy", row[1].text_length) == 0);
+            amounts += row[4].is_null ? 0 : row[4].double_value;
+        }
+        total += batch.num_rows;
+    }
+    assert(total == 1800);
+    assert(amounts == 2699100); // the amounts of orders 1..3000 whose customer is 1, 2 or 3
+    operator_close(join);
+
+    // each order looks its customer up by primary key
+    Expr amount = make_column(2);
+    Expr limit = make_double(2900);
+    Expr condition = make_compare(COMPARE_GT, &amount, &limit);
+    join = index_nested_loop_join_create(&arena, db->pool, db->pager, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS),
+                                         1, customers, NULL, NULL, ALL_COLUMNS);
+    assert(drain(join, &num_batches) == 1800 && num_batches >= 2);
+    operator_close(join);
+    join = index_nested_loop_join_create(&arena, db->pool, db->pager, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS),
+                                         1, customers, NULL, &condition, ALL_COLUMNS);
+    assert(drain(join, &num_batches) == 60);
+    operator_close(join);
+
+    arena_free(&arena);
+
+    printf("✓ Hash join test passed.\n");
+}
+
+void test_cursor(Database* db) {
+    printf("Testing streaming cursors...\n");
+
+    Cursor* cursor = db_query(db, "SELECT id, amount FROM orders WHERE customer = 3");
+    assert(cursor != NULL && cursor->num_columns == 2);
+    const Value* row = db_cursor_next(cursor);
+    assert(row != NULL && row[0].int_value == 3 && row[1].double_value == 3);
+
+    // rows are borrowed from one batch that is reused, never accumulated
+    const Value* first_batch = cursor->batch.values;
+    int count = 1;
+    while ((row = db_cursor_next(cursor)) != NULL) {
+        assert(row[0].int_value % 5 == 3);
+        assert(row >= first_batch && row < first_batch + BATCH_SIZE * cursor->num_columns);
+        count++;
+    }
+    assert(count == 600);
+    assert(db_cursor_next(cursor) == NULL);
+
+    // tables cannot change under an open cursor
+    db_execute(db, "BEGIN");
+    db_execute(db, "DELETE FROM orders WHERE id = 3");
+    db_cursor_close(cursor);
+    db_execute(db, "COMMIT");
+    Result* result = db_execute(db, "SELECT * FROM orders WHERE id = 3");
+    assert(result != NULL);
+    db_result_free(result);
+
+    // prepared statements stream through db_cursor_open
+    PreparedStatement* prepared = db_prepare(db, "SELECT name FROM customers WHERE id > ? ORDER BY name DESC");
+    db_bind_int(prepared, 1, 1);
+    cursor = db_cursor_open(prepared);
+    assert(cursor != NULL);
+    row = db_cursor_next(cursor);
+    assert(row != NULL && row[0].text_length == 2 && memcmp(row[0].text, "cy", 2) == 0);
+    assert(db_cursor_next(cursor) != NULL && db_cursor_next(cursor) == NULL);
+    db_cursor_close(cursor);
+    assert(db_cursor_open(prepared) == NULL); // needs a reset first
+    db_reset(prepared);
+    cursor = db_cursor_open(prepared);
+    assert(cursor != NULL);
+    db_cursor_close(cursor);
+    db_finalize(prepared);
+
+    // other statements run and return no cursor
+    assert(db_query(db, "BEGIN") == NULL);
+    assert(db_query(db, "INSERT INTO customers VALUES (4, 'di')") == NULL);
+    assert(db_query(db, "COMMIT") == NULL);
+    cursor = db_query(db, "SELECT name FROM customers WHERE id = 4");
+    assert(cursor != NULL && db_cursor_next(cursor) != NULL);
+    db_cursor_close(cursor);
+    assert(db_query(db, "SELECT * FROM missing") == NULL);
+
+    printf("✓ Streaming cursor test passed.\n");
+}
+
+void test_operator_errors(Database* db) {
+    printf("Testing operators that cannot spill...\n");
+    Arena arena;
+    arena_init(&arena);
+    TableSchema* orders = get_table(db, "orders");
+    TableSchema* customers = get_table(db, "customers");
+
+    // with no file allowed to grow every temporary file write fails; nothing
+    // else is written while the limit holds
+    buffer_pool_flush_all(db->pool, db->pager);
+    struct rlimit saved;
+    getrlimit(RLIMIT_FSIZE, &saved);
+    struct rlimit none = saved;
+    none.rlim_cur = 0;
+    signal(SIGXFSZ, SIG_IGN);
+    assert(setrlimit(RLIMIT_FSIZE, &none) == 0);
+
+    // a sort over budget reports the failure instead of ending early
+    Expr id = make_column(0);
+    OrderByItem by_id = {&id, 1};
+    Operator* sort = sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &by_id, 1, 4096);
+    int num_batches;
+    assert(drain(sort, &num_batches) == 0 && sort->error);
+    operator_close(sort);
+
+    // as do the operators above it
+    Operator* limit = limit_create(&arena, sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS),
+                                                       &by_id, 1, 4096), 10, 0);
+    assert(drain(limit, &num_batches) == 0 && limit->error);
+    operator_close(limit);
+
+    // a hash join that partitions its inputs fails the same way
+    Operator* join = hash_join_create(&arena, seq_scan_create(&arena, db->pool, db->pager, customers, ALL_COLUMNS),
+                                      seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), 0, 1, NULL, 4096);
+    assert(drain(join, &num_batches) == 0 && join->error);
+    operator_close(join);
+
+    // through SQL a cursor tells the failure from the end of the rows
+    db->sort_memory = 4096;
+    Cursor* cursor = db_query(db, "SELECT id FROM orders ORDER BY amount DESC");
+    assert(cursor != NULL && !cursor->failed);
+    assert(db_cursor_next(cursor) == NULL && cursor->failed);
+    db_cursor_close(cursor);
+    assert(db_execute(db, "SELECT id FROM orders ORDER BY amount DESC") == NULL);
+    db->sort_memory = SORT_MEMORY_BUDGET;
+
+    assert(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+    signal(SIGXFSZ, SIG_DFL);
+
+    // the same sort runs once files can be written again
+    sort = sort_create(&arena, seq_scan_create(&arena, db->pool, db->pager, orders, ALL_COLUMNS), &by_id, 1, 4096);
+    assert(drain(sort, &num_batches) > 0 && !sort->error);
+    operator_close(sort);
+
+    arena_free(&arena);
+
+    printf("✓ Operator error test passed.\n");
+}
+
+void test_arena() {
+    printf("Testing arena allocator...\n");
+    Arena arena;
+    arena_init(&arena);
+
+    // allocations are aligned and a block holds many small ones
+    char* first = (char*)arena_alloc(&arena, 3);
+    char* second = (char*)arena_alloc(&arena, 5);
+    assert(((uintptr_t)first % 16) == 0 && ((uintptr_t)second % 16) == 0);
+    assert(second == first + 16);
+
+    // the newest allocation grows in place, others are copied
+    memcpy(second, "abcd", 5);
+    char* grown = (char*)arena_grow(&arena, second, 5, 40);
+    assert(grown == second);
+    char* moved = (char*)arena_grow(&arena, first, 3, 8);
+    assert(moved != first);
+
+    // requests larger than a block get their own
+    char* big = (char*)arena_calloc(&arena, ARENA_MAX_BLOCK_SIZE * 2);
+    assert(big != NULL && big[ARENA_MAX_BLOCK_SIZE * 2 - 1] == 0);
+    char* text = arena_strndup(&arena, "hello world", 5);
+    assert(strcmp(text, "hello") == 0);
+
+    arena_reset(&arena);
+    assert(arena.head != NULL && arena.head->next == NULL && arena.head->used == 0);
+    arena_free(&arena);
+    assert(arena.head == NULL);
+
+    printf("✓ Arena test passed.\n");
+}
+
+int main() {
+    printf("Starting executor tests...\n\n");
+
+    test_arena();
+    test_simd_kernels();
+    Database* db = create_test_db();
+    test_scan_filter_limit(db);
+    test_compiled_predicates(db);
+    test_vectorized_filter(db);
+    test_sort_project(db);
+    test_aggregate(db);
+    test_group_aggregate(db);
+    test_nested_loop_join(db);
+    test_hash_join(db);
+    test_cursor(db);
+    test_operator_errors(db);
+    db_close(db);
+
+    cleanup_test_files();
+
+    printf("\nExecutor tests completed successfully!\n");
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "../src/database.h"
+#include "../src/btree.h"
+#include "../src/stats.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
@@ -6,7 +8,14 @@
 
 // helper function to clean up test databases
 void cleanup_test_files() {
-    system("rm -f test_indexes.db test_indexes_*.db wal.log");
+    system("rm -f test_indexes.db test_indexes_*.db test_indexes*.db.wal");
+}
+
+int count_rows(Database* db, const char* query) {
+    Result* result = db_execute(db, query);
+    int count = result != NULL ? result->num_rows : 0;
+    db_result_free(result);
+    return count;
 }
 
 void test_basic_index_creation() {
@@ -24,10 +33,11 @@ void test_basic_index_creation() {
     
     // verify index was created by checking catalog
     assert(db->catalog->num_tables == 1);
-    assert(db->catalog->tables[0].num_indexes == 1);
-    assert(strcmp(db->catalog->tables[0].indexes[0].name, "age_idx") == 0);
-    assert(strcmp(db->catalog->tables[0].indexes[0].column_name, "age") == 0);
-    assert(db->catalog->tables[0].indexes[0].is_unique == 0);
+    TableSchema* users = catalog_find_table(db->catalog, "users");
+    assert(users != NULL && users->num_indexes == 1);
+    assert(strcmp(users->indexes[0].name, "age_idx") == 0);
+    assert(strcmp(users->indexes[0].column_name, "age") == 0);
+    assert(users->indexes[0].is_unique == 0);
     
     printf("✓ Basic index creation test passed.\n");
     db_close(db);
@@ -47,9 +57,44 @@ void test_unique_index_creation() {
     db_execute(db, "CREATE UNIQUE INDEX email_idx ON users (email)");
     
     // verify unique index was created
-    assert(db->catalog->tables[0].num_indexes == 1);
-    assert(strcmp(db->catalog->tables[0].indexes[0].name, "email_idx") == 0);
-    assert(db->catalog->tables[0].indexes[0].is_unique == 1);
+    TableSchema* users = catalog_find_table(db->catalog, "users");
+    assert(users != NULL && users->num_indexes == 1);
+    assert(strcmp(users->indexes[0].name, "email_idx") == 0);
+    assert(users->indexes[0].is_unique == 1);
+
+    // a unique index takes each value once, whichever statement adds it
+    db_execute(db, "CREATE UNIQUE INDEX age_idx ON users (age)");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO users VALUES (1, 'a@x', 30), (2, 'b@x', 40), (3, 'c@x', NULL), (4, 'd@x', NULL)");
+    db_execute(db, "INSERT INTO users VALUES (5, 'e@x', 50), (6, 'f@x', 30)");
+    db_execute(db, "INSERT INTO users VALUES (7, 'g@x', 60), (8, 'h@x', 60)");
+    db_execute(db, "UPDATE users SET age = 40 WHERE id = 1");
+    db_execute(db, "UPDATE users SET age = 70 WHERE id > 2");
+    db_execute(db, "UPDATE users SET age = 30 WHERE id = 1");
+    db_execute(db, "UPDATE users SET age = 45 WHERE id = 2");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT id FROM users") == 4);
+    assert(count_rows(db, "SELECT id FROM users WHERE age = 45") == 1);
+    assert(count_rows(db, "SELECT id FROM users WHERE age IS NULL") == 2);
+
+    FILE* file = fopen("test_indexes_unique.csv", "w");
+    assert(file != NULL);
+    fprintf(file, "9,i@x,90\n10,j@x,100\n11,k@x,90\n");
+    fclose(file);
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY users FROM 'test_indexes_unique.csv'");
+    db_execute(db, "COMMIT");
+    remove("test_indexes_unique.csv");
+    assert(count_rows(db, "SELECT id FROM users") == 6);
+    assert(count_rows(db, "SELECT id FROM users WHERE id = 11") == 0);
+
+    // nor is one created over values that repeat
+    db_execute(db, "DROP INDEX age_idx ON users");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO users VALUES (13, 'm@x', 30)");
+    db_execute(db, "COMMIT");
+    db_execute(db, "CREATE UNIQUE INDEX age_idx ON users (age)");
+    assert(users->num_indexes == 1);
     
     printf("✓ Unique index creation test passed.\n");
     db_close(db);
@@ -74,13 +119,13 @@ void test_index_creation_errors() {
     
     // create valid index first
     db_execute(db, "CREATE INDEX name_idx ON users (name)");
-    assert(db->catalog->tables[0].num_indexes == 1);
+    assert(catalog_find_table(db->catalog, "users")->num_indexes == 1);
     
     // test duplicate index name - should handle gracefully
     db_execute(db, "CREATE INDEX name_idx ON users (id)");
     
     // should still have only one index
-    assert(db->catalog->tables[0].num_indexes == 1);
+    assert(catalog_find_table(db->catalog, "users")->num_indexes == 1);
     
     printf("✓ Index creation error handling test passed.\n");
     db_close(db);
@@ -200,6 +245,36 @@ void test_index_maintenance_delete() {
     assert(result->num_rows == 1);
     assert(strcmp(result->rows[0][1], "Marketing") == 0);
     
+    // rows sharing a value share its entry; deleting one of them must not
+    // take the entry from another, and deleting by the value removes them all
+    db_execute(db, "CREATE TABLE people (id INT, age INT)");
+    db_execute(db, "CREATE INDEX people_age_idx ON people (age)");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO people VALUES (1, 30)");
+    db_execute(db, "INSERT INTO people VALUES (2, 30)");
+    db_execute(db, "INSERT INTO people VALUES (3, 40)");
+    db_execute(db, "COMMIT");
+    IndexSchema* age_idx = &catalog_find_table(db->catalog, "people")->indexes[0];
+    uint16_t length;
+    char* entry = btree_search(db->pool, db->pager, age_idx->root_page_id, 30, &length);
+    assert(entry != NULL && *(int32_t*)entry == 2);
+    free(entry);
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE people SET age = 50 WHERE id = 1");
+    db_execute(db, "DELETE FROM people WHERE id = 1");
+    db_execute(db, "COMMIT");
+    entry = btree_search(db->pool, db->pager, age_idx->root_page_id, 30, &length);
+    assert(entry != NULL && *(int32_t*)entry == 2);
+    free(entry);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO people VALUES (1, 30)");
+    db_execute(db, "DELETE FROM people WHERE age = 30");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM people") == 1);
+    entry = btree_search(db->pool, db->pager, age_idx->root_page_id, 30, &length);
+    assert(entry == NULL);
+
     printf("✓ Index maintenance during DELETE test passed.\n");
     db_close(db);
 }
@@ -219,9 +294,10 @@ void test_multiple_indexes() {
     db_execute(db, "CREATE INDEX age_idx ON students (age)");
     
     // verify both indexes created
-    assert(db->catalog->tables[0].num_indexes == 2);
-    assert(strcmp(db->catalog->tables[0].indexes[0].name, "grade_idx") == 0);
-    assert(strcmp(db->catalog->tables[0].indexes[1].name, "age_idx") == 0);
+    TableSchema* students = catalog_find_table(db->catalog, "students");
+    assert(students != NULL && students->num_indexes == 2);
+    assert(strcmp(students->indexes[0].name, "grade_idx") == 0);
+    assert(strcmp(students->indexes[1].name, "age_idx") == 0);
     
     // insert data
     db_execute(db, "BEGIN");
@@ -230,11 +306,17 @@ void test_multiple_indexes() {
     db_execute(db, "INSERT INTO students VALUES (3, 'Charlie', 95, 20)");
     db_execute(db, "COMMIT");
     
-    // test query using grade index
-    // note: current implementation only returns first match for duplicate values
+    // an index holds one entry per value, so with values repeated the
+    // queries scan and still find every row
+    PreparedStatement* prepared = db_prepare(db, "SELECT * FROM students WHERE grade = 95");
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    db_finalize(prepared);
     Result* result = db_execute(db, "SELECT * FROM students WHERE grade = 95");
     assert(result != NULL);
-    assert(result->num_rows == 1); // only returns first match for now
+    assert(result->num_rows == 2);
+    db_result_free(result);
+    assert(count_rows(db, "SELECT id FROM students WHERE grade >= 87") == 3);
+    assert(count_rows(db, "SELECT id FROM students WHERE age BETWEEN 20 AND 20") == 2);
     
     // test query using age index
     result = db_execute(db, "SELECT * FROM students WHERE age = 21");
@@ -259,20 +341,20 @@ void test_drop_index() {
     db_execute(db, "CREATE INDEX amount_idx ON orders (amount)");
     
     // verify indexes created
-    assert(db->catalog->tables[0].num_indexes == 2);
+    assert(catalog_find_table(db->catalog, "orders")->num_indexes == 2);
     
     // drop one index
     db_execute(db, "DROP INDEX customer_idx ON orders");
     
     // verify index was removed
-    assert(db->catalog->tables[0].num_indexes == 1);
-    assert(strcmp(db->catalog->tables[0].indexes[0].name, "amount_idx") == 0);
+    assert(catalog_find_table(db->catalog, "orders")->num_indexes == 1);
+    assert(strcmp(catalog_find_table(db->catalog, "orders")->indexes[0].name, "amount_idx") == 0);
     
     // drop remaining index
     db_execute(db, "DROP INDEX amount_idx ON orders");
     
     // verify all indexes removed
-    assert(db->catalog->tables[0].num_indexes == 0);
+    assert(catalog_find_table(db->catalog, "orders")->num_indexes == 0);
     
     printf("✓ DROP INDEX test passed.\n");
     db_close(db);
@@ -354,6 +436,552 @@ void test_edge_cases() {
     db_close(db);
 }
 
+void test_range_scans() {
+    printf("Testing range scans...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_indexes_range.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE nums (id INT, score INT, label VARCHAR(10))");
+    db_execute(db, "CREATE UNIQUE INDEX score_idx ON nums (score)");
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO nums VALUES (?, ?, ?)");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 2000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i * 2);
+        db_bind_text(insert, 3, i % 2 == 0 ? "even" : "odd");
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_execute(db, "COMMIT");
+    db_finalize(insert);
+
+    // ranges on the primary key walk the table's own tree
+    PreparedStatement* prepared = db_prepare(db, "SELECT id FROM nums WHERE id > 1990");
+    assert(prepared->access == ACCESS_PRIMARY_KEY);
+    Result* result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 10);
+    assert(strcmp(result->rows[0][0], "1991") == 0 && strcmp(result->rows[9][0], "2000") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+    assert(count_rows(db, "SELECT id FROM nums WHERE id <= 5") == 5);
+    assert(count_rows(db, "SELECT id FROM nums WHERE 100 < id AND id < 103") == 2);
+    assert(count_rows(db, "SELECT id FROM nums WHERE id BETWEEN 100 AND 109") == 10);
+    assert(count_rows(db, "SELECT id FROM nums WHERE id >= 100 AND id < 1900") == 1800); // several batches
+    assert(count_rows(db, "SELECT id FROM nums WHERE id BETWEEN 10 AND 5") == 0);
+    assert(count_rows(db, "SELECT id FROM nums WHERE id > 2147483647") == 0);
+    assert(count_rows(db, "SELECT id FROM nums WHERE id < -5") == 0);
+
+    // NOT BETWEEN is not a range, the rest of the condition still filters
+    prepared = db_prepare(db, "SELECT id FROM nums WHERE id NOT BETWEEN 2 AND 1999");
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 2);
+    db_result_free(result);
+    db_finalize(prepared);
+    assert(count_rows(db, "SELECT id FROM nums WHERE id < 10 AND label = 'odd'") == 5);
+
+    // ranges on an indexed column go through the index
+    prepared = db_prepare(db, "SELECT id FROM nums WHERE score >= 3990");
+    assert(prepared->access == ACCESS_INDEX && prepared->index != NULL);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 6 && strcmp(result->rows[0][0], "1995") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // the tighter bounds win: an equality beats a range
+    prepared = db_prepare(db, "SELECT id FROM nums WHERE id > 10 AND score = 40");
+    assert(prepared->access == ACCESS_INDEX);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT id FROM nums WHERE id BETWEEN 1 AND 100 AND score > 40");
+    assert(prepared->access == ACCESS_PRIMARY_KEY);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 80);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // bounds can be parameters
+    prepared = db_prepare(db, "SELECT id FROM nums WHERE score BETWEEN ? AND ?");
+    assert(prepared->access == ACCESS_INDEX);
+    db_bind_int(prepared, 1, 20);
+    db_bind_int(prepared, 2, 30);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 6 && strcmp(result->rows[5][0], "15") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    printf("✓ Range scan test passed.\n");
+    db_close(db);
+}
+
+void test_analyze() {
+    printf("Testing ANALYZE and cost-based planning...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_indexes_analyze.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE facts (id INT, score INT, flag INT, label VARCHAR(10))");
+    db_execute(db, "CREATE UNIQUE INDEX score_idx ON facts (score)");
+    db_execute(db, "CREATE INDEX flag_idx ON facts (flag)");
+    const char* labels[] = {"red", "green", "blue", "cyan"};
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO facts VALUES (?, ?, ?, ?)");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 5000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i * 2);
+        db_bind_int(insert, 3, i % 2);
+        db_bind_text(insert, 4, i % 10 == 0 ? NULL : labels[i % 4]);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_execute(db, "COMMIT");
+    db_finalize(insert);
+
+    // without statistics any equality on a unique indexed column uses the index
+    PreparedStatement* prepared = db_prepare(db, "SELECT id FROM facts WHERE score = 40");
+    assert(prepared->access == ACCESS_INDEX);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT id FROM facts WHERE flag = 1");
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    db_finalize(prepared);
+
+    // statements prepared before ANALYZE are planned again after it
+    prepared = db_prepare(db, "SELECT id, label FROM facts WHERE flag = 1");
+    db_execute(db, "ANALYZE facts");
+    Result* result = db_step(prepared);
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    assert(result != NULL && result->num_rows == 2500);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    TableStats* stats = &catalog_find_table(db->catalog, "facts")->stats;
+    assert(stats->analyzed && stats->num_rows == 5000 && stats->num_pages > 1);
+    assert(stats->columns[0].num_distinct == 5000 && stats->columns[0].num_nulls == 0);
+    assert(stats->columns[2].num_distinct == 2);
+    assert(stats->columns[3].num_distinct == 4 && stats->columns[3].num_nulls == 500);
+    assert(stats->columns[3].num_bounds == 0); // no histograms for text
+    assert(stats->columns[1].num_bounds == HISTOGRAM_BUCKETS + 1);
+    assert(stats->columns[1].bounds[0] == 2 && stats->columns[1].bounds[HISTOGRAM_BUCKETS] == 10000);
+    double half = stats_fraction_below(&stats->columns[1], 5001);
+    assert(half > 0.45 && half < 0.55);
+    assert(stats_fraction_below(&stats->columns[1], 0) == 0);
+    assert(stats_fraction_below(&stats->columns[1], 20000) == 1);
+    assert(stats_fraction_below(&stats->columns[3], 1) == -1);
+
+    // a selective range probes the index, an unselective one scans
+    prepared = db_prepare(db, "SELECT id FROM facts WHERE score < 20");
+    assert(prepared->access == ACCESS_INDEX);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT id, label FROM facts WHERE score > 100");
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 4950);
+    db_result_free(result);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT id FROM facts WHERE score = 500 AND flag = 0");
+    assert(prepared->access == ACCESS_INDEX && strcmp(prepared->index->name, "score_idx") == 0);
+    db_finalize(prepared);
+
+    // the primary key reads its range in order, cheaper than fetching rows from
+    // an index unless the index range is much smaller
+    prepared = db_prepare(db, "SELECT id FROM facts WHERE id BETWEEN 100 AND 2000");
+    assert(prepared->access == ACCESS_PRIMARY_KEY);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT id FROM facts WHERE id < 4000 AND score BETWEEN 10 AND 14");
+    assert(prepared->access == ACCESS_INDEX);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 3);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // however selective, an index whose values repeat is not costed at all:
+    // it would return one row per value
+    db_execute(db, "CREATE TABLE pairs (id INT, pair INT)");
+    db_execute(db, "CREATE INDEX pair_idx ON pairs (pair)");
+    insert = db_prepare(db, "INSERT INTO pairs VALUES (?, ?)");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 4000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i / 2);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_execute(db, "COMMIT");
+    db_finalize(insert);
+    db_execute(db, "ANALYZE pairs");
+    prepared = db_prepare(db, "SELECT id FROM pairs WHERE pair = 700");
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 2);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // statistics are saved with the catalog
+    db_close(db);
+    db = db_open("test_indexes_analyze.db");
+    assert(db != NULL);
+    stats = &catalog_find_table(db->catalog, "facts")->stats;
+    assert(stats->analyzed && stats->num_rows == 5000);
+    prepared = db_prepare(db, "SELECT id, label FROM facts WHERE flag = 0");
+    assert(prepared->access == ACCESS_SEQ_SCAN);
+    db_finalize(prepared);
+
+    // ANALYZE is ddl: not inside a transaction, and the table must exist
+    db_execute(db, "ANALYZE missing");
+    db_execute(db, "BEGIN");
+    db_execute(db, "ANALYZE");
+    db_execute(db, "ROLLBACK");
+    db_execute(db, "ANALYZE");
+    assert(catalog_find_table(db->catalog, "facts")->stats.num_rows == 5000);
+
+    printf("✓ ANALYZE test passed.\n");
+    db_close(db);
+}
+
+void test_covering_index() {
+    printf("Testing covering indexes...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_indexes_covering.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, sku INT, qty INT, price DOUBLE, name VARCHAR(20), notes TEXT)");
+    db_execute(db, "CREATE UNIQUE INDEX sku_idx ON items (sku) INCLUDE (price, name)");
+    db_execute(db, "CREATE UNIQUE INDEX qty_idx ON items (qty)");
+    db_execute(db, "CREATE INDEX bad_idx ON items (qty) INCLUDE (missing)");
+    assert(catalog_find_table(db->catalog, "items")->num_indexes == 2);
+    assert(catalog_find_table(db->catalog, "items")->indexes[0].num_include_columns == 2);
+
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO items VALUES (?, ?, ?, ?, ?, 'long notes')");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 500; i++) {
+        char price[16];
+        char name[16];
+        snprintf(price, sizeof(price), "%d.5", i);
+        snprintf(name, sizeof(name), "item%d", i);
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i + 1000);
+        db_bind_int(insert, 3, i);
+        db_bind_text(insert, 4, price);
+        db_bind_text(insert, 5, i == 3 ? NULL : name);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_execute(db, "COMMIT");
+    db_finalize(insert);
+
+    // the key, the primary key and the included columns come from the index alone
+    PreparedStatement* prepared = db_prepare(db, "SELECT id, price, name FROM items WHERE sku BETWEEN 1001 AND 1010 AND price > 2");
+    assert(prepared->access == ACCESS_INDEX && prepared->index_only);
+    Result* result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 9);
+    assert(strcmp(result->rows[0][0], "2") == 0 && strcmp(result->rows[0][1], "2.5") == 0);
+    assert(result->rows[1][2] == NULL && strcmp(result->rows[8][2], "item10") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // entries without INCLUDE columns still answer for the key and the primary key
+    prepared = db_prepare(db, "SELECT qty, id FROM items WHERE qty < 4 ORDER BY id DESC");
+    assert(prepared->access == ACCESS_INDEX && prepared->index_only);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 3);
+    assert(strcmp(result->rows[0][0], "3") == 0 && strcmp(result->rows[0][1], "3") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // any other column sends the scan to the table
+    prepared = db_prepare(db, "SELECT notes FROM items WHERE sku = 1005");
+    assert(prepared->access == ACCESS_INDEX && !prepared->index_only);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 1 && strcmp(result->rows[0][0], "long notes") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT price FROM items WHERE qty = 7");
+    assert(prepared->access == ACCESS_INDEX && !prepared->index_only);
+    db_finalize(prepared);
+
+    // updates and deletes keep the included columns current
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET price = 99.25, name = 'renamed' WHERE id = 4");
+    db_execute(db, "DELETE FROM items WHERE id = 5");
+    db_execute(db, "COMMIT");
+    result = db_execute(db, "SELECT price, name FROM items WHERE sku BETWEEN 1004 AND 1005");
+    assert(result != NULL && result->num_rows == 1);
+    assert(strcmp(result->rows[0][0], "99.25") == 0 && strcmp(result->rows[0][1], "renamed") == 0);
+    db_result_free(result);
+
+    // the INCLUDE list is saved with the catalog
+    db_close(db);
+    db = db_open("test_indexes_covering.db");
+    assert(db != NULL);
+    prepared = db_prepare(db, "SELECT name FROM items WHERE sku = 1006");
+    assert(prepared->access == ACCESS_INDEX && prepared->index_only);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 1 && strcmp(result->rows[0][0], "item6") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    printf("✓ Covering index test passed.\n");
+    db_close(db);
+}
+
+void test_set_based_changes() {
+    printf("Testing UPDATE and DELETE over many rows...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_indexes_set.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, score INT, name VARCHAR(30))");
+    db_execute(db, "CREATE UNIQUE INDEX score_idx ON items (score) INCLUDE (name)");
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO items VALUES (?, ?, 'item')");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 3000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i * 10);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_finalize(insert);
+    db_execute(db, "COMMIT");
+
+    // a range of the index, and the entries' INCLUDE copies follow the rows
+    PreparedStatement* update = db_prepare(db, "UPDATE items SET name = 'cheap' WHERE score < 5000");
+    assert(update != NULL && update->access == ACCESS_INDEX);
+    db_execute(db, "BEGIN");
+    db_step(update);
+    db_finalize(update);
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT id FROM items WHERE name = 'cheap'") == 499);
+    Result* result = db_execute(db, "SELECT name FROM items WHERE score BETWEEN 100 AND 120");
+    assert(result != NULL && result->num_rows == 3 && strcmp(result->rows[2][0], "cheap") == 0);
+    db_result_free(result);
+
+    // moving index keys, and a change rolled back
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET score = 7 WHERE id = 5");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT id FROM items WHERE score = 50") == 0);
+    result = db_execute(db, "SELECT id FROM items WHERE score = 7");
+    assert(result != NULL && result->num_rows == 1 && strcmp(result->rows[0][0], "5") == 0);
+    db_result_free(result);
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET name = 'gone' WHERE name = 'item' OR name IS NULL");
+    assert(count_rows(db, "SELECT id FROM items WHERE name = 'gone'") == 2501);
+    db_execute(db, "ROLLBACK");
+    assert(count_rows(db, "SELECT id FROM items WHERE name = 'item'") == 2501);
+
+    // deletes by primary key range, by index range and by a full scan
+    PreparedStatement* delete_ = db_prepare(db, "DELETE FROM items WHERE id BETWEEN ? AND ?");
+    assert(delete_ != NULL && delete_->access == ACCESS_PRIMARY_KEY);
+    db_execute(db, "BEGIN");
+    db_bind_int(delete_, 1, 2900);
+    db_bind_int(delete_, 2, 2999);
+    db_step(delete_);
+    db_finalize(delete_);
+    db_execute(db, "DELETE FROM items WHERE score >= 20000");
+    db_execute(db, "DELETE FROM items WHERE name = 'cheap'");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM items") == 1500);
+    assert(count_rows(db, "SELECT * FROM items WHERE score = 25000") == 0);
+    assert(count_rows(db, "SELECT * FROM items WHERE score = 7") == 0);
+    assert(count_rows(db, "SELECT * FROM items WHERE score = 19990") == 1);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "DELETE FROM items");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM items") == 0);
+    assert(db_prepare(db, "DELETE FROM items WHERE COUNT(*) > 1") == NULL);
+    assert(db_prepare(db, "UPDATE items SET id = 1 WHERE score > 1") == NULL);
+
+    // a row past the first batches that outgrows ROW_MAX_SIZE stops the
+    // update before any row changes
+    char text[601];
+    memset(text, 'n', 600);
+    text[600] = '\0';
+    int wide_id = MODIFY_BATCH_ROWS * 2 + 10;
+    db_execute(db, "CREATE TABLE notes (id INT, note TEXT, extra TEXT)");
+    insert = db_prepare(db, "INSERT INTO notes VALUES (?, ?, NULL)");
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 3000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_text(insert, 2, i == wide_id ? text : "short");
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_finalize(insert);
+    db_execute(db, "COMMIT");
+    update = db_prepare(db, "UPDATE notes SET extra = ?");
+    text[500] = '\0';
+    db_bind_text(update, 1, text);
+    db_execute(db, "BEGIN");
+    db_step(update);
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT id FROM notes WHERE extra IS NULL") == 3000);
+    db_execute(db, "BEGIN");
+    char query[64];
+    snprintf(query, sizeof(query), "DELETE FROM notes WHERE id = %d", wide_id);
+    db_execute(db, query);
+    db_reset(update);
+    db_step(update);
+    db_finalize(update);
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT id FROM notes WHERE extra IS NULL") == 0);
+    assert(count_rows(db, "SELECT id FROM notes") == 2999);
+    db_close(db);
+
+    printf("✓ Set-based UPDATE and DELETE test passed.\n");
+}
+
+void test_catalog_lookup() {
+    printf("Testing the system catalog...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_indexes_catalog.db");
+    assert(db != NULL);
+    // well past what one page could describe, each with the full number of
+    // columns, c1 to c15 after the id
+    char sql[1024];
+    int num_tables = 300;
+    for (int t = 0; t < num_tables; t++) {
+        int length = snprintf(sql, sizeof(sql), "CREATE TABLE t%d (id INT", t);
+        for (int c = 1; c < MAX_COLUMNS_PER_TABLE; c++) {
+            length += snprintf(sql + length, sizeof(sql) - length, ", c%d INT", c);
+        }
+        snprintf(sql + length, sizeof(sql) - length, ")");
+        db_execute(db, sql);
+        if (t == 1) {
+            db_execute(db, "CREATE TABLE t1 (id INT)");
+            assert(db->catalog->num_tables == 2);
+        }
+    }
+    assert(db->catalog->num_tables == num_tables);
+
+    db_execute(db, "CREATE INDEX c15_idx ON t209 (c15)");
+    db_execute(db, "CREATE INDEX c3_idx ON t209 (c3)");
+    db_execute(db, "BEGIN");
+    // column c of row r holds r * 100 + c
+    int length = snprintf(sql, sizeof(sql), "INSERT INTO t209 VALUES (1");
+    for (int r = 1; r <= 2; r++) {
+        length += snprintf(sql + length, sizeof(sql) - length, r == 1 ? "" : ", (%d", r);
+        for (int c = 1; c < MAX_COLUMNS_PER_TABLE; c++) {
+            length += snprintf(sql + length, sizeof(sql) - length, ", %d", r * 100 + c);
+        }
+        length += snprintf(sql + length, sizeof(sql) - length, ")");
+    }
+    db_execute(db, sql);
+    db_execute(db, "COMMIT");
+    db_execute(db, "DROP INDEX c15_idx ON t209");
+    db_execute(db, "ANALYZE t209");
+    db_close(db);
+
+    // opening reads only the header, tables are loaded when first named
+    db = db_open("test_indexes_catalog.db");
+    assert(db != NULL);
+    assert(db->catalog->num_tables == num_tables && db->catalog->num_loaded == 0);
+    PreparedStatement* select = db_prepare(db, "SELECT c7 FROM t209 WHERE c3 = 203");
+    assert(select != NULL && db->catalog->num_loaded == 1);
+    Result* result = db_step(select);
+    assert(result != NULL && result->num_rows == 1 && strcmp(result->rows[0][0], "207") == 0);
+    db_result_free(result);
+    db_finalize(select);
+    TableSchema* table = catalog_find_table(db->catalog, "t209");
+    assert(table->num_indexes == 1 && strcmp(table->indexes[0].name, "c3_idx") == 0);
+    assert(table->stats.analyzed && table->stats.num_rows == 2 && table->stats.columns[15].num_distinct == 2);
+    assert(db_prepare(db, "SELECT c16 FROM t209") == NULL);
+    assert(db_prepare(db, "SELECT id FROM t300") == NULL);
+
+    // listing loads the rest, in creation order
+    int count;
+    TableSchema** tables = catalog_list_tables(db->catalog, &count);
+    assert(count == num_tables && db->catalog->num_loaded == (uint32_t)num_tables);
+    assert(strcmp(tables[0]->table_name, "t0") == 0 && strcmp(tables[num_tables - 1]->table_name, "t299") == 0);
+    assert(tables[209] == table && tables[1]->num_columns == MAX_COLUMNS_PER_TABLE);
+    free(tables);
+    db_execute(db, "CREATE TABLE extra (id INT)");
+    assert(catalog_find_table(db->catalog, "extra")->id == num_tables + 1);
+    db_close(db);
+
+    printf("✓ System catalog test passed.\n");
+}
+
+void test_legacy_catalog() {
+    printf("Testing the migration of a legacy catalog...\n");
+    cleanup_test_files();
+
+    // lay the file out as before the system trees: the root at page 0, the
+    // catalog struct in the metadata pages after it, then the table's trees
+    Pager* pager = pager_open("test_indexes_legacy.db");
+    BufferPool* pool = buffer_pool_init();
+    assert(btree_create(pool, pager, NULL) == 0);
+    for (uint32_t i = 0; i < LEGACY_CATALOG_NUM_PAGES; i++) {
+        pager_allocate_page(pager);
+    }
+    LegacyCatalog* legacy = (LegacyCatalog*)calloc(1, sizeof(LegacyCatalog));
+    legacy->num_tables = 2;
+    LegacyTableSchema* people = &legacy->tables[0];
+    strcpy(people->table_name, "people");
+    people->root_page_id = btree_create(pool, pager, NULL);
+    people->num_columns = 2;
+    strcpy(people->columns[0].name, "id");
+    people->columns[0].type = COLUMN_TYPE_INT;
+    people->columns[0].is_primary_key = 1;
+    strcpy(people->columns[1].name, "age");
+    people->columns[1].type = COLUMN_TYPE_INT;
+    people->num_indexes = 1;
+    strcpy(people->indexes[0].name, "age_idx");
+    strcpy(people->indexes[0].table_name, "people");
+    strcpy(people->indexes[0].column_name, "age");
+    people->indexes[0].root_page_id = btree_create(pool, pager, NULL);
+    people->stats.num_rows = 7;
+    LegacyTableSchema* notes = &legacy->tables[1];
+    strcpy(notes->table_name, "notes");
+    notes->root_page_id = btree_create(pool, pager, NULL);
+    notes->num_columns = 1;
+    strcpy(notes->columns[0].name, "id");
+    notes->columns[0].type = COLUMN_TYPE_INT;
+
+    const char* src = (const char*)legacy;
+    size_t remaining = sizeof(LegacyCatalog);
+    for (uint32_t i = 0; i < LEGACY_CATALOG_NUM_PAGES; i++) {
+        size_t chunk = remaining < LEGACY_CATALOG_PAGE_CAPACITY ? remaining : LEGACY_CATALOG_PAGE_CAPACITY;
+        Page* page = buffer_pool_get_page(pool, pager, 1 + i);
+        page->header.page_type = PAGE_TYPE_METADATA;
+        memcpy(page->data, src, chunk);
+        buffer_pool_unpin_page(pool, pager, 1 + i, 1);
+        src += chunk;
+        remaining -= chunk;
+    }
+    free(legacy);
+    buffer_pool_flush_all(pool, pager);
+    pager_close(pager);
+    buffer_pool_free(pool);
+
+    // the first open moves the tables into the system trees, keeping their trees
+    Database* db = db_open("test_indexes_legacy.db");
+    assert(db != NULL);
+    assert(db->catalog->num_tables == 2);
+    TableSchema* table = catalog_find_table(db->catalog, "people");
+    assert(table != NULL && table->id == 1 && table->num_columns == 2 && table->columns[0].is_primary_key);
+    assert(table->num_indexes == 1 && strcmp(table->indexes[0].name, "age_idx") == 0 && table->stats.num_rows == 7);
+    assert(catalog_find_table(db->catalog, "notes")->id == 2);
+    assert(catalog_find_column(table, "age") == 1);
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO people VALUES (1, 30), (2, 40), (3, 30)");
+    db_execute(db, "COMMIT");
+    db_close(db);
+
+    // and later opens find them there
+    db = db_open("test_indexes_legacy.db");
+    assert(db != NULL);
+    assert(db->catalog->num_tables == 2 && db->catalog->num_loaded == 0);
+    assert(count_rows(db, "SELECT id FROM people WHERE age = 30") == 2);
+    assert(count_rows(db, "SELECT id FROM people") == 3);
+    db_execute(db, "CREATE TABLE extra (id INT)");
+    assert(catalog_find_table(db->catalog, "extra")->id == 3);
+    db_close(db);
+
+    printf("✓ Legacy catalog migration test passed.\n");
+}
+
 int main() {
     printf("Starting index tests...\n\n");
     
@@ -367,6 +995,12 @@ int main() {
     test_drop_index();
     test_query_optimization();
     test_edge_cases();
+    test_range_scans();
+    test_analyze();
+    test_covering_index();
+    test_set_based_changes();
+    test_catalog_lookup();
+    test_legacy_catalog();
     
     cleanup_test_files();
     
@@ -5,7 +5,7 @@
 #include <stdlib.h>
 
 void cleanup_test_files() {
-    system("rm -f test_integration.db wal.log");
+    system("rm -f test_integration.db test_integration.db.wal");
 }
 
 void test_basic_workflow() {
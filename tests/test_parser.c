@@ -0,0 +1,603 @@
+#include "../src/database.h"
+#include "../src/parser.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+void cleanup_test_files() {
+    system("rm -f test_parser*.db test_parser*.db.wal test_parser*.csv");
+}
+
+void test_parse_select() {
+    printf("Testing SELECT parsing...\n");
+
+    Statement* statement = parse_statement("select id, name FROM users WHERE age >= 18 AND (name = 'O''Brien' OR NOT active) "
+                                           "ORDER BY age DESC, id LIMIT 10;");
+    assert(statement != NULL && statement->type == STATEMENT_SELECT);
+    SelectStatement* select = &statement->select;
+    assert(!select->select_star && select->num_columns == 2);
+    assert(strcmp(select->columns[1]->name, "name") == 0);
+    assert(strcmp(select->table_name, "users") == 0);
+    assert(select->limit == 10);
+    assert(select->num_order_by == 2);
+    assert(select->order_by[0].descending && !select->order_by[1].descending);
+
+    // AND binds tighter than OR, parentheses group
+    Expr* where = select->where;
+    assert(where->type == EXPR_AND);
+    assert(where->left->type == EXPR_COMPARE && where->left->op == COMPARE_GE);
+    assert(where->right->type == EXPR_OR);
+    Expr* name = where->right->left->right;
+    assert(name->type == EXPR_LITERAL && strcmp(name->text, "O'Brien") == 0);
+    assert(where->right->right->type == EXPR_NOT);
+    statement_free(statement);
+
+    statement = parse_statement("SELECT * FROM t WHERE a <> -3 OR b IS NOT NULL");
+    assert(statement != NULL && statement->select.select_star && statement->select.limit == -1);
+    assert(statement->select.where->type == EXPR_OR);
+    assert(strcmp(statement->select.where->left->right->text, "-3") == 0);
+    assert(statement->select.where->right->type == EXPR_IS_NULL && statement->select.where->right->negated);
+    statement_free(statement);
+
+    // BETWEEN is sugar for a pair of inclusive comparisons
+    statement = parse_statement("SELECT * FROM t WHERE a BETWEEN 1 AND 5 AND b NOT BETWEEN 2 AND 3");
+    assert(statement != NULL && statement->select.where->type == EXPR_AND);
+    Expr* between = statement->select.where->left;
+    assert(between->type == EXPR_AND && between->left->op == COMPARE_GE && between->right->op == COMPARE_LE);
+    assert(strcmp(between->right->right->text, "5") == 0);
+    assert(statement->select.where->right->type == EXPR_NOT);
+    statement_free(statement);
+
+    statement = parse_statement("CREATE UNIQUE INDEX sku_idx ON items (sku) INCLUDE (price, name)");
+    assert(statement != NULL && statement->type == STATEMENT_CREATE_INDEX && statement->create_index.is_unique);
+    assert(statement->create_index.num_include_columns == 2);
+    assert(strcmp(statement->create_index.include_columns[1], "name") == 0);
+    statement_free(statement);
+
+    statement = parse_statement("SELECT * FROM t ORDER BY id LIMIT 20 OFFSET 40");
+    assert(statement != NULL && statement->select.limit == 20 && statement->select.offset == 40);
+    statement_free(statement);
+    statement = parse_statement("SELECT * FROM t OFFSET 3");
+    assert(statement != NULL && statement->select.limit == -1 && statement->select.offset == 3);
+    statement_free(statement);
+
+    statement = parse_statement("ANALYZE users");
+    assert(statement != NULL && statement->type == STATEMENT_ANALYZE);
+    assert(strcmp(statement->analyze.table_name, "users") == 0);
+    statement_free(statement);
+    statement = parse_statement("analyze;");
+    assert(statement != NULL && statement->type == STATEMENT_ANALYZE && statement->analyze.table_name[0] == '\0');
+    statement_free(statement);
+
+    statement = parse_statement("SELECT a.x, b.y FROM a JOIN b ON a.id = b.a_id AND b.y > 1 WHERE a.x = 2");
+    assert(statement != NULL && strcmp(statement->select.join_table_name, "b") == 0);
+    assert(statement->select.join_condition->type == EXPR_AND && statement->select.where->type == EXPR_COMPARE);
+    assert(strcmp(statement->select.columns[1]->table_name, "b") == 0);
+    statement_free(statement);
+
+    // aggregate names are only functions when a '(' follows
+    statement = parse_statement("SELECT region, count(*), SUM(amount), count FROM sales GROUP BY region, count ORDER BY MAX(amount)");
+    assert(statement != NULL && statement->select.num_columns == 4 && statement->select.num_group_by == 2);
+    Expr** columns = statement->select.columns;
+    assert(columns[1]->type == EXPR_AGGREGATE && columns[1]->function == AGGREGATE_COUNT && columns[1]->left == NULL);
+    assert(columns[2]->function == AGGREGATE_SUM && strcmp(columns[2]->left->name, "amount") == 0);
+    assert(columns[3]->type == EXPR_COLUMN && strcmp(statement->select.group_by[1]->name, "count") == 0);
+    assert(statement->select.order_by[0].expr->function == AGGREGATE_MAX);
+    statement_free(statement);
+
+    printf("✓ SELECT parsing test passed.\n");
+}
+
+void test_parse_errors() {
+    printf("Testing parse errors...\n");
+
+    assert(parse_statement("SELECT FROM users") == NULL);
+    assert(parse_statement("SELECT * FROM users WHERE") == NULL);
+    assert(parse_statement("SELECT * FROM users WHERE name = 'open") == NULL);
+    assert(parse_statement("INSERT INTO users VALUES (1, 'a'), (2)") == NULL);
+    assert(parse_statement("CREATE TABLE t (id BIGNUM)") == NULL);
+    assert(parse_statement("SELECT * FROM users extra") == NULL);
+    assert(parse_statement("FROB users") == NULL);
+    assert(parse_statement("SELECT * FROM t WHERE a NOT 5") == NULL);
+    assert(parse_statement("SELECT * FROM t WHERE a BETWEEN 1 OR 5") == NULL);
+    assert(parse_statement("ANALYZE users extra") == NULL);
+    assert(parse_statement("CREATE INDEX i ON t (a) INCLUDE ()") == NULL);
+    assert(parse_statement("SELECT * FROM a JOIN b") == NULL);
+    assert(parse_statement("SELECT * FROM a INNER b ON a.x = b.y") == NULL);
+    assert(parse_statement("SELECT SUM(*) FROM t") == NULL);
+    assert(parse_statement("SELECT COUNT(a, b) FROM t") == NULL);
+    assert(parse_statement("SELECT a FROM t GROUP a") == NULL);
+    assert(parse_statement("SELECT a FROM t GROUP BY 1") == NULL);
+    assert(parse_statement("SELECT a FROM t LIMIT 1 OFFSET") == NULL);
+    assert(parse_statement("SELECT a FROM t OFFSET 1 LIMIT 1") == NULL);
+    assert(parse_statement("COPY t FROM data.csv") == NULL);
+    assert(parse_statement("COPY t 'data.csv'") == NULL);
+
+    printf("✓ Parse error test passed.\n");
+}
+
+void test_queries() {
+    printf("Testing queries through the parser...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_parser.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE users (id INT, name VARCHAR(50), age INT)");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO users VALUES (1, 'Alice', 30), (2, 'Bob', 25), (3, 'Carol', 35), (4, 'Dan', NULL)");
+    db_execute(db, "INSERT INTO users VALUES (5, 'Eve', 25), (6, 'bad')"); // rejected as a whole
+    db_execute(db, "COMMIT");
+
+    Result* result = db_execute(db, "SELECT * FROM users");
+    assert(result != NULL && result->num_rows == 4 && result->num_columns == 3);
+
+    // select list projects columns in the order given
+    result = db_execute(db, "SELECT age, name FROM users WHERE id = 3");
+    assert(result != NULL && result->num_columns == 2);
+    assert(strcmp(result->rows[0][0], "35") == 0 && strcmp(result->rows[0][1], "Carol") == 0);
+
+    result = db_execute(db, "SELECT id FROM users WHERE age > 26 AND name != 'Carol' OR id = 2");
+    assert(result != NULL && result->num_rows == 2);
+    assert(strcmp(result->rows[0][0], "1") == 0 && strcmp(result->rows[1][0], "2") == 0);
+
+    result = db_execute(db, "SELECT id FROM users WHERE age IS NULL");
+    assert(result != NULL && result->num_rows == 1 && strcmp(result->rows[0][0], "4") == 0);
+
+    result = db_execute(db, "SELECT name FROM users ORDER BY age DESC, name");
+    assert(result != NULL && result->num_rows == 4);
+    assert(strcmp(result->rows[0][0], "Carol") == 0 && strcmp(result->rows[2][0], "Bob") == 0);
+    assert(strcmp(result->rows[3][0], "Dan") == 0); // nulls sort first, so last descending
+
+    result = db_execute(db, "SELECT id FROM users ORDER BY name DESC LIMIT 2");
+    assert(result != NULL && result->num_rows == 2 && strcmp(result->rows[0][0], "4") == 0);
+    result = db_execute(db, "SELECT id FROM users LIMIT 3");
+    assert(result != NULL && result->num_rows == 3);
+
+    // an index serves one conjunct, the rest of the condition still applies
+    db_execute(db, "CREATE INDEX age_idx ON users (age)");
+    result = db_execute(db, "SELECT name FROM users WHERE age = 35 AND name = 'Carol'");
+    assert(result != NULL && strcmp(result->rows[0][0], "Carol") == 0);
+    assert(db_execute(db, "SELECT name FROM users WHERE age = 35 AND name = 'Alice'") == NULL);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE users SET name = 'Caroline', age = 36 WHERE id = 3");
+    db_execute(db, "DELETE FROM users WHERE id = 1 AND name = 'Nobody'");
+    db_execute(db, "COMMIT");
+    result = db_execute(db, "SELECT name, age FROM users WHERE id = 3");
+    assert(result != NULL && strcmp(result->rows[0][0], "Caroline") == 0 && strcmp(result->rows[0][1], "36") == 0);
+    result = db_execute(db, "SELECT * FROM users WHERE id = 1");
+    assert(result != NULL);
+
+    assert(db_execute(db, "SELECT missing FROM users") == NULL);
+    db_close(db);
+
+    printf("✓ Query test passed.\n");
+}
+
+void test_prepared_statements() {
+    printf("Testing prepared statements...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_parser_prepared.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(20), price DOUBLE)");
+
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO items VALUES (?, ?, ?)");
+    assert(insert != NULL && insert->statement->num_parameters == 3);
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 50; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "item_%d", i);
+        assert(db_bind_int(insert, 1, i) == 0);
+        assert(db_bind_text(insert, 2, i % 10 == 0 ? NULL : name) == 0);
+        assert(db_bind_int(insert, 3, i * 2) == 0); // converted to the DOUBLE column
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_execute(db, "COMMIT");
+    assert(db_bind_int(insert, 4, 0) != 0);
+    db_finalize(insert);
+
+    PreparedStatement* lookup = db_prepare(db, "SELECT name, price FROM items WHERE id = ? OR price > ?");
+    assert(lookup != NULL);
+    db_bind_int(lookup, 1, 7);
+    db_bind_text(lookup, 2, "99.5");
+    Result* result = db_step(lookup);
+    assert(result != NULL && result->num_rows == 2);
+    assert(strcmp(result->rows[0][0], "item_7") == 0 && strcmp(result->rows[1][1], "100") == 0);
+
+    // a statement runs once per reset, bindings survive the reset
+    assert(db_step(lookup) == NULL);
+    db_reset(lookup);
+    db_bind_int(lookup, 1, 20);
+    result = db_step(lookup);
+    assert(result != NULL && result->num_rows == 2 && result->rows[0][0] == NULL);
+    db_finalize(lookup);
+
+    // the access path is re-planned after ddl
+    PreparedStatement* by_id = db_prepare(db, "SELECT name FROM items WHERE id = ?");
+    assert(by_id != NULL && by_id->index == NULL);
+    db_execute(db, "CREATE TABLE other (id INT, price INT)");
+    db_execute(db, "CREATE UNIQUE INDEX id_idx ON items (id)");
+    PreparedStatement* update = db_prepare(db, "UPDATE items SET name = ? WHERE id = ?");
+    assert(update != NULL);
+    db_execute(db, "BEGIN");
+    db_bind_text(update, 1, "renamed");
+    db_bind_int(update, 2, 3);
+    db_step(update);
+    db_execute(db, "COMMIT");
+    db_finalize(update);
+    db_bind_int(by_id, 1, 3);
+    result = db_step(by_id);
+    assert(by_id->index != NULL);
+    assert(result != NULL && strcmp(result->rows[0][0], "renamed") == 0);
+    db_finalize(by_id);
+
+    // unbound parameters and parameters that cannot be typed are rejected
+    PreparedStatement* unbound = db_prepare(db, "SELECT * FROM items WHERE id = ?");
+    assert(db_step(unbound) == NULL);
+    db_finalize(unbound);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = ?") == NULL);
+    assert(db_prepare(db, "SELECT ? FROM items") == NULL);
+    db_close(db);
+
+    printf("✓ Prepared statement test passed.\n");
+}
+
+int count_rows(Database* db, const char* query) {
+    Result* result = db_execute(db, query);
+    int count = result != NULL ? result->num_rows : 0;
+    db_result_free(result);
+    return count;
+}
+
+void test_joins() {
+    printf("Testing joins...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_parser_joins.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE users (id INT, name VARCHAR(20), code INT)");
+    db_execute(db, "CREATE TABLE orders (id INT, user_id INT, amount INT, user_name VARCHAR(20), code INT)");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO users VALUES (1, 'ann', 10), (2, 'bo', 20), (3, 'cy', 30), (4, 'di', NULL)");
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO orders VALUES (?, ?, ?, ?, ?)");
+    const char* names[] = {"ann", "bo", "cy", "zed"};
+    for (int i = 1; i <= 2000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i % 5);  // 0 matches no user
+        db_bind_int(insert, 3, i);
+        db_bind_text(insert, 4, names[i % 4]);
+        db_bind_int(insert, 5, (i % 4) * 10);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_finalize(insert);
+    db_execute(db, "COMMIT");
+
+    // an equality with the joined table's primary key looks each row up
+    PreparedStatement* prepared = db_prepare(db, "SELECT orders.id, users.name FROM orders JOIN users ON orders.user_id = users.id "
+                                                 "WHERE amount <= 12 ORDER BY orders.id");
+    assert(prepared != NULL && prepared->join == JOIN_INDEX_NESTED_LOOP && prepared->join_index == NULL);
+    Result* result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 10 && result->num_columns == 2);
+    assert(strcmp(result->rows[0][0], "1") == 0 && strcmp(result->rows[0][1], "ann") == 0);
+    assert(strcmp(result->rows[3][0], "4") == 0 && strcmp(result->rows[3][1], "di") == 0);
+    assert(strcmp(result->rows[4][0], "6") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // other equalities hash the joined table, text keys too
+    prepared = db_prepare(db, "SELECT * FROM orders INNER JOIN users ON users.name = orders.user_name");
+    assert(prepared != NULL && prepared->join == JOIN_HASH && prepared->num_columns == 8);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 1500);
+    for (int i = 0; i < result->num_rows; i++) {
+        assert(strcmp(result->rows[i][3], result->rows[i][6]) == 0);
+    }
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // the rest of the ON condition is checked for each pair with equal keys
+    assert(count_rows(db, "SELECT orders.id FROM orders JOIN users ON user_name = name AND users.id = 1") == 500);
+
+    // a unique index on the joined column is looked up; both plans agree
+    const char* by_code = "SELECT orders.id FROM orders JOIN users ON orders.code = users.code";
+    assert(count_rows(db, by_code) == 1500);
+    db_execute(db, "CREATE UNIQUE INDEX code_idx ON users (code)");
+    prepared = db_prepare(db, by_code);
+    assert(prepared->join == JOIN_INDEX_NESTED_LOOP && prepared->join_index != NULL);
+    db_finalize(prepared);
+    assert(count_rows(db, by_code) == 1500);
+
+    // one whose values repeat would find a single row per key, so the joined
+    // table is hashed and every duplicate matches
+    db_execute(db, "DROP INDEX code_idx ON users");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO users VALUES (301, 'eve', 10)");
+    db_execute(db, "COMMIT");
+    db_execute(db, "CREATE INDEX code_idx ON users (code)");
+    prepared = db_prepare(db, by_code);
+    assert(prepared->join == JOIN_HASH);
+    db_finalize(prepared);
+    assert(count_rows(db, by_code) == 2000);
+    db_execute(db, "BEGIN");
+    db_execute(db, "DELETE FROM users WHERE id = 301");
+    db_execute(db, "COMMIT");
+
+    // without an equality every pair is compared
+    prepared = db_prepare(db, "SELECT orders.id FROM orders JOIN users ON orders.user_id < users.id WHERE orders.id < 6");
+    assert(prepared->join == JOIN_NESTED_LOOP);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 3 + 2 + 1 + 0 + 4);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // with statistics many outer rows hash the joined table, a few still look
+    // theirs up
+    insert = db_prepare(db, "INSERT INTO users VALUES (?, 'more', NULL)");
+    db_execute(db, "BEGIN");
+    for (int i = 5; i <= 300; i++) {
+        db_bind_int(insert, 1, i);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_execute(db, "COMMIT");
+    db_finalize(insert);
+    db_execute(db, "ANALYZE");
+    prepared = db_prepare(db, "SELECT users.name FROM orders JOIN users ON orders.user_id = users.id");
+    assert(prepared->join == JOIN_HASH);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 1600);
+    db_result_free(result);
+    db_finalize(prepared);
+    prepared = db_prepare(db, "SELECT users.name FROM orders JOIN users ON orders.user_id = users.id WHERE orders.id = 7");
+    assert(prepared->join == JOIN_INDEX_NESTED_LOOP);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 1 && strcmp(result->rows[0][0], "bo") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // names must resolve to exactly one table
+    assert(db_prepare(db, "SELECT id FROM orders JOIN users ON user_id = users.id") == NULL);
+    assert(db_prepare(db, "SELECT orders.id FROM orders JOIN users ON user_id = other.id") == NULL);
+    assert(db_prepare(db, "SELECT * FROM orders JOIN missing ON user_id = 1") == NULL);
+    db_close(db);
+
+    printf("✓ Join test passed.\n");
+}
+
+void test_group_by() {
+    printf("Testing GROUP BY...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_parser_groups.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE sales (id INT, region VARCHAR(10), amount INT, price DOUBLE)");
+    db_execute(db, "BEGIN");
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO sales VALUES (?, ?, ?, ?)");
+    const char* regions[] = {"north", "south", "east"};
+    for (int i = 1; i <= 3000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_text(insert, 2, i % 10 == 0 ? NULL : regions[i % 3]);
+        db_bind_int(insert, 3, i % 7);
+        db_bind_text(insert, 4, i % 2 == 0 ? "0.5" : "1.5");
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_finalize(insert);
+    db_execute(db, "COMMIT");
+
+    // without GROUP BY the whole table is one group
+    Result* result = db_execute(db, "SELECT COUNT(*), count(region), SUM(amount), MIN(region), MAX(id), AVG(price) FROM sales");
+    assert(result != NULL && result->num_rows == 1 && result->num_columns == 6);
+    assert(strcmp(result->rows[0][0], "3000") == 0 && strcmp(result->rows[0][1], "2700") == 0);
+    assert(strcmp(result->rows[0][2], "8998") == 0);
+    assert(strcmp(result->rows[0][3], "east") == 0 && strcmp(result->rows[0][4], "3000") == 0);
+    assert(atof(result->rows[0][5]) == 1.0);
+    db_result_free(result);
+
+    // text groups by hashing, nulls form their own group, ORDER BY reads the
+    // grouped rows
+    PreparedStatement* prepared = db_prepare(db, "SELECT region, COUNT(*), MAX(amount) FROM sales GROUP BY region "
+                                                 "ORDER BY COUNT(*) DESC, region");
+    assert(prepared != NULL && prepared->aggregated && !prepared->group_ordered);
+    assert(prepared->num_group_columns == 1 && prepared->num_aggregates == 2);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 4);
+    assert(strcmp(result->rows[0][0], "east") == 0 && strcmp(result->rows[0][1], "900") == 0);
+    assert(strcmp(result->rows[2][0], "south") == 0 && strcmp(result->rows[2][2], "6") == 0);
+    assert(result->rows[3][0] == NULL && strcmp(result->rows[3][1], "300") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // an index on a column whose values repeat holds only some of the rows, so
+    // its groups are hashed from a full scan
+    db_execute(db, "CREATE INDEX amount_idx ON sales (amount)");
+    prepared = db_prepare(db, "SELECT amount, COUNT(*) FROM sales WHERE amount BETWEEN 2 AND 4 GROUP BY amount");
+    assert(prepared != NULL && prepared->access == ACCESS_SEQ_SCAN && !prepared->group_ordered);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 3);
+    for (int i = 0; i < 3; i++) {
+        assert(strcmp(result->rows[i][1], "429") == 0);
+    }
+    db_result_free(result);
+    db_finalize(prepared);
+
+    // grouping on the key of an ordered scan streams one group at a time
+    prepared = db_prepare(db, "SELECT id, SUM(amount) FROM sales WHERE id > 2990 GROUP BY id");
+    assert(prepared != NULL && prepared->access == ACCESS_PRIMARY_KEY && prepared->group_ordered);
+    result = db_step(prepared);
+    assert(result != NULL && result->num_rows == 10);
+    assert(strcmp(result->rows[0][0], "2991") == 0 && strcmp(result->rows[0][1], "2") == 0);
+    db_result_free(result);
+    db_finalize(prepared);
+
+    result = db_execute(db, "SELECT amount, COUNT(*), SUM(id) FROM sales GROUP BY amount ORDER BY amount LIMIT 2");
+    assert(result != NULL && result->num_rows == 2);
+    assert(strcmp(result->rows[1][0], "1") == 0 && strcmp(result->rows[1][1], "429") == 0);
+    db_result_free(result);
+
+    assert(count_rows(db, "SELECT id FROM sales GROUP BY id") == 3000);
+    assert(db_prepare(db, "SELECT region, amount FROM sales GROUP BY region") == NULL);
+    assert(db_prepare(db, "SELECT * FROM sales GROUP BY region") == NULL);
+    assert(db_prepare(db, "SELECT region FROM sales WHERE COUNT(*) > 1") == NULL);
+    assert(db_prepare(db, "SELECT SUM(region) FROM sales") == NULL);
+    assert(db_prepare(db, "SELECT MAX(COUNT(id)) FROM sales") == NULL);
+    assert(db_prepare(db, "SELECT COUNT(*) FROM sales ORDER BY id") == NULL);
+    db_close(db);
+
+    printf("✓ GROUP BY test passed.\n");
+}
+
+// the first column of each row of a query, as integers
+int first_column(Database* db, const char* query, int* values, int max_values) {
+    Result* result = db_execute(db, query);
+    int count = 0;
+    for (int i = 0; result != NULL && i < result->num_rows && count < max_values; i++) {
+        values[count++] = atoi(result->rows[i][0]);
+    }
+    db_result_free(result);
+    return count;
+}
+
+void test_limit_offset() {
+    printf("Testing LIMIT and OFFSET...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_parser_pages.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, kind INT, name VARCHAR(20))");
+    db_execute(db, "BEGIN");
+    PreparedStatement* insert = db_prepare(db, "INSERT INTO items VALUES (?, ?, 'item')");
+    for (int i = 1; i <= 5000; i++) {
+        db_bind_int(insert, 1, i);
+        db_bind_int(insert, 2, i % 10);
+        db_step(insert);
+        db_reset(insert);
+    }
+    db_finalize(insert);
+    db_execute(db, "COMMIT");
+
+    // ordered by the primary key the scan needs no sort and skips the offset
+    PreparedStatement* prepared = db_prepare(db, "SELECT id FROM items ORDER BY id LIMIT 5 OFFSET 4000");
+    assert(prepared != NULL && prepared->ordered && prepared->offset_in_scan);
+    db_finalize(prepared);
+    int ids[16];
+    assert(first_column(db, "SELECT id FROM items ORDER BY id LIMIT 5 OFFSET 4000", ids, 16) == 5);
+    assert(ids[0] == 4001 && ids[4] == 4005);
+    assert(first_column(db, "SELECT id FROM items WHERE id >= 100 ORDER BY id LIMIT 3 OFFSET 10", ids, 16) == 3 && ids[0] == 110);
+    assert(first_column(db, "SELECT id FROM items WHERE id BETWEEN 100 AND 105 LIMIT 10 OFFSET 4", ids, 16) == 2 && ids[1] == 105);
+    assert(first_column(db, "SELECT id FROM items OFFSET 4998", ids, 16) == 2 && ids[0] == 4999);
+    assert(count_rows(db, "SELECT id FROM items ORDER BY id OFFSET 5000") == 0);
+
+    // rows the filter drops are not counted by the scan
+    prepared = db_prepare(db, "SELECT id FROM items WHERE kind = 3 ORDER BY id LIMIT 2 OFFSET 5");
+    assert(prepared != NULL && prepared->ordered && !prepared->offset_in_scan);
+    db_finalize(prepared);
+    assert(first_column(db, "SELECT id FROM items WHERE kind = 3 ORDER BY id LIMIT 2 OFFSET 5", ids, 16) == 2);
+    assert(ids[0] == 53 && ids[1] == 63);
+    prepared = db_prepare(db, "SELECT id FROM items WHERE id > 10 AND id > ? ORDER BY id LIMIT 2 OFFSET 5");
+    assert(prepared != NULL && !prepared->offset_in_scan);
+    db_finalize(prepared);
+
+    // other orders sort, keeping only the rows up to the end of the page
+    prepared = db_prepare(db, "SELECT id FROM items ORDER BY kind DESC, id LIMIT 3 OFFSET 2");
+    assert(prepared != NULL && !prepared->ordered && !prepared->offset_in_scan);
+    db_finalize(prepared);
+    assert(first_column(db, "SELECT id FROM items ORDER BY kind DESC, id LIMIT 3 OFFSET 2", ids, 16) == 3);
+    assert(ids[0] == 29 && ids[2] == 49);
+    assert(first_column(db, "SELECT id FROM items ORDER BY id DESC LIMIT 2 OFFSET 1", ids, 16) == 2 && ids[0] == 4999);
+    db_close(db);
+
+    printf("✓ LIMIT and OFFSET test passed.\n");
+}
+
+void write_file(const char* filename, const char* text) {
+    FILE* file = fopen(filename, "wb");
+    assert(file != NULL);
+    fputs(text, file);
+    fclose(file);
+}
+
+void test_copy() {
+    printf("Testing COPY FROM a CSV file...\n");
+    cleanup_test_files();
+
+    Statement* statement = parse_statement("COPY people FROM 'it''s.csv'");
+    assert(statement != NULL && statement->type == STATEMENT_COPY);
+    assert(strcmp(statement->copy.table_name, "people") == 0 && strcmp(statement->copy.file_name, "it's.csv") == 0);
+    statement_free(statement);
+
+    Database* db = db_open("test_parser_copy.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE people (id INT, name TEXT, score DOUBLE, born DATE)");
+    // quoted commas, quotes and newlines, \r\n line ends, a blank line, an
+    // unquoted empty field for null and a quoted one for empty text
+    write_file("test_parser_copy.csv",
+               "3,\"Smith, Ann\",1.5,2001-02-03\r\n"
+               "1,\"say \"\"hi\"\"\",,2000-01-01\n"
+               "\n"
+               "2,\"two\nlines\",-4,\n"
+               "4,\"\",0,1999-12-31");
+    assert(db_execute(db, "COPY people FROM 'test_parser_copy.csv'") == NULL);
+    assert(count_rows(db, "SELECT * FROM people") == 0); // outside a transaction
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY people FROM 'test_parser_copy.csv'");
+    db_execute(db, "COMMIT");
+    Result* result = db_execute(db, "SELECT id, name, score, born FROM people");
+    assert(result != NULL && result->num_rows == 4);
+    assert(strcmp(result->rows[0][1], "say \"hi\"") == 0 && result->rows[0][2] == NULL);
+    assert(strcmp(result->rows[1][1], "two\nlines") == 0 && strcmp(result->rows[1][2], "-4") == 0);
+    assert(result->rows[1][3] == NULL);
+    assert(strcmp(result->rows[2][1], "Smith, Ann") == 0 && strcmp(result->rows[2][3], "2001-02-03") == 0);
+    assert(result->rows[3][1] != NULL && result->rows[3][1][0] == '\0');
+    db_result_free(result);
+
+    // a bad row stops the copy, keeping the rows before it
+    write_file("test_parser_copy.csv", "10,a,1,2000-01-01\n11,b,1\n12,c,1,2000-01-01\n");
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY people FROM 'test_parser_copy.csv'");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM people") == 5);
+    write_file("test_parser_copy.csv", "20,\"open,1,2000-01-01\n");
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY people FROM 'test_parser_copy.csv'");
+    write_file("test_parser_copy.csv", ",a,1,2000-01-01\n");
+    db_execute(db, "COPY people FROM 'test_parser_copy.csv'");
+    db_execute(db, "COPY people FROM 'test_parser_missing.csv'");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM people") == 5);
+
+    // an id past the int32 range is an error, not a wrapped key that
+    // overwrites another row
+    write_file("test_parser_copy.csv", "30,a,1,2000-01-01\n4294967297,clobber,1,2000-01-01\n");
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY people FROM 'test_parser_copy.csv'");
+    db_execute(db, "INSERT INTO people VALUES (4294967298, 'clobber', 1, '2000-01-01')");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM people") == 6);
+    assert(count_rows(db, "SELECT * FROM people WHERE name = 'clobber'") == 0);
+    db_close(db);
+
+    printf("✓ COPY test passed.\n");
+}
+
+int main() {
+    printf("Starting parser tests...\n\n");
+
+    test_parse_select();
+    test_parse_errors();
+    test_queries();
+    test_prepared_statements();
+    test_joins();
+    test_group_by();
+    test_limit_offset();
+    test_copy();
+
+    cleanup_test_files();
+
+    printf("\nParser tests completed successfully!\n");
+    return 0;
+}
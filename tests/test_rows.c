@@ -0,0 +1,200 @@
+#include "../src/database.h"
+#include "../src/row.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+void cleanup_test_files() {
+    system("rm -f test_rows*.db test_rows*.db.wal");
+}
+
+TableSchema make_table() {
+    TableSchema table;
+    memset(&table, 0, sizeof(TableSchema));
+    strcpy(table.table_name, "t");
+    ColumnType types[] = {COLUMN_TYPE_INT, COLUMN_TYPE_VARCHAR, COLUMN_TYPE_FLOAT, COLUMN_TYPE_DOUBLE,
+                          COLUMN_TYPE_TEXT, COLUMN_TYPE_DATE, COLUMN_TYPE_TIMESTAMP, COLUMN_TYPE_BOOLEAN};
+    for (int i = 0; i < 8; i++) {
+        snprintf(table.columns[i].name, MAX_NAME_LEN, "c%d", i);
+        table.columns[i].type = types[i];
+    }
+    table.columns[1].length = 10;
+    table.num_columns = 8;
+    return table;
+}
+
+void parse(Value* value, ColumnType type, const char* text) {
+    assert(value_parse(value, type, text, (uint16_t)strlen(text)) == 0);
+}
+
+void assert_formats(const RowLayout* layout, const char* row, int column, const char* expected) {
+    Value value;
+    row_get_value(layout, row, column, &value);
+    Arena arena;
+    arena_init(&arena);
+    char* text = value_format(&arena, &value);
+    if (expected == NULL) {
+        assert(text == NULL);
+    } else {
+        assert(text != NULL && strcmp(text, expected) == 0);
+    }
+    arena_free(&arena);
+}
+
+void test_round_trip() {
+    printf("Testing binary rows round trip every column type...\n");
+
+    TableSchema table = make_table();
+    RowLayout layout;
+    row_layout_init(&layout, &table);
+
+    Value values[8];
+    parse(&values[0], COLUMN_TYPE_INT, "-42");
+    parse(&values[1], COLUMN_TYPE_VARCHAR, "hello");
+    parse(&values[2], COLUMN_TYPE_FLOAT, "99.9");
+    parse(&values[3], COLUMN_TYPE_DOUBLE, "3.14159");
+    parse(&values[4], COLUMN_TYPE_TEXT, "some longer text");
+    parse(&values[5], COLUMN_TYPE_DATE, "1969-12-31");
+    parse(&values[6], COLUMN_TYPE_TIMESTAMP, "2024-02-29 23:59:58");
+    parse(&values[7], COLUMN_TYPE_BOOLEAN, "true");
+
+    char row[ROW_MAX_SIZE];
+    uint16_t length;
+    assert(row_encode(&layout, values, row, &length) == 0);
+    assert(length == layout.header_size + 5 + 16);
+
+    assert(row_get_int(&layout, row, 0) == -42);
+    assert_formats(&layout, row, 0, "-42");
+    assert_formats(&layout, row, 1, "hello");
+    assert_formats(&layout, row, 2, "99.9");
+    assert_formats(&layout, row, 3, "3.14159");
+    assert_formats(&layout, row, 4, "some longer text");
+    assert_formats(&layout, row, 5, "1969-12-31");
+    assert_formats(&layout, row, 6, "2024-02-29 23:59:58");
+    assert_formats(&layout, row, 7, "true");
+
+    // nulls keep the other columns addressable
+    value_set_null(&values[1], COLUMN_TYPE_VARCHAR);
+    value_set_null(&values[3], COLUMN_TYPE_DOUBLE);
+    assert(row_encode(&layout, values, row, &length) == 0);
+    assert(row_is_null(&layout, row, 1) && row_is_null(&layout, row, 3));
+    assert(!row_is_null(&layout, row, 4));
+    assert_formats(&layout, row, 1, NULL);
+    assert_formats(&layout, row, 3, NULL);
+    assert_formats(&layout, row, 4, "some longer text");
+    assert_formats(&layout, row, 6, "2024-02-29 23:59:58");
+
+    printf("✓ Round trip test passed.\n");
+}
+
+void test_invalid_values() {
+    printf("Testing invalid literals and oversized values...\n");
+
+    TableSchema table = make_table();
+    RowLayout layout;
+    row_layout_init(&layout, &table);
+
+    Value value;
+    assert(value_parse(&value, COLUMN_TYPE_INT, "12abc", 5) != 0);
+    // INT is stored in 32 bits, wider values are rejected rather than wrapped
+    assert(value_parse(&value, COLUMN_TYPE_INT, "2147483647", 10) == 0 && value.int_value == INT32_MAX);
+    assert(value_parse(&value, COLUMN_TYPE_INT, "-2147483648", 11) == 0 && value.int_value == INT32_MIN);
+    assert(value_parse(&value, COLUMN_TYPE_INT, "2147483648", 10) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_INT, "-2147483649", 11) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_INT, "4294967297", 10) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_INT, "99999999999999999999", 20) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "2024-13-01", 10) != 0);
+    // days past the end of the month are rejected, not carried into the next
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "2024-02-30", 10) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "2023-04-31", 10) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "2023-02-29", 10) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "1900-02-29", 10) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "2024-02-29", 10) == 0);
+    assert(value_parse(&value, COLUMN_TYPE_DATE, "2000-02-29", 10) == 0);
+    assert(value_parse(&value, COLUMN_TYPE_TIMESTAMP, "2023-06-31 10:00:00", 19) != 0);
+    assert(value_parse(&value, COLUMN_TYPE_BOOLEAN, "maybe", 5) != 0);
+
+    Value values[8];
+    for (int i = 0; i < 8; i++) {
+        value_set_null(&values[i], table.columns[i].type);
+    }
+    parse(&values[1], COLUMN_TYPE_VARCHAR, "more than ten characters");
+    char row[ROW_MAX_SIZE];
+    uint16_t length;
+    assert(row_encode(&layout, values, row, &length) != 0);
+
+    printf("✓ Invalid values test passed.\n");
+}
+
+void test_typed_comparisons() {
+    printf("Testing typed comparisons...\n");
+
+    Value a;
+    Value b;
+    parse(&a, COLUMN_TYPE_INT, "9");
+    parse(&b, COLUMN_TYPE_INT, "10");
+    assert(value_compare(&a, &b) < 0);
+
+    parse(&a, COLUMN_TYPE_VARCHAR, "9");
+    parse(&b, COLUMN_TYPE_VARCHAR, "10");
+    assert(value_compare(&a, &b) > 0);
+
+    parse(&a, COLUMN_TYPE_DATE, "2023-12-31");
+    parse(&b, COLUMN_TYPE_DATE, "2024-01-01");
+    assert(value_compare(&a, &b) < 0);
+
+    parse(&a, COLUMN_TYPE_FLOAT, "99.9");
+    parse(&b, COLUMN_TYPE_FLOAT, "99.9");
+    assert(value_compare(&a, &b) == 0);
+
+    printf("✓ Typed comparison test passed.\n");
+}
+
+void test_nulls_through_sql() {
+    printf("Testing NULL values through SQL...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_rows_sql.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE people (id INT, name VARCHAR(20), score DOUBLE)");
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO people VALUES (1, 'ann', 7.5)");
+    db_execute(db, "INSERT INTO people VALUES (2, NULL, 9.25)");
+    db_execute(db, "INSERT INTO people VALUES (3, 'cy', NULL)");
+    db_execute(db, "COMMIT");
+
+    Result* result = db_execute(db, "SELECT * FROM people WHERE id = 2");
+    assert(result != NULL && result->rows[0][1] == NULL);
+    assert(strcmp(result->rows[0][2], "9.25") == 0);
+
+    // nulls never satisfy a comparison
+    result = db_execute(db, "SELECT * FROM people WHERE score > 1");
+    assert(result != NULL && result->num_rows == 2);
+    result = db_execute(db, "SELECT * FROM people WHERE score < 8");
+    assert(result != NULL && result->num_rows == 1);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE people SET score = 1.5 WHERE id = 3");
+    db_execute(db, "COMMIT");
+    result = db_execute(db, "SELECT * FROM people WHERE id = 3");
+    assert(result != NULL && strcmp(result->rows[0][1], "cy") == 0);
+    assert(strcmp(result->rows[0][2], "1.5") == 0);
+    db_close(db);
+
+    printf("✓ SQL NULL test passed.\n");
+}
+
+int main() {
+    printf("Starting row format tests...\n\n");
+
+    test_round_trip();
+    test_invalid_values();
+    test_typed_comparisons();
+    test_nulls_through_sql();
+
+    cleanup_test_files();
+
+    printf("\nRow format tests completed successfully!\n");
+    return 0;
+}
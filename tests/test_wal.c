@@ -0,0 +1,734 @@
+#include "../src/database.h"
+#include "../src/crc32c.h"
+#include "../src/btree.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+void cleanup_test_files() {
+    system("rm -f test_wal*.db test_wal*.db.wal test_wal*.csv");
+}
+
+// abandon the database without flushing anything, as if the process died
+void simulate_crash(Database* db) {
+    close(db->wal->fd);
+    close(db->pager->fd);
+}
+
+void insert_rows(Database* db, const char* table, int from, int to) {
+    char query[256];
+    db_execute(db, "BEGIN");
+    for (int i = from; i <= to; i++) {
+        snprintf(query, sizeof(query), "INSERT INTO %s VALUES (%d, 'name_%d', %d)", table, i, i, i % 7);
+        db_execute(db, query);
+    }
+    db_execute(db, "COMMIT");
+}
+
+int count_rows(Database* db, const char* query) {
+    Result* result = db_execute(db, query);
+    return result == NULL ? 0 : result->num_rows;
+}
+
+void test_splits_and_reopen() {
+    printf("Testing page splits survive close and reopen...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_splits.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 5000);
+
+    assert(count_rows(db, "SELECT * FROM items") == 5000);
+    Result* result = db_execute(db, "SELECT * FROM items WHERE id = 4321");
+    assert(result != NULL && result->num_rows == 1);
+    assert(strcmp(result->rows[0][1], "name_4321") == 0);
+    db_close(db);
+
+    db = db_open("test_wal_splits.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 5000);
+    result = db_execute(db, "SELECT * FROM items WHERE id = 17");
+    assert(result != NULL && result->num_rows == 1);
+    assert(strcmp(result->rows[0][1], "name_17") == 0);
+    db_close(db);
+
+    printf("✓ Page split test passed.\n");
+}
+
+void test_crash_recovery() {
+    printf("Testing redo of committed changes after a crash...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_crash.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 1000);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET name = 'updated' WHERE id = 10");
+    db_execute(db, "DELETE FROM items WHERE id = 20");
+    db_execute(db, "COMMIT");
+    simulate_crash(db);
+
+    db = db_open("test_wal_crash.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 999);
+    Result* result = db_execute(db, "SELECT * FROM items WHERE id = 10");
+    assert(result != NULL && strcmp(result->rows[0][1], "updated") == 0);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 20") == NULL);
+
+    // recovering an already recovered database must not change it
+    simulate_crash(db);
+    db = db_open("test_wal_crash.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 999);
+
+    // new transactions continue after the recovered ones
+    insert_rows(db, "items", 1001, 1010);
+    db_close(db);
+
+    db = db_open("test_wal_crash.db");
+    assert(count_rows(db, "SELECT * FROM items") == 1009);
+    db_close(db);
+
+    printf("✓ Crash recovery test passed.\n");
+}
+
+void test_rollback_not_replayed() {
+    printf("Testing rolled back transactions stay rolled back after recovery...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_rollback.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 10);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO items VALUES (11, 'gone', 0)");
+    db_execute(db, "DELETE FROM items WHERE id = 1");
+    db_execute(db, "ROLLBACK");
+
+    assert(count_rows(db, "SELECT * FROM items") == 10);
+    simulate_crash(db);
+
+    db = db_open("test_wal_rollback.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 10);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 11") == NULL);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 1") != NULL);
+    db_close(db);
+
+    printf("✓ Rollback recovery test passed.\n");
+}
+
+void test_rollback_in_place() {
+    printf("Testing rollback undoes a large transaction in place...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_undo.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    db_execute(db, "CREATE INDEX bucket_idx ON items (bucket)");
+    insert_rows(db, "items", 1, 500);
+
+    BufferPool* pool = db->pool;
+    char query[256];
+    db_execute(db, "BEGIN");
+    for (int i = 501; i <= 3000; i++) {
+        snprintf(query, sizeof(query), "INSERT INTO items VALUES (%d, 'new_%d', %d)", i, i, i % 7);
+        db_execute(db, query);
+    }
+    for (int i = 1; i <= 500; i += 2) {
+        snprintf(query, sizeof(query), "UPDATE items SET name = 'a much longer replacement name %d' WHERE id = %d", i, i);
+        db_execute(db, query);
+        snprintf(query, sizeof(query), "DELETE FROM items WHERE id = %d", i + 1);
+        db_execute(db, query);
+    }
+    assert(count_rows(db, "SELECT * FROM items") == 2750);
+    db_execute(db, "ROLLBACK");
+
+    // the buffer pool survives the rollback
+    assert(db->pool == pool);
+    assert(count_rows(db, "SELECT * FROM items") == 500);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 501") == NULL);
+    Result* result = db_execute(db, "SELECT * FROM items WHERE id = 1");
+    assert(result != NULL && strcmp(result->rows[0][1], "name_1") == 0);
+    result = db_execute(db, "SELECT * FROM items WHERE id = 2");
+    assert(result != NULL && strcmp(result->rows[0][1], "name_2") == 0);
+
+    // the rollback is itself logged and survives a crash
+    simulate_crash(db);
+    db = db_open("test_wal_undo.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 500);
+    result = db_execute(db, "SELECT * FROM items WHERE id = 2");
+    assert(result != NULL && strcmp(result->rows[0][1], "name_2") == 0);
+    db_close(db);
+
+    printf("✓ In-place rollback test passed.\n");
+}
+
+void test_unfinished_transaction_undone() {
+    printf("Testing recovery undoes transactions that never finished...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_loser.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 1000);
+
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO items VALUES (1001, 'uncommitted', 0)");
+    db_execute(db, "UPDATE items SET name = 'uncommitted' WHERE id = 10");
+    db_execute(db, "DELETE FROM items WHERE id = 20");
+    // uncommitted changes may reach the data file before the crash
+    buffer_pool_flush_all(db->pool, db->pager);
+    simulate_crash(db);
+
+    db = db_open("test_wal_loser.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 1000);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 1001") == NULL);
+    Result* result = db_execute(db, "SELECT * FROM items WHERE id = 10");
+    assert(result != NULL && strcmp(result->rows[0][1], "name_10") == 0);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 20") != NULL);
+
+    // the undo was logged, so a second recovery leaves the data alone
+    simulate_crash(db);
+    db = db_open("test_wal_loser.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 1000);
+    insert_rows(db, "items", 1001, 1005);
+    assert(count_rows(db, "SELECT * FROM items") == 1005);
+    db_close(db);
+
+    printf("✓ Unfinished transaction undo test passed.\n");
+}
+
+// replay a crashed database's log directly against its data file
+void recover_file(const char* filename, int num_workers) {
+    char wal_filename[256];
+    snprintf(wal_filename, sizeof(wal_filename), "%s.wal", filename);
+
+    Pager* pager = pager_open(filename);
+    BufferPool* pool = buffer_pool_init();
+    Wal* wal = wal_init(wal_filename);
+    assert(pager != NULL && pool != NULL && wal != NULL);
+
+    wal_recover_parallel(pool, pager, wal, num_workers);
+    buffer_pool_flush_all(pool, pager);
+
+    wal_close(wal);
+    buffer_pool_free(pool);
+    pager_close(pager);
+}
+
+char* read_file(const char* filename, long* size) {
+    FILE* file = fopen(filename, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = (char*)malloc(*size);
+    assert(fread(data, 1, *size, file) == (size_t)*size);
+    fclose(file);
+    return data;
+}
+
+void test_parallel_redo_matches_serial() {
+    printf("Testing parallel redo produces the same pages as serial redo...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_serial.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    db_execute(db, "CREATE INDEX bucket_idx ON items (bucket)");
+    insert_rows(db, "items", 1, 3000);
+
+    char query[256];
+    db_execute(db, "BEGIN");
+    for (int i = 1; i <= 3000; i += 3) {
+        snprintf(query, sizeof(query), "UPDATE items SET name = 'changed_%d' WHERE id = %d", i, i);
+        db_execute(db, query);
+        snprintf(query, sizeof(query), "DELETE FROM items WHERE id = %d", i + 1);
+        db_execute(db, query);
+    }
+    db_execute(db, "COMMIT");
+    simulate_crash(db);
+
+    system("cp test_wal_serial.db test_wal_parallel.db && cp test_wal_serial.db.wal test_wal_parallel.db.wal");
+    recover_file("test_wal_serial.db", 1);
+    recover_file("test_wal_parallel.db", 4);
+
+    long serial_size;
+    long parallel_size;
+    char* serial = read_file("test_wal_serial.db", &serial_size);
+    char* parallel = read_file("test_wal_parallel.db", &parallel_size);
+    assert(serial_size == parallel_size);
+    assert(memcmp(serial, parallel, serial_size) == 0);
+    free(serial);
+    free(parallel);
+
+    db = db_open("test_wal_parallel.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 2000);
+    Result* result = db_execute(db, "SELECT * FROM items WHERE id = 2998");
+    assert(result != NULL && strcmp(result->rows[0][1], "changed_2998") == 0);
+    db_close(db);
+
+    printf("✓ Parallel redo test passed.\n");
+}
+
+// threads sharing a pool, each with its own pages, evict each other's
+// pages while reading and writing theirs
+typedef struct {
+    BufferPool* pool;
+    Pager* pager;
+    uint32_t first_page;
+} PoolWorker;
+
+#define POOL_WORKER_PAGES 150
+
+void* pool_worker(void* arg) {
+    PoolWorker* worker = (PoolWorker*)arg;
+    for (uint32_t round = 1; round <= 3; round++) {
+        for (uint32_t i = 0; i < POOL_WORKER_PAGES; i++) {
+            uint32_t page_id = worker->first_page + i;
+            Page* page = buffer_pool_get_page(worker->pool, worker->pager, page_id);
+            assert(page != NULL);
+            uint32_t* words = (uint32_t*)page;
+            assert(words[0] == (round == 1 ? 0 : page_id) && words[1] == round - 1);
+            words[0] = page_id;
+            words[1] = round;
+            buffer_pool_unpin_page(worker->pool, worker->pager, page_id, 1);
+        }
+    }
+    return NULL;
+}
+
+void test_pool_shared_across_threads() {
+    printf("Testing a buffer pool shared across threads...\n");
+    cleanup_test_files();
+
+    Pager* pager = pager_open("test_wal_pool.db");
+    BufferPool* pool = buffer_pool_init();
+    assert(pager != NULL && pool != NULL);
+    pthread_t threads[4];
+    PoolWorker workers[4];
+    for (int i = 0; i < 4; i++) {
+        workers[i].pool = pool;
+        workers[i].pager = pager;
+        workers[i].first_page = i * POOL_WORKER_PAGES;
+        assert(pthread_create(&threads[i], NULL, pool_worker, &workers[i]) == 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    buffer_pool_flush_all(pool, pager);
+    buffer_pool_free(pool);
+
+    // every page was written back with its last round
+    pool = buffer_pool_init();
+    for (uint32_t page_id = 0; page_id < 4 * POOL_WORKER_PAGES; page_id++) {
+        uint32_t* words = (uint32_t*)buffer_pool_get_page(pool, pager, page_id);
+        assert(words != NULL && words[0] == page_id && words[1] == 3);
+        buffer_pool_unpin_page(pool, pager, page_id, 0);
+    }
+    buffer_pool_free(pool);
+    pager_close(pager);
+
+    printf("✓ Shared buffer pool test passed.\n");
+}
+
+void test_redo_failure() {
+    printf("Testing recovery fails when a page cannot be redone...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_redo.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 500);
+    simulate_crash(db);
+
+    // with every frame pinned no logged page can be read back
+    for (int num_workers = 1; num_workers <= 4; num_workers += 3) {
+        Pager* pager = pager_open("test_wal_redo.db");
+        BufferPool* pool = buffer_pool_init();
+        Wal* wal = wal_init("test_wal_redo.db.wal");
+        assert(pager != NULL && pool != NULL && wal != NULL);
+        for (uint32_t page_id = 0; page_id < BUFFER_POOL_SIZE; page_id++) {
+            assert(buffer_pool_get_page(pool, pager, 10000 + page_id) != NULL);
+        }
+        assert(wal_recover_parallel(pool, pager, wal, num_workers) == -1);
+        wal_close(wal);
+        buffer_pool_free(pool);
+        pager_close(pager);
+    }
+
+    // nothing was lost: a pool with room recovers every row
+    db = db_open("test_wal_redo.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 500);
+    db_close(db);
+
+    printf("✓ Redo failure test passed.\n");
+}
+
+void test_crc32c() {
+    printf("Testing crc32c checksums...\n");
+
+    // standard check value for crc32c
+    assert(crc32c(0, "123456789", 9) == 0xE3069283u);
+    assert(crc32c(crc32c(0, "1234", 4), "56789", 5) == 0xE3069283u);
+    assert(crc32c(0, "", 0) == 0);
+
+    char buffer[1000];
+    for (int i = 0; i < (int)sizeof(buffer); i++) {
+        buffer[i] = (char)(i * 31);
+    }
+    uint32_t whole = crc32c(0, buffer, sizeof(buffer));
+    assert(crc32c(crc32c(0, buffer, 333), buffer + 333, sizeof(buffer) - 333) == whole);
+    buffer[500] ^= 1;
+    assert(crc32c(0, buffer, sizeof(buffer)) != whole);
+
+    printf("✓ crc32c test passed.\n");
+}
+
+void test_torn_log_tail() {
+    printf("Testing recovery stops cleanly at a torn log tail...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_torn.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 100);
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO items VALUES (101, 'torn', 0)");
+    db_execute(db, "COMMIT");
+    simulate_crash(db);
+
+    // tear the commit record of the last transaction in half
+    long size;
+    char* log = read_file("test_wal_torn.db.wal", &size);
+    free(log);
+    assert(truncate("test_wal_torn.db.wal", size - 20) == 0);
+
+    db = db_open("test_wal_torn.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 100);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 101") == NULL);
+    insert_rows(db, "items", 101, 110);
+    simulate_crash(db);
+
+    // garbage after the last record is not replayed either
+    FILE* file = fopen("test_wal_torn.db.wal", "ab");
+    assert(file != NULL);
+    char garbage[300];
+    for (int i = 0; i < (int)sizeof(garbage); i++) {
+        garbage[i] = (char)(i * 7 + 3);
+    }
+    fwrite(garbage, 1, sizeof(garbage), file);
+    fclose(file);
+
+    db = db_open("test_wal_torn.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 110);
+    db_close(db);
+
+    printf("✓ Torn log tail test passed.\n");
+}
+
+// the type of the last record in a log file
+LogRecordType last_record_type(const char* filename) {
+    long size;
+    char* log = read_file(filename, &size);
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(LogRecordHeader));
+    for (long offset = 0; offset + (long)sizeof(LogRecordHeader) <= size; offset += header.length) {
+        memcpy(&header, log + offset, sizeof(LogRecordHeader));
+    }
+    free(log);
+    return (LogRecordType)header.type;
+}
+
+void test_checkpoint_on_close() {
+    printf("Testing close checkpoints the log...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_checkpoint.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 500);
+    db_close(db);
+    assert(last_record_type("test_wal_checkpoint.db.wal") == LOG_RECORD_TYPE_CHECKPOINT);
+
+    // the checkpoint is all that is left of the log, its lsn carries on
+    long size;
+    char* log = read_file("test_wal_checkpoint.db.wal", &size);
+    LogRecordHeader checkpoint;
+    assert(size == sizeof(LogRecordHeader));
+    memcpy(&checkpoint, log, sizeof(LogRecordHeader));
+    free(log);
+    assert(checkpoint.lsn > sizeof(LogRecordHeader) && checkpoint.tx_id > 0);
+    db = db_open("test_wal_checkpoint.db");
+    assert(db != NULL && db->wal->lsn == checkpoint.lsn && db->current_tx_id == checkpoint.tx_id);
+    insert_rows(db, "items", 501, 510);
+    db_execute(db, "BEGIN");
+    db_execute(db, "DELETE FROM items WHERE id > 500");
+    db_execute(db, "COMMIT");
+    db_close(db);
+    log = read_file("test_wal_checkpoint.db.wal", &size);
+    assert(size == sizeof(LogRecordHeader) && ((LogRecordHeader*)log)->lsn > checkpoint.lsn);
+    free(log);
+
+    // changes after the checkpoint are redone after a crash
+    db = db_open("test_wal_checkpoint.db");
+    assert(db != NULL);
+    insert_rows(db, "items", 501, 600);
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET name = 'after' WHERE id = 7");
+    db_execute(db, "COMMIT");
+    simulate_crash(db);
+    db = db_open("test_wal_checkpoint.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 600);
+    Result* result = db_execute(db, "SELECT * FROM items WHERE id = 7");
+    assert(result != NULL && strcmp(result->rows[0][1], "after") == 0);
+
+    // closing inside a transaction leaves it to recovery to undo
+    db_execute(db, "BEGIN");
+    db_execute(db, "INSERT INTO items VALUES (601, 'open', 0)");
+    db_close(db);
+    assert(last_record_type("test_wal_checkpoint.db.wal") != LOG_RECORD_TYPE_CHECKPOINT);
+    db = db_open("test_wal_checkpoint.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 600);
+    db_close(db);
+
+    printf("✓ Checkpoint test passed.\n");
+}
+
+int count_dirty_frames(BufferPool* pool) {
+    int dirty = 0;
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        dirty += pool->frames[i].is_dirty;
+    }
+    return dirty;
+}
+
+void test_select_keeps_pool_warm() {
+    printf("Testing SELECT runs against the live buffer pool...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_warm.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 200);
+
+    int dirty = count_dirty_frames(db->pool);
+    assert(dirty > 0);
+    uint32_t cached[BUFFER_POOL_SIZE];
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        cached[i] = db->pool->frames[i].page_id;
+    }
+
+    // reads neither write back dirty pages nor drop cached ones
+    assert(count_rows(db, "SELECT * FROM items") == 200);
+    assert(count_rows(db, "SELECT * FROM items WHERE id = 150") == 1);
+    assert(count_dirty_frames(db->pool) == dirty);
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        assert(db->pool->frames[i].page_id == cached[i]);
+    }
+    db_close(db);
+
+    printf("✓ Warm buffer pool test passed.\n");
+}
+
+// rows id,name,bucket for ids from..to, written out of key order
+void write_csv(const char* filename, int from, int to) {
+    FILE* file = fopen(filename, "w");
+    assert(file != NULL);
+    int count = to - from + 1;
+    for (int i = 0; i < count; i++) {
+        int id = from + (int)((int64_t)i * 7919 % count);
+        fprintf(file, "%d,name_%d,%d\n", id, id, id % 7);
+    }
+    fclose(file);
+}
+
+void test_copy_batches() {
+    printf("Testing COPY logs a record per leaf and batch...\n");
+    cleanup_test_files();
+
+    // keys landing in the same leaf are added by one change
+    Database* db = db_open("test_wal_copy.db");
+    assert(db != NULL);
+    uint32_t root_page_id = btree_create(db->pool, db->pager, db->wal);
+    int keys[1000];
+    const char* values[1000];
+    uint16_t lengths[1000];
+    for (int i = 0; i < 1000; i++) {
+        keys[i] = i * 2;
+        values[i] = "value";
+        lengths[i] = 5;
+    }
+    int num_writes = btree_insert_batch(db->pool, db->pager, db->wal, 0, root_page_id, keys, values, lengths, 1000);
+    assert(num_writes > 1 && num_writes < 100);
+    keys[0] = 1; // a new key between existing ones, then one already there
+    keys[1] = 2;
+    values[1] = "changed";
+    lengths[1] = 7;
+    assert(btree_insert_batch(db->pool, db->pager, db->wal, 0, root_page_id, keys, values, lengths, 2) == 2);
+    uint16_t length;
+    char* value = btree_search(db->pool, db->pager, root_page_id, 2, &length);
+    assert(value != NULL && length == 7 && memcmp(value, "changed", 7) == 0);
+    free(value);
+    value = btree_search(db->pool, db->pager, root_page_id, 1998, &length);
+    assert(value != NULL && length == 5);
+    free(value);
+
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    db_execute(db, "CREATE INDEX bucket_idx ON items (bucket)");
+    write_csv("test_wal_copy.csv", 1, 20000);
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY items FROM 'test_wal_copy.csv'");
+    db_execute(db, "COMMIT");
+    assert(count_rows(db, "SELECT * FROM items") == 20000);
+    Result* result = db_execute(db, "SELECT name FROM items WHERE id = 12345");
+    assert(result != NULL && strcmp(result->rows[0][0], "name_12345") == 0);
+    result = db_execute(db, "SELECT bucket FROM items WHERE bucket = 3");
+    assert(result != NULL && result->num_rows == 2857 && strcmp(result->rows[2856][0], "3") == 0);
+
+    // committed batches are redone after a crash
+    simulate_crash(db);
+    db = db_open("test_wal_copy.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 20000);
+    result = db_execute(db, "SELECT name FROM items WHERE id = 19999");
+    assert(result != NULL && strcmp(result->rows[0][0], "name_19999") == 0);
+
+    // and rolled back key by key, by ROLLBACK or by recovery
+    write_csv("test_wal_copy.csv", 20001, 25000);
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY items FROM 'test_wal_copy.csv'");
+    assert(count_rows(db, "SELECT * FROM items") == 25000);
+    db_execute(db, "ROLLBACK");
+    assert(count_rows(db, "SELECT * FROM items") == 20000);
+    db_execute(db, "BEGIN");
+    db_execute(db, "COPY items FROM 'test_wal_copy.csv'");
+    buffer_pool_flush_all(db->pool, db->pager);
+    simulate_crash(db);
+    db = db_open("test_wal_copy.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items") == 20000);
+    assert(db_execute(db, "SELECT * FROM items WHERE id = 20001") == NULL);
+    db_close(db);
+
+    printf("✓ COPY batch test passed.\n");
+}
+
+void test_ddl_recovered() {
+    printf("Testing DDL is recovered from the log...\n");
+    cleanup_test_files();
+
+    // schema changes leave their pages dirty like any other change
+    Database* db = db_open("test_wal_ddl.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 300);
+    db_execute(db, "CREATE INDEX bucket_idx ON items (bucket)");
+    db_execute(db, "CREATE UNIQUE INDEX id_idx ON items (id)");
+    db_execute(db, "DROP INDEX bucket_idx ON items");
+    db_execute(db, "ANALYZE items");
+    assert(count_dirty_frames(db->pool) > 0);
+    simulate_crash(db);
+
+    db = db_open("test_wal_ddl.db");
+    assert(db != NULL);
+    TableSchema* items = catalog_find_table(db->catalog, "items");
+    assert(items != NULL && items->num_indexes == 1 && strcmp(items->indexes[0].name, "id_idx") == 0);
+    assert(items->stats.analyzed && items->stats.num_rows == 300);
+    uint16_t length;
+    char* entry = btree_search(db->pool, db->pager, items->indexes[0].root_page_id, 250, &length);
+    assert(entry != NULL && *(int32_t*)entry == 250);
+    free(entry);
+    assert(count_rows(db, "SELECT * FROM items WHERE bucket = 3") == 43);
+    db_close(db);
+
+    printf("✓ DDL recovery test passed.\n");
+}
+
+void test_update_batches() {
+    printf("Testing UPDATE logs a record per leaf and batch...\n");
+    cleanup_test_files();
+
+    Database* db = db_open("test_wal_update.db");
+    assert(db != NULL);
+    db_execute(db, "CREATE TABLE items (id INT, name VARCHAR(50), bucket INT)");
+    insert_rows(db, "items", 1, 3000);
+    db_close(db);
+
+    // the changed rows of a leaf go into one record, which is undone a row at
+    // a time
+    db = db_open("test_wal_update.db");
+    assert(db != NULL);
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET name = 'renamed' WHERE id > 100");
+    assert(db->wal->undo.count == 2900);
+    db_execute(db, "ROLLBACK");
+    assert(count_rows(db, "SELECT * FROM items WHERE name = 'renamed'") == 0);
+    Result* result = db_execute(db, "SELECT name FROM items WHERE id = 2500");
+    assert(result != NULL && strcmp(result->rows[0][0], "name_2500") == 0);
+    db_result_free(result);
+
+    uint64_t start = db->wal->lsn;
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET name = 'renamed', bucket = 9 WHERE id > 100");
+    db_execute(db, "COMMIT");
+    assert(db->wal->lsn - start < 2900 * (uint64_t)sizeof(LogRecordHeader));
+
+    // committed batches are redone after a crash, unfinished ones undone
+    db_execute(db, "BEGIN");
+    db_execute(db, "UPDATE items SET name = 'lost' WHERE id <= 2000");
+    simulate_crash(db);
+    db = db_open("test_wal_update.db");
+    assert(db != NULL);
+    assert(count_rows(db, "SELECT * FROM items WHERE name = 'renamed'") == 2900);
+    assert(count_rows(db, "SELECT * FROM items WHERE bucket = 9") == 2900);
+    assert(count_rows(db, "SELECT * FROM items WHERE name = 'lost'") == 0);
+    result = db_execute(db, "SELECT name FROM items WHERE id = 50");
+    assert(result != NULL && strcmp(result->rows[0][0], "name_50") == 0);
+    db_result_free(result);
+    db_close(db);
+
+    printf("✓ UPDATE batch test passed.\n");
+}
+
+int main() {
+    printf("Starting WAL tests...\n\n");
+
+    test_splits_and_reopen();
+    test_crash_recovery();
+    test_rollback_not_replayed();
+    test_rollback_in_place();
+    test_unfinished_transaction_undone();
+    test_parallel_redo_matches_serial();
+    test_pool_shared_across_threads();
+    test_redo_failure();
+    test_crc32c();
+    test_torn_log_tail();
+    test_checkpoint_on_close();
+    test_select_keeps_pool_warm();
+    test_copy_batches();
+    test_ddl_recovered();
+    test_update_batches();
+
+    cleanup_test_files();
+
+    printf("\nWAL tests completed successfully!\n");
+    return 0;
+}